@@ -2,4 +2,6 @@ C:\VulkanSDK\1.3.275.0\Bin\glslangValidator.exe -V shader.vert
 
 C:\VulkanSDK\1.3.275.0\Bin\glslangValidator.exe -V shader.frag
 
+C:\VulkanSDK\1.3.275.0\Bin\glslangValidator.exe -V shader_bindless.frag -o frag_bindless.spv
+
 pause
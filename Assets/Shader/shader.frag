@@ -7,8 +7,15 @@ layout(set = 1, binding = 0) uniform sampler2D textureSampler;
 
 layout(location = 0) out vec4 outColour;
 
+/* Specialization constants, see shaderConstant_e. Each pipeline variant is folded to its own path */
+layout(constant_id = 0) const bool TEXTURED      = true;
+layout(constant_id = 1) const bool VERTEX_COLOUR = false;
+
 void
 main()
 {
-	outColour = texture(textureSampler, fragTex);
+	vec4 colour = TEXTURED ? texture(textureSampler, fragTex) : vec4(1.0);
+	if (VERTEX_COLOUR) colour.rgb *= fragCol;
+
+	outColour = colour;
 }
@@ -44,11 +44,15 @@ layout(push_constant) uniform PushModel
 layout(location = 0) out vec3 fragCol;
 layout(location = 1) out vec2 fragTex;
 
+/* Specialization constants, see shaderConstant_e. Attributes a variant does not use are not fetched */
+layout(constant_id = 0) const bool TEXTURED      = true;
+layout(constant_id = 1) const bool VERTEX_COLOUR = false;
+
 void
 main()
 {
   gl_Position = ubo_vp.proj * ubo_vp.view * push_model.model * vec4(pos, 1.0);
 	
-  fragCol = col;
-  fragTex = tex;
+  fragCol = VERTEX_COLOUR ? col : vec3(1.0);
+  fragTex = TEXTURED ? tex : vec2(0.0);
 }
@@ -0,0 +1,33 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragCol;
+layout(location = 1) in vec2 fragTex;
+
+/*
+    * Bindless textures: every texture lives in one array, bound once per frame.
+    * The array is partially bound, only the slots of loaded textures are valid.
+    * The index comes from a push constant, so it is uniform across the draw.
+*/
+layout(set = 1, binding = 0) uniform sampler2D textureSamplers[];
+
+/* The model matrix takes the first 64 bytes, used by the vertex stage. */
+layout(push_constant) uniform PushTexture
+{
+    layout(offset = 64) uint textureIndex;
+} push_texture;
+
+layout(location = 0) out vec4 outColour;
+
+/* Specialization constants, see shaderConstant_e. Each pipeline variant is folded to its own path */
+layout(constant_id = 0) const bool TEXTURED      = true;
+layout(constant_id = 1) const bool VERTEX_COLOUR = false;
+
+void
+main()
+{
+	vec4 colour = TEXTURED ? texture(textureSamplers[push_texture.textureIndex], fragTex) : vec4(1.0);
+	if (VERTEX_COLOUR) colour.rgb *= fragCol;
+
+	outColour = colour;
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "CpuProfiler.h"
+
+/*
+ * Times a PROFILE_SCOPE with the profiler stopped and running, on one thread and on several at once while the
+ * collector drains them to a file. Exits with a failure if a recorded scope costs more than the budget, or if any
+ * scope was dropped.
+ *
+ * The budget is the whole cost of a scope, its two clock reads included. A TSC read takes a few nanoseconds on hardware
+ * and several times that in a VM that traps it, which no change to the profiler can win back: with a clock that slow
+ * the budget is not checked, and the reason is printed. The cost net of the clock reads is printed either way.
+ */
+
+constexpr uint32_t BENCH_BATCH_SCOPES  = CPU_PROFILER_RING_EVENTS / 4;  // The collector drains a batch before the ring fills
+constexpr int      BENCH_BATCHES       = 64;
+constexpr uint32_t BENCH_THREADS       = 4;
+constexpr double   BENCH_BUDGET_NS     = 50.0;   // Clock reads included
+constexpr double   BENCH_SLOW_CLOCK_NS = 15.0;   // A clock read slower than this is trapped, not the hardware counter
+constexpr const char *BENCH_TRACE_FILE = "cpu_profiler_bench.json";
+
+/** @brief Keep the compiler from folding the empty loops */
+static void
+Clobber()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	_ReadWriteBarrier();
+#else
+	asm volatile("" ::: "memory");
+#endif
+}
+
+/** @brief Get the median of batch times, in nanoseconds per iteration. A batch the thread was preempted in is an outlier */
+static double
+MedianNs(std::vector<double> batchNs)
+{
+	std::ranges::sort(batchNs);
+	return batchNs[batchNs.size() / 2] / BENCH_BATCH_SCOPES;
+}
+
+/** @brief Run the batches on the calling thread, return the nanoseconds of a scope */
+static double
+TimeScopes()
+{
+	std::vector<double> batchNs;
+	for (int batch = 0; batch < BENCH_BATCHES; ++batch)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < BENCH_BATCH_SCOPES; ++i)
+		{
+			PROFILE_SCOPE("Bench");
+			Clobber();
+		}
+		batchNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+
+		// Outside of the timing: leave the collector a flush to drain the batch
+		if (CpuProfiler::IsRunning()) std::this_thread::sleep_for(std::chrono::milliseconds(CPU_PROFILER_FLUSH_MS * 2));
+	}
+	return MedianNs(std::move(batchNs));
+}
+
+/** @brief Time a read of the scope clock, a scope reads it twice */
+static double
+TimeClock()
+{
+	[[maybe_unused]] static volatile uint64_t sink = 0;
+
+	std::vector<double> batchNs;
+	for (int batch = 0; batch < BENCH_BATCHES; ++batch)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < BENCH_BATCH_SCOPES; ++i) sink = CpuProfiler::ReadTicks();
+		batchNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+	}
+	return MedianNs(std::move(batchNs));
+}
+
+/** @brief Run the batches on a number of threads at once, return the worst nanoseconds of a scope */
+static double
+TimeScopesOnThreads(uint32_t threadCount)
+{
+	std::vector<double>      results(threadCount, 0.0);
+	std::vector<std::thread> threads;
+	for (uint32_t i = 0; i < threadCount; ++i)
+	{
+		threads.emplace_back([&results, i]() -> void { results[i] = TimeScopes(); });
+	}
+	for (std::thread &thread : threads) thread.join();
+
+	return *std::ranges::max_element(results);
+}
+
+int
+main()
+{
+#if !ENABLE_CPU_PROFILER
+	fprintf(stdout, "CPU profiler compiled out, nothing to time\n");
+	return EXIT_SUCCESS;
+#endif
+
+	// Empty loop, what every other number includes
+	double loopNs = 0.0;
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < BENCH_BATCH_SCOPES * BENCH_BATCHES; ++i) Clobber();
+		loopNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+		         (static_cast<double>(BENCH_BATCHES) * BENCH_BATCH_SCOPES);
+	}
+
+	const double clockNs   = TimeClock();
+	const double stoppedNs = TimeScopes();
+
+	// No more threads than cores, a thread waiting for a core is not what is measured
+	const uint32_t threadCount = std::clamp(std::thread::hardware_concurrency(), 1u, BENCH_THREADS);
+
+	if (!CpuProfiler::Start(BENCH_TRACE_FILE)) return EXIT_FAILURE;
+	const double runningNs = TimeScopes();
+	const double threadsNs = TimeScopesOnThreads(threadCount);
+	const uint64_t dropped = CpuProfiler::GetDroppedScopes();
+	CpuProfiler::Stop();
+
+	// Every iteration includes the loop, each clock read was timed with its own loop around it
+	const double readNs  = clockNs - loopNs;
+	const double worstNs = std::max(runningNs, threadsNs) - loopNs;
+	const double netNs   = worstNs - 2.0 * readNs;
+
+	fprintf(stdout, "%-28s %8.2f ns\n", "Empty loop", loopNs);
+	fprintf(stdout, "%-28s %8.2f ns (two per scope)\n", "Clock read", readNs);
+	fprintf(stdout, "%-28s %8.2f ns\n", "Scope, profiler stopped", stoppedNs - loopNs);
+	fprintf(stdout, "%-28s %8.2f ns\n", "Scope, 1 thread", runningNs - loopNs);
+	fprintf(stdout, "%-28s %8.2f ns (worst thread of %u)\n", "Scope, threads at once", threadsNs - loopNs, threadCount);
+	fprintf(stdout, "%-28s %8.2f ns (worst scope minus two clock reads)\n", "Profiler cost", netNs);
+
+	bool bPassed = true;
+	if (readNs > BENCH_SLOW_CLOCK_NS)
+	{
+		fprintf(stdout, "Budget not checked: a clock read takes %.2f ns, over %.0f ns the counter is trapped, as in a VM\n",
+		        readNs, BENCH_SLOW_CLOCK_NS);
+	}
+	else if (worstNs > BENCH_BUDGET_NS)
+	{
+		fprintf(stderr, "A scope costs %.2f ns, over the %.0f ns budget\n", worstNs, BENCH_BUDGET_NS);
+		bPassed = false;
+	}
+	if (dropped != 0)
+	{
+		fprintf(stderr, "%llu scopes dropped, the collector fell behind\n", static_cast<unsigned long long>(dropped));
+		bPassed = false;
+	}
+
+	std::remove(BENCH_TRACE_FILE);
+	return bPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ImageKernels.h"
+
+/*
+ * Times every image kernel at each instruction set this CPU supports, and checks each result against the scalar one,
+ * and that sRGB downsamples keep alpha linear. Exits with a failure if any byte differs.
+ */
+
+constexpr uint32_t BENCH_WIDTH      = 2048;
+constexpr uint32_t BENCH_HEIGHT     = 2048;
+constexpr int      BENCH_ITERATIONS = 10;
+
+/**
+ * @struct benchCase_t
+ * @brief A kernel run on fresh inputs, with its output bytes to compare
+ */
+typedef struct benchCase_t
+{
+	const char                  *name        { nullptr };
+	double                       megapixels  { 0.0 };
+	std::function<void()>        reset       { };   // Restore the inputs, outside of the timing
+	std::function<void()>        run         { };
+	std::function<std::vector<uint8_t>()> result { };
+} benchCase_t;
+
+
+/** @brief Run a case at a level, return the best time of the iterations in milliseconds */
+static double
+TimeCase(const benchCase_t &bench, imageKernelLevel_e level)
+{
+	SetImageKernelLevel(level);
+
+	double best = 1e30;
+	for (int i = 0; i < BENCH_ITERATIONS; ++i)
+	{
+		bench.reset();
+
+		const auto start = std::chrono::steady_clock::now();
+		bench.run();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		best = std::min(best, ms);
+	}
+	return best;
+}
+
+int
+main()
+{
+	const size_t pixels = static_cast<size_t>(BENCH_WIDTH) * BENCH_HEIGHT;
+
+	std::mt19937 random(1234);
+	auto randomBytes = [&](size_t size) -> std::vector<uint8_t>
+	{
+		std::vector<uint8_t> bytes(size);
+		for (auto &byte : bytes) byte = static_cast<uint8_t>(random());
+		return bytes;
+	};
+
+	const std::vector<uint8_t> rgb  = randomBytes(pixels * 3);
+	const std::vector<uint8_t> rgba = randomBytes(pixels * 4);
+
+	// Linear values over the whole range, plus some out of it to check the clamping
+	std::vector<float> linear(pixels);
+	for (size_t i = 0; i < pixels; ++i) linear[i] = static_cast<float>(random() % 11000) / 10000.0f - 0.05f;
+
+	std::vector<uint8_t> outBytes;
+	std::vector<float>   outFloats;
+	std::vector<uint8_t> work;
+
+	std::vector<benchCase_t> cases;
+
+	cases.push_back(
+	{
+		.name       = "ExpandRGBToRGBA",
+		.megapixels = static_cast<double>(pixels) / 1e6,
+		.reset      = [&]() { outBytes.assign(pixels * 4, 0); },
+		.run        = [&]() { ExpandRGBToRGBA(rgb.data(), outBytes.data(), pixels); },
+		.result     = [&]() { return outBytes; }
+	});
+
+	cases.push_back(
+	{
+		.name       = "PremultiplyAlpha",
+		.megapixels = static_cast<double>(pixels) / 1e6,
+		.reset      = [&]() { work = rgba; },
+		.run        = [&]() { PremultiplyAlpha(work.data(), pixels); },
+		.result     = [&]() { return work; }
+	});
+
+	cases.push_back(
+	{
+		.name       = "ConvertSRGBToLinear",
+		.megapixels = static_cast<double>(pixels) / 1e6,
+		.reset      = [&]() { outFloats.assign(pixels, 0.0f); },
+		.run        = [&]() { ConvertSRGBToLinear(rgba.data(), outFloats.data(), pixels); },
+		.result     = [&]()
+		{
+			std::vector<uint8_t> bytes(outFloats.size() * sizeof(float));
+			memcpy(bytes.data(), outFloats.data(), bytes.size());
+			return bytes;
+		}
+	});
+
+	cases.push_back(
+	{
+		.name       = "ConvertLinearToSRGB",
+		.megapixels = static_cast<double>(pixels) / 1e6,
+		.reset      = [&]() { outBytes.assign(pixels, 0); },
+		.run        = [&]() { ConvertLinearToSRGB(linear.data(), outBytes.data(), pixels); },
+		.result     = [&]() { return outBytes; }
+	});
+
+	for (uint32_t channels : { 1u, 2u, 4u })
+	{
+		static const char *names[] = { "", "DownsampleTexels R8", "DownsampleTexels R8G8", "", "DownsampleTexels RGBA8" };
+
+		cases.push_back(
+		{
+			.name       = names[channels],
+			.megapixels = static_cast<double>(pixels) / 1e6,
+			.reset      = [&, channels]() { outBytes.assign(pixels * channels / 4, 0); },
+			.run        = [&, channels]()
+			{
+				DownsampleTexels(rgba.data(), BENCH_WIDTH, BENCH_HEIGHT, outBytes.data(), BENCH_WIDTH / 2, BENCH_HEIGHT / 2, channels, false);
+			},
+			.result     = [&]() { return outBytes; }
+		});
+	}
+
+	// Odd sizes take the general box filter, and the SIMD tails
+	cases.push_back(
+	{
+		.name       = "DownsampleTexels RGBA8 odd",
+		.megapixels = static_cast<double>(( BENCH_WIDTH - 1 ) * ( BENCH_HEIGHT - 1 )) / 1e6,
+		.reset      = [&]() { outBytes.assign(static_cast<size_t>(BENCH_WIDTH / 2 - 1) * ( BENCH_HEIGHT / 2 - 1 ) * 4, 0); },
+		.run        = [&]()
+		{
+			DownsampleTexels(rgba.data(), BENCH_WIDTH - 1, BENCH_HEIGHT - 1, outBytes.data(), BENCH_WIDTH / 2 - 1, BENCH_HEIGHT / 2 - 1, 4, false);
+		},
+		.result     = [&]() { return outBytes; }
+	});
+
+	for (uint32_t channels : { 2u, 4u })
+	{
+		static const char *names[] = { "", "", "DownsampleTexels sRGB R8G8", "", "DownsampleTexels sRGB8_A8" };
+
+		cases.push_back(
+		{
+			.name       = names[channels],
+			.megapixels = static_cast<double>(pixels) / 1e6,
+			.reset      = [&, channels]() { outBytes.assign(pixels * channels / 4, 0); },
+			.run        = [&, channels]()
+			{
+				DownsampleTexels(rgba.data(), BENCH_WIDTH, BENCH_HEIGHT, outBytes.data(), BENCH_WIDTH / 2, BENCH_HEIGHT / 2, channels, true);
+			},
+			.result     = [&]() { return outBytes; }
+		});
+	}
+
+	const imageKernelLevel_e supported = GetSupportedImageKernelLevel();
+	fprintf(stdout, "[INFO] Image kernels: %ux%u, best of %d runs, up to %s\n",
+	        BENCH_WIDTH, BENCH_HEIGHT, BENCH_ITERATIONS, GetImageKernelLevelName(supported));
+
+	bool bFailed = false;
+	for (const auto &bench : cases)
+	{
+		const double               scalarMs  = TimeCase(bench, IMAGE_KERNEL_SCALAR);
+		const std::vector<uint8_t> reference = bench.result();
+
+		fprintf(stdout, "%-28s %-6s %8.2f ms/MP\n", bench.name, GetImageKernelLevelName(IMAGE_KERNEL_SCALAR), scalarMs / bench.megapixels);
+
+		for (int level = IMAGE_KERNEL_SSE2; level <= supported; ++level)
+		{
+			const double ms     = TimeCase(bench, static_cast<imageKernelLevel_e>(level));
+			const bool   bMatch = bench.result() == reference;
+
+			fprintf(stdout, "%-28s %-6s %8.2f ms/MP  x%.2f  %s\n", bench.name, GetImageKernelLevelName(static_cast<imageKernelLevel_e>(level)),
+			        ms / bench.megapixels, scalarMs / ms, bMatch ? "match" : "MISMATCH");
+
+			bFailed |= !bMatch;
+		}
+	}
+
+	// Alpha, the last channel of R8G8 and RGBA, is averaged as it is: sRGB pixels must hold the alpha of UNORM ones,
+	// for exact halves and for the general box filter, at every level
+	bool bAlphaFailed = false;
+	for (int level = IMAGE_KERNEL_SCALAR; level <= supported; ++level)
+	{
+		SetImageKernelLevel(static_cast<imageKernelLevel_e>(level));
+
+		for (uint32_t channels : { 2u, 4u })
+		{
+			for (uint32_t shrink : { 0u, 1u })
+			{
+				const uint32_t srcWidth  = BENCH_WIDTH - shrink,     srcHeight = BENCH_HEIGHT - shrink;
+				const uint32_t dstWidth  = BENCH_WIDTH / 2 - shrink, dstHeight = BENCH_HEIGHT / 2 - shrink;
+				const size_t   dstBytes  = static_cast<size_t>(dstWidth) * dstHeight * channels;
+
+				std::vector<uint8_t> srgb(dstBytes), unorm(dstBytes);
+				DownsampleTexels(rgba.data(), srcWidth, srcHeight, srgb.data(), dstWidth, dstHeight, channels, true);
+				DownsampleTexels(rgba.data(), srcWidth, srcHeight, unorm.data(), dstWidth, dstHeight, channels, false);
+
+				bool bMatch = true;
+				for (size_t i = channels - 1; i < dstBytes && bMatch; i += channels) bMatch = srgb[i] == unorm[i];
+
+				fprintf(stdout, "%-28s %-6s sRGB alpha %s%s\n", channels == 2 ? "DownsampleTexels R8G8" : "DownsampleTexels RGBA8",
+				        GetImageKernelLevelName(static_cast<imageKernelLevel_e>(level)), bMatch ? "match" : "MISMATCH", shrink ? ", odd" : "");
+
+				bAlphaFailed |= !bMatch;
+			}
+		}
+	}
+
+	if (bFailed) fprintf(stderr, "[ERROR] A SIMD kernel differs from the scalar one\n");
+	if (bAlphaFailed) fprintf(stderr, "[ERROR] An sRGB downsample changed the alpha\n");
+	bFailed |= bAlphaFailed;
+
+	return bFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
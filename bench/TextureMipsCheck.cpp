@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+#include "TextureMips.h"
+
+/*
+ * Cooks grey plus alpha texels as colour and as data, round trips them through a mip file and the format conversion,
+ * and checks that alpha comes back unchanged. Exits with a failure if it does not.
+ */
+
+/** @brief Alpha of a texel of a level: the last channel, wherever the format puts it */
+static uint8_t
+GetAlpha(const textureMipChain_t &chain, uint32_t level, uint32_t texel)
+{
+	const uint32_t channels = GetFormatChannels(chain.format);
+	return chain.pixels[chain.levels[level].offset + static_cast<size_t>(texel) * channels + channels - 1];
+}
+
+/** @brief Check the alpha of every level 0 texel, and of the 1x1 average of the 2x2 block */
+static bool
+CheckAlpha(const char *label, const textureMipChain_t &chain, const uint8_t *alpha, uint8_t averageAlpha)
+{
+	bool bMatch = chain.levels.size() == 2 && GetAlpha(chain, 1, 0) == averageAlpha;
+	for (uint32_t texel = 0; texel < 4 && bMatch; ++texel) bMatch = GetAlpha(chain, 0, texel) == alpha[texel];
+
+	fprintf(stdout, "%-36s %s\n", label, bMatch ? "match" : "MISMATCH");
+	return bMatch;
+}
+
+int
+main()
+{
+	// 2x2 grey plus alpha, alpha averaged as it is: (0 + 255 + 64 + 200 + 2) / 4
+	const uint8_t alpha[4]     = { 0, 255, 64, 200 };
+	const uint8_t averageAlpha = 130;
+	const uint8_t pixels[8]    = { 200, alpha[0], 200, alpha[1], 50, alpha[2], 50, alpha[3] };
+
+	const std::string filePath = ( std::filesystem::temp_directory_path() / "TextureMipsCheck.mips" ).string();
+
+	bool bFailed = false;
+	for (bool bColor : { true, false })
+	{
+		textureMipChain_t chain;
+		BuildTextureMipChain(pixels, 2, 2, 2, bColor, &chain);
+
+		// sRGB colour must not keep alpha in a channel the sampler decodes
+		const VkFormat expected = bColor ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8_UNORM;
+		if (chain.format != expected)
+		{
+			fprintf(stdout, "%-36s MISMATCH (format %d)\n", bColor ? "Colour format" : "Data format", chain.format);
+			bFailed = true;
+			continue;
+		}
+
+		bFailed |= !CheckAlpha(bColor ? "Colour cooked" : "Data cooked", chain, alpha, averageAlpha);
+
+		textureMipChain_t read;
+		if (!WriteMipFile(filePath, chain) || !ReadMipFile(filePath, &read))
+		{
+			fprintf(stdout, "%-36s MISMATCH (mip file)\n", bColor ? "Colour mip file" : "Data mip file");
+			bFailed = true;
+			continue;
+		}
+		bFailed |= !CheckAlpha(bColor ? "Colour mip file" : "Data mip file", read, alpha, averageAlpha);
+
+		// What the loader does on a device without R8G8, or with a UNORM swap chain
+		ConvertMipChain(&read, VK_FORMAT_R8G8B8A8_UNORM);
+		bFailed |= !CheckAlpha(bColor ? "Colour relabelled UNORM" : "Data widened to RGBA", read, alpha, averageAlpha);
+	}
+
+	std::error_code error;
+	std::filesystem::remove(filePath, error);
+
+	if (bFailed) fprintf(stderr, "[ERROR] Grey plus alpha texels lost their alpha\n");
+
+	return bFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
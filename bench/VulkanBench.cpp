@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "VulkanRenderer.h"
+
+/*
+ * Draws a synthetic scene headless for a fixed number of frames and reports the CPU and GPU frame times, the draws,
+ * the upload bandwidth and the device memory, on stdout and as JSON. Needs no display, any Vulkan driver will do:
+ * a software one such as lavapipe is picked with VK_ICD_FILENAMES.
+ *
+ * Options, each followed by its value
+ *   --meshes <count>          Meshes drawn
+ *   --instancing <ratio>      Meshes drawing the same vertex and index buffers, 1 uploads every mesh
+ *   --textures <count>        Unique textures, 0 draws untextured
+ *   --texture-size <pixels>   Side of the textures
+ *   --triangles <count>       Triangles of a mesh, rounded up to a square grid
+ *   --update-rate <fraction>  Part of the meshes moved every frame
+ *   --frames <count>          Frames measured
+ *   --warmup <count>          Frames drawn before measuring
+ *   --size <width>x<height>   Size of the offscreen images
+ *   --json <file>             Report file, "none" to only print it
+ *   --seed <value>            Seed of the texture patterns
+ */
+
+/** @brief Scene and run settings */
+typedef struct benchConfig_t
+{
+	uint32_t    meshes        { 1000 };
+	uint32_t    instancing    { 1 };
+	uint32_t    textures      { 16 };
+	uint32_t    textureSize   { 256 };
+	uint32_t    triangles     { 128 };
+	double      updateRate    { 1.0 };
+	uint32_t    frames        { 1000 };
+	uint32_t    warmup        { 30 };
+	uint32_t    width         { 1280 };
+	uint32_t    height        { 720 };
+	std::string jsonPath      { "vulkan_bench.json" };
+	uint32_t    seed          { 1 };
+} benchConfig_t;
+
+/** @brief Distribution of a frame time, in milliseconds */
+typedef struct frameTimeStats_t
+{
+	size_t samples { 0 };
+	double p50     { 0.0 };
+	double p95     { 0.0 };
+	double p99     { 0.0 };
+	double max     { 0.0 };
+	double mean    { 0.0 };
+} frameTimeStats_t;
+
+/** @brief Bytes uploaded and the time they took, decoding included */
+typedef struct uploadStats_t
+{
+	VkDeviceSize bytes { 0 };
+	double       ms    { 0.0 };
+} uploadStats_t;
+
+/** @brief Folder the textures are generated in, relative to TEXTURE_DIRECTORY */
+constexpr const char *BENCH_TEXTURE_FOLDER = "Bench/";
+
+/** @brief Distance of the scene plane from the camera, the whole grid fits the view at it */
+constexpr float BENCH_SCENE_DISTANCE = 10.0f;
+
+VulkanRenderer vulkanRenderer;
+
+/** @brief Read a size written as <width>x<height>, both above 0 */
+static bool
+ParseSize(const char *value, uint32_t *outWidth, uint32_t *outHeight)
+{
+	return std::sscanf(value, "%ux%u", outWidth, outHeight) == 2 && *outWidth > 0 && *outHeight > 0;
+}
+
+/** @brief Read the options into a configuration. False on an unknown option or a value out of range */
+static bool
+ParseOptions(int argc, char *argv[], benchConfig_t *outConfig)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string option = argv[i];
+		const char       *value  = argv[i + 1];
+
+		if (option == "--meshes") outConfig->meshes = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--instancing") outConfig->instancing = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--textures") outConfig->textures = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--texture-size") outConfig->textureSize = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--triangles") outConfig->triangles = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--update-rate") outConfig->updateRate = std::atof(value);
+		else if (option == "--frames") outConfig->frames = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--warmup") outConfig->warmup = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else if (option == "--size" && ParseSize(value, &outConfig->width, &outConfig->height)) { }
+		else if (option == "--json") outConfig->jsonPath = value;
+		else if (option == "--seed") outConfig->seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+		else
+		{
+			fprintf(stderr, "[ERROR] Unknown option '%s %s'\n", option.c_str(), value);
+			return false;
+		}
+	}
+
+	if (outConfig->meshes == 0 || outConfig->instancing == 0 || outConfig->triangles == 0 || outConfig->frames == 0 ||
+	    outConfig->textureSize == 0 || outConfig->updateRate < 0.0 || outConfig->updateRate > 1.0)
+	{
+		fprintf(stderr, "[ERROR] Meshes, instancing, triangles, texture size and frames must be above 0, the update rate in [0, 1]\n");
+		return false;
+	}
+
+	// Without bindless textures the renderer has descriptor sets for this many
+	if (outConfig->textures > MAX_OBJECTS)
+	{
+		fprintf(stderr, "[ERROR] At most %d textures\n", MAX_OBJECTS);
+		return false;
+	}
+	return true;
+}
+
+/** @brief Name of a generated texture, relative to TEXTURE_DIRECTORY */
+static std::string
+GetTextureName(uint32_t index)
+{
+	return std::string(BENCH_TEXTURE_FOLDER) + "bench_" + std::to_string(index) + ".ppm";
+}
+
+/**
+ * @brief Write checkerboards of seeded colours as binary PPM files the renderer loads like any other texture
+ * @details Files rather than memory: evicted textures stream back in from their file
+ */
+static bool
+WriteTextures(const benchConfig_t &config)
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::string(TEXTURE_DIRECTORY) + BENCH_TEXTURE_FOLDER, error);
+	if (error) return false;
+
+	std::mt19937 random(config.seed);
+	std::vector<uint8_t> pixels(static_cast<size_t>(config.textureSize) * config.textureSize * 3);
+	for (uint32_t t = 0; t < config.textures; ++t)
+	{
+		uint8_t colors[2][3];
+		for (auto &color : colors) for (uint8_t &channel : color) channel = static_cast<uint8_t>(random() & 0xFF);
+		const uint32_t cell = std::max(1u, config.textureSize >> (2 + random() % 4));
+
+		for (uint32_t y = 0; y < config.textureSize; ++y)
+		{
+			for (uint32_t x = 0; x < config.textureSize; ++x)
+			{
+				const uint8_t *color = colors[( x / cell + y / cell ) & 1];
+				uint8_t       *pixel = &pixels[( static_cast<size_t>(y) * config.textureSize + x ) * 3];
+				pixel[0] = color[0];
+				pixel[1] = color[1];
+				pixel[2] = color[2];
+			}
+		}
+
+		std::ofstream file(TEXTURE_DIRECTORY + GetTextureName(t), std::ios::binary);
+		file << "P6\n" << config.textureSize << " " << config.textureSize << "\n255\n";
+		file.write(reinterpret_cast<const char *>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+		if (!file) return false;
+	}
+	return true;
+}
+
+/** @brief Build a unit square in XY, centred on the origin, split into a grid of at least the triangles asked for */
+static void
+BuildGrid(uint32_t triangles, std::vector<vertex_t> *outVertices, std::vector<uint32_t> *outIndices)
+{
+	const uint32_t side = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(triangles / 2.0))));
+
+	outVertices->clear();
+	outIndices->clear();
+	for (uint32_t y = 0; y <= side; ++y)
+	{
+		for (uint32_t x = 0; x <= side; ++x)
+		{
+			const float u = static_cast<float>(x) / static_cast<float>(side);
+			const float v = static_cast<float>(y) / static_cast<float>(side);
+			outVertices->push_back({ .pos = { u - 0.5f, v - 0.5f, 0.0f }, .color = { u, v, 1.0f - u }, .texCoord = { u, v } });
+		}
+	}
+	for (uint32_t y = 0; y < side; ++y)
+	{
+		for (uint32_t x = 0; x < side; ++x)
+		{
+			const uint32_t corner = y * ( side + 1 ) + x;
+			outIndices->insert(outIndices->end(), { corner, corner + side + 1, corner + 1,
+			                                        corner + 1, corner + side + 1, corner + side + 2 });
+		}
+	}
+}
+
+/** @brief Place a mesh in a grid filling the view, turned by an angle */
+static glm::mat4
+GetMeshModel(uint32_t meshIndex, uint32_t meshCount, float aspect, float angle)
+{
+	const float    viewHeight = 2.0f * ( BENCH_SCENE_DISTANCE * std::tan(glm::radians(22.5f)) );
+	const float    viewWidth  = viewHeight * aspect;
+	const uint32_t columns    = std::max(1u, static_cast<uint32_t>(std::ceil(std::sqrt(meshCount * aspect))));
+	const uint32_t rows       = ( meshCount + columns - 1 ) / columns;
+	const float    cell       = std::min(viewWidth / static_cast<float>(columns), viewHeight / static_cast<float>(rows));
+
+	const glm::vec3 position =
+	{
+		( static_cast<float>(meshIndex % columns) - 0.5f * static_cast<float>(columns - 1) ) * cell,
+		( static_cast<float>(meshIndex / columns) - 0.5f * static_cast<float>(rows - 1) ) * cell,
+		2.0f - BENCH_SCENE_DISTANCE
+	};
+
+	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+	model = glm::rotate(model, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+	return glm::scale(model, glm::vec3(cell * 0.9f));
+}
+
+/** @brief Sort the samples and read the percentiles, nearest rank */
+static frameTimeStats_t
+GetFrameTimeStats(std::vector<double> samples)
+{
+	frameTimeStats_t stats;
+	if (samples.empty()) return stats;
+
+	std::ranges::sort(samples);
+	const auto percentile = [&samples](double p) -> double
+	{
+		const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size())));
+		return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+	};
+
+	stats.samples = samples.size();
+	stats.p50     = percentile(50.0);
+	stats.p95     = percentile(95.0);
+	stats.p99     = percentile(99.0);
+	stats.max     = samples.back();
+	for (const double sample : samples) stats.mean += sample;
+	stats.mean   /= static_cast<double>(samples.size());
+	return stats;
+}
+
+/** @brief Megabytes per second of an upload, 0 when it took no time */
+static double
+GetBandwidthMBps(const uploadStats_t &upload)
+{
+	return upload.ms > 0.0 ? static_cast<double>(upload.bytes) / ( 1024.0 * 1024.0 ) / ( upload.ms / 1000.0 ) : 0.0;
+}
+
+/** @brief Print a frame time distribution as a table row */
+static void
+PrintFrameTimes(const char *label, const frameTimeStats_t &stats)
+{
+	fprintf(stdout, "%-12s %8.3f %8.3f %8.3f %8.3f %8.3f %8zu\n", label, stats.p50, stats.p95, stats.p99, stats.max, stats.mean,
+	        stats.samples);
+}
+
+/** @brief Write a frame time distribution as a JSON object */
+static void
+WriteFrameTimes(FILE *file, const char *name, const frameTimeStats_t &stats, const char *separator)
+{
+	fprintf(file, "  \"%s\": { \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"mean\": %.4f, \"samples\": %zu }%s\n",
+	        name, stats.p50, stats.p95, stats.p99, stats.max, stats.mean, stats.samples, separator);
+}
+
+/** @brief Write the report as JSON. False if the file cannot be written */
+static bool
+WriteJson(const std::string &path, const benchConfig_t &config, const std::string &deviceName, uint32_t uniqueMeshes,
+          const frameTimeStats_t &cpuStats, const frameTimeStats_t &gpuStats, const uploadStats_t &meshUpload,
+          const uploadStats_t &textureUpload, const overlayStats_t &frameStats)
+{
+	FILE *file = std::fopen(path.c_str(), "w");
+	if (!file) return false;
+
+	// Device names are plain, only quotes and backslashes need escaping
+	std::string escapedName;
+	for (const char c : deviceName)
+	{
+		if (c == '"' || c == '\\') escapedName += '\\';
+		escapedName += c;
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"device\": \"%s\",\n", escapedName.c_str());
+	fprintf(file, "  \"scene\": { \"meshes\": %u, \"uniqueMeshes\": %u, \"textures\": %u, \"textureSize\": %u, "
+	              "\"trianglesPerMesh\": %u, \"updateRate\": %.3f, \"width\": %u, \"height\": %u, \"frames\": %u, "
+	              "\"warmup\": %u, \"seed\": %u },\n",
+	        config.meshes, uniqueMeshes, config.textures, config.textureSize, config.triangles, config.updateRate,
+	        config.width, config.height, config.frames, config.warmup, config.seed);
+	WriteFrameTimes(file, "cpuFrameMs", cpuStats, ",");
+	WriteFrameTimes(file, "gpuFrameMs", gpuStats, ",");
+	fprintf(file, "  \"draws\": { \"drawCalls\": %u, \"instances\": %u, \"triangles\": %llu },\n", frameStats.draws.drawCalls,
+	        frameStats.draws.instances, static_cast<unsigned long long>(frameStats.draws.triangles));
+	fprintf(file, "  \"upload\": { \"meshBytes\": %llu, \"meshMs\": %.3f, \"meshMBps\": %.2f, "
+	              "\"textureBytes\": %llu, \"textureMs\": %.3f, \"textureMBps\": %.2f },\n",
+	        static_cast<unsigned long long>(meshUpload.bytes), meshUpload.ms, GetBandwidthMBps(meshUpload),
+	        static_cast<unsigned long long>(textureUpload.bytes), textureUpload.ms, GetBandwidthMBps(textureUpload));
+	fprintf(file, "  \"memory\": { \"textureBytes\": %llu, \"meshBytes\": %llu, \"uniformBytes\": %llu, "
+	              "\"depthBytes\": %llu, \"stagingBytes\": %llu }\n",
+	        static_cast<unsigned long long>(frameStats.textureBytes), static_cast<unsigned long long>(frameStats.meshBytes),
+	        static_cast<unsigned long long>(frameStats.uniformBytes), static_cast<unsigned long long>(frameStats.depthBytes),
+	        static_cast<unsigned long long>(frameStats.stagingBytes));
+	fprintf(file, "}\n");
+
+	return std::fclose(file) == 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	benchConfig_t config;
+	if (!ParseOptions(argc, argv, &config)) return EXIT_FAILURE;
+
+	if (config.textures > 0 && !WriteTextures(config))
+	{
+		fprintf(stderr, "[ERROR] Failed to write the bench textures to '%s%s'\n", TEXTURE_DIRECTORY, BENCH_TEXTURE_FOLDER);
+		return EXIT_FAILURE;
+	}
+
+	// Generated files go whatever happens, the cooked mips included
+	const auto removeTextures = []() -> void
+	{
+		std::error_code error;
+		std::filesystem::remove_all(std::string(TEXTURE_DIRECTORY) + BENCH_TEXTURE_FOLDER, error);
+		std::filesystem::remove_all(std::string(TEXTURE_COOKED_DIRECTORY) + BENCH_TEXTURE_FOLDER, error);
+	};
+
+	if (vulkanRenderer.InitHeadless(config.width, config.height) != EXIT_SUCCESS)
+	{
+		removeTextures();
+		return EXIT_FAILURE;
+	}
+
+	const uint32_t uniqueMeshes = ( config.meshes + config.instancing - 1 ) / config.instancing;
+	const float    aspect       = static_cast<float>(config.width) / static_cast<float>(config.height);
+
+	uploadStats_t meshUpload, textureUpload;
+	std::vector<double> cpuFrameMs, gpuFrameMs;
+	overlayStats_t frameStats;
+	bool bPassed = true;
+	try
+	{
+		// ------------------------------------------- Textures -------------------------------------------
+		std::vector<TextureHandle> textures;
+		const auto textureStart = std::chrono::steady_clock::now();
+		for (uint32_t t = 0; t < config.textures; ++t) textures.push_back(vulkanRenderer.CreateTextureAsync(GetTextureName(t)));
+
+		// ------------------------------------------- Meshes -------------------------------------------
+		// Instances follow the mesh they share buffers with, consecutive draws keep them bound
+		std::vector<vertex_t> vertices;
+		std::vector<uint32_t> indices;
+		BuildGrid(config.triangles, &vertices, &indices);
+
+		const auto meshStart = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < config.meshes; ++i)
+		{
+			const TextureHandle texture = textures.empty() ? -1 : textures[i % textures.size()];
+			if (i % config.instancing == 0)
+			{
+				vulkanRenderer.AddMesh(vertices, indices, texture);
+				meshUpload.bytes += vertices.size() * sizeof(vertex_t) + indices.size() * sizeof(uint32_t);
+			}
+			else vulkanRenderer.AddMeshInstance(i - i % config.instancing, texture);
+
+			vulkanRenderer.UpdateModel(i, GetMeshModel(i, config.meshes, aspect, 0.0f));
+		}
+		meshUpload.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - meshStart).count();
+
+		// Decoded on the workers while the meshes uploaded, measured from the first request
+		vulkanRenderer.WaitForTextures();
+		textureUpload.ms    = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - textureStart).count();
+		textureUpload.bytes = vulkanRenderer.GetTextureFormatStats().bytes;
+
+		// ------------------------------------------- Frames -------------------------------------------
+		const uint32_t updatesPerFrame = static_cast<uint32_t>(std::ceil(config.updateRate * config.meshes));
+		uint32_t       nextUpdate      = 0;
+		uint64_t       lastGpuFrame    = 0;
+		bool           bGpuFrameSeen   = false;
+
+		cpuFrameMs.reserve(config.frames);
+		for (uint32_t frame = 0; frame < config.warmup + config.frames; ++frame)
+		{
+			const auto frameStart = std::chrono::steady_clock::now();
+
+			// The moved meshes roll through the scene, every mesh moves as often
+			const float angle = std::fmod(static_cast<float>(frame), 360.0f);
+			for (uint32_t u = 0; u < updatesPerFrame; ++u)
+			{
+				vulkanRenderer.UpdateModel(nextUpdate, GetMeshModel(nextUpdate, config.meshes, aspect, angle));
+				nextUpdate = ( nextUpdate + 1 ) % config.meshes;
+			}
+
+			vulkanRenderer.Draw();
+
+			const bool bMeasured = frame >= config.warmup;
+			if (bMeasured)
+			{
+				cpuFrameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+			}
+
+			// Read back frames in flight later, only the ones not seen yet
+			for (const gpuFrameTiming_t &timing : vulkanRenderer.GetGpuFrameTimings())
+			{
+				if (bGpuFrameSeen && timing.frameNumber <= lastGpuFrame) continue;
+				if (bMeasured) gpuFrameMs.push_back(timing.gpuMs);
+				lastGpuFrame  = timing.frameNumber;
+				bGpuFrameSeen = true;
+			}
+		}
+
+		frameStats = vulkanRenderer.GetFrameStats();
+	}
+	catch (const std::runtime_error &e)
+	{
+		fprintf(stderr, "[ERROR] %s\n", e.what());
+		bPassed = false;
+	}
+
+	const std::string deviceName = vulkanRenderer.GetDeviceName();
+	vulkanRenderer.Cleanup();
+	removeTextures();
+	if (!bPassed) return EXIT_FAILURE;
+
+	const frameTimeStats_t cpuStats = GetFrameTimeStats(std::move(cpuFrameMs));
+	const frameTimeStats_t gpuStats = GetFrameTimeStats(std::move(gpuFrameMs));
+
+	// ------------------------------------------- Report -------------------------------------------
+	fprintf(stdout, "Device      %s\n", deviceName.c_str());
+	fprintf(stdout, "Scene       %u meshes (%u unique), %u textures of %u px, %u triangles per mesh, %.0f%% moved per frame, %ux%u\n",
+	        config.meshes, uniqueMeshes, config.textures, config.textureSize, config.triangles, config.updateRate * 100.0,
+	        config.width, config.height);
+	fprintf(stdout, "\n%-12s %8s %8s %8s %8s %8s %8s\n", "Frame (ms)", "p50", "p95", "p99", "max", "mean", "samples");
+	PrintFrameTimes("CPU", cpuStats);
+	PrintFrameTimes("GPU", gpuStats);
+	fprintf(stdout, "\nDraws       %u draw calls, %u instances, %llu triangles per frame\n", frameStats.draws.drawCalls,
+	        frameStats.draws.instances, static_cast<unsigned long long>(frameStats.draws.triangles));
+	fprintf(stdout, "Upload      meshes %.2f MiB in %.1f ms (%.1f MiB/s), textures %.2f MiB in %.1f ms (%.1f MiB/s, decoding included)\n",
+	        static_cast<double>(meshUpload.bytes) / ( 1024.0 * 1024.0 ), meshUpload.ms, GetBandwidthMBps(meshUpload),
+	        static_cast<double>(textureUpload.bytes) / ( 1024.0 * 1024.0 ), textureUpload.ms, GetBandwidthMBps(textureUpload));
+	fprintf(stdout, "Memory      textures %.2f MiB, meshes %.2f MiB, uniforms %.2f MiB, depth %.2f MiB, staging %.2f MiB\n",
+	        static_cast<double>(frameStats.textureBytes) / ( 1024.0 * 1024.0 ),
+	        static_cast<double>(frameStats.meshBytes) / ( 1024.0 * 1024.0 ),
+	        static_cast<double>(frameStats.uniformBytes) / ( 1024.0 * 1024.0 ),
+	        static_cast<double>(frameStats.depthBytes) / ( 1024.0 * 1024.0 ),
+	        static_cast<double>(frameStats.stagingBytes) / ( 1024.0 * 1024.0 ));
+
+	if (gpuStats.samples == 0) fprintf(stdout, "No GPU timings, the queue has no timestamps\n");
+
+	if (!config.jsonPath.empty() && config.jsonPath != "none")
+	{
+		if (!WriteJson(config.jsonPath, config, deviceName, uniqueMeshes, cpuStats, gpuStats, meshUpload, textureUpload, frameStats))
+		{
+			fprintf(stderr, "[ERROR] Failed to write '%s'\n", config.jsonPath.c_str());
+			return EXIT_FAILURE;
+		}
+		fprintf(stdout, "Report      %s\n", config.jsonPath.c_str());
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+# Writes SPIR-V files into a C++ source as constexpr word arrays, listed by GetEmbeddedShaders() (see src/Shaders.h)
+#
+# cmake -DOUTPUT=<source.cpp> "-DSHADERS=<name>=<file.spv>=<source>|..." -P EmbedShaders.cmake
+#
+# The GLSL source path is kept for the shader hot reload
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(arrays  "")
+set(entries "")
+set(index   0)
+
+foreach (shader IN LISTS SHADERS)
+    string(REPLACE "=" ";" pair "${shader}")
+    list(GET pair 0 name)
+    list(GET pair 1 path)
+    list(GET pair 2 source)
+
+    file(READ "${path}" hex HEX)
+    string(LENGTH "${hex}" length)
+    math(EXPR remainder "${length} % 8")
+    if (length EQUAL 0 OR NOT remainder EQUAL 0)
+        message(FATAL_ERROR "'${path}' is not SPIR-V, its size is not a multiple of 4")
+    endif ()
+
+    # Bytes to little endian words, as glslang and glslc write them and as every supported target reads them
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " words "${hex}")
+    if (NOT words MATCHES "^0x07230203u")
+        message(FATAL_ERROR "'${path}' is not SPIR-V, the magic number is missing")
+    endif ()
+
+    # 8 words per line, CMake regexes have no {n} repetition
+    set(line "")
+    foreach (word RANGE 1 8)
+        string(APPEND line "0x........u, ")
+    endforeach ()
+    string(REGEX REPLACE "(${line})" "\\1\n\t" words "${words}")
+    string(REPLACE ", \n" ",\n" words "${words}")
+    string(REGEX REPLACE "[ \n\t]+$" "" words "${words}")
+
+    string(APPEND arrays  "static constexpr uint32_t s_shader${index}[] =\n{\n\t${words}\n};\n\n")
+    string(APPEND entries "\t{ \"${name}\", s_shader${index}, std::size(s_shader${index}), \"${source}\" },\n")
+
+    math(EXPR index "${index} + 1")
+endforeach ()
+
+file(WRITE "${OUTPUT}"
+"// Generated by cmake/EmbedShaders.cmake, do not edit
+
+#include <iterator>
+
+#include \"Shaders.h\"
+
+${arrays}// Ends with an empty entry, so the array is never empty
+static constexpr embeddedShader_t s_embeddedShaders[] =
+{
+${entries}\t{ nullptr, nullptr, 0, nullptr }
+};
+
+std::span<const embeddedShader_t>
+GetEmbeddedShaders()
+{
+\treturn { s_embeddedShaders, std::size(s_embeddedShaders) - 1 };
+}
+")
+
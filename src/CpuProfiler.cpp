@@ -0,0 +1,205 @@
+#include "CpuProfiler.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	/**
+	 * @struct clockSample_t
+	 * @brief The scope clock and the steady clock read together, two of them give the tick length
+	 */
+	typedef struct clockSample_t
+	{
+		uint64_t ticks { 0 };
+		int64_t  ns    { 0 };
+	} clockSample_t;
+
+	/**
+	 * @struct collector_t
+	 * @brief Everything the collector thread owns, and the rings it drains
+	 */
+	typedef struct collector_t
+	{
+		/** @brief Guards the rings and the thread names. Taken once per thread, and by each drain */
+		std::mutex                                   mutex       {   };
+		std::vector<std::unique_ptr<CpuProfileRing>> rings       {   };   // Outlive their thread, what it left is still drained
+
+		std::thread                                  thread      {   };
+		std::condition_variable                      wakeUp      {   };
+		bool                                         bStop       { false };
+
+		FILE                                        *file        { nullptr };
+		std::string                                  path        {   };
+		uint64_t                                     written     { 0 };
+		clockSample_t                                start       {   };
+	} collector_t;
+
+	collector_t g_collector;
+
+	clockSample_t
+	SampleClocks()
+	{
+		return
+		{
+			.ticks = CpuProfiler::ReadTicks(),
+			.ns    = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+		};
+	}
+
+	/** @brief Write the scopes recorded since the last drain. The tick length is measured again each time */
+	void
+	DrainRings()
+	{
+		const clockSample_t now = SampleClocks();
+
+#ifdef CPU_PROFILER_TSC
+		const double nsPerTick = now.ticks > g_collector.start.ticks
+		                       ? static_cast<double>(now.ns - g_collector.start.ns) / static_cast<double>(now.ticks - g_collector.start.ticks)
+		                       : 1.0;
+#else
+		const double nsPerTick = 1.0;
+#endif
+
+		// Microseconds since the start, Chrome traces are in microseconds
+		const auto toUs = [nsPerTick](uint64_t ticks) -> double
+		{
+			return static_cast<double>(static_cast<int64_t>(ticks - g_collector.start.ticks)) * nsPerTick / 1000.0;
+		};
+
+		std::lock_guard<std::mutex> lock(g_collector.mutex);
+		for (const std::unique_ptr<CpuProfileRing> &ring : g_collector.rings)
+		{
+			g_collector.written += ring->Drain([&](const cpuProfileEvent_t &event) -> void
+			{
+				fprintf(g_collector.file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				        event.name, ring->threadId, toUs(event.beginTicks),
+				        static_cast<double>(event.endTicks - event.beginTicks) * nsPerTick / 1000.0);
+			});
+		}
+	}
+
+	void
+	CollectorLoop()
+	{
+		std::unique_lock<std::mutex> lock(g_collector.mutex);
+		while (!g_collector.bStop)
+		{
+			g_collector.wakeUp.wait_for(lock, std::chrono::milliseconds(CPU_PROFILER_FLUSH_MS));
+
+			// The drain takes the lock itself
+			lock.unlock();
+			DrainRings();
+			lock.lock();
+		}
+	}
+}
+
+bool
+CpuProfiler::Start(const std::string &path)
+{
+#if !ENABLE_CPU_PROFILER
+	fprintf(stdout, "[INFO] CPU profiler compiled out, no trace written to %s\n", path.c_str());
+	return false;
+#endif
+
+	if (IsRunning()) return false;
+
+	FILE *file = fopen(path.c_str(), "w");
+	if (file == nullptr)
+	{
+		fprintf(stderr, "[ERROR] Failed to write the CPU trace %s\n", path.c_str());
+		return false;
+	}
+
+	// Buffered: the collector writes many small events
+	setvbuf(file, nullptr, _IOFBF, 1 << 16);
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"CPU\"}}");
+
+	{
+		std::lock_guard<std::mutex> lock(g_collector.mutex);
+		for (const std::unique_ptr<CpuProfileRing> &ring : g_collector.rings) ring->Skip();
+
+		g_collector.file    = file;
+		g_collector.path    = path;
+		g_collector.written = 0;
+		g_collector.bStop   = false;
+		g_collector.start   = SampleClocks();
+	}
+
+	g_collector.thread = std::thread(CollectorLoop);
+	s_bRunning.store(true, std::memory_order_release);
+	return true;
+}
+
+void
+CpuProfiler::Stop()
+{
+	if (!IsRunning()) return;
+	s_bRunning.store(false, std::memory_order_release);
+
+	{
+		std::lock_guard<std::mutex> lock(g_collector.mutex);
+		g_collector.bStop = true;
+	}
+	g_collector.wakeUp.notify_one();
+	g_collector.thread.join();
+
+	// The scopes still open when it stopped are left out, their end is never seen
+	DrainRings();
+
+	uint64_t dropped = 0;
+	{
+		std::lock_guard<std::mutex> lock(g_collector.mutex);
+		for (const std::unique_ptr<CpuProfileRing> &ring : g_collector.rings)
+		{
+			dropped += ring->GetDropped();
+			if (ring->threadName.empty()) continue;
+
+			fprintf(g_collector.file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			        ring->threadId, ring->threadName.c_str());
+		}
+	}
+
+	fprintf(g_collector.file, "\n]}\n");
+	fclose(g_collector.file);
+	g_collector.file = nullptr;
+
+	fprintf(stdout, "[INFO] CPU profiler: %llu scopes written to %s, %llu dropped\n",
+			static_cast<unsigned long long>(g_collector.written), g_collector.path.c_str(), static_cast<unsigned long long>(dropped));
+}
+
+void
+CpuProfiler::SetThreadName(const char *name)
+{
+	CpuProfileRing *ring = s_threadRing;
+	if (ring == nullptr) ring = s_threadRing = RegisterThread();
+
+	std::lock_guard<std::mutex> lock(g_collector.mutex);
+	ring->threadName = name;
+}
+
+uint64_t
+CpuProfiler::GetDroppedScopes()
+{
+	std::lock_guard<std::mutex> lock(g_collector.mutex);
+
+	uint64_t dropped = 0;
+	for (const std::unique_ptr<CpuProfileRing> &ring : g_collector.rings) dropped += ring->GetDropped();
+	return dropped;
+}
+
+CpuProfileRing *
+CpuProfiler::RegisterThread()
+{
+	std::lock_guard<std::mutex> lock(g_collector.mutex);
+
+	g_collector.rings.push_back(std::make_unique<CpuProfileRing>());
+	CpuProfileRing *ring = g_collector.rings.back().get();
+	ring->threadId = static_cast<uint32_t>(g_collector.rings.size());
+	return ring;
+}
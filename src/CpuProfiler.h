@@ -0,0 +1,261 @@
+#ifndef VULKAN_COURSE_CPU_PROFILER_H
+#define VULKAN_COURSE_CPU_PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define CPU_PROFILER_TSC 1
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#else
+		#include <x86intrin.h>
+	#endif
+#endif
+
+/*
+ * Named CPU scopes, written by each thread into its own ring and drained to a Chrome trace by a collector thread.
+ * A scope costs two counter reads and one store into memory only its thread writes: no lock, no allocation.
+ * Standalone so the benchmarks can build it without the renderer.
+ */
+
+
+// ======================================================================================================================
+// ============================================ Macros ==================================================================
+// ======================================================================================================================
+
+/** @brief Compile the scopes in. Set by the VULKAN_COURSE_CPU_PROFILER option, 0 leaves nothing of them in the code */
+#ifndef ENABLE_CPU_PROFILER
+	#define ENABLE_CPU_PROFILER 1
+#endif
+
+#define CPU_PROFILE_CONCAT_(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_(a, b)
+
+#if ENABLE_CPU_PROFILER
+	/** @brief Measure the rest of the enclosing block. The name must outlive the profiler, a string literal */
+	#define PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+
+	/** @brief Name the track of the calling thread in the trace */
+	#define PROFILE_THREAD(name) CpuProfiler::SetThreadName(name)
+#else
+	#define PROFILE_SCOPE(name) ((void)0)
+	#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+
+// ======================================================================================================================
+// ============================================ Constants ===============================================================
+// ======================================================================================================================
+
+/** @brief Scopes a thread can record before the collector drains them, the ones past it are dropped. A power of two */
+constexpr uint32_t CPU_PROFILER_RING_EVENTS = 16384;
+
+/** @brief Time between two drains of the rings by the collector thread */
+constexpr uint32_t CPU_PROFILER_FLUSH_MS = 20;
+
+
+// ======================================================================================================================
+// ============================================ Types ===================================================================
+// ======================================================================================================================
+
+/**
+ * @struct cpuProfileEvent_t
+ * @brief A scope as its thread recorded it, in raw ticks
+ */
+typedef struct cpuProfileEvent_t
+{
+	const char *name       { nullptr };
+	uint64_t    beginTicks { 0 };
+	uint64_t    endTicks   { 0 };
+} cpuProfileEvent_t;
+
+/**
+ * @class CpuProfileRing
+ * @brief The scopes of one thread, written by it and read by the collector
+ * @details Single producer, single consumer. Each side only writes its own index, on its own cache line
+ */
+class CpuProfileRing
+{
+public:
+
+	/** @brief Id of the thread track in the trace */
+	uint32_t    threadId   { 0 };
+
+	/** @brief Set through PROFILE_THREAD, guarded by the profiler lock */
+	std::string threadName {   };
+
+	/** @brief Add a scope, or drop it if the collector is that far behind. Owner thread only */
+	void Push(const cpuProfileEvent_t &event);
+
+	/** @brief Hand the recorded scopes to a function, oldest first, then free their slots. Collector thread only */
+	template<typename F>
+	uint64_t Drain(F &&onEvent);
+
+	/** @brief Forget the scopes not drained yet. Collector side, before it starts */
+	void Skip();
+
+	/** @brief Get the scopes dropped since the ring was created */
+	[[nodiscard]] uint64_t GetDropped() const;
+
+private:
+
+	static_assert((CPU_PROFILER_RING_EVENTS & (CPU_PROFILER_RING_EVENTS - 1)) == 0, "The ring size must be a power of two");
+
+	alignas(64) std::atomic<uint64_t> m_head       { 0 }; // Written by the owner thread
+	uint64_t                          m_cachedTail { 0 }; // Owner's copy of the tail, read again only when looking full
+	std::atomic<uint64_t>             m_dropped    { 0 };
+
+	alignas(64) std::atomic<uint64_t> m_tail       { 0 }; // Written by the collector
+
+	alignas(64) std::array<cpuProfileEvent_t, CPU_PROFILER_RING_EVENTS> m_events { };
+};
+
+/**
+ * @class CpuProfiler
+ * @brief The rings of all the threads, and the collector thread writing them to a file
+ * @details Scopes are recorded while the profiler runs, one relaxed load and a branch otherwise.
+ *          Times are read from the TSC on x86 and converted to nanoseconds by the collector, from the steady clock elsewhere
+ */
+class CpuProfiler
+{
+public:
+
+	CpuProfiler() = delete;
+
+	/**
+	 * @brief Open the trace file and start the collector thread
+	 * @return False if the file cannot be written, the profiler already runs or is compiled out
+	 */
+	static bool Start(const std::string &path);
+
+	/** @brief Drain the rings one last time, close the trace and stop the collector thread */
+	static void Stop();
+
+	/** @brief Checks if scopes are recorded */
+	static bool IsRunning();
+
+	/** @brief Name the track of the calling thread. The name is copied */
+	static void SetThreadName(const char *name);
+
+	/** @brief Get the scopes dropped by every thread because their ring was full */
+	static uint64_t GetDroppedScopes();
+
+	/** @brief Read the scope clock: TSC ticks on x86, steady clock nanoseconds elsewhere */
+	static uint64_t ReadTicks();
+
+	/** @brief Record a finished scope of the calling thread */
+	static void Record(const char *name, uint64_t beginTicks, uint64_t endTicks);
+
+private:
+
+	static inline std::atomic<bool> s_bRunning { false };
+
+	/** @brief Ring of the calling thread, created on its first scope */
+	static inline thread_local CpuProfileRing *s_threadRing { nullptr };
+
+	/** @brief Create and register the ring of the calling thread */
+	static CpuProfileRing *RegisterThread();
+};
+
+/**
+ * @class CpuProfileScope
+ * @brief Reads the clock on construction, records the scope on destruction
+ */
+class CpuProfileScope
+{
+public:
+
+	explicit CpuProfileScope(const char *name) : m_name(name), m_beginTicks(CpuProfiler::IsRunning() ? CpuProfiler::ReadTicks() : 0) { }
+
+	~CpuProfileScope()
+	{
+		if (m_beginTicks != 0) CpuProfiler::Record(m_name, m_beginTicks, CpuProfiler::ReadTicks());
+	}
+
+	// Disallow copying, the scope ends once
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+
+	const char *m_name;
+	uint64_t    m_beginTicks; // 0 when the profiler was not running
+};
+
+
+inline void
+CpuProfileRing::Push(const cpuProfileEvent_t &event)
+{
+	const uint64_t head = m_head.load(std::memory_order_relaxed);
+	if (head - m_cachedTail >= CPU_PROFILER_RING_EVENTS)
+	{
+		m_cachedTail = m_tail.load(std::memory_order_acquire);
+		if (head - m_cachedTail >= CPU_PROFILER_RING_EVENTS)
+		{
+			m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	m_events[head & (CPU_PROFILER_RING_EVENTS - 1)] = event;
+
+	// Release: the collector sees the event once it sees the head
+	m_head.store(head + 1, std::memory_order_release);
+}
+
+template<typename F>
+uint64_t
+CpuProfileRing::Drain(F &&onEvent)
+{
+	const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+	const uint64_t head = m_head.load(std::memory_order_acquire);
+
+	for (uint64_t i = tail; i < head; ++i) onEvent(m_events[i & (CPU_PROFILER_RING_EVENTS - 1)]);
+
+	// Release: the owner only reuses the slots once they are read
+	m_tail.store(head, std::memory_order_release);
+	return head - tail;
+}
+
+inline void
+CpuProfileRing::Skip()
+{
+	m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+inline uint64_t
+CpuProfileRing::GetDropped() const
+{
+	return m_dropped.load(std::memory_order_relaxed);
+}
+
+inline bool
+CpuProfiler::IsRunning()
+{
+	return s_bRunning.load(std::memory_order_relaxed);
+}
+
+inline uint64_t
+CpuProfiler::ReadTicks()
+{
+#ifdef CPU_PROFILER_TSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+inline void
+CpuProfiler::Record(const char *name, uint64_t beginTicks, uint64_t endTicks)
+{
+	CpuProfileRing *ring = s_threadRing;
+	if (ring == nullptr) ring = s_threadRing = RegisterThread();
+
+	ring->Push({ .name = name, .beginTicks = beginTicks, .endTicks = endTicks });
+}
+
+#endif //VULKAN_COURSE_CPU_PROFILER_H
@@ -0,0 +1,105 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+void
+FramePacer::SetTargetFrameRate(double framesPerSecond)
+{
+	m_period   = framesPerSecond > 0.0
+	           ? std::chrono::duration_cast<steadyClock_t::duration>(std::chrono::duration<double>(1.0 / framesPerSecond))
+	           : steadyClock_t::duration::zero();
+	m_deadline = { };
+}
+
+void
+FramePacer::SetPresentWait(presentWait_t presentWait)
+{
+	m_presentWait = std::move(presentWait);
+}
+
+double
+FramePacer::WaitForNextFrame()
+{
+	// The display is the real deadline, do not queue more frames than it takes
+	if (m_presentWait)
+	{
+		const auto timeout = std::max<steadyClock_t::duration>(2 * m_period, std::chrono::milliseconds(50));
+		if (m_presentWait(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count())) ++m_stats.presentWaits;
+	}
+
+	if (m_period > steadyClock_t::duration::zero())
+	{
+		const steadyClock_t::time_point now = steadyClock_t::now();
+		m_deadline = m_deadline == steadyClock_t::time_point { } ? now : m_deadline + m_period;
+
+		if (now > m_deadline)
+		{
+			++m_stats.missed;
+			RecordJitter(now - m_deadline);
+
+			// Too late to keep the schedule, start a new one rather than run frames back to back
+			if (now - m_deadline > m_period) m_deadline = now;
+		}
+		else
+		{
+			WaitUntil(m_deadline);
+			RecordJitter(steadyClock_t::now() - m_deadline);
+		}
+
+		++m_stats.frames;
+	}
+
+	const steadyClock_t::time_point frameStart = steadyClock_t::now();
+	const double                    deltaTime  = m_frameStart == steadyClock_t::time_point { }
+	                                           ? 0.0 : std::chrono::duration<double>(frameStart - m_frameStart).count();
+	m_frameStart = frameStart;
+	return deltaTime;
+}
+
+void
+FramePacer::PrintStats() const
+{
+	if (m_stats.frames == 0) return;
+
+	fprintf(stdout, "[INFO] Frame pacing: %llu frames, %llu missed, %llu paced on presents, max jitter %.0f us\n",
+			static_cast<unsigned long long>(m_stats.frames), static_cast<unsigned long long>(m_stats.missed),
+			static_cast<unsigned long long>(m_stats.presentWaits), m_stats.maxJitterUs);
+
+	for (size_t i = 0; i < m_stats.histogram.size(); ++i)
+	{
+		const double percent = 100.0 * static_cast<double>(m_stats.histogram[i]) / static_cast<double>(m_stats.frames);
+		if (i < FRAME_PACER_JITTER_BOUNDS_US.size()) fprintf(stdout, "[INFO]   < %4u us: %6.2f%%\n", FRAME_PACER_JITTER_BOUNDS_US[i], percent);
+		else fprintf(stdout, "[INFO]  >= %4u us: %6.2f%%\n", FRAME_PACER_JITTER_BOUNDS_US.back(), percent);
+	}
+}
+
+void
+FramePacer::WaitUntil(steadyClock_t::time_point deadline)
+{
+	// Never spin more than half a frame, the sleep is what leaves the core to the other threads
+	const steadyClock_t::duration spin = std::min<steadyClock_t::duration>(m_oversleep + std::chrono::microseconds(FRAME_PACER_MIN_SPIN_US),
+	                                                                       m_period / 2);
+
+	const steadyClock_t::time_point wakeUp = deadline - spin;
+	if (steadyClock_t::now() < wakeUp)
+	{
+		std::this_thread::sleep_until(wakeUp);
+
+		// Remember how late the scheduler woke us, forget it slowly
+		const steadyClock_t::duration oversleep = std::max(steadyClock_t::now() - wakeUp, steadyClock_t::duration::zero());
+		m_oversleep = std::max(oversleep, m_oversleep - m_oversleep / 16);
+	}
+
+	while (steadyClock_t::now() < deadline) std::this_thread::yield();
+}
+
+void
+FramePacer::RecordJitter(steadyClock_t::duration jitter)
+{
+	const double jitterUs = std::chrono::duration<double, std::micro>(jitter).count();
+	m_stats.maxJitterUs = std::max(m_stats.maxJitterUs, jitterUs);
+
+	const auto bucket = std::ranges::upper_bound(FRAME_PACER_JITTER_BOUNDS_US, static_cast<uint32_t>(jitterUs));
+	++m_stats.histogram[bucket - FRAME_PACER_JITTER_BOUNDS_US.begin()];
+}
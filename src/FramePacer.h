@@ -0,0 +1,98 @@
+#ifndef VULKAN_COURSE_FRAME_PACER_H
+#define VULKAN_COURSE_FRAME_PACER_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "Utilities.h"
+
+/** @brief Upper bounds of the pacing jitter histogram buckets in microseconds, the last bucket holds the rest */
+constexpr std::array<uint32_t, 7> FRAME_PACER_JITTER_BOUNDS_US = { 25, 50, 100, 250, 500, 1000, 2000 };
+
+/**
+ * @struct framePacerStats_t
+ * @brief How close the frames started to their deadlines
+ */
+typedef struct framePacerStats_t
+{
+	uint64_t frames         { 0 };   // Paced frames
+	uint64_t missed         { 0 };   // Frames that reached the pacer after their deadline
+	uint64_t presentWaits   { 0 };   // Frames paced on a present reported by the driver
+	double   maxJitterUs    { 0.0 }; // Largest distance to a deadline
+
+	/** @brief Frames by distance between their start and their deadline, see FRAME_PACER_JITTER_BOUNDS_US */
+	std::array<uint64_t, FRAME_PACER_JITTER_BOUNDS_US.size() + 1> histogram { };
+} framePacerStats_t;
+
+
+/**
+ * @class FramePacer
+ * @brief Starts frames on absolute deadlines spaced by the target frame time
+ * @details The wait sleeps until shortly before the deadline, then spins the rest on the steady clock: sleeping
+ *          alone wakes up late by whatever the scheduler adds. The spin margin follows the worst recent oversleep.
+ *          Deadlines are absolute, an early or late frame does not shift the next ones; a frame more than a period late
+ *          starts a new schedule instead of rushing to catch up
+ */
+class FramePacer
+{
+public:
+
+	/** @brief Blocks until the display has caught up, false if it could not wait. The argument is a timeout in ns */
+	typedef std::function<bool(uint64_t)> presentWait_t;
+
+	FramePacer() = default;
+	~FramePacer() = default;
+
+	/** @brief Set the frame rate to pace to, 0 does not wait */
+	void SetTargetFrameRate(double framesPerSecond);
+
+	/**
+	 * @brief Pace on the presents of the swap chain too, before waiting for the deadline
+	 * @details Keeps the CPU from running ahead of the display when the target matches the refresh rate
+	 */
+	void SetPresentWait(presentWait_t presentWait);
+
+	/**
+	 * @brief Wait for the start of the next frame
+	 * @return Seconds since the start of the previous frame
+	 */
+	double WaitForNextFrame();
+
+	/** @brief Get the pacing counters and jitter histogram */
+	[[nodiscard]] const framePacerStats_t &GetStats() const;
+
+	/** @brief Print the counters and the histogram */
+	void PrintStats() const;
+
+private:
+
+	typedef std::chrono::steady_clock steadyClock_t;
+
+	steadyClock_t::duration   m_period      { 0 };
+	steadyClock_t::time_point m_deadline    { };
+	steadyClock_t::time_point m_frameStart  { };
+
+	/** @brief Worst recent oversleep, decays so a single hiccup does not keep the spin long */
+	steadyClock_t::duration   m_oversleep   { 0 };
+
+	presentWait_t             m_presentWait { };
+
+	framePacerStats_t         m_stats       { };
+
+	/** @brief Sleep until the spin margin before the deadline, then spin */
+	void WaitUntil(steadyClock_t::time_point deadline);
+
+	/** @brief Add the distance between now and the deadline to the histogram */
+	void RecordJitter(steadyClock_t::duration jitter);
+};
+
+
+FORCE_INLINE const framePacerStats_t &
+FramePacer::GetStats() const
+{
+	return m_stats;
+}
+
+#endif //VULKAN_COURSE_FRAME_PACER_H
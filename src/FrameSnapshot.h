@@ -0,0 +1,55 @@
+#ifndef VULKAN_COURSE_FRAME_SNAPSHOT_H
+#define VULKAN_COURSE_FRAME_SNAPSHOT_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "Utilities.h"
+
+/**
+ * @struct transform_t
+ * @brief Position, rotation and scale of a model. Kept apart so two of them can be interpolated
+ */
+typedef struct transform_t
+{
+	glm::vec3 position { 0.0f };
+	glm::quat rotation { 1.0f, 0.0f, 0.0f, 0.0f };
+	glm::vec3 scale    { 1.0f };
+} transform_t;
+
+/**
+ * @struct frameSnapshot_t
+ * @brief The state of the simulation after a tick, handed to the render thread as is
+ */
+typedef struct frameSnapshot_t
+{
+	uint64_t                 tick   { 0 };   // Ticks simulated so far
+	double                   time   { 0.0 }; // Simulated seconds, on the same clock as the render thread
+	std::vector<transform_t> models { };     // Transform of each mesh, by mesh index
+} frameSnapshot_t;
+
+/** @brief Blend two transforms, t = 0 gives a and t = 1 gives b */
+FORCE_INLINE transform_t
+InterpolateTransform(const transform_t &a, const transform_t &b, float t)
+{
+	return
+	{
+		.position = glm::mix(a.position, b.position, t),
+		.rotation = glm::slerp(a.rotation, b.rotation, t), // Shortest arc, a matrix blend would shrink the model
+		.scale    = glm::mix(a.scale, b.scale, t)
+	};
+}
+
+/** @brief Build the model matrix of a transform: scale, then rotate, then translate */
+FORCE_INLINE glm::mat4
+GetTransformMatrix(const transform_t &transform)
+{
+	return glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.rotation) *
+	       glm::scale(glm::mat4(1.0f), transform.scale);
+}
+
+#endif //VULKAN_COURSE_FRAME_SNAPSHOT_H
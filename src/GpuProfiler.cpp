@@ -0,0 +1,294 @@
+#include "GpuProfiler.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+void
+GpuProfiler::Create(const device_t &devices, uint32_t queueFamily)
+{
+	m_devices  = devices;
+	m_bEnabled = false;
+
+	if (!ENABLE_GPU_PROFILER) return;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(devices.physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(devices.physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	const uint32_t validBits = queueFamily < queueFamilyCount ? queueFamilies[queueFamily].timestampValidBits : 0;
+	if (validBits == 0)
+	{
+		fprintf(stdout, "[INFO] The graphics queue does not support timestamps, the GPU profiler is disabled\n");
+		return;
+	}
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(devices.physicalDevice, &deviceProperties);
+
+	m_periodNs  = static_cast<double>(deviceProperties.limits.timestampPeriod);
+	m_validMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max() : (uint64_t{1} << validBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo =
+	{
+		.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType  = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = GPU_PROFILER_MAX_SCOPES * 2
+	};
+
+	for (frameQueries_t &frame : m_frames)
+	{
+		VK_CHECK(vkCreateQueryPool(devices.logicalDevice, &queryPoolCreateInfo, nullptr, &frame.pool), "Failed to create a Query Pool!");
+		frame.scopes.reserve(GPU_PROFILER_MAX_SCOPES);
+	}
+
+	m_bEnabled = true;
+	fprintf(stdout, "[INFO] GPU profiler: %u timestamp bits, %.2f ns per tick\n", validBits, m_periodNs);
+}
+
+void
+GpuProfiler::Destroy()
+{
+	for (frameQueries_t &frame : m_frames)
+	{
+		if (frame.pool != VK_NULL_HANDLE) vkDestroyQueryPool(m_devices.logicalDevice, frame.pool, nullptr);
+		frame = frameQueries_t{};
+	}
+
+	m_bEnabled = false;
+	m_bInFrame = false;
+}
+
+void
+GpuProfiler::BeginFrame(uint32_t slot, uint64_t frameNumber)
+{
+	// A frame that returned early never reached its submit
+	if (m_bInFrame) EndFrame();
+	if (!m_bEnabled) return;
+
+	frameQueries_t &frame = m_frames[slot];
+	if (frame.bPending) Resolve(frame);
+
+	frame.frameNumber = frameNumber;
+	frame.queryCount  = 0;
+	frame.bNeedsReset = true;
+	frame.cpuBeginNs  = GetCpuTimeNs();
+	frame.cpuEndNs    = frame.cpuBeginNs;
+	frame.scopes.clear();
+
+	m_currentSlot = slot;
+	m_depth       = 0;
+	m_bInFrame    = true;
+}
+
+void
+GpuProfiler::EndFrame()
+{
+	if (!m_bInFrame) return;
+
+	frameQueries_t &frame = m_frames[m_currentSlot];
+	frame.cpuEndNs = GetCpuTimeNs();
+	frame.bPending = frame.queryCount > 0;
+
+	m_bInFrame = false;
+}
+
+int32_t
+GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char *name)
+{
+	if (!m_bInFrame) return -1;
+
+	frameQueries_t &frame = m_frames[m_currentSlot];
+	if (frame.queryCount + 2 > GPU_PROFILER_MAX_SCOPES * 2)
+	{
+		++m_droppedScopes;
+		return -1;
+	}
+
+	// The first command buffer of the frame to be submitted resets the pool for the rest
+	if (frame.bNeedsReset)
+	{
+		vkCmdResetQueryPool(commandBuffer, frame.pool, 0, GPU_PROFILER_MAX_SCOPES * 2);
+		frame.bNeedsReset = false;
+	}
+
+	const uint32_t startQuery = frame.queryCount;
+	frame.queryCount += 2;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, startQuery);
+
+	frame.scopes.push_back({ .name = name, .depth = m_depth++, .startQuery = startQuery });
+	return static_cast<int32_t>(frame.scopes.size() - 1);
+}
+
+void
+GpuProfiler::EndScope(VkCommandBuffer commandBuffer, int32_t scope)
+{
+	if (scope < 0 || !m_bInFrame) return;
+
+	// Bottom of pipe: the scope ends once everything recorded before it is done
+	const frameQueries_t &frame = m_frames[m_currentSlot];
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, frame.scopes[scope].startQuery + 1);
+
+	if (m_depth > 0) --m_depth;
+}
+
+void
+GpuProfiler::PrintStats() const
+{
+	if (m_history.empty()) return;
+
+	// Same name, same scope: literals of a name may differ by pointer across translation units
+	typedef struct scopeStats_t
+	{
+		std::string name    {   };
+		uint32_t    depth   { 0 };
+		uint64_t    count   { 0 };
+		double      totalMs { 0.0 };
+		double      maxMs   { 0.0 };
+	} scopeStats_t;
+
+	std::vector<scopeStats_t> scopeStats;
+	double totalFrameMs = 0.0;
+	double maxFrameMs   = 0.0;
+
+	for (const gpuFrameTiming_t &frame : m_history)
+	{
+		totalFrameMs += frame.gpuMs;
+		maxFrameMs    = std::max(maxFrameMs, frame.gpuMs);
+
+		for (const gpuScopeTiming_t &scope : frame.scopes)
+		{
+			auto stats = std::ranges::find_if(scopeStats, [&scope](const scopeStats_t &entry) -> bool { return entry.name == scope.name; });
+			if (stats == scopeStats.end()) stats = scopeStats.insert(scopeStats.end(), { .name = scope.name, .depth = scope.depth });
+
+			++stats->count;
+			stats->totalMs += scope.durationMs;
+			stats->maxMs    = std::max(stats->maxMs, scope.durationMs);
+		}
+	}
+
+	fprintf(stdout, "[INFO] GPU profiler: %zu frames, %.3f ms avg (max %.3f), %llu frames not ready, %llu scopes dropped\n",
+			m_history.size(), totalFrameMs / static_cast<double>(m_history.size()), maxFrameMs,
+			static_cast<unsigned long long>(m_droppedFrames), static_cast<unsigned long long>(m_droppedScopes));
+
+	for (const scopeStats_t &stats : scopeStats)
+	{
+		fprintf(stdout, "[INFO]   %*s%-*s %8.3f ms avg (max %.3f), %llu times\n",
+				static_cast<int>(stats.depth * 2), "", static_cast<int>(24 - std::min(stats.depth * 2, 24u)), stats.name.c_str(),
+				stats.totalMs / static_cast<double>(stats.count), stats.maxMs, static_cast<unsigned long long>(stats.count));
+	}
+}
+
+bool
+GpuProfiler::ExportChromeTrace(const std::string &path) const
+{
+	if (m_history.empty()) return true;
+
+	std::ofstream file(path, std::ios::out | std::ios::trunc);
+	if (!file.is_open())
+	{
+		fprintf(stderr, "[ERROR] Failed to write the GPU trace %s\n", path.c_str());
+		return false;
+	}
+
+	// The GPU starts a frame after the CPU began recording it. Without calibrated timestamps the offset between the
+	// two clocks is the smallest one that keeps that true for every frame, the GPU track can only be late by the
+	// shortest gap seen between the two
+	int64_t clockOffsetNs = std::numeric_limits<int64_t>::min();
+	for (const gpuFrameTiming_t &frame : m_history)
+	{
+		clockOffsetNs = std::max(clockOffsetNs, frame.cpuBeginNs - static_cast<int64_t>(frame.gpuStartNs));
+	}
+
+	// Microseconds from the first frame, Chrome traces are in microseconds
+	const int64_t originNs = m_history.front().cpuBeginNs;
+	const auto toUs = [originNs](int64_t cpuNs) -> double { return static_cast<double>(cpuNs - originNs) / 1000.0; };
+
+	const auto escape = [](const char *name) -> std::string
+	{
+		std::string escaped;
+		for (const char *c = name; *c != '\0'; ++c)
+		{
+			if (*c == '"' || *c == '\\') escaped += '\\';
+			escaped += *c;
+		}
+		return escaped;
+	};
+
+	char event[512];
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU frame\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	for (const gpuFrameTiming_t &frame : m_history)
+	{
+		snprintf(event, sizeof(event), ",\n{\"name\":\"Frame %" PRIu64 "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+		         frame.frameNumber, toUs(frame.cpuBeginNs), static_cast<double>(frame.cpuEndNs - frame.cpuBeginNs) / 1000.0);
+		file << event;
+
+		for (const gpuScopeTiming_t &scope : frame.scopes)
+		{
+			snprintf(event, sizeof(event), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f,"
+			                               "\"args\":{\"frame\":%" PRIu64 "}}",
+			         escape(scope.name).c_str(), toUs(static_cast<int64_t>(scope.startNs) + clockOffsetNs),
+			         scope.durationMs * 1000.0, frame.frameNumber);
+			file << event;
+		}
+	}
+
+	file << "\n]}\n";
+	fprintf(stdout, "[INFO] Wrote %zu frames of GPU timings to %s\n", m_history.size(), path.c_str());
+	return true;
+}
+
+void
+GpuProfiler::Resolve(frameQueries_t &frame)
+{
+	frame.bPending = false;
+
+	// No wait flag: a frame the GPU is not done with is dropped, the profiler never stalls the frame
+	std::array<uint64_t, GPU_PROFILER_MAX_SCOPES * 2> timestamps { };
+	const VkResult result = vkGetQueryPoolResults(m_devices.logicalDevice, frame.pool, 0, frame.queryCount,
+	                                              frame.queryCount * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+	                                              VK_QUERY_RESULT_64_BIT);
+	if (result == VK_NOT_READY)
+	{
+		++m_droppedFrames;
+		return;
+	}
+	VK_CHECK(result, "Failed to read the GPU timestamps!");
+
+	gpuFrameTiming_t timing =
+	{
+		.frameNumber = frame.frameNumber,
+		.cpuBeginNs  = frame.cpuBeginNs,
+		.cpuEndNs    = frame.cpuEndNs
+	};
+	timing.scopes.reserve(frame.scopes.size());
+
+	uint64_t firstTick = std::numeric_limits<uint64_t>::max();
+	uint64_t lastTick  = 0;
+	for (const pendingScope_t &scope : frame.scopes)
+	{
+		const uint64_t startTick = timestamps[scope.startQuery] & m_validMask;
+		const uint64_t endTick   = std::max(timestamps[scope.startQuery + 1] & m_validMask, startTick);
+		firstTick = std::min(firstTick, startTick);
+		lastTick  = std::max(lastTick, endTick);
+
+		timing.scopes.push_back(
+		{
+			.name       = scope.name,
+			.depth      = scope.depth,
+			.startNs    = static_cast<uint64_t>(static_cast<double>(startTick) * m_periodNs),
+			.durationMs = static_cast<double>(endTick - startTick) * m_periodNs / 1e6
+		});
+	}
+
+	timing.gpuStartNs = static_cast<uint64_t>(static_cast<double>(firstTick) * m_periodNs);
+	timing.gpuMs      = static_cast<double>(lastTick - firstTick) * m_periodNs / 1e6;
+
+	m_history.push_back(std::move(timing));
+	if (m_history.size() > GPU_PROFILER_HISTORY_FRAMES) m_history.pop_front();
+}
@@ -0,0 +1,215 @@
+#ifndef VULKAN_COURSE_GPU_PROFILER_H
+#define VULKAN_COURSE_GPU_PROFILER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Utilities.h"
+
+/**
+ * @struct gpuScopeTiming_t
+ * @brief Time a named scope took on the GPU
+ */
+typedef struct gpuScopeTiming_t
+{
+	const char *name       { nullptr };
+	uint32_t    depth      { 0 };     // Scopes open around it when it began
+	uint64_t    startNs    { 0 };     // On the device clock
+	double      durationMs { 0.0 };
+} gpuScopeTiming_t;
+
+/**
+ * @struct gpuFrameTiming_t
+ * @brief GPU scopes of a frame, with the CPU time the frame was recorded in
+ */
+typedef struct gpuFrameTiming_t
+{
+	uint64_t                      frameNumber { 0 };
+	int64_t                       cpuBeginNs  { 0 };   // Steady clock, from the start of the frame to its submit
+	int64_t                       cpuEndNs    { 0 };
+	uint64_t                      gpuStartNs  { 0 };   // Device clock, first timestamp of the frame
+	double                        gpuMs       { 0.0 }; // First to last timestamp of the frame
+	std::vector<gpuScopeTiming_t> scopes      {   };
+} gpuFrameTiming_t;
+
+
+/**
+ * @class GpuProfiler
+ * @brief Named GPU scopes measured with timestamp queries
+ * @details One query pool for each frame in flight. A frame reads its pool back once it can be recorded again, by then
+ *          the GPU is done with it: the read never waits, a frame not ready is dropped. Scopes can be written in any
+ *          command buffer recorded during the frame, as long as they are submitted in the order they are recorded.
+ *          Disabled when the queue family has no valid timestamp bits, scopes then cost a branch
+ */
+class GpuProfiler
+{
+public:
+
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+
+	// Disallow copying, the query pools are owned
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	/**
+	 * @brief Create the query pools, if the queue family can write timestamps
+	 *
+	 * @param devices The physical and logical devices
+	 * @param queueFamily The family of the queue the scopes are submitted to
+	 */
+	void Create(const device_t &devices, uint32_t queueFamily);
+
+	/** @brief Destroy the query pools. Nothing submitted may still write to them */
+	void Destroy();
+
+	/** @brief Checks if timestamps are written */
+	[[nodiscard]] bool IsEnabled() const;
+
+	/**
+	 * @brief Start a frame in a frame in flight slot, reading back what the slot measured last time
+	 * @details The GPU must be done with the last frame of the slot
+	 */
+	void BeginFrame(uint32_t slot, uint64_t frameNumber);
+
+	/** @brief End the frame, once its last command buffer is submitted */
+	void EndFrame();
+
+	/**
+	 * @brief Write the start timestamp of a scope. The first scope of a frame resets the pool, outside a render pass
+	 *
+	 * @param name Must outlive the profiler, a string literal
+	 * @return The scope to end, -1 if nothing was written
+	 */
+	int32_t BeginScope(VkCommandBuffer commandBuffer, const char *name);
+
+	/** @brief Write the end timestamp of a scope */
+	void EndScope(VkCommandBuffer commandBuffer, int32_t scope);
+
+	/** @brief Get the frames read back, the oldest first. At most GPU_PROFILER_HISTORY_FRAMES */
+	[[nodiscard]] const std::deque<gpuFrameTiming_t> &GetHistory() const;
+
+	/** @brief Print the average and worst time of each scope over the history */
+	void PrintStats() const;
+
+	/**
+	 * @brief Write the history as a Chrome trace, for about:tracing or Perfetto
+	 * @details The CPU time each frame was recorded in goes on its own track, the GPU scopes are moved to the CPU clock
+	 * @return False if the file cannot be written
+	 */
+	bool ExportChromeTrace(const std::string &path) const;
+
+private:
+
+	/**
+	 * @struct pendingScope_t
+	 * @brief A scope written in a pool, its end timestamp follows the start one
+	 */
+	typedef struct pendingScope_t
+	{
+		const char *name       { nullptr };
+		uint32_t    depth      { 0 };
+		uint32_t    startQuery { 0 };
+	} pendingScope_t;
+
+	/**
+	 * @struct frameQueries_t
+	 * @brief The query pool of a frame in flight slot, and what was written to it
+	 */
+	typedef struct frameQueries_t
+	{
+		VkQueryPool                 pool        { VK_NULL_HANDLE };
+		uint64_t                    frameNumber { 0 };
+		uint32_t                    queryCount  { 0 };
+		bool                        bNeedsReset { true };
+		bool                        bPending    { false }; // Written and submitted, not read back yet
+		int64_t                     cpuBeginNs  { 0 };
+		int64_t                     cpuEndNs    { 0 };
+		std::vector<pendingScope_t> scopes      {   };
+	} frameQueries_t;
+
+	device_t                                      m_devices       { VK_NULL_HANDLE };
+	std::array<frameQueries_t, MAX_FRAME_DRAWS>   m_frames        {   };
+
+	/** @brief Nanoseconds per timestamp tick, and the bits of a timestamp that count */
+	double                                        m_periodNs      { 1.0 };
+	uint64_t                                      m_validMask     { 0 };
+
+	bool                                          m_bEnabled      { false };
+	bool                                          m_bInFrame      { false };
+	uint32_t                                      m_currentSlot   { 0 };
+	uint32_t                                      m_depth         { 0 };
+
+	/** @brief Scopes not written because the pool was full, they would need a larger GPU_PROFILER_MAX_SCOPES */
+	uint64_t                                      m_droppedScopes { 0 };
+
+	/** @brief Frames not ready when read back, they are skipped rather than waited on */
+	uint64_t                                      m_droppedFrames { 0 };
+
+	std::deque<gpuFrameTiming_t>                  m_history       {   };
+
+	/** @brief Read back the pool of a slot into the history */
+	void Resolve(frameQueries_t &frame);
+
+	/** @brief Get the steady clock time in nanoseconds */
+	static int64_t GetCpuTimeNs();
+};
+
+
+/**
+ * @class GpuProfileScope
+ * @brief Writes the start timestamp of a scope on construction and the end one on destruction
+ */
+class GpuProfileScope
+{
+public:
+
+	GpuProfileScope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name)
+		: m_profiler(profiler), m_commandBuffer(commandBuffer), m_scope(profiler.BeginScope(commandBuffer, name)) { }
+
+	~GpuProfileScope() { m_profiler.EndScope(m_commandBuffer, m_scope); }
+
+	// Disallow copying, the scope ends once
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+
+	GpuProfiler    &m_profiler;
+	VkCommandBuffer m_commandBuffer;
+	int32_t         m_scope;
+};
+
+/** @brief Measure the rest of the enclosing block on the GPU */
+#define GPU_PROFILE_SCOPE_CONCAT_(a, b) a##b
+#define GPU_PROFILE_SCOPE_CONCAT(a, b) GPU_PROFILE_SCOPE_CONCAT_(a, b)
+#define GPU_PROFILE_SCOPE(profiler, commandBuffer, name) \
+	GpuProfileScope GPU_PROFILE_SCOPE_CONCAT(gpuProfileScope, __LINE__)(profiler, commandBuffer, name)
+
+
+FORCE_INLINE bool
+GpuProfiler::IsEnabled() const
+{
+	return m_bEnabled;
+}
+
+FORCE_INLINE const std::deque<gpuFrameTiming_t> &
+GpuProfiler::GetHistory() const
+{
+	return m_history;
+}
+
+FORCE_INLINE int64_t
+GpuProfiler::GetCpuTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif //VULKAN_COURSE_GPU_PROFILER_H
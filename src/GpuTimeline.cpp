@@ -0,0 +1,181 @@
+#include "GpuTimeline.h"
+
+#include <array>
+#include <stdexcept>
+
+void
+GpuTimeline::Create(VkDevice device, bool bTimelineSemaphores)
+{
+	m_device    = device;
+	m_submitted = 0;
+	m_completed = 0;
+
+	if (!bTimelineSemaphores) return;
+
+	// Core in 1.2, the extension names the same functions with a suffix
+	m_vkGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValue"));
+	m_vkWaitSemaphores           = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphores"));
+	if (m_vkGetSemaphoreCounterValue == nullptr || m_vkWaitSemaphores == nullptr)
+	{
+		m_vkGetSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR"));
+		m_vkWaitSemaphores           = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR"));
+	}
+	if (m_vkGetSemaphoreCounterValue == nullptr || m_vkWaitSemaphores == nullptr) return;
+
+	VkSemaphoreTypeCreateInfoKHR typeCreateInfo =
+	{
+		.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR,
+		.initialValue  = 0
+	};
+	VkSemaphoreCreateInfo semaphoreCreateInfo =
+	{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &typeCreateInfo
+	};
+
+	VK_CHECK(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &m_semaphore), "Failed to create a Timeline Semaphore!");
+}
+
+void
+GpuTimeline::Destroy()
+{
+	if (m_device == VK_NULL_HANDLE) return;
+
+	if (m_semaphore != VK_NULL_HANDLE) vkDestroySemaphore(m_device, m_semaphore, nullptr);
+	m_semaphore = VK_NULL_HANDLE;
+
+	for (const auto &pending : m_pendingFences) vkDestroyFence(m_device, pending.second, nullptr);
+	for (const auto &fence : m_freeFences) vkDestroyFence(m_device, fence, nullptr);
+	m_pendingFences.clear();
+	m_freeFences.clear();
+
+	m_device = VK_NULL_HANDLE;
+}
+
+uint64_t
+GpuTimeline::Submit(VkQueue queue, const VkSubmitInfo &submitInfo)
+{
+	const uint64_t value = m_submitted + 1;
+
+	if (IsTimelineSemaphore())
+	{
+		if (submitInfo.signalSemaphoreCount > MAX_SIGNAL_SEMAPHORES)
+		{
+			throw std::runtime_error("Too many signal semaphores for a timeline submit!");
+		}
+
+		// Binary semaphores ignore their value, the timeline goes last
+		std::array<VkSemaphore, MAX_SIGNAL_SEMAPHORES + 1> signalSemaphores { };
+		std::array<uint64_t, MAX_SIGNAL_SEMAPHORES + 1>    signalValues     { };
+		for (uint32_t i = 0; i < submitInfo.signalSemaphoreCount; ++i) signalSemaphores[i] = submitInfo.pSignalSemaphores[i];
+		signalSemaphores[submitInfo.signalSemaphoreCount] = m_semaphore;
+		signalValues[submitInfo.signalSemaphoreCount]     = value;
+
+		VkTimelineSemaphoreSubmitInfoKHR timelineSubmitInfo =
+		{
+			.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR,
+			.pNext                     = submitInfo.pNext,
+			.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount + 1,
+			.pSignalSemaphoreValues    = signalValues.data()
+		};
+
+		VkSubmitInfo timelineSubmit         = submitInfo;
+		timelineSubmit.pNext                = &timelineSubmitInfo;
+		timelineSubmit.signalSemaphoreCount = submitInfo.signalSemaphoreCount + 1;
+		timelineSubmit.pSignalSemaphores    = signalSemaphores.data();
+
+		VK_CHECK(vkQueueSubmit(queue, 1, &timelineSubmit, VK_NULL_HANDLE), "Failed to submit to the queue!");
+	}
+	else
+	{
+		// Reuse a fence of a completed submit if there is one
+		PollFences();
+
+		VkFence fence;
+		if (!m_freeFences.empty())
+		{
+			fence = m_freeFences.back();
+			m_freeFences.pop_back();
+		}
+		else
+		{
+			VkFenceCreateInfo fenceCreateInfo = { .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+			VK_CHECK(vkCreateFence(m_device, &fenceCreateInfo, nullptr, &fence), "Failed to create a Fence!");
+		}
+
+		VK_CHECK(vkQueueSubmit(queue, 1, &submitInfo, fence), "Failed to submit to the queue!");
+		m_pendingFences.emplace_back(value, fence);
+	}
+
+	m_submitted = value;
+	return value;
+}
+
+uint64_t
+GpuTimeline::GetCompletedValue()
+{
+	if (IsTimelineSemaphore())
+	{
+		uint64_t value = 0;
+		VK_CHECK(m_vkGetSemaphoreCounterValue(m_device, m_semaphore, &value), "Failed to read the Timeline Semaphore!");
+		m_completed = std::max(m_completed, value);
+	}
+	else
+	{
+		PollFences();
+	}
+
+	return m_completed;
+}
+
+bool
+GpuTimeline::Wait(uint64_t value, uint64_t timeoutNs)
+{
+	if (value <= m_completed) return true;
+	if (value > m_submitted) return false;
+
+	if (IsTimelineSemaphore())
+	{
+		VkSemaphoreWaitInfoKHR waitInfo =
+		{
+			.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR,
+			.semaphoreCount = 1,
+			.pSemaphores    = &m_semaphore,
+			.pValues        = &value
+		};
+
+		const VkResult result = m_vkWaitSemaphores(m_device, &waitInfo, timeoutNs);
+		if (result == VK_TIMEOUT) return false;
+		VK_CHECK(result, "Failed to wait for the Timeline Semaphore!");
+
+		m_completed = std::max(m_completed, value);
+		return true;
+	}
+
+	// The first pending submit at or past the value, the ones before it finish first
+	const auto pending = std::ranges::find_if(m_pendingFences, [value](const auto &entry) -> bool { return entry.first >= value; });
+	if (pending == m_pendingFences.end()) return false;
+
+	const VkResult result = vkWaitForFences(m_device, 1, &pending->second, VK_TRUE, timeoutNs);
+	if (result == VK_TIMEOUT) return false;
+	VK_CHECK(result, "Failed to wait for a Fence!");
+
+	PollFences();
+	return true;
+}
+
+void
+GpuTimeline::PollFences()
+{
+	while (!m_pendingFences.empty())
+	{
+		const auto &[value, fence] = m_pendingFences.front();
+		if (vkGetFenceStatus(m_device, fence) != VK_SUCCESS) break;
+
+		VK_CHECK(vkResetFences(m_device, 1, &fence), "Failed to reset a Fence!");
+		m_freeFences.push_back(fence);
+		m_completed = value;
+		m_pendingFences.pop_front();
+	}
+}
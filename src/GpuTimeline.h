@@ -0,0 +1,119 @@
+#ifndef VULKAN_COURSE_GPU_TIMELINE_H
+#define VULKAN_COURSE_GPU_TIMELINE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "Utilities.h"
+
+/**
+ * @class GpuTimeline
+ * @brief A counter of the work submitted to one queue, raised as the submits complete and read back without blocking
+ * @details Backed by a timeline semaphore when the device has them: one object for the whole queue, any value can be
+ *          waited on or polled. Otherwise each submit gets a fence from a small pool, and the counter is the last
+ *          fence found signalled. A value reached means every earlier submit to the queue is done too.
+ *          Not thread safe, owned by the thread that submits to the queue
+ */
+class GpuTimeline
+{
+public:
+
+	GpuTimeline() = default;
+	~GpuTimeline() = default;
+
+	// Disallow copying, the pending fences belong to one queue
+	GpuTimeline(const GpuTimeline&) = delete;
+	GpuTimeline& operator=(const GpuTimeline&) = delete;
+
+	/**
+	 * @brief Create the timeline semaphore, or nothing if fences are used
+	 *
+	 * @param device The logical device
+	 * @param bTimelineSemaphores The timelineSemaphore feature is enabled on the device
+	 */
+	void Create(VkDevice device, bool bTimelineSemaphores);
+
+	/** @brief Destroy the semaphore and the fences. Nothing submitted may still be running */
+	void Destroy();
+
+	/**
+	 * @brief Submit a batch that raises the counter once it completes
+	 * @details The timeline semaphore is added to the signal semaphores of the batch, it can still signal binary ones
+	 *
+	 * @return The value the counter reaches once the batch is done
+	 */
+	uint64_t Submit(VkQueue queue, const VkSubmitInfo &submitInfo);
+
+	/** @brief Get the value of the last submit */
+	[[nodiscard]] uint64_t GetSubmittedValue() const;
+
+	/** @brief Get the value of the next submit. Resources retired now are free once it is reached */
+	[[nodiscard]] uint64_t GetNextValue() const;
+
+	/** @brief Poll the value of the last completed submit, never blocks */
+	uint64_t GetCompletedValue();
+
+	/** @brief Check if the submit of a value completed, never blocks */
+	bool IsComplete(uint64_t value);
+
+	/**
+	 * @brief Block until the counter reaches a value
+	 * @return False if the wait timed out, or the value was never submitted
+	 */
+	bool Wait(uint64_t value, uint64_t timeoutNs = UINT64_MAX);
+
+	/** @brief Checks if the counter is a timeline semaphore, and not a fence per submit */
+	[[nodiscard]] bool IsTimelineSemaphore() const;
+
+private:
+
+	/** @brief Most semaphores a submit can signal besides the timeline */
+	static constexpr uint32_t MAX_SIGNAL_SEMAPHORES = 7;
+
+	VkDevice    m_device    { VK_NULL_HANDLE };
+	VkSemaphore m_semaphore { VK_NULL_HANDLE };
+
+	PFN_vkGetSemaphoreCounterValueKHR m_vkGetSemaphoreCounterValue { nullptr };
+	PFN_vkWaitSemaphoresKHR           m_vkWaitSemaphores           { nullptr };
+
+	uint64_t m_submitted { 0 };
+	uint64_t m_completed { 0 };  // Last value seen completed, so a poll never goes back
+
+	/** @brief Fence of each submit not seen completed yet, in submission order. Without timeline semaphores only */
+	std::deque<std::pair<uint64_t, VkFence>> m_pendingFences { };
+	std::vector<VkFence>                     m_freeFences    { };
+
+	/** @brief Retire the signalled fences at the front of the pending ones */
+	void PollFences();
+};
+
+
+FORCE_INLINE uint64_t
+GpuTimeline::GetSubmittedValue() const
+{
+	return m_submitted;
+}
+
+FORCE_INLINE uint64_t
+GpuTimeline::GetNextValue() const
+{
+	return m_submitted + 1;
+}
+
+FORCE_INLINE bool
+GpuTimeline::IsComplete(uint64_t value)
+{
+	return value <= m_completed || value <= GetCompletedValue();
+}
+
+FORCE_INLINE bool
+GpuTimeline::IsTimelineSemaphore() const
+{
+	return m_semaphore != VK_NULL_HANDLE;
+}
+
+#endif //VULKAN_COURSE_GPU_TIMELINE_H
@@ -0,0 +1,755 @@
+#include "ImageKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define IMAGE_KERNELS_X86 1
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define IMAGE_KERNELS_TARGET_SSE2
+		#define IMAGE_KERNELS_TARGET_AVX2
+		#define IMAGE_KERNELS_HELPER_SSE2 static __forceinline
+		#define IMAGE_KERNELS_HELPER_AVX2 static __forceinline
+	#else
+		// Built for the baseline ISA, these functions only run once the CPU is known to support theirs
+		#define IMAGE_KERNELS_TARGET_SSE2 __attribute__((target("sse2")))
+		#define IMAGE_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+
+		// Inlined into the kernels of the same ISA, never called through the baseline ABI
+		#define IMAGE_KERNELS_HELPER_SSE2 static inline __attribute__((target("sse2"), always_inline))
+		#define IMAGE_KERNELS_HELPER_AVX2 static inline __attribute__((target("avx2"), always_inline))
+	#endif
+#endif
+
+// ======================================================================================================================
+// ============================================ Tables ==================================================================
+// ======================================================================================================================
+
+/** @brief Linear value of each sRGB code */
+static const std::array<float, 256> s_srgbToLinear = []() -> std::array<float, 256>
+{
+	std::array<float, 256> table {};
+	for (int i = 0; i < 256; ++i)
+	{
+		const double c = i / 255.0;
+		table[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow(( c + 0.055 ) / 1.055, 2.4));
+	}
+	return table;
+}();
+
+/**
+ * @brief Linear value half way between two sRGB codes: code k + 0.5 for k < 255, then infinity
+ * @details The code of a linear value is the number of thresholds below or at it, found with a binary search
+ */
+static const std::array<float, 256> s_srgbThresholds = []() -> std::array<float, 256>
+{
+	std::array<float, 256> table {};
+	for (int i = 0; i < 255; ++i)
+	{
+		const double c = ( i + 0.5 ) / 255.0;
+		table[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow(( c + 0.055 ) / 1.055, 2.4));
+	}
+	table[255] = std::numeric_limits<float>::infinity();
+	return table;
+}();
+
+/** @brief Linear values below 2^-13 are all code 0, the first threshold is above */
+constexpr int SRGB_BUCKET_MIN_EXPONENT = -13;
+
+/** @brief 2^-13 */
+constexpr float SRGB_BUCKET_MIN_VALUE = 1.0f / 8192.0f;
+
+/** @brief Buckets per power of two, enough for a code to change at most once inside a bucket */
+constexpr int SRGB_BUCKET_BITS = 7;
+
+/** @brief Float bits of the start of the first bucket */
+constexpr uint32_t SRGB_BUCKET_BASE = static_cast<uint32_t>(127 + SRGB_BUCKET_MIN_EXPONENT) << 23;
+
+/**
+ * @brief Code of the start of each bucket, a bucket being the exponent and top mantissa bits of a float in [2^-13, 1]
+ * @details The code of a value is its bucket code, plus one if the threshold of that code is below or at the value
+ */
+static const std::array<uint32_t, ( -SRGB_BUCKET_MIN_EXPONENT << SRGB_BUCKET_BITS ) + 1> s_srgbBuckets = []()
+{
+	std::array<uint32_t, ( -SRGB_BUCKET_MIN_EXPONENT << SRGB_BUCKET_BITS ) + 1> table {};
+	for (uint32_t bucket = 0; bucket < table.size(); ++bucket)
+	{
+		float start;
+		const uint32_t bits = SRGB_BUCKET_BASE + ( bucket << ( 23 - SRGB_BUCKET_BITS ) );
+		memcpy(&start, &bits, sizeof(start));
+
+		table[bucket] = static_cast<uint32_t>(std::upper_bound(s_srgbThresholds.begin(), s_srgbThresholds.end(), start) - s_srgbThresholds.begin());
+	}
+	return table;
+}();
+
+// ======================================================================================================================
+// ============================================ Scalar ==================================================================
+// ======================================================================================================================
+
+static void
+ExpandRGBToRGBAScalar(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, src += 3, dst += 4)
+	{
+		dst[0] = src[0];
+		dst[1] = src[1];
+		dst[2] = src[2];
+		dst[3] = 255;
+	}
+}
+
+static void
+PremultiplyAlphaScalar(uint8_t *pixels, size_t count)
+{
+	for (size_t i = 0; i < count; ++i, pixels += 4)
+	{
+		const uint32_t alpha = pixels[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			// Exact c * a / 255 rounded, without a division
+			const uint32_t x = pixels[c] * alpha + 128;
+			pixels[c] = static_cast<uint8_t>(( x + ( x >> 8 ) ) >> 8);
+		}
+	}
+}
+
+static void
+ConvertSRGBToLinearScalar(const uint8_t *src, float *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i) dst[i] = s_srgbToLinear[src[i]];
+}
+
+static void
+ConvertLinearToSRGBScalar(const float *src, uint8_t *dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		// Every value below the first bucket has the code of its start, 0
+		const float value = std::clamp(src[i], SRGB_BUCKET_MIN_VALUE, 1.0f);
+
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t code = s_srgbBuckets[( bits - SRGB_BUCKET_BASE ) >> ( 23 - SRGB_BUCKET_BITS )];
+		if (s_srgbThresholds[code] <= value) ++code;
+
+		dst[i] = static_cast<uint8_t>(code);
+	}
+}
+
+/** @brief Average 2x2 blocks of UNORM pixels into a row of dstWidth pixels, from the given source byte onward */
+static void
+DownsampleHalfRowScalar(const uint8_t *row0, const uint8_t *row1, uint8_t *dst, size_t firstByte, size_t dstBytes, uint32_t channels)
+{
+	for (size_t i = firstByte; i < dstBytes; ++i)
+	{
+		// Byte i of the destination is channel c of pixel p, which covers source pixels 2p and 2p + 1
+		const size_t p = i / channels;
+		const size_t c = i % channels;
+		const size_t a = 2 * p * channels + c;
+		const size_t b = a + channels;
+
+		dst[i] = static_cast<uint8_t>(( row0[a] + row0[b] + row1[a] + row1[b] + 2 ) / 4);
+	}
+}
+
+/** @brief Average the linear values of neighbour pixels of two rows, from the given destination value onward */
+static void
+AverageLinearPairsRangeScalar(const float *row0, const float *row1, float *dst, size_t first, size_t dstCount, uint32_t channels)
+{
+	for (size_t i = first; i < dstCount; ++i)
+	{
+		const size_t a = 2 * ( i / channels ) * channels + i % channels;
+		const size_t b = a + channels;
+		dst[i] = ( row0[a] + row0[b] + row1[a] + row1[b] ) * 0.25f;
+	}
+}
+
+static void
+AverageLinearPairsScalar(const float *row0, const float *row1, float *dst, size_t dstCount, uint32_t channels)
+{
+	AverageLinearPairsRangeScalar(row0, row1, dst, 0, dstCount, channels);
+}
+
+static void
+DownsampleHalfScalar(const uint8_t *src, uint32_t srcWidth, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels)
+{
+	const size_t srcStride = static_cast<size_t>(srcWidth) * channels;
+	const size_t dstStride = static_cast<size_t>(dstWidth) * channels;
+
+	for (uint32_t y = 0; y < dstHeight; ++y)
+	{
+		const uint8_t *row0 = src + 2 * y * srcStride;
+		DownsampleHalfRowScalar(row0, row0 + srcStride, dst + y * dstStride, 0, dstStride, channels);
+	}
+}
+
+// ======================================================================================================================
+// ============================================ SSE2 ====================================================================
+// ======================================================================================================================
+
+#ifdef IMAGE_KERNELS_X86
+
+/** @brief Premultiply 2 RGBA pixels widened to 16 bit lanes: (x + 128 + ((x + 128) >> 8)) >> 8, as the scalar version */
+IMAGE_KERNELS_HELPER_SSE2 __m128i
+PremultiplyWideSSE2(__m128i wide)
+{
+	const __m128i alphaMask = _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+	const __m128i alpha     = _mm_shufflehi_epi16(_mm_shufflelo_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m128i x = _mm_add_epi16(_mm_mullo_epi16(wide, alpha), _mm_set1_epi16(128));
+	x = _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+
+	// Alpha is kept as is
+	return _mm_or_si128(_mm_andnot_si128(alphaMask, x), _mm_and_si128(alphaMask, wide));
+}
+
+IMAGE_KERNELS_TARGET_SSE2 static void
+PremultiplyAlphaSSE2(uint8_t *pixels, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i *block = reinterpret_cast<__m128i *>(pixels + i * 4);
+		const __m128i v = _mm_loadu_si128(block);
+
+		const __m128i lo = PremultiplyWideSSE2(_mm_unpacklo_epi8(v, zero));
+		const __m128i hi = PremultiplyWideSSE2(_mm_unpackhi_epi8(v, zero));
+		_mm_storeu_si128(block, _mm_packus_epi16(lo, hi));
+	}
+
+	PremultiplyAlphaScalar(pixels + i * 4, count - i);
+}
+
+/** @brief Sum the 16 bit sums of neighbour pixels: the 8 lanes of lo and hi give the 8 pair sums, in order */
+IMAGE_KERNELS_HELPER_SSE2 __m128i
+SumPixelPairsSSE2(__m128i lo, __m128i hi, uint32_t channels)
+{
+	switch (channels)
+	{
+		case 1:
+		{
+			// Neighbours are the two halves of each 32 bit lane
+			const __m128i mask = _mm_set1_epi32(0x0000FFFF);
+			lo = _mm_and_si128(_mm_add_epi16(lo, _mm_srli_epi32(lo, 16)), mask);
+			hi = _mm_and_si128(_mm_add_epi16(hi, _mm_srli_epi32(hi, 16)), mask);
+			return _mm_packs_epi32(lo, hi);
+		}
+		case 2:
+		{
+			// The two halves of each 64 bit lane
+			lo = _mm_shuffle_epi32(_mm_add_epi16(lo, _mm_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			hi = _mm_shuffle_epi32(_mm_add_epi16(hi, _mm_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			return _mm_unpacklo_epi64(lo, hi);
+		}
+		default:
+		{
+			// The two halves of the register
+			lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+			hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+			return _mm_unpacklo_epi64(lo, hi);
+		}
+	}
+}
+
+IMAGE_KERNELS_TARGET_SSE2 static void
+DownsampleHalfSSE2(const uint8_t *src, uint32_t srcWidth, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels)
+{
+	const size_t  srcStride = static_cast<size_t>(srcWidth) * channels;
+	const size_t  dstStride = static_cast<size_t>(dstWidth) * channels;
+	const __m128i zero      = _mm_setzero_si128();
+	const __m128i two       = _mm_set1_epi16(2);
+
+	for (uint32_t y = 0; y < dstHeight; ++y)
+	{
+		const uint8_t *row0 = src + 2 * y * srcStride;
+		const uint8_t *row1 = row0 + srcStride;
+		uint8_t       *out  = dst + y * dstStride;
+
+		// 16 source bytes of both rows give 8 destination bytes
+		size_t i = 0;
+		for (; 2 * i + 16 <= srcStride; i += 8)
+		{
+			const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + 2 * i));
+			const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + 2 * i));
+
+			const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(v0, zero), _mm_unpacklo_epi8(v1, zero));
+			const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(v0, zero), _mm_unpackhi_epi8(v1, zero));
+
+			const __m128i sum = _mm_srli_epi16(_mm_add_epi16(SumPixelPairsSSE2(lo, hi, channels), two), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(sum, sum));
+		}
+
+		DownsampleHalfRowScalar(row0, row1, out, i, dstStride, channels);
+	}
+}
+
+/** @brief Split 8 values into the first and second pixel of each pair: a gets pixels 0, 2.., b pixels 1, 3.. */
+IMAGE_KERNELS_HELPER_SSE2 void
+SplitPixelPairsSSE2(__m128 v0, __m128 v1, uint32_t channels, __m128 *a, __m128 *b)
+{
+	switch (channels)
+	{
+		case 1:
+			*a = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+			*b = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+			return;
+		case 2:
+			*a = _mm_movelh_ps(v0, v1);
+			*b = _mm_movehl_ps(v1, v0);
+			return;
+		default:
+			*a = v0;
+			*b = v1;
+			return;
+	}
+}
+
+IMAGE_KERNELS_TARGET_SSE2 static void
+AverageLinearPairsSSE2(const float *row0, const float *row1, float *dst, size_t dstCount, uint32_t channels)
+{
+	const __m128 quarter = _mm_set1_ps(0.25f);
+
+	// 8 source values of both rows give 4 destination values, summed in the order of the scalar version
+	size_t i = 0;
+	for (; i + 4 <= dstCount; i += 4)
+	{
+		__m128 a0, b0, a1, b1;
+		SplitPixelPairsSSE2(_mm_loadu_ps(row0 + 2 * i), _mm_loadu_ps(row0 + 2 * i + 4), channels, &a0, &b0);
+		SplitPixelPairsSSE2(_mm_loadu_ps(row1 + 2 * i), _mm_loadu_ps(row1 + 2 * i + 4), channels, &a1, &b1);
+
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a0, b0), a1), b1), quarter));
+	}
+
+	AverageLinearPairsRangeScalar(row0, row1, dst, i, dstCount, channels);
+}
+
+// ======================================================================================================================
+// ============================================ AVX2 ====================================================================
+// ======================================================================================================================
+
+IMAGE_KERNELS_TARGET_AVX2 static void
+ExpandRGBToRGBAAVX2(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	// Each 128 bit lane takes 4 pixels from the first 12 bytes of its load
+	const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+	                                         0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m256i alpha   = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+	// 8 pixels per step, the second load reads 16 bytes from pixel 4: keep 10 pixels ahead in bounds
+	size_t i = 0;
+	for (; i + 10 <= count; i += 8)
+	{
+		const uint8_t *p  = src + i * 3;
+		const __m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))),
+		                                            _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12)), 1);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+	}
+
+	ExpandRGBToRGBAScalar(src + i * 3, dst + i * 4, count - i);
+}
+
+/** @brief Same as the SSE2 version, on 4 pixels */
+IMAGE_KERNELS_HELPER_AVX2 __m256i
+PremultiplyWideAVX2(__m256i wide)
+{
+	const __m256i alphaMask = _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1);
+	const __m256i alpha     = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(wide, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+
+	__m256i x = _mm256_add_epi16(_mm256_mullo_epi16(wide, alpha), _mm256_set1_epi16(128));
+	x = _mm256_srli_epi16(_mm256_add_epi16(x, _mm256_srli_epi16(x, 8)), 8);
+
+	return _mm256_or_si256(_mm256_andnot_si256(alphaMask, x), _mm256_and_si256(alphaMask, wide));
+}
+
+IMAGE_KERNELS_TARGET_AVX2 static void
+PremultiplyAlphaAVX2(uint8_t *pixels, size_t count)
+{
+	const __m256i zero = _mm256_setzero_si256();
+
+	// Unpack and pack both work per 128 bit lane, so the pixels come back in order
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m256i *block = reinterpret_cast<__m256i *>(pixels + i * 4);
+		const __m256i v = _mm256_loadu_si256(block);
+
+		const __m256i lo = PremultiplyWideAVX2(_mm256_unpacklo_epi8(v, zero));
+		const __m256i hi = PremultiplyWideAVX2(_mm256_unpackhi_epi8(v, zero));
+		_mm256_storeu_si256(block, _mm256_packus_epi16(lo, hi));
+	}
+
+	PremultiplyAlphaScalar(pixels + i * 4, count - i);
+}
+
+IMAGE_KERNELS_TARGET_AVX2 static void
+ConvertSRGBToLinearAVX2(const uint8_t *src, float *dst, size_t count)
+{
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i)));
+		_mm256_storeu_ps(dst + i, _mm256_i32gather_ps(s_srgbToLinear.data(), codes, 4));
+	}
+
+	ConvertSRGBToLinearScalar(src + i, dst + i, count - i);
+}
+
+IMAGE_KERNELS_TARGET_AVX2 static void
+ConvertLinearToSRGBAVX2(const float *src, uint8_t *dst, size_t count)
+{
+	const __m256  low  = _mm256_set1_ps(SRGB_BUCKET_MIN_VALUE);
+	const __m256  one  = _mm256_set1_ps(1.0f);
+	const __m256i base = _mm256_set1_epi32(static_cast<int>(SRGB_BUCKET_BASE));
+
+	// The bucket lookup of the scalar version, 8 values at once
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		const __m256  value  = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(src + i), one), low);
+		const __m256i bucket = _mm256_srli_epi32(_mm256_sub_epi32(_mm256_castps_si256(value), base), 23 - SRGB_BUCKET_BITS);
+
+		__m256i code = _mm256_i32gather_epi32(reinterpret_cast<const int *>(s_srgbBuckets.data()), bucket, 4);
+
+		const __m256  threshold = _mm256_i32gather_ps(s_srgbThresholds.data(), code, 4);
+		const __m256i below     = _mm256_castps_si256(_mm256_cmp_ps(threshold, value, _CMP_LE_OQ));
+		code = _mm256_sub_epi32(code, below); // below is -1 where the threshold is passed
+
+		const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(code), _mm256_extracti128_si256(code, 1));
+		_mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(words, words));
+	}
+
+	ConvertLinearToSRGBScalar(src + i, dst + i, count - i);
+}
+
+IMAGE_KERNELS_HELPER_AVX2 __m256i
+SumPixelPairsAVX2(__m256i lo, __m256i hi, uint32_t channels)
+{
+	// Same as the SSE2 version, per 128 bit lane
+	switch (channels)
+	{
+		case 1:
+		{
+			const __m256i mask = _mm256_set1_epi32(0x0000FFFF);
+			lo = _mm256_and_si256(_mm256_add_epi16(lo, _mm256_srli_epi32(lo, 16)), mask);
+			hi = _mm256_and_si256(_mm256_add_epi16(hi, _mm256_srli_epi32(hi, 16)), mask);
+			return _mm256_packs_epi32(lo, hi);
+		}
+		case 2:
+		{
+			lo = _mm256_shuffle_epi32(_mm256_add_epi16(lo, _mm256_srli_epi64(lo, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			hi = _mm256_shuffle_epi32(_mm256_add_epi16(hi, _mm256_srli_epi64(hi, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+			return _mm256_unpacklo_epi64(lo, hi);
+		}
+		default:
+		{
+			lo = _mm256_add_epi16(lo, _mm256_srli_si256(lo, 8));
+			hi = _mm256_add_epi16(hi, _mm256_srli_si256(hi, 8));
+			return _mm256_unpacklo_epi64(lo, hi);
+		}
+	}
+}
+
+IMAGE_KERNELS_TARGET_AVX2 static void
+DownsampleHalfAVX2(const uint8_t *src, uint32_t srcWidth, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels)
+{
+	const size_t  srcStride = static_cast<size_t>(srcWidth) * channels;
+	const size_t  dstStride = static_cast<size_t>(dstWidth) * channels;
+	const __m256i zero      = _mm256_setzero_si256();
+	const __m256i two       = _mm256_set1_epi16(2);
+
+	for (uint32_t y = 0; y < dstHeight; ++y)
+	{
+		const uint8_t *row0 = src + 2 * y * srcStride;
+		const uint8_t *row1 = row0 + srcStride;
+		uint8_t       *out  = dst + y * dstStride;
+
+		// 32 source bytes of both rows give 16 destination bytes, 8 per 128 bit lane
+		size_t i = 0;
+		for (; 2 * i + 32 <= srcStride; i += 16)
+		{
+			const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row0 + 2 * i));
+			const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row1 + 2 * i));
+
+			const __m256i lo = _mm256_add_epi16(_mm256_unpacklo_epi8(v0, zero), _mm256_unpacklo_epi8(v1, zero));
+			const __m256i hi = _mm256_add_epi16(_mm256_unpackhi_epi8(v0, zero), _mm256_unpackhi_epi8(v1, zero));
+
+			const __m256i sum    = _mm256_srli_epi16(_mm256_add_epi16(SumPixelPairsAVX2(lo, hi, channels), two), 2);
+			const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sum, sum), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm256_castsi256_si128(packed));
+		}
+
+		DownsampleHalfRowScalar(row0, row1, out, i, dstStride, channels);
+	}
+}
+
+/** @brief Same as the SSE2 version, on 16 values: 128 bit operations work per lane, the permutes put the pixels back in order */
+IMAGE_KERNELS_HELPER_AVX2 void
+SplitPixelPairsAVX2(__m256 v0, __m256 v1, uint32_t channels, __m256 *a, __m256 *b)
+{
+	switch (channels)
+	{
+		case 1:
+			*a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+			*b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+			return;
+		case 2:
+			*a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_unpacklo_pd(_mm256_castps_pd(v0), _mm256_castps_pd(v1)), _MM_SHUFFLE(3, 1, 2, 0)));
+			*b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_unpackhi_pd(_mm256_castps_pd(v0), _mm256_castps_pd(v1)), _MM_SHUFFLE(3, 1, 2, 0)));
+			return;
+		default:
+			*a = _mm256_permute2f128_ps(v0, v1, 0x20);
+			*b = _mm256_permute2f128_ps(v0, v1, 0x31);
+			return;
+	}
+}
+
+IMAGE_KERNELS_TARGET_AVX2 static void
+AverageLinearPairsAVX2(const float *row0, const float *row1, float *dst, size_t dstCount, uint32_t channels)
+{
+	const __m256 quarter = _mm256_set1_ps(0.25f);
+
+	size_t i = 0;
+	for (; i + 8 <= dstCount; i += 8)
+	{
+		__m256 a0, b0, a1, b1;
+		SplitPixelPairsAVX2(_mm256_loadu_ps(row0 + 2 * i), _mm256_loadu_ps(row0 + 2 * i + 8), channels, &a0, &b0);
+		SplitPixelPairsAVX2(_mm256_loadu_ps(row1 + 2 * i), _mm256_loadu_ps(row1 + 2 * i + 8), channels, &a1, &b1);
+
+		_mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a0, b0), a1), b1), quarter));
+	}
+
+	AverageLinearPairsRangeScalar(row0, row1, dst, i, dstCount, channels);
+}
+
+#endif // IMAGE_KERNELS_X86
+
+// ======================================================================================================================
+// ============================================ Dispatch ================================================================
+// ======================================================================================================================
+
+/**
+ * @struct imageKernelTable_t
+ * @brief The kernels of one instruction set
+ * @details SSE2 has no gather nor byte shuffle: its sRGB conversions and RGB expansion are the scalar ones, which
+ *          the compiler already vectorises as well as the SSE2 version could
+ */
+typedef struct imageKernelTable_t
+{
+	void (*expandRGBToRGBA)(const uint8_t *, uint8_t *, size_t);
+	void (*premultiplyAlpha)(uint8_t *, size_t);
+	void (*srgbToLinear)(const uint8_t *, float *, size_t);
+	void (*linearToSRGB)(const float *, uint8_t *, size_t);
+	void (*downsampleHalf)(const uint8_t *, uint32_t, uint8_t *, uint32_t, uint32_t, uint32_t);
+	void (*averageLinearPairs)(const float *, const float *, float *, size_t, uint32_t);
+} imageKernelTable_t;
+
+static const imageKernelTable_t s_kernelTables[] =
+{
+	{ ExpandRGBToRGBAScalar, PremultiplyAlphaScalar, ConvertSRGBToLinearScalar, ConvertLinearToSRGBScalar, DownsampleHalfScalar, AverageLinearPairsScalar },
+#ifdef IMAGE_KERNELS_X86
+	{ ExpandRGBToRGBAScalar, PremultiplyAlphaSSE2,   ConvertSRGBToLinearScalar, ConvertLinearToSRGBScalar, DownsampleHalfSSE2,   AverageLinearPairsSSE2 },
+	{ ExpandRGBToRGBAAVX2,   PremultiplyAlphaAVX2,   ConvertSRGBToLinearAVX2,   ConvertLinearToSRGBAVX2,   DownsampleHalfAVX2,   AverageLinearPairsAVX2 },
+#endif
+};
+
+/** @brief The level the kernels run with, the supported one unless overridden */
+static imageKernelLevel_e &
+ActiveLevel()
+{
+	static imageKernelLevel_e level = GetSupportedImageKernelLevel();
+	return level;
+}
+
+static const imageKernelTable_t &
+ActiveKernels()
+{
+	return s_kernelTables[ActiveLevel()];
+}
+
+/**
+ * @brief Exact halves of sRGB pixels, a row at a time through the dispatched kernels: decoded with the linear table,
+ *        averaged, encoded with the bucket table
+ * @details Sums in the order of the general box filter, so both give the same bytes
+ */
+static void
+DownsampleHalfSRGB(const uint8_t *src, uint32_t srcWidth, uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels)
+{
+	const size_t srcStride = static_cast<size_t>(srcWidth) * channels;
+	const size_t dstStride = static_cast<size_t>(dstWidth) * channels;
+
+	std::vector<float> linear0(srcStride);
+	std::vector<float> linear1(srcStride);
+	std::vector<float> average(dstStride);
+
+	for (uint32_t y = 0; y < dstHeight; ++y)
+	{
+		const uint8_t *row0 = src + 2 * y * srcStride;
+		const uint8_t *row1 = row0 + srcStride;
+		uint8_t       *out  = dst + y * dstStride;
+
+		ActiveKernels().srgbToLinear(row0, linear0.data(), srcStride);
+		ActiveKernels().srgbToLinear(row1, linear1.data(), srcStride);
+		ActiveKernels().averageLinearPairs(linear0.data(), linear1.data(), average.data(), dstStride, channels);
+		ActiveKernels().linearToSRGB(average.data(), out, dstStride);
+
+		// Alpha, the last channel of R8G8 and RGBA, is averaged as it is
+		if (channels != 2 && channels != 4) continue;
+
+		for (size_t i = channels - 1; i < dstStride; i += channels)
+		{
+			const size_t a = 2 * i - ( channels - 1 );
+			const size_t b = a + channels;
+			out[i] = static_cast<uint8_t>(( row0[a] + row0[b] + row1[a] + row1[b] + 2 ) / 4);
+		}
+	}
+}
+
+
+imageKernelLevel_e
+GetSupportedImageKernelLevel()
+{
+#ifdef IMAGE_KERNELS_X86
+	#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		const int maxLeaf = info[0];
+
+		__cpuid(info, 1);
+		const bool bSSE2    = ( info[3] & ( 1 << 26 ) ) != 0;
+		const bool bOSXSAVE = ( info[2] & ( 1 << 27 ) ) != 0;
+
+		// AVX2 also needs the OS to save the YMM registers
+		bool bAVX2 = false;
+		if (maxLeaf >= 7 && bOSXSAVE && ( _xgetbv(0) & 0x6 ) == 0x6)
+		{
+			__cpuidex(info, 7, 0);
+			bAVX2 = ( info[1] & ( 1 << 5 ) ) != 0;
+		}
+	#else
+		__builtin_cpu_init();
+		const bool bSSE2 = __builtin_cpu_supports("sse2");
+		const bool bAVX2 = __builtin_cpu_supports("avx2");
+	#endif
+
+	if (bAVX2) return IMAGE_KERNEL_AVX2;
+	if (bSSE2) return IMAGE_KERNEL_SSE2;
+#endif
+
+	return IMAGE_KERNEL_SCALAR;
+}
+
+imageKernelLevel_e
+GetImageKernelLevel()
+{
+	return ActiveLevel();
+}
+
+void
+SetImageKernelLevel(imageKernelLevel_e level)
+{
+	ActiveLevel() = std::min(level, GetSupportedImageKernelLevel());
+}
+
+const char *
+GetImageKernelLevelName(imageKernelLevel_e level)
+{
+	switch (level)
+	{
+		case IMAGE_KERNEL_SSE2: return "SSE2";
+		case IMAGE_KERNEL_AVX2: return "AVX2";
+		default:                return "Scalar";
+	}
+}
+
+void
+ExpandRGBToRGBA(const uint8_t *src, uint8_t *dst, size_t count)
+{
+	ActiveKernels().expandRGBToRGBA(src, dst, count);
+}
+
+void
+PremultiplyAlpha(uint8_t *pixels, size_t count)
+{
+	ActiveKernels().premultiplyAlpha(pixels, count);
+}
+
+void
+ConvertSRGBToLinear(const uint8_t *src, float *dst, size_t count)
+{
+	ActiveKernels().srgbToLinear(src, dst, count);
+}
+
+void
+ConvertLinearToSRGB(const float *src, uint8_t *dst, size_t count)
+{
+	ActiveKernels().linearToSRGB(src, dst, count);
+}
+
+void
+DownsampleTexels(const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight,
+                 uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels, bool bSRGB)
+{
+	// Exact halves, each destination pixel averages a 2x2 block
+	if (srcWidth == 2 * dstWidth && srcHeight == 2 * dstHeight)
+	{
+		if (bSRGB) DownsampleHalfSRGB(src, srcWidth, dst, dstWidth, dstHeight, channels);
+		else       ActiveKernels().downsampleHalf(src, srcWidth, dst, dstWidth, dstHeight, channels);
+		return;
+	}
+
+	// The last channel of R8G8 and RGBA is alpha, as GetFormatSwizzle shows grey plus alpha. R8 holds data or grey levels
+	const uint32_t colourChannels = channels == 2 || channels == 4 ? channels - 1 : channels;
+
+	for (uint32_t y = 0; y < dstHeight; ++y)
+	{
+		const uint32_t y0 = y * srcHeight / dstHeight;
+		const uint32_t y1 = std::max(y0 + 1, ( y + 1 ) * srcHeight / dstHeight);
+
+		for (uint32_t x = 0; x < dstWidth; ++x)
+		{
+			const uint32_t x0 = x * srcWidth / dstWidth;
+			const uint32_t x1 = std::max(x0 + 1, ( x + 1 ) * srcWidth / dstWidth);
+
+			uint32_t sum[4]       = { 0, 0, 0, 0 };
+			float    linearSum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (uint32_t sy = y0; sy < y1; ++sy)
+			{
+				const uint8_t *row = src + ( static_cast<size_t>(sy) * srcWidth + x0 ) * channels;
+				for (uint32_t sx = x0; sx < x1; ++sx, row += channels)
+				{
+					for (uint32_t c = 0; c < channels; ++c)
+					{
+						sum[c] += row[c];
+						if (bSRGB && c < colourChannels) linearSum[c] += s_srgbToLinear[row[c]];
+					}
+				}
+			}
+
+			const uint32_t count = ( y1 - y0 ) * ( x1 - x0 );
+			uint8_t *out = dst + ( static_cast<size_t>(y) * dstWidth + x ) * channels;
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				if (bSRGB && c < colourChannels)
+				{
+					const float average = linearSum[c] / static_cast<float>(count);
+					ConvertLinearToSRGBScalar(&average, &out[c], 1);
+					continue;
+				}
+
+				out[c] = static_cast<uint8_t>(( sum[c] + count / 2 ) / count);
+			}
+		}
+	}
+}
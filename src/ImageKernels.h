@@ -0,0 +1,75 @@
+#ifndef VULKAN_COURSE_IMAGE_KERNELS_H
+#define VULKAN_COURSE_IMAGE_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Pixel kernels of the texture ingestion, each with a scalar reference and SSE2 / AVX2 versions picked at runtime.
+ * Every SIMD version gives the same bytes as the scalar one.
+ */
+
+/**
+ * @enum imageKernelLevel_e
+ * @brief Instruction set the kernels run with
+ */
+typedef enum imageKernelLevel_e : uint8_t
+{
+	IMAGE_KERNEL_SCALAR = 0,
+	IMAGE_KERNEL_SSE2,
+	IMAGE_KERNEL_AVX2
+} imageKernelLevel_e;
+
+/** @brief Get the best instruction set of this CPU the kernels were built with */
+imageKernelLevel_e GetSupportedImageKernelLevel();
+
+/** @brief Get the instruction set the kernels run with */
+imageKernelLevel_e GetImageKernelLevel();
+
+/**
+ * @brief Set the instruction set the kernels run with, capped to the supported one
+ * @details Not thread safe, call it before the texture workers start. Meant for benchmarks
+ */
+void SetImageKernelLevel(imageKernelLevel_e level);
+
+/** @brief Get the name of an instruction set, for logs */
+const char *GetImageKernelLevelName(imageKernelLevel_e level);
+
+/**
+ * @brief Expand RGB8 pixels to RGBA8, with an opaque alpha
+ *
+ * @param src The RGB pixels, tightly packed
+ * @param dst The RGBA pixels, must not overlap src
+ * @param count The number of pixels
+ */
+void ExpandRGBToRGBA(const uint8_t *src, uint8_t *dst, size_t count);
+
+/**
+ * @brief Multiply the colour of RGBA8 pixels by their alpha, in place
+ * @details Rounded to nearest: c * a / 255
+ */
+void PremultiplyAlpha(uint8_t *pixels, size_t count);
+
+/** @brief Decode sRGB encoded 8 bit values to linear floats */
+void ConvertSRGBToLinear(const uint8_t *src, float *dst, size_t count);
+
+/** @brief Encode linear floats to 8 bit sRGB, clamped to [0, 1] and rounded to the nearest step */
+void ConvertLinearToSRGB(const float *src, uint8_t *dst, size_t count);
+
+/**
+ * @brief Shrink 8 bit pixels with a box filter
+ * @details Each destination pixel is the rounded average of the source pixels it covers.
+ *          sRGB colour channels are averaged in linear space, alpha (the last channel of R8G8 and RGBA) never is.
+ *          Exact halves, the common mip case, take the SIMD path: UNORM pixels in integers, sRGB ones decoded with a
+ *          table, averaged as floats and encoded again (table lookups need AVX2 gathers, SSE2 only averages).
+ *          Other sizes, odd mip levels included, take the scalar box filter at every level
+ *
+ * @param src The source pixels, tightly packed
+ * @param dst The destination pixels, tightly packed
+ * @param channels The channels per pixel: 1, 2 or 4
+ * @param bSRGB The colour channels are sRGB encoded
+ */
+void DownsampleTexels(const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight,
+                      uint8_t *dst, uint32_t dstWidth, uint32_t dstHeight, uint32_t channels, bool bSRGB);
+
+#endif //VULKAN_COURSE_IMAGE_KERNELS_H
@@ -51,10 +51,25 @@ public:
   /** @brief Get the texture ID */
   [[nodiscard]] int GetTextureID() const;
 
+	/** @brief Get the pipeline variant the mesh is drawn with, -1 for the default one */
+	[[nodiscard]] int GetPipeline() const;
+
+	/** @brief Set the pipeline variant the mesh is drawn with, -1 for the default one */
+	void SetPipeline(int pipeline);
+
 	/** @brief Set the model data */
 	void SetModel(glm::mat4 model);
 
-	/** @brief Destroy the vertex buffer */
+	/** @brief Checks if the mesh created its buffers, instances draw the buffers of another mesh */
+	[[nodiscard]] bool OwnsBuffers() const;
+
+	/**
+	 * @brief Get a mesh drawing the same vertex and index buffers, with its own model, texture and pipeline
+	 * @details The buffers stay owned by this mesh, its instances must not be drawn once it is destroyed
+	 */
+	[[nodiscard]] Mesh CreateInstance(int newTexID) const;
+
+	/** @brief Destroy the vertex buffer. Nothing for an instance */
 	void DestroyVertexBuffer();
 
 private:
@@ -78,6 +93,12 @@ private:
   // Texture
   int m_textureID { -1 };
 
+	// Pipeline variant
+	int m_pipeline  { -1 };
+
+	// Buffers created by this mesh, not shared from another one
+	bool m_bOwnsBuffers { true };
+
 	/**
 	 * @brief Create the vertex buffer
 	 * @param transferQueue The queue to use for transfer operations
@@ -126,6 +147,18 @@ Mesh::GetTextureID() const
   return m_textureID;
 }
 
+FORCE_INLINE int
+Mesh::GetPipeline() const
+{
+	return m_pipeline;
+}
+
+FORCE_INLINE void
+Mesh::SetPipeline(int pipeline)
+{
+	m_pipeline = pipeline;
+}
+
 FORCE_INLINE void
 Mesh::SetModel(glm::mat4 model)
 {
@@ -138,9 +171,28 @@ Mesh::GetModel() const
 	return m_model;
 }
 
+FORCE_INLINE bool
+Mesh::OwnsBuffers() const
+{
+	return m_bOwnsBuffers;
+}
+
+FORCE_INLINE Mesh
+Mesh::CreateInstance(int newTexID) const
+{
+	Mesh instance = *this;
+	instance.m_model        = { .mat = glm::mat4(1.0f) };
+	instance.m_textureID    = newTexID;
+	instance.m_pipeline     = -1;
+	instance.m_bOwnsBuffers = false;
+	return instance;
+}
+
 FORCE_INLINE void
 Mesh::DestroyVertexBuffer()
 {
+	if (!m_bOwnsBuffers) return;
+
 	vkDestroyBuffer(m_devices.logicalDevice, m_vertexBuffer, nullptr);
 	vkFreeMemory(m_devices.logicalDevice, m_vertexBufferMemory, nullptr);
 
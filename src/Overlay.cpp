@@ -0,0 +1,232 @@
+#include "Overlay.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include "imgui.h"
+#include "backends/imgui_impl_vulkan.h"
+
+namespace
+{
+	FORCE_INLINE float
+	ToMiB(VkDeviceSize bytes)
+	{
+		return static_cast<float>(bytes) / (1024.0f * 1024.0f);
+	}
+
+	/** @brief 8 bit linear value of each sRGB code */
+	const std::array<uint8_t, 256> s_srgbToLinear = []()
+	{
+		std::array<uint8_t, 256> table {};
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			const double c = i / 255.0;
+			table[i] = static_cast<uint8_t>(std::lround(( c <= 0.04045 ? c / 12.92 : std::pow(( c + 0.055 ) / 1.055, 2.4) ) * 255.0));
+		}
+		return table;
+	}();
+
+	/** @brief Convert the colours of every vertex from sRGB to linear, alpha kept */
+	void
+	LineariseVertexColours(ImDrawData *drawData)
+	{
+		for (int list = 0; list < drawData->CmdListsCount; ++list)
+		{
+			for (ImDrawVert &vertex : drawData->CmdLists[list]->VtxBuffer)
+			{
+				const ImU32 r = s_srgbToLinear[( vertex.col >> IM_COL32_R_SHIFT ) & 0xFF];
+				const ImU32 g = s_srgbToLinear[( vertex.col >> IM_COL32_G_SHIFT ) & 0xFF];
+				const ImU32 b = s_srgbToLinear[( vertex.col >> IM_COL32_B_SHIFT ) & 0xFF];
+				vertex.col = ( vertex.col & IM_COL32_A_MASK ) | r << IM_COL32_R_SHIFT | g << IM_COL32_G_SHIFT | b << IM_COL32_B_SHIFT;
+			}
+		}
+	}
+}
+
+void
+Overlay::Create(VkInstance instance, const device_t &devices, uint32_t queueFamily, VkQueue queue, VkRenderPass renderPass,
+                VkPipelineCache pipelineCache, bool bSRGBTarget)
+{
+	m_device      = devices.logicalDevice;
+	m_bSRGBTarget = bSRGBTarget;
+
+	// The font is the only texture, the backend frees its set on shutdown
+	VkDescriptorPoolSize poolSize = { .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, .descriptorCount = 1 };
+	VkDescriptorPoolCreateInfo poolCreateInfo =
+	{
+		.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+		.maxSets       = 1,
+		.poolSizeCount = 1,
+		.pPoolSizes    = &poolSize
+	};
+	VK_CHECK(vkCreateDescriptorPool(m_device, &poolCreateInfo, nullptr, &m_descriptorPool), "Failed to create the overlay Descriptor Pool!");
+
+	IMGUI_CHECKVERSION();
+	ImGui::CreateContext();
+
+	ImGuiIO &io = ImGui::GetIO();
+	io.IniFilename         = nullptr;   // Nothing to remember, the window does not move
+	io.LogFilename         = nullptr;
+	io.BackendPlatformName = "VulkanCourse";
+	ImGui::StyleColorsDark();
+
+	ImGui_ImplVulkan_InitInfo initInfo =
+	{
+		.Instance        = instance,
+		.PhysicalDevice  = devices.physicalDevice,
+		.Device          = devices.logicalDevice,
+		.QueueFamily     = queueFamily,
+		.Queue           = queue,
+		.DescriptorPool  = m_descriptorPool,
+		.RenderPass      = renderPass,
+		.MinImageCount   = 2,
+		.ImageCount      = MAX_FRAME_DRAWS,   // Vertex buffers of a frame are reused this many frames later, the GPU is done with them by then
+		.MSAASamples     = VK_SAMPLE_COUNT_1_BIT,
+		.PipelineCache   = pipelineCache,
+		.Subpass         = 0,
+		.CheckVkResultFn = [](VkResult result) -> void { VK_CHECK(result, "ImGui Vulkan backend call failed!"); }
+	};
+	if (!ImGui_ImplVulkan_Init(&initInfo)) throw std::runtime_error("Failed to initialise the ImGui Vulkan backend!");
+
+	// Uploaded now, NewFrame would otherwise do it on the first frame shown and wait for the device there
+	ImGui_ImplVulkan_CreateFontsTexture();
+
+	m_bCreated = true;
+}
+
+void
+Overlay::Destroy()
+{
+	if (!m_bCreated) return;
+
+	if (m_shownFrames > 0)
+	{
+		fprintf(stdout, "[INFO] Overlay: shown %llu frames, %.3f ms of CPU per frame shown\n",
+				static_cast<unsigned long long>(m_shownFrames), m_totalCostMs / static_cast<double>(m_shownFrames));
+	}
+
+	ImGui_ImplVulkan_Shutdown();
+	ImGui::DestroyContext();
+
+	vkDestroyDescriptorPool(m_device, m_descriptorPool, nullptr);
+	m_descriptorPool = VK_NULL_HANDLE;
+	m_bCreated       = false;
+}
+
+void
+Overlay::Build(const overlayStats_t &stats, VkExtent2D extent)
+{
+	if (!m_bCreated) return;
+
+	const auto buildStart = std::chrono::steady_clock::now();
+
+	ImGuiIO &io = ImGui::GetIO();
+	io.DisplaySize = ImVec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+	io.DeltaTime   = m_lastBuildTime == std::chrono::steady_clock::time_point { }
+	               ? 1.0f / 60.0f : std::max(std::chrono::duration<float>(buildStart - m_lastBuildTime).count(), 1e-4f);
+	m_lastBuildTime = buildStart;
+
+	ImGui_ImplVulkan_NewFrame();
+	ImGui::NewFrame();
+
+	constexpr ImGuiWindowFlags windowFlags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+	                                         ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoSavedSettings |
+	                                         ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+	ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_Always);
+	ImGui::SetNextWindowBgAlpha(0.75f);
+
+	if (ImGui::Begin("Performance", nullptr, windowFlags))
+	{
+		// ------- Frame times -------
+		ImGui::TextUnformatted("Frame times (ms)");
+		PlotFrameTimes("CPU", m_history.cpuMs);
+		PlotFrameTimes("GPU", m_history.gpuMs);
+		PlotFrameTimes("Present", m_history.presentMs);
+
+		// ------- Draws -------
+		ImGui::Separator();
+		ImGui::Text("Draws %u, instances %u, triangles %llu", stats.draws.drawCalls, stats.draws.instances,
+		            static_cast<unsigned long long>(stats.draws.triangles));
+
+		// ------- Memory -------
+		ImGui::Separator();
+		ImGui::Text("Device memory: %.1f MiB", ToMiB(stats.textureBytes + stats.meshBytes + stats.uniformBytes +
+		                                             stats.depthBytes + stats.stagingBytes));
+		ImGui::Text("  Textures  %8.2f MiB", ToMiB(stats.textureBytes));
+		ImGui::Text("  Meshes    %8.2f MiB", ToMiB(stats.meshBytes));
+		ImGui::Text("  Uniforms  %8.2f MiB", ToMiB(stats.uniformBytes));
+		ImGui::Text("  Depth     %8.2f MiB", ToMiB(stats.depthBytes));
+		ImGui::Text("  Staging   %8.2f MiB", ToMiB(stats.stagingBytes));
+
+		const float stagingFraction = stats.stagingBytes ? static_cast<float>(stats.stagingUsed) / static_cast<float>(stats.stagingBytes) : 0.0f;
+		char stagingLabel[64];
+		snprintf(stagingLabel, sizeof(stagingLabel), "%.1f / %.1f MiB staged", ToMiB(stats.stagingUsed), ToMiB(stats.stagingBytes));
+		ImGui::ProgressBar(stagingFraction, ImVec2(240.0f, 0.0f), stagingLabel);
+
+		// ------- Texture residency -------
+		ImGui::Separator();
+		const textureResidencyStats_t &residency = stats.residency;
+		ImGui::Text("Textures: %u resident, %u on fallback", residency.residentTextures, residency.evictedTextures);
+		ImGui::Text("  %.1f MiB of %.1f MiB budget", ToMiB(residency.residentBytes), ToMiB(residency.budgetBytes));
+		ImGui::Text("  %u evictions, %u stream-ins (avg %.1f ms, max %.1f ms)", residency.evictions, residency.streamIns,
+		            residency.averageStreamInMs, residency.maxStreamInMs);
+
+		// ------- Pipelines -------
+		ImGui::Separator();
+		ImGui::Text("Pipeline cache: %s, %u pipelines in %.1f ms", stats.pipelineCache.bLoaded ? "hit" : "miss",
+		            stats.pipelineCache.pipelines, stats.pipelineCache.creationMs);
+		ImGui::Text("  %u variants, %u compiled, %u failed, %u fallback draws", stats.pipelines.variants,
+		            stats.pipelines.compiled, stats.pipelines.failed, stats.pipelines.fallbackDraws);
+
+		// ------- Own cost -------
+		ImGui::Separator();
+		ImGui::Text("Overlay: build %.3f ms, record %.3f ms", m_buildMs, m_recordMs);
+	}
+	ImGui::End();
+
+	ImGui::Render();
+
+	// The style and widget colours are sRGB, an sRGB target would encode them a second time and wash them out
+	if (m_bSRGBTarget) LineariseVertexColours(ImGui::GetDrawData());
+
+	m_bBuilt  = true;
+	m_buildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+}
+
+void
+Overlay::Record(VkCommandBuffer commandBuffer)
+{
+	// Hidden, or shown while the frame was already past its build
+	if (!m_bBuilt) return;
+
+	const auto recordStart = std::chrono::steady_clock::now();
+
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
+	m_bBuilt = false;
+
+	m_recordMs     = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+	m_totalCostMs += m_buildMs + m_recordMs;
+	++m_shownFrames;
+}
+
+void
+Overlay::PlotFrameTimes(const char *label, const std::array<float, OVERLAY_HISTORY_FRAMES> &values) const
+{
+	float total = 0.0f, worst = 0.0f;
+	for (const float value : values)
+	{
+		total += value;
+		worst  = std::max(worst, value);
+	}
+
+	char caption[64];
+	snprintf(caption, sizeof(caption), "avg %.2f  max %.2f", total / static_cast<float>(values.size()), worst);
+
+	// Oldest frame first, the ring starts at the next slot to write
+	ImGui::PlotLines(label, values.data(), static_cast<int>(values.size()), static_cast<int>(m_history.next), caption,
+	                 0.0f, std::max(worst * 1.2f, 1.0f), ImVec2(240.0f, 40.0f));
+}
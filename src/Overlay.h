@@ -0,0 +1,174 @@
+#ifndef VULKAN_COURSE_OVERLAY_H
+#define VULKAN_COURSE_OVERLAY_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "PipelineCache.h"
+#include "PipelineManager.h"
+#include "Texture.h"
+#include "Utilities.h"
+
+/**
+ * @struct drawStats_t
+ * @brief What a frame drew
+ */
+typedef struct drawStats_t
+{
+	uint32_t drawCalls { 0 };
+	uint32_t instances { 0 };
+	uint64_t triangles { 0 };
+
+	/** @brief Count an indexed triangle list draw */
+	FORCE_INLINE void
+	Add(uint32_t indexCount, uint32_t instanceCount)
+	{
+		++drawCalls;
+		instances += instanceCount;
+		triangles += static_cast<uint64_t>(indexCount / 3) * instanceCount;
+	}
+} drawStats_t;
+
+/**
+ * @struct overlayStats_t
+ * @brief What the renderer hands the overlay for a frame. Only gathered while the overlay is shown
+ */
+typedef struct overlayStats_t
+{
+	drawStats_t             draws           {   };   // Of the last frame recorded
+
+	// Device memory by category
+	VkDeviceSize            textureBytes    { 0 };
+	VkDeviceSize            meshBytes       { 0 };
+	VkDeviceSize            uniformBytes    { 0 };
+	VkDeviceSize            depthBytes      { 0 };
+	VkDeviceSize            stagingBytes    { 0 };   // Capacity of the staging ring
+	VkDeviceSize            stagingUsed     { 0 };   // Part of it held by uploads in flight
+
+	pipelineCacheStats_t    pipelineCache   {   };
+	pipelineManagerStats_t  pipelines       {   };
+	textureResidencyStats_t residency       {   };
+} overlayStats_t;
+
+
+/**
+ * @class Overlay
+ * @brief Dear ImGui window drawn over the scene with frame time graphs and the renderer counters
+ * @details Driven from the render thread only, with no platform backend: the events are polled on the main thread, so
+ *          the overlay takes no input and its size comes from the swap chain. Shown or hidden from any thread.
+ *          While hidden a frame costs the three frame times written to the graphs and the visibility check
+ */
+class Overlay
+{
+public:
+
+	Overlay() = default;
+	~Overlay() = default;
+
+	// Disallow copying, the ImGui context is global
+	Overlay(const Overlay&) = delete;
+	Overlay& operator=(const Overlay&) = delete;
+
+	/**
+	 * @brief Create the ImGui context, its descriptor pool and the Vulkan backend, and upload the font
+	 * @details Waits for the queue once, for the font upload
+	 *
+	 * @param instance The Vulkan instance
+	 * @param devices The physical and logical devices
+	 * @param queueFamily Family of the queue the overlay is drawn on
+	 * @param queue The queue, the font is uploaded on it
+	 * @param renderPass The render pass the overlay is drawn in, in its last subpass
+	 * @param pipelineCache The cache the overlay pipeline is built with
+	 * @param bSRGBTarget The render pass draws into an sRGB image: the colours are converted to linear each frame
+	 */
+	void Create(VkInstance instance, const device_t &devices, uint32_t queueFamily, VkQueue queue, VkRenderPass renderPass,
+	            VkPipelineCache pipelineCache, bool bSRGBTarget);
+
+	/** @brief Destroy the backend, the context and the descriptor pool. Nothing submitted may still use them */
+	void Destroy();
+
+	/** @brief Show or hide the overlay from the next frame. Any thread */
+	void SetVisible(bool bVisible);
+
+	/** @brief Checks if the overlay is shown. Any thread */
+	[[nodiscard]] bool IsVisible() const;
+
+	/**
+	 * @brief Add the times of a frame to the graphs, shown or not
+	 *
+	 * @param cpuMs Time the CPU spent in the frame
+	 * @param gpuMs Time the GPU spent on the last frame read back
+	 * @param presentMs Interval since the previous present
+	 */
+	void AddFrameTimes(float cpuMs, float gpuMs, float presentMs);
+
+	/** @brief Lay out the overlay for the frame being recorded. CPU only, call it outside the render pass */
+	void Build(const overlayStats_t &stats, VkExtent2D extent);
+
+	/** @brief Record the overlay built for this frame, if any, in the render pass */
+	void Record(VkCommandBuffer commandBuffer);
+
+private:
+
+	/** @brief Frame times of the last frames, a ring */
+	typedef struct frameTimeHistory_t
+	{
+		std::array<float, OVERLAY_HISTORY_FRAMES> cpuMs     {   };
+		std::array<float, OVERLAY_HISTORY_FRAMES> gpuMs     {   };
+		std::array<float, OVERLAY_HISTORY_FRAMES> presentMs {   };
+		uint32_t                                  next      { 0 };   // Slot the next frame goes into, the oldest one
+	} frameTimeHistory_t;
+
+	VkDevice                              m_device         { VK_NULL_HANDLE };
+	VkDescriptorPool                      m_descriptorPool { VK_NULL_HANDLE };
+	bool                                  m_bCreated       { false };
+	bool                                  m_bSRGBTarget    { false };
+
+	std::atomic<bool>                     m_bVisible       { OVERLAY_VISIBLE_AT_START };
+
+	/** @brief A frame was built and not recorded yet */
+	bool                                  m_bBuilt         { false };
+
+	frameTimeHistory_t                    m_history        {   };
+
+	/** @brief CPU time of the last Build and Record, the cost of showing the overlay */
+	float                                 m_buildMs        { 0.0f };
+	float                                 m_recordMs       { 0.0f };
+	double                                m_totalCostMs    { 0.0 };
+	uint64_t                              m_shownFrames    { 0 };
+
+	/** @brief Time of the last Build, ImGui animates on the time between two */
+	std::chrono::steady_clock::time_point m_lastBuildTime  {   };
+
+	/** @brief Draw the graph of a frame time with its average and worst value */
+	void PlotFrameTimes(const char *label, const std::array<float, OVERLAY_HISTORY_FRAMES> &values) const;
+};
+
+
+FORCE_INLINE void
+Overlay::SetVisible(bool bVisible)
+{
+	m_bVisible.store(bVisible, std::memory_order_relaxed);
+}
+
+FORCE_INLINE bool
+Overlay::IsVisible() const
+{
+	return m_bVisible.load(std::memory_order_relaxed);
+}
+
+FORCE_INLINE void
+Overlay::AddFrameTimes(float cpuMs, float gpuMs, float presentMs)
+{
+	m_history.cpuMs[m_history.next]     = cpuMs;
+	m_history.gpuMs[m_history.next]     = gpuMs;
+	m_history.presentMs[m_history.next] = presentMs;
+	m_history.next                      = (m_history.next + 1) % OVERLAY_HISTORY_FRAMES;
+}
+
+#endif //VULKAN_COURSE_OVERLAY_H
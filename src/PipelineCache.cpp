@@ -0,0 +1,151 @@
+#include "PipelineCache.h"
+
+#include <filesystem>
+#include <fstream>
+
+void
+PipelineCache::Create(const device_t &devices, const std::string &filePath)
+{
+	m_devices  = devices;
+	m_filePath = filePath;
+	m_stats    = { };
+
+	std::vector<char> data;
+	const char       *rejected = "no cache file";
+
+	std::error_code error;
+	if (std::filesystem::exists(m_filePath, error))
+	{
+		data     = ReadFile(m_filePath);
+		rejected = ValidateData(data);
+	}
+
+	if (rejected) data.clear();
+
+	VkPipelineCacheCreateInfo cacheCreateInfo =
+	{
+		.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = data.size(),                         // Empty starts a new cache
+		.pInitialData    = data.empty() ? nullptr : data.data()
+	};
+
+	VK_CHECK(vkCreatePipelineCache(m_devices.logicalDevice, &cacheCreateInfo, nullptr, &m_cache),
+			 "Failed to create Pipeline Cache!");
+
+	m_saveWorker = std::make_unique<ThreadPool>(1);
+	m_bSaving    = false;
+
+	m_stats.bLoaded     = !data.empty();
+	m_stats.loadedBytes = data.size();
+	m_savedHash         = HashFNV1a(data.data(), data.size());
+
+	if (m_stats.bLoaded) fprintf(stdout, "[INFO] Pipeline cache hit: %zu bytes from '%s'\n", data.size(), m_filePath.c_str());
+	else fprintf(stdout, "[INFO] Pipeline cache miss: %s\n", rejected);
+}
+
+void
+PipelineCache::Destroy()
+{
+	if (m_cache == VK_NULL_HANDLE) return;
+
+	// Joining the worker finishes a background save, it reads the cache
+	m_saveWorker.reset();
+
+	if (!Save()) fprintf(stderr, "[ERROR] Failed to write pipeline cache: '%s'\n", m_filePath.c_str());
+
+	const pipelineCacheStats_t stats = GetStats();
+	fprintf(stdout, "[INFO] Pipeline cache: %u pipelines created in %.1f ms, %s, %zu bytes saved\n",
+			stats.pipelines, stats.creationMs, stats.bLoaded ? "hit" : "miss", stats.savedBytes);
+
+	vkDestroyPipelineCache(m_devices.logicalDevice, m_cache, nullptr);
+	m_cache = VK_NULL_HANDLE;
+}
+
+bool
+PipelineCache::Save()
+{
+	if (m_cache == VK_NULL_HANDLE) return false;
+
+	// The size can grow between the two calls, VK_INCOMPLETE then asks for another try
+	std::vector<char> data;
+	VkResult          result;
+	do
+	{
+		size_t dataSize = 0;
+		VK_CHECK(vkGetPipelineCacheData(m_devices.logicalDevice, m_cache, &dataSize, nullptr), "Failed to get Pipeline Cache size!");
+
+		data.resize(dataSize);
+		result = vkGetPipelineCacheData(m_devices.logicalDevice, m_cache, &dataSize, data.data());
+		data.resize(dataSize);
+	} while (result == VK_INCOMPLETE);
+
+	VK_CHECK(result, "Failed to get Pipeline Cache data!");
+
+	const uint64_t hash = HashFNV1a(data.data(), data.size());
+	if (hash == m_savedHash) return true;
+
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(m_filePath).parent_path(), error);
+
+	const std::string tempPath = m_filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!file)
+		{
+			file.close();
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempPath, m_filePath, error);
+	if (error) return false;
+
+	m_savedHash = hash;
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.savedBytes = data.size();
+	return true;
+}
+
+void
+PipelineCache::SaveAsync()
+{
+	if (m_cache == VK_NULL_HANDLE || m_bSaving.exchange(true)) return;
+
+	m_saveWorker->Enqueue([this]() -> void
+	{
+		if (!Save()) fprintf(stderr, "[ERROR] Failed to write pipeline cache: '%s'\n", m_filePath.c_str());
+		m_bSaving = false;
+	});
+}
+
+void
+PipelineCache::AddPipeline(float creationMs)
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+
+	++m_stats.pipelines;
+	m_stats.creationMs += creationMs;
+}
+
+const char *
+PipelineCache::ValidateData(const std::vector<char> &data) const
+{
+	VkPipelineCacheHeaderVersionOne header;
+	if (data.size() < sizeof(header)) return "cache file truncated";
+
+	memcpy(&header, data.data(), sizeof(header));
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_devices.physicalDevice, &properties);
+
+	if (header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header.headerSize < sizeof(header)) return "unknown cache header";
+	if (header.vendorID != properties.vendorID || header.deviceID != properties.deviceID) return "cache written for another device";
+	if (memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) return "cache written by another driver";
+
+	return nullptr;
+}
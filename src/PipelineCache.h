@@ -0,0 +1,117 @@
+#ifndef VULKAN_COURSE_PIPELINE_CACHE_H
+#define VULKAN_COURSE_PIPELINE_CACHE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "ThreadPool.hpp"
+#include "Utilities.h"
+
+/**
+ * @struct pipelineCacheStats_t
+ * @brief What the pipeline cache saved, for the logs
+ */
+typedef struct pipelineCacheStats_t
+{
+	bool     bLoaded      { false }; // The file matched this driver and device, pipelines are built from it
+	size_t   loadedBytes  { 0 };     // Size of the data read at startup
+	size_t   savedBytes   { 0 };     // Size of the data last written
+	uint32_t pipelines    { 0 };     // Pipelines created with the cache
+	float    creationMs   { 0.0f };  // Time spent creating them
+} pipelineCacheStats_t;
+
+
+/**
+ * @class PipelineCache
+ * @brief A VkPipelineCache kept on disk between runs
+ * @details The file is only used when its header matches the device and driver, otherwise the cache starts empty
+ *          and the file is replaced on the next save
+ */
+class PipelineCache
+{
+public:
+
+	PipelineCache() = default;
+	~PipelineCache() = default;
+
+	// Disallow copying, the cache handle is owned
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	/**
+	 * @brief Create the cache, seeded with the file if it was written for this device and driver
+	 * @param devices The physical and logical devices
+	 * @param filePath The cache file, created on the first save
+	 */
+	void Create(const device_t &devices, const std::string &filePath);
+
+	/** @brief Wait for a background save, save the cache and destroy it */
+	void Destroy();
+
+	/**
+	 * @brief Write the cache to its file if it changed since the last save
+	 * @details Written to a temporary file renamed over the target, a crash never leaves a partial file
+	 *
+	 * @return False if the file could not be written
+	 */
+	bool Save();
+
+	/**
+	 * @brief Save on a worker thread, the calling thread neither reads the cache data nor writes the file
+	 * @details Skipped while the previous save still runs. A failed save is logged
+	 */
+	void SaveAsync();
+
+	/** @brief Count a pipeline created with the cache, for the logs. Thread safe */
+	void AddPipeline(float creationMs);
+
+	/** @brief Get the cache to create pipelines with */
+	[[nodiscard]] VkPipelineCache Get() const;
+
+	/** @brief Get the load, save and creation counters */
+	[[nodiscard]] pipelineCacheStats_t GetStats();
+
+private:
+
+	device_t             m_devices    { VK_NULL_HANDLE };
+	VkPipelineCache      m_cache      { VK_NULL_HANDLE };
+	std::string          m_filePath   { };
+
+	/** @brief Hash of the data last read or written, unchanged data is not written again */
+	uint64_t             m_savedHash  { 0 };
+
+	/** @brief Runs SaveAsync, one save at a time. The cache is internally synchronised, as for the compile workers */
+	std::unique_ptr<ThreadPool> m_saveWorker { };
+	std::atomic<bool>           m_bSaving    { false };
+
+	/** @brief Pipelines are created from several threads, the counters are guarded */
+	pipelineCacheStats_t m_stats      { };
+	std::mutex           m_statsMutex { };
+
+	/**
+	 * @brief Checks the file data was written by this driver for this device
+	 * @return Why the data is rejected, nullptr if it can be used
+	 */
+	[[nodiscard]] const char *ValidateData(const std::vector<char> &data) const;
+};
+
+
+FORCE_INLINE VkPipelineCache
+PipelineCache::Get() const
+{
+	return m_cache;
+}
+
+FORCE_INLINE pipelineCacheStats_t
+PipelineCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_stats;
+}
+
+#endif //VULKAN_COURSE_PIPELINE_CACHE_H
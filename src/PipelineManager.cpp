@@ -0,0 +1,572 @@
+#include "PipelineManager.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+#include "Shaders.h"
+
+/** @brief Append the bytes of a value to a serialised description */
+template<typename T>
+static void
+AppendBytes(std::string *key, const T &value)
+{
+	key->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+/** @brief Append a string and its terminator, "ab" + "c" differs from "a" + "bc" */
+static void
+AppendString(std::string *key, const std::string &value)
+{
+	key->append(value.c_str(), value.size() + 1);
+}
+
+/** @brief Create a shader module from SPIR-V words */
+static VkShaderModule
+CreateShaderModule(VkDevice device, std::span<const uint32_t> code)
+{
+	VkShaderModuleCreateInfo createInfo =
+	{
+		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.codeSize = code.size_bytes(),
+		.pCode    = code.data()
+	};
+
+	VkShaderModule shaderModule;
+	VK_CHECK(vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule), "Failed to create a shader module!");
+
+	return shaderModule;
+}
+
+
+void
+PipelineManager::Create(const device_t &devices, PipelineCache *pipelineCache)
+{
+	m_devices       = devices;
+	m_pipelineCache = pipelineCache;
+	m_workers       = std::make_unique<ThreadPool>(PIPELINE_COMPILE_THREADS);
+}
+
+void
+PipelineManager::Destroy()
+{
+	if (!m_workers) return;
+
+	// Workers write into the variants, let them finish first
+	m_workers.reset();
+
+	for (auto &variant : m_variants)
+	{
+		vkDestroyPipeline(m_devices.logicalDevice, variant.pipeline.load(std::memory_order_acquire), nullptr);
+		vkDestroyPipeline(m_devices.logicalDevice, variant.rebuilt.load(std::memory_order_acquire), nullptr);
+	}
+
+	const pipelineManagerStats_t stats = GetStats();
+	fprintf(stdout, "[INFO] Pipeline variants: %u requested, %u request hits, %u compiled, %u failed, %u fallback draws, %u reloaded\n",
+			stats.variants, stats.requestHits, stats.compiled, stats.failed, stats.fallbackDraws, stats.reloaded);
+
+	m_variants.clear();
+	m_lookup.clear();
+}
+
+PipelineHandle
+PipelineManager::CompileNow(const pipelineDesc_t &desc)
+{
+	bool                 bNew;
+	const PipelineHandle handle = FindOrAdd(desc, -1, &bNew);
+
+	// Already queued, the worker may not have started it: wait rather than compile it twice
+	if (!bNew) WaitIdle();
+	else CompileVariant(&m_variants[handle]);
+
+	if (GetState(handle) != PIPELINE_STATE_READY) throw std::runtime_error("Failed to create Graphics Pipeline");
+
+	return handle;
+}
+
+PipelineHandle
+PipelineManager::Request(const pipelineDesc_t &desc, PipelineHandle fallback)
+{
+	bool                 bNew;
+	const PipelineHandle handle = FindOrAdd(desc, fallback, &bNew);
+	if (!bNew) return handle;
+
+	variant_t *variant = &m_variants[handle];
+	m_workers->Enqueue([this, variant]() -> void
+	{
+		CompileVariant(variant);
+	});
+
+	return handle;
+}
+
+VkPipeline
+PipelineManager::Resolve(PipelineHandle handle)
+{
+	if (handle < 0) return VK_NULL_HANDLE;
+
+	const variant_t &variant = m_variants[handle];
+	if (variant.state.load(std::memory_order_acquire) == PIPELINE_STATE_READY) return variant.pipeline.load(std::memory_order_relaxed);
+
+	if (variant.fallback < 0) return VK_NULL_HANDLE;
+
+	++m_stats.fallbackDraws;
+	return Resolve(variant.fallback);
+}
+
+void
+PipelineManager::Reload(const std::string &shaderName)
+{
+	for (auto &variant : m_variants)
+	{
+		if (variant.desc.vertexShader != shaderName && variant.desc.fragmentShader != shaderName) continue;
+
+		variant_t *pVariant = &variant;
+		m_workers->Enqueue([this, pVariant]() -> void
+		{
+			RebuildVariant(pVariant);
+		});
+	}
+}
+
+void
+PipelineManager::SwapReloaded(std::vector<VkPipeline> *outRetired)
+{
+	if (!m_bRebuilt.exchange(false, std::memory_order_acq_rel)) return;
+
+	for (auto &variant : m_variants)
+	{
+		// The first compile of a pending variant still writes its pipeline, swap on a later frame
+		if (variant.state.load(std::memory_order_acquire) == PIPELINE_STATE_PENDING)
+		{
+			if (variant.rebuilt.load(std::memory_order_relaxed) != VK_NULL_HANDLE) m_bRebuilt.store(true, std::memory_order_relaxed);
+			continue;
+		}
+
+		const VkPipeline rebuilt = variant.rebuilt.exchange(VK_NULL_HANDLE, std::memory_order_acq_rel);
+		if (rebuilt == VK_NULL_HANDLE) continue;
+
+		const VkPipeline retired = variant.pipeline.exchange(rebuilt, std::memory_order_relaxed);
+		if (retired != VK_NULL_HANDLE) outRetired->push_back(retired);
+
+		// A variant that failed with the old shaders works now
+		variant.state.store(PIPELINE_STATE_READY, std::memory_order_release);
+		++m_stats.reloaded;
+	}
+}
+
+void
+PipelineManager::WaitIdle()
+{
+	if (m_workers) m_workers->WaitIdle();
+}
+
+pipelineManagerStats_t
+PipelineManager::GetStats() const
+{
+	pipelineManagerStats_t stats = m_stats;
+	stats.compiled = m_compiled.load(std::memory_order_relaxed);
+	stats.failed   = m_failed.load(std::memory_order_relaxed);
+	return stats;
+}
+
+PipelineHandle
+PipelineManager::FindOrAdd(const pipelineDesc_t &desc, PipelineHandle fallback, bool *outbNew)
+{
+	std::string    key  = SerialiseDesc(desc);
+	const uint64_t hash = HashFNV1a(key.data(), key.size());
+
+	auto found = m_lookup.find(hash);
+	if (found != m_lookup.end() && m_variants[found->second].key == key)
+	{
+		++m_stats.requestHits;
+		*outbNew = false;
+		return found->second;
+	}
+
+	const auto handle = static_cast<PipelineHandle>(m_variants.size());
+
+	variant_t &variant = m_variants.emplace_back();
+	variant.desc     = desc;
+	variant.key      = std::move(key);
+	variant.fallback = fallback;
+
+	// A colliding description is still compiled, it just cannot be found again
+	if (found == m_lookup.end()) m_lookup.emplace(hash, handle);
+
+	++m_stats.variants;
+	*outbNew = true;
+	return handle;
+}
+
+void
+PipelineManager::CompileVariant(variant_t *variant)
+{
+	const auto creationStart = std::chrono::steady_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	try
+	{
+		pipeline = CreatePipeline(variant->desc);
+	}
+	catch (const std::runtime_error &e)
+	{
+		fprintf(stderr, "[ERROR] %s ('%s', '%s')\n", e.what(), variant->desc.vertexShader.c_str(), variant->desc.fragmentShader.c_str());
+
+		++m_failed;
+		variant->state.store(PIPELINE_STATE_FAILED, std::memory_order_release);
+		return;
+	}
+
+	m_pipelineCache->AddPipeline(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - creationStart).count());
+
+	++m_compiled;
+	variant->pipeline.store(pipeline, std::memory_order_relaxed);
+	variant->state.store(PIPELINE_STATE_READY, std::memory_order_release);
+}
+
+void
+PipelineManager::RebuildVariant(variant_t *variant)
+{
+	const auto creationStart = std::chrono::steady_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	try
+	{
+		pipeline = CreatePipeline(variant->desc);
+	}
+	catch (const std::runtime_error &e)
+	{
+		fprintf(stderr, "[ERROR] %s, keeping the previous pipeline ('%s', '%s')\n", e.what(),
+				variant->desc.vertexShader.c_str(), variant->desc.fragmentShader.c_str());
+		return;
+	}
+
+	m_pipelineCache->AddPipeline(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - creationStart).count());
+
+	// Rebuilt twice before a swap: the older one was never bound
+	const VkPipeline stale = variant->rebuilt.exchange(pipeline, std::memory_order_acq_rel);
+	vkDestroyPipeline(m_devices.logicalDevice, stale, nullptr);
+
+	m_bRebuilt.store(true, std::memory_order_release);
+}
+
+VkPipeline
+PipelineManager::CreatePipeline(const pipelineDesc_t &desc) const
+{
+	shaderCode_t vertShaderCode, fragShaderCode;
+	LoadShaderCode(desc.vertexShader, &vertShaderCode);
+	LoadShaderCode(desc.fragmentShader, &fragShaderCode);
+
+	// Shader Module is a wrapper object for the shader bytecode
+	VkShaderModule vertexShaderModule = CreateShaderModule(m_devices.logicalDevice, vertShaderCode.words);
+	VkShaderModule fragShaderModule   = VK_NULL_HANDLE;
+	try
+	{
+		fragShaderModule = CreateShaderModule(m_devices.logicalDevice, fragShaderCode.words);
+	}
+	catch (const std::runtime_error &)
+	{
+		vkDestroyShaderModule(m_devices.logicalDevice, vertexShaderModule, nullptr);
+		throw;
+	}
+
+
+	/* ----------------------------------------- Specialization Constants ----------------------------------------- */
+
+	// One 32 bit value per constant, both stages share the map: a stage ignores the IDs it does not declare
+	std::vector<VkSpecializationMapEntry> specializationEntries;
+	std::vector<uint32_t>                 specializationData;
+	for (const auto &constant : desc.constants)
+	{
+		specializationEntries.push_back(
+		{
+			.constantID = constant.id,
+			.offset     = static_cast<uint32_t>(specializationData.size() * sizeof(uint32_t)),
+			.size       = sizeof(uint32_t)
+		});
+		specializationData.push_back(constant.value);
+	}
+
+	VkSpecializationInfo specializationInfo =
+	{
+		.mapEntryCount = static_cast<uint32_t>(specializationEntries.size()), // Number of constants
+		.pMapEntries   = specializationEntries.data(),                        // Where each constant is in the data
+		.dataSize      = specializationData.size() * sizeof(uint32_t),        // Size of the values
+		.pData         = specializationData.data()                            // The values
+	};
+
+	const VkSpecializationInfo *pSpecializationInfo = desc.constants.empty() ? nullptr : &specializationInfo;
+
+
+	/* ----------------------------------------- Shader Stage Creation Information ----------------------------------------- */
+
+	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages =
+	{
+		{
+			// Vertex stage creation information
+			{
+				.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage               = VK_SHADER_STAGE_VERTEX_BIT,  // Shader stage name
+				.module              = vertexShaderModule,          // Shader module to be used by stage
+				.pName               = "main",                      // Entry point in the shader
+				.pSpecializationInfo = pSpecializationInfo          // Constants folded into this variant
+			},
+			// Fragment stage creation information
+			{
+				.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				.stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
+				.module              = fragShaderModule,
+				.pName               = "main",
+				.pSpecializationInfo = pSpecializationInfo
+			}
+		}
+	};
+
+
+	/* ----------------------------------------- Vertex Input ----------------------------------------- */
+
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo =
+	{
+		.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+		.vertexBindingDescriptionCount   = 1,                                                    // Number of vertex binding descriptions
+		.pVertexBindingDescriptions      = &desc.vertexBinding,                                  // List of vertex binding descriptions (data spacing/stride information)
+		.vertexAttributeDescriptionCount = static_cast<uint32_t>(desc.vertexAttributes.size()), // Number of vertex attribute descriptions
+		.pVertexAttributeDescriptions    = desc.vertexAttributes.data()                         // List of vertex attribute descriptions (data format and where to bind to from)
+	};
+
+
+	/* ----------------------------------------- Input Assembly ----------------------------------------- */
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo =
+	{
+		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.topology               = desc.topology, // Primitive type to assemble vertices as
+		.primitiveRestartEnable = VK_FALSE       // Allow overriding of "strip" topology to start new primitives
+	};
+
+
+	/* ----------------------------------------- Viewport & Scissor ----------------------------------------- */
+
+	// Both are dynamic, set when recording: only their count is part of the pipeline
+	VkPipelineViewportStateCreateInfo viewportStateCreateInfo =
+	{
+		.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.viewportCount = 1,  // Number of viewports to use
+		.scissorCount  = 1,  // Number of scissor rectangles to use
+	};
+
+
+	/* ----------------------------------------- Dynamic States ----------------------------------------- */
+
+	// Dynamic states to enable
+	// !WARNING! If you are resizing the window, you need to recreate the swap chain,
+	// 			 swap chain images, and any image views associated with output attachments to the swap chain
+	std::array<VkDynamicState, 3> dynamicStates =
+	{
+		VK_DYNAMIC_STATE_VIEWPORT,  // Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		VK_DYNAMIC_STATE_SCISSOR,   // Dynamic Scissor  : Can resize in command buffer with vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		VK_DYNAMIC_STATE_LINE_WIDTH   // Dynamic Line Width : Can resize in command buffer with vkCmdSetLineWidth(commandBuffer, 1.0F);
+	};
+
+	// Dynamic state creation information
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo =
+	{
+		.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()), // Number of dynamic states to enable
+		.pDynamicStates    = dynamicStates.data()                         // List of dynamic states to enable
+	};
+
+
+	/* ----------------------------------------- Depth Stencil ----------------------------------------- */
+
+	// Depth and stencil testing
+	VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo =
+	{
+		.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.depthTestEnable       = desc.bDepthTest,          // Enable checking depth to determine fragment write
+		.depthWriteEnable      = desc.bDepthWrite,         // Enable writing to the depth buffer (to replace old values)
+		.depthCompareOp        = desc.depthCompareOp,      // Comparison operation that allows an overwriting (is in front)
+		.depthBoundsTestEnable = VK_FALSE,                 // Depth bounds test: Does the depth value exist between two bounds
+		.stencilTestEnable     = VK_FALSE,                 // Enable checking stencil value
+		.front                 = {},                       // Stencil operations for front-facing triangles
+		.back                  = {},                       // Stencil operations for back-facing triangles
+		.minDepthBounds        = 0.0F,                     // Min depth bounds
+		.maxDepthBounds        = 1.0F,                     // Max depth bounds
+	};
+
+	/**
+	 * Depth Testing (depthCompareOp):
+	 *
+	 * - VK_COMPARE_OP_NEVER            : Always pass the depth test
+	 * - VK_COMPARE_OP_LESS             : Pass if the new depth is less than the old depth
+	 * - VK_COMPARE_OP_EQUAL            : Pass if the new depth is equal to the old depth
+	 * - VK_COMPARE_OP_LESS_OR_EQUAL    : Pass if the new depth is less than or equal to the old depth
+	 * - VK_COMPARE_OP_GREATER          : Pass if the new depth is greater than the old depth
+	 * - VK_COMPARE_OP_NOT_EQUAL        : Pass if the new depth is not equal to the old depth
+	 * - VK_COMPARE_OP_GREATER_OR_EQUAL : Pass if the new depth is greater than or equal to the old depth
+	 * - VK_COMPARE_OP_ALWAYS           : Always pass the depth test
+	 */
+
+
+	/* ----------------------------------------- Rasterizer ----------------------------------------- */
+
+	// How to draw the polygons
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo =
+	{
+		.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.depthClampEnable        = VK_FALSE,          // Change if fragments beyond near/far planes are clamped (default) or discarded
+		.rasterizerDiscardEnable = VK_FALSE,          // Whether to discard data and skip rasterizer. Never creates fragments, only suitable for pipeline without framebuffer output
+		.polygonMode             = desc.polygonMode,  // How to handle filling points between vertices
+		.cullMode                = desc.cullMode,     // Which face of a triangle to cull
+		.frontFace               = desc.frontFace,    // Winding to determine which side is front
+		.depthBiasEnable         = VK_FALSE,          // Whether to add depth bias to fragments (good for stopping "shadow acne" in shadow mapping)
+		.lineWidth               = 1.0F,              // How thick lines should be when drawn
+	};
+
+
+	/* ----------------------------------------- Multisampling ----------------------------------------- */
+
+	// How to handle multisampling
+	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo =
+	{
+		.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT,  // Number of samples to use per fragment
+		.sampleShadingEnable   = VK_FALSE,               // Enable multisample shading or not
+	};
+
+
+	/* ----------------------------------------- Colour Blending ----------------------------------------- */
+
+	// How to handle the colours
+	VkPipelineColorBlendAttachmentState colorBlendAttachment =
+	{
+		.blendEnable         = desc.blend != PIPELINE_BLEND_OPAQUE,                 // Enable blending
+		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,                           // How to handle blending of new colour
+		.dstColorBlendFactor = desc.blend == PIPELINE_BLEND_ADDITIVE                // How to handle blending of old colour
+		                     ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorBlendOp        = VK_BLEND_OP_ADD,                                     // Type of blend operation to use
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,                                 // How to handle blending of new alpha
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,                                // How to handle blending of old alpha
+		.alphaBlendOp        = VK_BLEND_OP_ADD,                                     // Type of blend operation to use for alpha
+		.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT  // Which colours to apply the blend to
+		                     | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+	};
+
+	/*
+	 * Blend Equation:
+	 *
+	 * newColor.rgb = (srcColourBlendFactor * newColor)    colourBlendOp    (dstColourBlendFactor * oldColor)
+	 * newColor.a   = (srcAlphaBlendFactor * newAlpha)     alphaBlendOp     (dstAlphaBlendFactor * oldAlpha)
+	 *
+	 * Summarised, for PIPELINE_BLEND_ALPHA:
+	 *
+	 * (VK_BLEND_FACTOR_SRC_ALPHA * newColor) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * oldColor)
+	 * ( newAlpha + newColor ) + ( ( 1 - newAlpha ) * oldColor )
+	 */
+
+	// How to handle all the colours and alpha
+	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo =
+	{
+		.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.logicOpEnable     = VK_FALSE,                   // Alternative to calculations is to use logical operations
+		.logicOp           = VK_LOGIC_OP_COPY,           // What logical operation to use
+		.attachmentCount   = 1,                          // Number of colour blend attachments
+		.pAttachments      = &colorBlendAttachment,      // Information about how to handle blending
+		.blendConstants    = { 0.0F, 0.0F, 0.0F, 0.0F }  // (Optional) Constants to use for blending [VK_BLEND_FACTOR_CONSTANT_COLOR]
+	};
+
+
+	/* ----------------------------------------- Create Pipeline ----------------------------------------- */
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo =
+	{
+		.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.stageCount          = static_cast<uint32_t>(shaderStages.size()),
+		.pStages             = shaderStages.data(),
+
+		// Actual states creations
+		.pVertexInputState   = &vertexInputCreateInfo,
+		.pInputAssemblyState = &inputAssemblyCreateInfo,
+		.pViewportState      = &viewportStateCreateInfo,
+		.pRasterizationState = &rasterizerCreateInfo,
+		.pMultisampleState   = &multisamplingCreateInfo,
+		.pDepthStencilState  = &depthStencilStateCreateInfo,
+		.pColorBlendState    = &colorBlendCreateInfo,
+		.pDynamicState       = &dynamicStateCreateInfo,
+
+		.layout              = desc.layout,                                       // Pipeline layout to use with render pass
+		.renderPass          = desc.renderPass,                                   // Render pass description the pipeline is compatible with
+		.subpass             = desc.subpass,                                      // Index of the subpass to use with this pipeline
+
+		// Pipeline derivatives : Can create multiple pipelines that derive from one another for optimisation
+		.basePipelineHandle  = VK_NULL_HANDLE,                                    // Pipeline to derive from
+		.basePipelineIndex   = -1                                                 // Index of the base pipeline to derive from
+	};
+
+	// The cache is internally synchronised, workers share it
+	VkPipeline     pipeline;
+	const VkResult result = vkCreateGraphicsPipelines(m_devices.logicalDevice, m_pipelineCache->Get(), 1, &pipelineCreateInfo,
+	                                                  nullptr, &pipeline);
+
+	// Destroy shader modules
+	vkDestroyShaderModule(m_devices.logicalDevice, fragShaderModule, nullptr);
+	vkDestroyShaderModule(m_devices.logicalDevice, vertexShaderModule, nullptr);
+
+	VK_CHECK(result, "Failed to create Graphics Pipeline");
+
+	return pipeline;
+}
+
+std::string
+PipelineManager::SerialiseDesc(const pipelineDesc_t &desc)
+{
+	std::string key;
+	key.reserve(128);
+
+	AppendString(&key, desc.vertexShader);
+	AppendString(&key, desc.fragmentShader);
+
+	// The order constants were given in does not make another variant
+	std::vector<shaderConstant_t> constants = desc.constants;
+	std::sort(constants.begin(), constants.end(), [](const shaderConstant_t &a, const shaderConstant_t &b) -> bool
+	{
+		return a.id < b.id;
+	});
+
+	AppendBytes(&key, static_cast<uint32_t>(constants.size()));
+	for (const auto &constant : constants)
+	{
+		AppendBytes(&key, constant.id);
+		AppendBytes(&key, constant.value);
+	}
+
+	AppendBytes(&key, desc.vertexBinding.binding);
+	AppendBytes(&key, desc.vertexBinding.stride);
+	AppendBytes(&key, desc.vertexBinding.inputRate);
+	AppendBytes(&key, static_cast<uint32_t>(desc.vertexAttributes.size()));
+	for (const auto &attribute : desc.vertexAttributes)
+	{
+		AppendBytes(&key, attribute.location);
+		AppendBytes(&key, attribute.binding);
+		AppendBytes(&key, attribute.format);
+		AppendBytes(&key, attribute.offset);
+	}
+	AppendBytes(&key, desc.topology);
+
+	AppendBytes(&key, desc.polygonMode);
+	AppendBytes(&key, desc.cullMode);
+	AppendBytes(&key, desc.frontFace);
+
+	AppendBytes(&key, desc.bDepthTest);
+	AppendBytes(&key, desc.bDepthWrite);
+	AppendBytes(&key, desc.depthCompareOp);
+
+	AppendBytes(&key, desc.blend);
+
+	AppendBytes(&key, desc.layout);
+	AppendBytes(&key, desc.renderPass);
+	AppendBytes(&key, desc.subpass);
+
+	return key;
+}
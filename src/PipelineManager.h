@@ -0,0 +1,250 @@
+#ifndef VULKAN_COURSE_PIPELINE_MANAGER_H
+#define VULKAN_COURSE_PIPELINE_MANAGER_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineCache.h"
+#include "ThreadPool.hpp"
+#include "Utilities.h"
+
+/** @brief Index of a pipeline variant in the pipeline manager. -1 is no pipeline */
+typedef int PipelineHandle;
+
+/**
+ * @enum pipelineBlend_e
+ * @brief How a pipeline blends with the colour attachment
+ */
+typedef enum pipelineBlend_e : uint8_t
+{
+	PIPELINE_BLEND_OPAQUE = 0, // Overwrite
+	PIPELINE_BLEND_ALPHA,      // Straight alpha: src * a + dst * (1 - a)
+	PIPELINE_BLEND_ADDITIVE    // src * a + dst
+} pipelineBlend_e;
+
+/**
+ * @enum pipelineState_e
+ * @brief Where a pipeline variant is in its compilation
+ */
+typedef enum pipelineState_e : uint8_t
+{
+	PIPELINE_STATE_PENDING = 0, // Waiting for or being compiled on a worker
+	PIPELINE_STATE_READY,       // Compiled, can be bound
+	PIPELINE_STATE_FAILED       // Could not be compiled, its fallback is used for good
+} pipelineState_e;
+
+/**
+ * @enum shaderConstant_e
+ * @brief Specialization constant IDs, the layout(constant_id) of the mesh shaders
+ */
+typedef enum shaderConstant_e : uint32_t
+{
+	SHADER_CONSTANT_TEXTURED      = 0, // Bool, default true: sample the texture, white otherwise
+	SHADER_CONSTANT_VERTEX_COLOUR = 1  // Bool, default false: multiply by the vertex colour
+} shaderConstant_e;
+
+/**
+ * @struct shaderConstant_t
+ * @brief The value of a specialization constant, for both shader stages
+ */
+typedef struct shaderConstant_t
+{
+	uint32_t id;    // layout(constant_id) in the shaders
+	uint32_t value; // 32 bits: VkBool32, int, uint or the bits of a float
+} shaderConstant_t;
+
+/**
+ * @struct pipelineDesc_t
+ * @brief Everything a graphics pipeline variant is built from
+ * @details Viewport, scissor and line width are dynamic, they are not part of the variant
+ */
+typedef struct pipelineDesc_t
+{
+	// Shaders, by embedded .spv name
+	std::string                                    vertexShader    { };
+	std::string                                    fragmentShader  { };
+
+	// Specialization constants, folded by the driver. Constants left out keep their shader default
+	std::vector<shaderConstant_t>                  constants       { };
+
+	// Vertex layout, one interleaved binding
+	VkVertexInputBindingDescription                vertexBinding   { };
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes { };
+	VkPrimitiveTopology                            topology        { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+
+	// Rasterizer
+	VkPolygonMode                                  polygonMode     { VK_POLYGON_MODE_FILL };
+	VkCullModeFlags                                cullMode        { VK_CULL_MODE_BACK_BIT };
+	VkFrontFace                                    frontFace       { VK_FRONT_FACE_COUNTER_CLOCKWISE };
+
+	// Depth
+	bool                                           bDepthTest      { true };
+	bool                                           bDepthWrite     { true };
+	VkCompareOp                                    depthCompareOp  { VK_COMPARE_OP_LESS };
+
+	// Colour
+	pipelineBlend_e                                blend           { PIPELINE_BLEND_ALPHA };
+
+	// Compatibility
+	VkPipelineLayout                               layout          { VK_NULL_HANDLE };
+	VkRenderPass                                   renderPass      { VK_NULL_HANDLE };
+	uint32_t                                       subpass         { 0 };
+} pipelineDesc_t;
+
+/**
+ * @struct pipelineManagerStats_t
+ * @brief Pipeline variant counters
+ */
+typedef struct pipelineManagerStats_t
+{
+	uint32_t variants       { 0 }; // Distinct descriptions requested
+	uint32_t requestHits    { 0 }; // Requests answered with an existing variant
+	uint32_t compiled       { 0 }; // Variants compiled, on a worker or at startup
+	uint32_t failed         { 0 }; // Variants that could not be compiled
+	uint32_t fallbackDraws  { 0 }; // Resolves answered with the fallback while the variant was not ready
+	uint32_t reloaded       { 0 }; // Variants swapped for a pipeline built from reloaded shaders
+} pipelineManagerStats_t;
+
+
+/**
+ * @class PipelineManager
+ * @brief Deduplicated graphics pipeline variants, compiled on worker threads
+ * @details A description is hashed to a key, asking twice for the same description returns the same handle.
+ *          New variants compile in the background; until they are ready, resolving them gives their fallback,
+ *          or nothing so the draw is skipped. Requests, resolves, reloads and swaps are made from the render thread only
+ */
+class PipelineManager
+{
+public:
+
+	PipelineManager() = default;
+	~PipelineManager() = default;
+
+	// Disallow copying, workers point into the variants
+	PipelineManager(const PipelineManager&) = delete;
+	PipelineManager& operator=(const PipelineManager&) = delete;
+
+	/**
+	 * @brief Start the compile workers
+	 * @param devices The physical and logical devices
+	 * @param pipelineCache The cache every variant is created with
+	 */
+	void Create(const device_t &devices, PipelineCache *pipelineCache);
+
+	/** @brief Wait for the workers and destroy every variant. The GPU must no longer use them */
+	void Destroy();
+
+	/**
+	 * @brief Get a variant, compiled right away on this thread if it is new
+	 * @details For the few pipelines needed before the first frame, the fallbacks of the others
+	 * @throws std::runtime_error If the variant cannot be compiled
+	 */
+	PipelineHandle CompileNow(const pipelineDesc_t &desc);
+
+	/**
+	 * @brief Get a variant, queued for a worker if it is new
+	 *
+	 * @param desc The description of the variant
+	 * @param fallback Resolved instead while the variant is not ready, -1 to skip its draws
+	 * @return The handle of the variant, the same for the same description
+	 */
+	PipelineHandle Request(const pipelineDesc_t &desc, PipelineHandle fallback = -1);
+
+	/**
+	 * @brief Get the pipeline to bind for a variant
+	 * @return The variant if ready, else its fallback if ready, else VK_NULL_HANDLE: skip the draw
+	 */
+	VkPipeline Resolve(PipelineHandle handle);
+
+	/** @brief Get the compilation state of a variant */
+	[[nodiscard]] pipelineState_e GetState(PipelineHandle handle) const;
+
+	/**
+	 * @brief Rebuild, on the workers, every variant using a shader whose SPIR-V changed
+	 * @details The variants keep their pipeline until SwapReloaded; a failed rebuild keeps the old one for good
+	 */
+	void Reload(const std::string &shaderName);
+
+	/**
+	 * @brief Swap in the pipelines rebuilt since the last call. Call at a frame boundary, before recording
+	 * @param outRetired The replaced pipelines, frames in flight may still use them
+	 */
+	void SwapReloaded(std::vector<VkPipeline> *outRetired);
+
+	/** @brief Block until every queued variant is compiled or failed */
+	void WaitIdle();
+
+	/** @brief Get the variant counters */
+	[[nodiscard]] pipelineManagerStats_t GetStats() const;
+
+private:
+
+	/**
+	 * @struct variant_t
+	 * @brief A pipeline variant. Never moves once created, workers write its pipeline and state
+	 */
+	typedef struct variant_t
+	{
+		pipelineDesc_t               desc     { };
+		std::string                  key      { };                  // Serialised description, tells hash collisions apart
+		PipelineHandle               fallback { -1 };
+		std::atomic<VkPipeline>      pipeline { VK_NULL_HANDLE };
+		std::atomic<pipelineState_e> state    { PIPELINE_STATE_PENDING };
+		std::atomic<VkPipeline>      rebuilt  { VK_NULL_HANDLE };         // Built from reloaded shaders, waiting for SwapReloaded
+	} variant_t;
+
+	device_t                    m_devices       { VK_NULL_HANDLE };
+	PipelineCache              *m_pipelineCache { nullptr };
+
+	/** @brief Variants by handle. A deque, so growing it does not move the variants the workers write */
+	std::deque<variant_t>                        m_variants { };
+
+	/** @brief Handles by hash of the serialised description */
+	std::unordered_map<uint64_t, PipelineHandle> m_lookup   { };
+
+	std::unique_ptr<ThreadPool>                  m_workers  { };
+
+	pipelineManagerStats_t                       m_stats    { };
+	std::atomic<uint32_t>                        m_compiled { 0 };
+	std::atomic<uint32_t>                        m_failed   { 0 };
+
+	/** @brief Set by the workers when a variant was rebuilt, SwapReloaded skips the variants otherwise */
+	std::atomic<bool>                            m_bRebuilt { false };
+
+	/**
+	 * @brief Find the variant of a description, or add a pending one
+	 * @return The handle, and true in outbNew if the variant was added
+	 */
+	PipelineHandle FindOrAdd(const pipelineDesc_t &desc, PipelineHandle fallback, bool *outbNew);
+
+	/** @brief Compile a variant and publish the result. Called on a worker, or on the render thread at startup */
+	void CompileVariant(variant_t *variant);
+
+	/** @brief Rebuild a variant from the current shaders and leave it for SwapReloaded. Called on a worker */
+	void RebuildVariant(variant_t *variant);
+
+	/**
+	 * @brief Create the pipeline of a description
+	 * @throws std::runtime_error If a shader is missing or the driver fails
+	 */
+	[[nodiscard]] VkPipeline CreatePipeline(const pipelineDesc_t &desc) const;
+
+	/** @brief Write every field of a description as bytes, equal descriptions give equal keys. Constants are sorted by ID */
+	static std::string SerialiseDesc(const pipelineDesc_t &desc);
+};
+
+
+FORCE_INLINE pipelineState_e
+PipelineManager::GetState(PipelineHandle handle) const
+{
+	return m_variants[handle].state.load(std::memory_order_acquire);
+}
+
+#endif //VULKAN_COURSE_PIPELINE_MANAGER_H
@@ -0,0 +1,193 @@
+#include "ShaderWatcher.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Shaders.h"
+#include "Utilities.h"
+
+#ifdef VULKAN_COURSE_SHADER_COMPILER
+/** @brief Get the id of this process, to keep the compile output of two running renderers apart */
+static long
+GetOwnProcessId()
+{
+#ifdef _WIN32
+	return static_cast<long>(_getpid());
+#else
+	return static_cast<long>(getpid());
+#endif
+}
+#endif
+
+void
+ShaderWatcher::Create()
+{
+	if constexpr (!ENABLE_SHADER_HOT_RELOAD) return;
+
+#if !defined(__linux__)
+	fprintf(stdout, "[INFO] Shader hot reload disabled: only supported on Linux\n");
+#elif !defined(VULKAN_COURSE_SHADER_COMPILER)
+	fprintf(stdout, "[INFO] Shader hot reload disabled: no shader compiler was found at build time\n");
+#else
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0)
+	{
+		fprintf(stderr, "[ERROR] Shader hot reload disabled: inotify_init1 failed (%s)\n", strerror(errno));
+		return;
+	}
+
+	for (const auto &shader : GetEmbeddedShaders())
+	{
+		std::error_code error;
+		if (!std::filesystem::exists(shader.sourcePath, error)) continue;
+
+		const std::string directory = std::filesystem::path(shader.sourcePath).parent_path().string();
+
+		// Editors often save by writing a new file and renaming it over the old one, watch the folder and not the file
+		const int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0)
+		{
+			fprintf(stderr, "[ERROR] Failed to watch shader folder '%s' (%s)\n", directory.c_str(), strerror(errno));
+			continue;
+		}
+
+		m_directories[watch] = directory;
+		m_shaders.push_back({ .name = shader.name, .sourcePath = shader.sourcePath });
+	}
+
+	if (m_shaders.empty())
+	{
+		Destroy();
+		return;
+	}
+
+	m_worker = std::make_unique<ThreadPool>(1);
+	fprintf(stdout, "[INFO] Shader hot reload: watching %zu shader sources\n", m_shaders.size());
+#endif
+}
+
+void
+ShaderWatcher::Destroy()
+{
+	m_worker.reset();
+
+#ifdef __linux__
+	if (m_inotify >= 0) close(m_inotify);
+#endif
+
+	m_inotify = -1;
+	m_directories.clear();
+	m_shaders.clear();
+	m_reloaded.clear();
+}
+
+void
+ShaderWatcher::Poll(std::vector<std::string> *outReloaded)
+{
+	if (m_inotify < 0) return;
+
+	ReadEvents();
+
+	// Compile the sources that stopped changing, the worker takes them in order
+	const auto now = std::chrono::steady_clock::now();
+	for (auto &shader : m_shaders)
+	{
+		if (!shader.bChanged || now - shader.changedAt < std::chrono::milliseconds(SHADER_RELOAD_DELAY_MS)) continue;
+
+		shader.bChanged = false;
+		m_worker->Enqueue([this, name = shader.name, sourcePath = shader.sourcePath]() -> void
+		{
+			Compile(name, sourcePath);
+		});
+	}
+
+	std::lock_guard<std::mutex> lock(m_reloadedMutex);
+	outReloaded->insert(outReloaded->end(), m_reloaded.begin(), m_reloaded.end());
+	m_reloaded.clear();
+}
+
+void
+ShaderWatcher::ReadEvents()
+{
+#ifdef __linux__
+	// Events are variable sized, the buffer must be aligned for the header
+	alignas(inotify_event) char buffer[4096];
+
+	ssize_t length;
+	while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+	{
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+			offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+
+			const auto directory = m_directories.find(event->wd);
+			if (event->len == 0 || directory == m_directories.end()) continue;
+
+			const std::filesystem::path path = std::filesystem::path(directory->second) / event->name;
+			for (auto &shader : m_shaders)
+			{
+				if (std::filesystem::path(shader.sourcePath) != path) continue;
+
+				shader.bChanged  = true;
+				shader.changedAt = std::chrono::steady_clock::now();
+			}
+		}
+	}
+#endif
+}
+
+void
+ShaderWatcher::Compile(const std::string &name, const std::string &sourcePath)
+{
+#ifdef VULKAN_COURSE_SHADER_COMPILER
+	std::error_code             error;
+	const std::filesystem::path outputPath = std::filesystem::temp_directory_path(error) /
+	                                         ("VulkanCourse_" + std::to_string(GetOwnProcessId()) + "_" + name);
+
+	// The compiler prints its own errors
+	const std::string command = std::string("\"") + VULKAN_COURSE_SHADER_COMPILER + "\" " + VULKAN_COURSE_SHADER_COMPILER_FLAGS +
+	                            " \"" + sourcePath + "\" -o \"" + outputPath.string() + "\"";
+	if (std::system(command.c_str()) != 0)
+	{
+		fprintf(stderr, "[ERROR] Failed to compile '%s', keeping the previous '%s'\n", sourcePath.c_str(), name.c_str());
+		return;
+	}
+
+	try
+	{
+		const std::vector<char> bytes = ReadFile(outputPath.string());
+		std::filesystem::remove(outputPath, error);
+
+		std::vector<uint32_t> words(bytes.size() / sizeof(uint32_t));
+		memcpy(words.data(), bytes.data(), words.size() * sizeof(uint32_t));
+		SetShaderOverride(name, std::move(words));
+	}
+	catch (const std::runtime_error &e)
+	{
+		fprintf(stderr, "[ERROR] %s\n", e.what());
+		return;
+	}
+
+	fprintf(stdout, "[INFO] Shader '%s' recompiled from '%s'\n", name.c_str(), sourcePath.c_str());
+
+	std::lock_guard<std::mutex> lock(m_reloadedMutex);
+	m_reloaded.push_back(name);
+#else
+	(void)name;
+	(void)sourcePath;
+#endif
+}
@@ -0,0 +1,79 @@
+#ifndef VULKAN_COURSE_SHADER_WATCHER_H
+#define VULKAN_COURSE_SHADER_WATCHER_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ThreadPool.hpp"
+
+/**
+ * @class ShaderWatcher
+ * @brief Recompiles the GLSL sources of the embedded shaders when they change on disk
+ * @details The source folders are watched with inotify, so this only works on Linux and when a shader compiler was
+ *          found at build time. A change is compiled on a worker with that compiler and installed with
+ *          SetShaderOverride; Poll then reports the shader so its pipelines can be rebuilt. Nothing here blocks the
+ *          frame loop, a source that does not compile keeps the previous SPIR-V
+ */
+class ShaderWatcher
+{
+public:
+
+	ShaderWatcher() = default;
+	~ShaderWatcher() = default;
+
+	// Disallow copying, the worker captures `this`
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	/** @brief Watch the folders of the embedded shader sources. Does nothing if hot reload is unavailable */
+	void Create();
+
+	/** @brief Stop watching, waiting for a compile in progress */
+	void Destroy();
+
+	/**
+	 * @brief Queue the sources changed since the last call and collect the shaders recompiled since. Never blocks
+	 * @param outReloaded Names of the .spv files whose SPIR-V was replaced
+	 */
+	void Poll(std::vector<std::string> *outReloaded);
+
+private:
+
+	/**
+	 * @struct watchedShader_t
+	 * @brief An embedded shader and where its source is
+	 */
+	typedef struct watchedShader_t
+	{
+		std::string                           name       { }; // Name of the .spv file
+		std::string                           sourcePath { }; // GLSL source
+		std::chrono::steady_clock::time_point changedAt  { }; // Last write seen, compiled once it settles
+		bool                                  bChanged   { false };
+	} watchedShader_t;
+
+	int                                  m_inotify     { -1 };
+
+	/** @brief Watched folder of each inotify watch descriptor */
+	std::unordered_map<int, std::string> m_directories { };
+
+	std::vector<watchedShader_t>         m_shaders     { };
+
+	/** @brief One worker, compiles never overlap */
+	std::unique_ptr<ThreadPool>          m_worker      { };
+
+	/** @brief Recompiled by the worker, not yet returned by Poll */
+	std::vector<std::string>             m_reloaded    { };
+	std::mutex                           m_reloadedMutex { };
+
+	/** @brief Flag the shaders of the files inotify reported as written */
+	void ReadEvents();
+
+	/** @brief Compile a source and install its SPIR-V. Called on the worker */
+	void Compile(const std::string &name, const std::string &sourcePath);
+};
+
+#endif //VULKAN_COURSE_SHADER_WATCHER_H
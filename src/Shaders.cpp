@@ -0,0 +1,140 @@
+#include "Shaders.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Utilities.h"
+
+/** @brief Magic number starting every SPIR-V module */
+constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+/** @brief Words of the SPIR-V header, before the first instruction */
+constexpr size_t SPIRV_HEADER_WORDS = 5;
+
+/** @brief OpDecorate and its SpecId decoration */
+constexpr uint32_t SPIRV_OP_DECORATE     = 71;
+constexpr uint32_t SPIRV_DECORATION_SPEC = 1;
+
+/** @brief Path of a shader in the override folder, empty if no folder is set */
+static std::filesystem::path
+GetOverridePath(const std::string &name)
+{
+	const char *directory = std::getenv(SHADER_OVERRIDE_ENVIRONMENT);
+	if (!directory || *directory == '\0') return { };
+
+	return std::filesystem::path(directory) / name;
+}
+
+/** @brief Shaders recompiled at runtime, written by the hot reload worker and read by the pipeline workers */
+static std::mutex                                             s_runtimeMutex;
+static std::unordered_map<std::string, std::vector<uint32_t>> s_runtimeShaders;
+
+/** @brief Copy the runtime SPIR-V of a shader into the storage, false if it was not recompiled */
+static bool
+LoadRuntimeShader(const std::string &name, shaderCode_t *outCode)
+{
+	std::lock_guard<std::mutex> lock(s_runtimeMutex);
+
+	const auto it = s_runtimeShaders.find(name);
+	if (it == s_runtimeShaders.end()) return false;
+
+	outCode->storage = it->second;
+	outCode->words   = outCode->storage;
+	return true;
+}
+
+static const embeddedShader_t *
+FindEmbeddedShader(const std::string &name)
+{
+	for (const auto &shader : GetEmbeddedShaders())
+	{
+		if (name == shader.name) return &shader;
+	}
+	return nullptr;
+}
+
+void
+LoadShaderCode(const std::string &name, shaderCode_t *outCode)
+{
+	if (LoadRuntimeShader(name, outCode)) return;
+
+	const std::filesystem::path overridePath = GetOverridePath(name);
+
+	std::error_code error;
+	if (!overridePath.empty() && std::filesystem::exists(overridePath, error))
+	{
+		const std::vector<char> bytes = ReadFile(overridePath.string());
+		if (bytes.size() < sizeof(uint32_t) || bytes.size() % sizeof(uint32_t) != 0)
+		{
+			throw std::runtime_error("Shader override is not SPIR-V: " + overridePath.string());
+		}
+
+		outCode->storage.resize(bytes.size() / sizeof(uint32_t));
+		memcpy(outCode->storage.data(), bytes.data(), bytes.size());
+		if (outCode->storage[0] != SPIRV_MAGIC) throw std::runtime_error("Shader override is not SPIR-V: " + overridePath.string());
+
+		outCode->words = outCode->storage;
+		fprintf(stdout, "[INFO] Shader '%s' overridden by '%s'\n", name.c_str(), overridePath.string().c_str());
+		return;
+	}
+
+	const embeddedShader_t *shader = FindEmbeddedShader(name);
+	if (!shader) throw std::runtime_error("Shader not embedded: " + name);
+
+	outCode->storage.clear();
+	outCode->words = { shader->code, shader->wordCount };
+}
+
+bool
+HasShader(const std::string &name)
+{
+	if (FindEmbeddedShader(name)) return true;
+
+	{
+		std::lock_guard<std::mutex> lock(s_runtimeMutex);
+		if (s_runtimeShaders.contains(name)) return true;
+	}
+
+	const std::filesystem::path overridePath = GetOverridePath(name);
+
+	std::error_code error;
+	return !overridePath.empty() && std::filesystem::exists(overridePath, error);
+}
+
+void
+SetShaderOverride(const std::string &name, std::vector<uint32_t> words)
+{
+	if (words.empty() || words[0] != SPIRV_MAGIC) throw std::runtime_error("Shader override is not SPIR-V: " + name);
+
+	std::lock_guard<std::mutex> lock(s_runtimeMutex);
+	s_runtimeShaders[name] = std::move(words);
+}
+
+bool
+HasShaderConstant(const std::string &name, uint32_t constantId)
+{
+	if (!HasShader(name)) return false;
+
+	shaderCode_t code;
+	LoadShaderCode(name, &code);
+
+	// Instructions start with their word count in the high half and their opcode in the low half
+	const std::span<const uint32_t> words = code.words;
+	for (size_t i = SPIRV_HEADER_WORDS; i < words.size();)
+	{
+		const uint32_t wordCount = words[i] >> 16;
+		const uint32_t opcode    = words[i] & 0xFFFF;
+		if (wordCount == 0) break;
+
+		// OpDecorate target SpecId id
+		if (opcode == SPIRV_OP_DECORATE && wordCount >= 4 && i + 3 < words.size() &&
+		    words[i + 2] == SPIRV_DECORATION_SPEC && words[i + 3] == constantId) return true;
+
+		i += wordCount;
+	}
+	return false;
+}
@@ -0,0 +1,67 @@
+#ifndef VULKAN_COURSE_SHADERS_H
+#define VULKAN_COURSE_SHADERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/*
+ * SPIR-V is compiled at build time and embedded into the binary (see cmake/EmbedShaders.cmake), pipelines are created
+ * without reading a file. For development, setting SHADER_OVERRIDE_ENVIRONMENT to a folder makes the .spv files found
+ * there win over the embedded ones. Shaders recompiled at runtime by the hot reload (see ShaderWatcher.h) win over both.
+ */
+
+/**
+ * @struct embeddedShader_t
+ * @brief SPIR-V compiled into the binary
+ */
+typedef struct embeddedShader_t
+{
+	const char     *name;       // Name of the .spv file, "vert.spv"
+	const uint32_t *code;       // The SPIR-V words
+	size_t          wordCount;  // Number of words
+	const char     *sourcePath; // GLSL source it was compiled from, at build time
+} embeddedShader_t;
+
+/**
+ * @struct shaderCode_t
+ * @brief SPIR-V ready to create a shader module with
+ * @details Moving is fine, a copy would keep pointing at the storage of the original
+ */
+typedef struct shaderCode_t
+{
+	std::span<const uint32_t> words   { };   // The embedded words, or the storage of an override
+	std::vector<uint32_t>     storage { };   // Words read from the override folder, or recompiled
+} shaderCode_t;
+
+/** @brief Get the shaders embedded at build time. Defined by the generated EmbeddedShaders.cpp */
+std::span<const embeddedShader_t> GetEmbeddedShaders();
+
+/**
+ * @brief Get the SPIR-V of a shader: recompiled at runtime, else from the override folder if set and holding the file,
+ *        embedded otherwise
+ * @throws std::runtime_error If the shader is neither overridden nor embedded, or the override is not SPIR-V
+ *
+ * @param name The name of the .spv file
+ * @param outCode The SPIR-V
+ */
+void LoadShaderCode(const std::string &name, shaderCode_t *outCode);
+
+/** @brief Checks if a shader can be loaded, embedded or overridden */
+bool HasShader(const std::string &name);
+
+/**
+ * @brief Replace the SPIR-V of a shader for the rest of the run. Thread safe
+ * @details Pipelines created afterwards use the new words, existing ones are not touched
+ */
+void SetShaderOverride(const std::string &name, std::vector<uint32_t> words);
+
+/**
+ * @brief Checks if a shader declares a specialization constant
+ * @details Constants a shader does not declare are ignored by the driver, their variants would all look the same
+ */
+bool HasShaderConstant(const std::string &name, uint32_t constantId);
+
+#endif //VULKAN_COURSE_SHADERS_H
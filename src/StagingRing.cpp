@@ -0,0 +1,145 @@
+#include "StagingRing.h"
+
+void
+StagingRing::Create(const device_t &devices, VkDeviceSize capacity)
+{
+	m_devices  = devices;
+	m_capacity = capacity;
+
+	CreateBuffer(m_devices, m_capacity,
+				 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,                                           // The ring is only used as the source of transfers
+				 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, // Written by the CPU, no flush needed
+				 &m_buffer, &m_memory);
+
+	// Keep the memory mapped for the lifetime of the ring
+	void *data;
+	VK_CHECK(vkMapMemory(m_devices.logicalDevice, m_memory, 0, m_capacity, 0, &data), "Failed to map Staging Ring Memory!");
+	m_mapped = static_cast<uint8_t *>(data);
+}
+
+void
+StagingRing::Destroy()
+{
+	if (m_buffer == VK_NULL_HANDLE) return;
+
+	vkUnmapMemory(m_devices.logicalDevice, m_memory);
+	vkDestroyBuffer(m_devices.logicalDevice, m_buffer, nullptr);
+	vkFreeMemory(m_devices.logicalDevice, m_memory, nullptr);
+
+	m_buffer   = VK_NULL_HANDLE;
+	m_memory   = VK_NULL_HANDLE;
+	m_mapped   = nullptr;
+	m_entries.clear();
+}
+
+bool
+StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, stagingAllocation_t *outAllocation)
+{
+	if (size == 0 || size > m_capacity) return false;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_spaceFreed.wait(lock, [&]() { return TryAllocateLocked(size, alignment, outAllocation); });
+	return true;
+}
+
+bool
+StagingRing::TryAllocate(VkDeviceSize size, VkDeviceSize alignment, stagingAllocation_t *outAllocation)
+{
+	if (size == 0 || size > m_capacity) return false;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return TryAllocateLocked(size, alignment, outAllocation);
+}
+
+void
+StagingRing::Release(const stagingAllocation_t &allocation)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (auto &entry : m_entries)
+		{
+			if (entry.begin != allocation.offset) continue;
+
+			entry.released = true;
+			break;
+		}
+
+		// Reclaim space from the oldest allocation onwards
+		while (!m_entries.empty() && m_entries.front().released) m_entries.pop_front();
+	}
+	m_spaceFreed.notify_all();
+}
+
+VkDeviceSize
+StagingRing::GetUsedBytes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_entries.empty()) return 0;
+
+	const VkDeviceSize tail = m_entries.front().begin;
+	const VkDeviceSize head = m_entries.back().end;
+
+	return head > tail ? head - tail : ( m_capacity - tail ) + head;
+}
+
+bool
+StagingRing::TryFindRegion(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *outBegin) const
+{
+	// Empty ring, start over from the beginning
+	if (m_entries.empty())
+	{
+		*outBegin = 0;
+		return true;
+	}
+
+	const VkDeviceSize tail    = m_entries.front().begin;
+	const VkDeviceSize head    = m_entries.back().end;
+	const VkDeviceSize aligned = ( head + alignment - 1 ) & ~( alignment - 1 );
+
+	/*
+	 * Not wrapped: [ free | tail ### head | free ]  -> try after head, then wrap to the start
+	 * Wrapped    : [ ### head | free | tail ### ]   -> try between head and tail
+	 */
+	const bool bWrapped = m_entries.back().begin < m_entries.front().begin;
+
+	if (!bWrapped)
+	{
+		if (aligned + size <= m_capacity)
+		{
+			*outBegin = aligned;
+			return true;
+		}
+		if (size <= tail)
+		{
+			*outBegin = 0;
+			return true;
+		}
+		return false;
+	}
+
+	if (aligned + size <= tail)
+	{
+		*outBegin = aligned;
+		return true;
+	}
+	return false;
+}
+
+bool
+StagingRing::TryAllocateLocked(VkDeviceSize size, VkDeviceSize alignment, stagingAllocation_t *outAllocation)
+{
+	VkDeviceSize begin = 0;
+	if (!TryFindRegion(size, alignment, &begin)) return false;
+
+	m_entries.push_back({ .begin = begin, .end = begin + size });
+
+	*outAllocation =
+	{
+		.buffer = m_buffer,
+		.offset = begin,
+		.size   = size,
+		.mapped = m_mapped + begin
+	};
+	return true;
+}
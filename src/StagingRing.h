@@ -0,0 +1,122 @@
+#ifndef VULKAN_COURSE_STAGING_RING_H
+#define VULKAN_COURSE_STAGING_RING_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "Utilities.h"
+
+/**
+ * @struct stagingAllocation_t
+ * @brief A region of the staging ring, mapped and ready to be written by the CPU
+ */
+typedef struct stagingAllocation_t
+{
+	VkBuffer     buffer { VK_NULL_HANDLE }; // Buffer to use as the copy source
+	VkDeviceSize offset { 0 };              // Offset of the region inside the buffer
+	VkDeviceSize size   { 0 };              // Size of the region
+	void        *mapped { nullptr };        // CPU pointer to the start of the region
+} stagingAllocation_t;
+
+
+/**
+ * @class StagingRing
+ * @brief A persistently mapped, host visible buffer sub-allocated as a ring
+ * @details Allocations are thread safe and block while the ring is full.
+ *          Regions may be released in any order, space is reclaimed in allocation order.
+ */
+class StagingRing
+{
+public:
+
+	StagingRing() = default;
+	~StagingRing() = default;
+
+	// Disallow copying, the mutex and mapped pointer are not shareable
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+
+	/**
+	 * @brief Create the ring buffer and map it
+	 * @param devices The physical and logical devices
+	 * @param capacity The size of the ring in bytes
+	 */
+	void Create(const device_t &devices, VkDeviceSize capacity);
+
+	/** @brief Unmap and destroy the ring buffer. Every allocation must have been released */
+	void Destroy();
+
+	/**
+	 * @brief Allocate a region of the ring, waiting for space if the ring is full
+	 *
+	 * @param size The size of the region
+	 * @param alignment The alignment of the region offset
+	 * @param outAllocation The allocated region
+	 * @return False if the region can never fit the ring
+	 */
+	bool Allocate(VkDeviceSize size, VkDeviceSize alignment, stagingAllocation_t *outAllocation);
+
+	/**
+	 * @brief Allocate a region of the ring without waiting
+	 * @return False if the region does not fit the ring right now
+	 */
+	bool TryAllocate(VkDeviceSize size, VkDeviceSize alignment, stagingAllocation_t *outAllocation);
+
+	/** @brief Give a region back to the ring once the GPU is done reading it */
+	void Release(const stagingAllocation_t &allocation);
+
+	/** @brief Get the ring capacity in bytes */
+	[[nodiscard]] VkDeviceSize GetCapacity() const;
+
+	/** @brief Get the bytes currently held by allocations, alignment padding included */
+	[[nodiscard]] VkDeviceSize GetUsedBytes();
+
+private:
+
+	/**
+	 * @struct entry_t
+	 * @brief A live allocation, kept in allocation order
+	 */
+	typedef struct entry_t
+	{
+		VkDeviceSize begin    { 0 };
+		VkDeviceSize end      { 0 };
+		bool         released { false };
+	} entry_t;
+
+	device_t       m_devices  { VK_NULL_HANDLE };
+
+	VkBuffer       m_buffer   { VK_NULL_HANDLE };
+	VkDeviceMemory m_memory   { VK_NULL_HANDLE };
+	uint8_t       *m_mapped   { nullptr };
+	VkDeviceSize   m_capacity { 0 };
+
+	std::deque<entry_t>     m_entries    { };
+	std::mutex              m_mutex      { };
+	std::condition_variable m_spaceFreed { };
+
+	/**
+	 * @brief Find a free region for the given size
+	 * @return True and the region start in outBegin if the region fits right now
+	 */
+	bool TryFindRegion(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize *outBegin) const;
+
+	/**
+	 * @brief Find a free region and record it as a live allocation. The mutex must be held
+	 * @return False if the region does not fit the ring right now
+	 */
+	bool TryAllocateLocked(VkDeviceSize size, VkDeviceSize alignment, stagingAllocation_t *outAllocation);
+};
+
+
+FORCE_INLINE VkDeviceSize
+StagingRing::GetCapacity() const
+{
+	return m_capacity;
+}
+
+#endif //VULKAN_COURSE_STAGING_RING_H
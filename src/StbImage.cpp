@@ -0,0 +1,3 @@
+// The stb_image implementation, compiled once into the renderer for everything linking it
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
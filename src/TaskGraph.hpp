@@ -0,0 +1,271 @@
+#ifndef TASKGRAPH_HPP
+#define TASKGRAPH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "CpuProfiler.h"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief Named tasks run once each, as soon as the tasks they depend on are done, and timed
+ * @details Tasks are added after their dependencies, so the order they are added in is a valid serial order: without
+ *          a pool they run in it on the calling thread. A task that throws stops its dependents from running, the
+ *          others still run, then the first exception is rethrown to the caller of Run.
+ *
+ * @example
+ * {
+ *   TaskGraph graph;
+ *   const auto device   = graph.Add("Device", []() { CreateDevice(); });
+ *   const auto pipeline = graph.Add("Pipeline", []() { CompilePipeline(); }, { device });
+ *   graph.Add("Buffers", []() { CreateBuffers(); }, { device });
+ *
+ *   ThreadPool pool(2);
+ *   graph.Run(&pool);  // Pipeline and Buffers run at the same time
+ *   graph.PrintStats("Init");
+ * }
+ */
+class TaskGraph
+{
+
+public:
+    typedef uint32_t TaskId;
+
+    /** @brief When and where a task ran, in milliseconds from the start of Run */
+    typedef struct taskTiming_t
+    {
+        const char *name    { nullptr };
+        double      startMs { 0.0 };
+        double      endMs   { 0.0 };
+        uint32_t    thread  { 0 };      // 0 is the first thread seen running a task
+        bool        bRan    { false };  // False when a dependency failed
+    } taskTiming_t;
+
+private:
+    typedef struct task_t
+    {
+        const char            *name         { nullptr };
+        std::function<void()>  function     {   };
+        std::vector<TaskId>    dependencies {   };
+        std::vector<TaskId>    dependents   {   };
+    } task_t;
+
+    std::vector<task_t>                   tasks          {   };
+    std::vector<taskTiming_t>             timings        {   };
+
+    // Run state, guarded by the mutex
+    std::mutex                            mutex          {   };
+    std::condition_variable               tasksDone      {   };
+    std::vector<uint32_t>                 waitingOn      {   };  // Dependencies of each task not done yet
+    std::vector<bool>                     failed         {   };  // The task or one of its dependencies threw
+    std::vector<std::thread::id>          threads        {   };
+    uint32_t                              doneTasks      { 0 };
+    std::exception_ptr                    firstException {   };
+
+    std::chrono::steady_clock::time_point runStart       {   };
+    double                                wallMs         { 0.0 };
+    uint32_t                              threadCount    { 1 };
+
+public:
+
+    TaskGraph() = default;
+
+    // Disallow copying and moving, running tasks capture `this`
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    /**
+     * @brief Add a task, run once every dependency is done
+     *
+     * @param name Shown in the stats and the CPU profiler trace, a string literal
+     * @param function The work, may throw
+     * @param dependencies Tasks already added
+     * @return The task, for the dependencies of the next ones
+     */
+    TaskId
+    Add(const char *name, std::function<void()> &&function, std::initializer_list<TaskId> dependencies = { })
+    {
+        const TaskId id = static_cast<TaskId>(tasks.size());
+        for (const TaskId dependency : dependencies)
+        {
+            if (dependency >= id) throw std::logic_error("A task can only depend on tasks added before it");
+            tasks[dependency].dependents.push_back(id);
+        }
+
+        tasks.push_back({ .name = name, .function = std::move(function), .dependencies = dependencies });
+        return id;
+    }
+
+    /**
+     * @brief Run every task and wait for them
+     *
+     * @param pool Workers to run the tasks on, nullptr runs them in order on the calling thread
+     */
+    void
+    Run(ThreadPool *pool)
+    {
+        timings.assign(tasks.size(), { });
+        waitingOn.resize(tasks.size());
+        failed.assign(tasks.size(), false);
+        threads.clear();
+        doneTasks      = 0;
+        firstException = nullptr;
+        threadCount    = pool ? pool->GetThreadCount() : 1;
+        runStart       = std::chrono::steady_clock::now();
+
+        for (TaskId id = 0; id < tasks.size(); ++id)
+        {
+            timings[id].name = tasks[id].name;
+            waitingOn[id]    = static_cast<uint32_t>(tasks[id].dependencies.size());
+        }
+
+        if (!pool)
+        {
+            for (TaskId id = 0; id < tasks.size(); ++id) RunTask(id, nullptr);
+        }
+        else
+        {
+            // Snapshot the roots first, a fast one could already release a later task
+            std::vector<TaskId> roots;
+            for (TaskId id = 0; id < tasks.size(); ++id) if (waitingOn[id] == 0) roots.push_back(id);
+            for (const TaskId id : roots) pool->Enqueue([this, id, pool]() { RunTask(id, pool); });
+
+            std::unique_lock<std::mutex> lock(mutex);
+            tasksDone.wait(lock, [this]() { return doneTasks == tasks.size(); });
+        }
+
+        wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - runStart).count();
+        if (firstException) std::rethrow_exception(firstException);
+    }
+
+    /** @brief Get the timing of each task of the last run, in the order they were added */
+    [[nodiscard]] const std::vector<taskTiming_t> &GetTimings() const { return timings; }
+
+    /** @brief Get the time the last run took */
+    [[nodiscard]] double GetWallMs() const { return wallMs; }
+
+    /** @brief Get the sum of the task times of the last run, what running them one after the other would take */
+    [[nodiscard]] double
+    GetWorkMs() const
+    {
+        double workMs = 0.0;
+        for (const taskTiming_t &timing : timings) workMs += timing.endMs - timing.startMs;
+        return workMs;
+    }
+
+    /** @brief Get the longest chain of dependent task times of the last run, the least any number of threads can take */
+    [[nodiscard]] double
+    GetCriticalPathMs() const
+    {
+        std::vector<double> finishMs(tasks.size(), 0.0);
+        for (TaskId id = 0; id < tasks.size(); ++id)
+        {
+            for (const TaskId dependency : tasks[id].dependencies) finishMs[id] = std::max(finishMs[id], finishMs[dependency]);
+            finishMs[id] += timings[id].endMs - timings[id].startMs;
+        }
+        return finishMs.empty() ? 0.0 : *std::ranges::max_element(finishMs);
+    }
+
+    /** @brief Print the totals and each task of the last run, in the order they started */
+    void
+    PrintStats(const char *label) const
+    {
+        fprintf(stdout, "[INFO] %s: %zu steps in %.2f ms on %u threads (%.2f ms of work, critical path %.2f ms)\n", label,
+                tasks.size(), wallMs, threadCount, GetWorkMs(), GetCriticalPathMs());
+
+        std::vector<const taskTiming_t *> sorted;
+        for (const taskTiming_t &timing : timings) sorted.push_back(&timing);
+        std::ranges::stable_sort(sorted, { }, &taskTiming_t::startMs);
+
+        for (const taskTiming_t *timing : sorted)
+        {
+            if (!timing->bRan)
+            {
+                fprintf(stdout, "[INFO]   %-28s skipped, a dependency failed\n", timing->name);
+                continue;
+            }
+            fprintf(stdout, "[INFO]   %-28s %8.2f ms  at %8.2f ms  thread %u\n", timing->name, timing->endMs - timing->startMs,
+                    timing->startMs, timing->thread);
+        }
+    }
+
+private:
+
+    /** @brief Run a task unless a dependency failed, then release its dependents */
+    void
+    RunTask(TaskId id, ThreadPool *pool)
+    {
+        bool bRun;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            bRun = !failed[id];
+        }
+
+        bool bFailed = !bRun;
+        if (bRun)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            try
+            {
+                PROFILE_SCOPE(tasks[id].name);
+                tasks[id].function();
+            }
+            catch (...)
+            {
+                bFailed = true;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!firstException) firstException = std::current_exception();
+            }
+            const auto end = std::chrono::steady_clock::now();
+
+            timings[id].startMs = std::chrono::duration<double, std::milli>(start - runStart).count();
+            timings[id].endMs   = std::chrono::duration<double, std::milli>(end - runStart).count();
+            timings[id].bRan    = true;
+        }
+
+        std::vector<TaskId> released;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (bRun) timings[id].thread = GetThreadIndex();
+
+            for (const TaskId dependent : tasks[id].dependents)
+            {
+                if (bFailed) failed[dependent] = true;
+                if (--waitingOn[dependent] == 0) released.push_back(dependent);
+            }
+
+            // Under the lock: Run can return and the graph go as soon as the waiter wakes
+            if (++doneTasks == tasks.size()) tasksDone.notify_all();
+        }
+
+        // Serially the dependents run in their turn, they were added after this task
+        if (pool)
+        {
+            for (const TaskId dependent : released) pool->Enqueue([this, dependent, pool]() { RunTask(dependent, pool); });
+        }
+    }
+
+    /** @brief Get a small index for the calling thread. Under the mutex */
+    uint32_t
+    GetThreadIndex()
+    {
+        const std::thread::id self = std::this_thread::get_id();
+        const auto            it   = std::ranges::find(threads, self);
+        if (it != threads.end()) return static_cast<uint32_t>(it - threads.begin());
+
+        threads.push_back(self);
+        return static_cast<uint32_t>(threads.size() - 1);
+    }
+};
+
+#endif // TASKGRAPH_HPP
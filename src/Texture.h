@@ -0,0 +1,197 @@
+#ifndef VULKAN_COURSE_TEXTURE_H
+#define VULKAN_COURSE_TEXTURE_H
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "StagingRing.h"
+
+/** @brief Handle to a texture. Indexes the texture lists of the renderer */
+typedef int TextureHandle;
+
+/**
+ * @enum textureState_e
+ * @brief Where a texture is in the decode/upload pipeline
+ */
+typedef enum textureState_e : uint8_t
+{
+	TEXTURE_STATE_PENDING = 0, // Being decoded on a worker or waiting for its upload batch to finish
+	TEXTURE_STATE_READY,       // Uploaded and safe to sample
+	TEXTURE_STATE_FAILED,      // Could not be loaded, never becomes ready
+	TEXTURE_STATE_RELEASED     // Last reference released, the handle waits to be reused
+} textureState_e;
+
+/**
+ * @enum textureUsage_e
+ * @brief What a texture holds, decides if it is stored as sRGB
+ */
+typedef enum textureUsage_e : uint8_t
+{
+	TEXTURE_USAGE_AUTO = 0, // Guessed from the file name: data suffixes such as "_n" or "_mask", colour otherwise
+	TEXTURE_USAGE_COLOR,    // Colour, sRGB encoded when the swap chain is
+	TEXTURE_USAGE_DATA      // Normals, masks and other values read as they are
+} textureUsage_e;
+
+/**
+ * @struct textureMipLevel_t
+ * @brief Where a mip level is in the pixels of a mip chain
+ */
+typedef struct textureMipLevel_t
+{
+	VkDeviceSize offset { 0 };
+	VkDeviceSize size   { 0 };
+	uint32_t     width  { 0 };
+	uint32_t     height { 0 };
+} textureMipLevel_t;
+
+/**
+ * @struct textureMipChain_t
+ * @brief Every mip level of a texture, as laid out in a cooked mip file
+ */
+typedef struct textureMipChain_t
+{
+	uint32_t                       width  { 0 };
+	uint32_t                       height { 0 };
+	VkFormat                       format { VK_FORMAT_R8G8B8A8_UNORM }; // R8, R8G8 or R8G8B8A8, UNORM or SRGB
+	std::vector<textureMipLevel_t> levels { };  // Indexed by mip level, 0 is the full resolution
+	std::vector<uint8_t>           pixels { };  // Smallest level first, each level 4 byte aligned
+} textureMipChain_t;
+
+/**
+ * @struct textureDecode_t
+ * @brief Mip levels of a texture in staging memory, waiting for an upload batch
+ * @details Either the mip tail of a texture decoded by a worker, or the next level of a texture being streamed in
+ */
+typedef struct textureDecode_t
+{
+	TextureHandle       handle          { -1 };
+	uint32_t            width           { 0 };
+	uint32_t            height          { 0 };
+	bool                bFailed         { false };
+	float               decodeMs        { 0.0f };           // Time spent reading and decoding the file
+	bool                bStreamIn       { false };          // Full resolution reload of an evicted texture, no fallback copy
+	bool                bMipUpload      { false };          // Next level of an image already created
+
+	uint32_t            firstMip        { 0 };              // Levels in staging, stored smallest first as in the mip chain
+	uint32_t            mipCount        { 0 };
+	std::shared_ptr<textureMipChain_t> mipChain { };        // Every level, released once the batch staged them
+
+	stagingAllocation_t staging         {   };             // Copy source. Points into the staging ring, or into the dedicated buffer
+	VkDeviceMemory      dedicatedMemory { VK_NULL_HANDLE }; // Set when the image was too big for the staging ring
+} textureDecode_t;
+
+/**
+ * @struct textureUploadBatch_t
+ * @brief Decoded textures uploaded together by a single submit
+ */
+typedef struct textureUploadBatch_t
+{
+	VkCommandBuffer              commandBuffer { VK_NULL_HANDLE };
+	uint64_t                     timelineValue { 0 };              // Graphics timeline value reached once every copy of the batch is done
+	std::vector<textureDecode_t> textures      {   };
+} textureUploadBatch_t;
+
+/**
+ * @struct textureCacheEntry_t
+ * @brief Cache bookkeeping of a texture handle
+ */
+typedef struct textureCacheEntry_t
+{
+	std::vector<std::string> pathKeys    {   };    // Normalised paths the texture was requested with
+	uintmax_t                fileSize    { 0 };    // Size of the file, 0 when unknown. Only files of the same size are compared
+	uint64_t                 contentHash { 0 };    // Hash of the file bytes, 0 until a file of the same size is requested
+	uint32_t                 refCount    { 0 };    // Requests minus releases
+	uint32_t                 cacheHits   { 0 };    // Requests served without loading the file again
+	VkDeviceSize             byteSize    { 0 };    // Size of the decoded pixels
+	float                    decodeMs    { 0.0f }; // Time the single load took
+} textureCacheEntry_t;
+
+/**
+ * @struct textureCacheStats_t
+ * @brief Texture cache counters, for the savings of the deduplication
+ */
+typedef struct textureCacheStats_t
+{
+	uint32_t     hits         { 0 };      // Requests served from the cache, by path or by content
+	uint32_t     contentHits  { 0 };      // Part of the hits matched by content under another path
+	uint32_t     misses       { 0 };      // Requests that loaded a file
+	uint32_t     liveTextures { 0 };      // Textures currently referenced
+	VkDeviceSize bytesSaved   { 0 };      // Device memory not allocated thanks to the hits
+	float        msSaved      { 0.0f };   // Decode time not spent thanks to the hits
+} textureCacheStats_t;
+
+/**
+ * @struct textureResidency_t
+ * @brief Residency of a texture: the full image comes and goes, the low resolution copy stays
+ */
+typedef struct textureResidency_t
+{
+	int                                   fullDescriptor     { -1 };             // Descriptor of the full image
+	int                                   fallbackDescriptor { -1 };             // Descriptor of the low resolution copy
+	int                                   spareDescriptor    { -1 };             // Takes the next view of the full image, while frames in flight may use the current one
+	std::string                           fileName           {   };              // Read again to stream the full image back in
+	textureUsage_e                        usage              { TEXTURE_USAGE_AUTO };
+	VkFormat                              format             { VK_FORMAT_UNDEFINED }; // Format of both images, set by the first upload
+
+	VkImage                               fallbackImage      { VK_NULL_HANDLE };
+	VkDeviceMemory                        fallbackMemory     { VK_NULL_HANDLE };
+	VkImageView                           fallbackView       { VK_NULL_HANDLE };
+
+	VkDeviceSize                          fullBytes          { 0 };
+	VkDeviceSize                          fallbackBytes      { 0 };
+	uint64_t                              lastUsedFrame      { 0 };              // Last frame a draw sampled the texture
+	uint64_t                              lastUsedValue      { 0 };              // Graphics timeline value of that frame, sampled until it is reached
+
+	std::shared_ptr<textureMipChain_t>    mipChain           {   };              // Levels not uploaded yet, null once the full resolution is staged
+	uint32_t                              mipLevels          { 0 };
+	uint32_t                              tailMip            { 0 };              // First level of the mip tail, the one the low resolution copy holds
+	uint32_t                              uploadedMip        { 0 };              // Lowest level with its pixels on the device
+	uint32_t                              viewMip            { 0 };              // Lowest level the view of the full image shows
+	uint64_t                              spareFreeValue     { 0 };              // Graphics timeline value after which the spare descriptor can be written
+
+	bool                                  bResident          { false };          // The full image is uploaded and drawn
+	bool                                  bStreaming         { false };          // The full image is being loaded again
+	bool                                  bUploading         { false };          // A worker or an upload batch still references the texture
+	bool                                  bStreamFailed      { false };          // The file could not be loaded again, stays on the fallback
+	std::chrono::steady_clock::time_point streamRequestTime  {   };
+} textureResidency_t;
+
+/**
+ * @struct textureResidencyStats_t
+ * @brief Texture memory counters of the residency manager
+ */
+typedef struct textureResidencyStats_t
+{
+	VkDeviceSize budgetBytes       { 0 };    // Budget the last residency update evicted down to
+	VkDeviceSize residentBytes     { 0 };    // Full images plus low resolution copies
+	VkDeviceSize fallbackBytes     { 0 };    // Part of the resident bytes held by the low resolution copies
+	uint32_t     residentTextures  { 0 };    // Textures drawn at full resolution
+	uint32_t     evictedTextures   { 0 };    // Textures drawn with their low resolution copy
+	uint32_t     evictions         { 0 };    // Full images dropped so far
+	uint32_t     streamIns         { 0 };    // Full images loaded back so far
+	float        lastStreamInMs    { 0.0f }; // From the request to the image being drawn
+	float        averageStreamInMs { 0.0f };
+	float        maxStreamInMs     { 0.0f };
+} textureResidencyStats_t;
+
+/**
+ * @struct textureFormatStats_t
+ * @brief Formats picked for the textures loaded so far, and the memory saved against storing them all as RGBA8
+ */
+typedef struct textureFormatStats_t
+{
+	uint32_t     r8Textures    { 0 };
+	uint32_t     r8g8Textures  { 0 };
+	uint32_t     rgba8Textures { 0 };
+	uint32_t     srgbTextures  { 0 };   // Part of the above stored as sRGB
+	VkDeviceSize bytes         { 0 };   // Full mip chains in their picked format
+	VkDeviceSize rgba8Bytes    { 0 };   // The same mip chains as RGBA8
+} textureFormatStats_t;
+
+#endif //VULKAN_COURSE_TEXTURE_H
@@ -0,0 +1,335 @@
+#include "TextureAtlas.h"
+
+#include <bit>
+#include <filesystem>
+#include <fstream>
+
+#include "stb_image.h"
+#include "TextureMips.h"
+
+// The implementation compiled by imgui_draw.cpp is static, keep a private copy
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+constexpr uint32_t ATLAS_MANIFEST_VERSION = 3;
+
+/** @brief Mip levels of a page: past them a texel of the padding covers more than the padding, and neighbours bleed */
+constexpr uint32_t ATLAS_MIP_LEVELS = std::bit_width(TEXTURE_ATLAS_PADDING);
+
+static_assert(TEXTURE_ATLAS_MAX_SIZE + 2 * TEXTURE_ATLAS_PADDING <= TEXTURE_ATLAS_PAGE_SIZE, "Atlas textures must fit a page");
+static_assert(std::has_single_bit(TEXTURE_ATLAS_PADDING), "The atlas padding halves with each mip level");
+
+/** @brief "a/../b.png" and "b.png" are the same file */
+static std::string
+NormaliseTexturePath(const std::string &fileName)
+{
+	return std::filesystem::path(fileName).lexically_normal().generic_string();
+}
+
+/** @brief Path of the manifest of an atlas */
+static std::string
+GetManifestPath(const std::string &atlasName)
+{
+	return std::string(TEXTURE_COOKED_DIRECTORY) + "Atlas/" + atlasName + ".atlas";
+}
+
+/** @brief Hash of the requested texture list, a cooked atlas is only reused for the same list */
+static uint64_t
+HashFileList(const std::vector<std::string> &fileNames)
+{
+	uint64_t hash = HashFNV1a(nullptr, 0);
+	for (const auto &fileName : fileNames)
+	{
+		const std::string key = NormaliseTexturePath(fileName);
+		hash = HashFNV1a(key.data(), key.size() + 1, hash); // Terminator included, "ab" + "c" differs from "a" + "bc"
+	}
+	return hash;
+}
+
+
+bool
+TextureAtlas::Build(const std::string &atlasName, const std::vector<std::string> &fileNames)
+{
+	m_entries.clear();
+	m_lookup.clear();
+	m_pages.clear();
+	m_pageCount = 0;
+	m_skipped   = 0;
+
+	if (ReadManifest(atlasName, fileNames)) return !m_entries.empty();
+
+	for (const auto &fileName : fileNames)
+	{
+		// A repeated name is packed once, check before decoding it again
+		std::string normalisedName = NormaliseTexturePath(fileName);
+		if (m_lookup.contains(normalisedName)) continue;
+
+		const std::string filePath = TEXTURE_DIRECTORY + fileName;
+
+		int width, height, channels;
+		stbi_uc *image = stbi_load(filePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!image)
+		{
+			fprintf(stderr, "[ERROR] Failed to load Image: '%s'\n", filePath.c_str());
+			++m_skipped;
+			continue;
+		}
+
+		// Big textures stream their own mips, the atlas is for the small ones
+		if (static_cast<uint32_t>(width) > TEXTURE_ATLAS_MAX_SIZE || static_cast<uint32_t>(height) > TEXTURE_ATLAS_MAX_SIZE)
+		{
+			stbi_image_free(image);
+			++m_skipped;
+			continue;
+		}
+
+		entry_t entry
+		{
+			.fileName = std::move(normalisedName),
+			.width    = static_cast<uint32_t>(width),
+			.height   = static_cast<uint32_t>(height)
+		};
+		entry.pixels.assign(image, image + static_cast<size_t>(width) * height * 4);
+		stbi_image_free(image);
+
+		m_lookup.emplace(entry.fileName, m_entries.size());
+		m_entries.push_back(std::move(entry));
+	}
+
+	if (m_entries.empty()) return false;
+
+	Pack();
+	FillPages();
+
+	if (!Write(atlasName)) fprintf(stderr, "[ERROR] Failed to write texture atlas: '%s'\n", atlasName.c_str());
+
+	return true;
+}
+
+bool
+TextureAtlas::FindRegion(const std::string &fileName, atlasRegion_t *outRegion) const
+{
+	auto found = m_lookup.find(NormaliseTexturePath(fileName));
+	if (found == m_lookup.end()) return false;
+
+	const entry_t &entry = m_entries[found->second];
+	const float    page  = static_cast<float>(TEXTURE_ATLAS_PAGE_SIZE);
+
+	*outRegion =
+	{
+		.page     = entry.page,
+		.uvOffset = glm::vec2(static_cast<float>(entry.x), static_cast<float>(entry.y)) / page,
+		.uvScale  = glm::vec2(static_cast<float>(entry.width), static_cast<float>(entry.height)) / page
+	};
+	return true;
+}
+
+std::string
+TextureAtlas::GetPageName(const std::string &atlasName, uint32_t page)
+{
+	return "Atlas/" + atlasName + "_" + std::to_string(page);
+}
+
+void
+TextureAtlas::RemapTexCoords(std::vector<vertex_t> *vertices, const atlasRegion_t &region)
+{
+	// Only [0, 1] maps inside the region, repeating coordinates would sample the neighbours
+	for (auto &vertex : *vertices) vertex.texCoord = region.uvOffset + vertex.texCoord * region.uvScale;
+}
+
+void
+TextureAtlas::PrintStats(const std::string &atlasName) const
+{
+	const atlasStats_t stats = GetStats();
+	fprintf(stdout, "[INFO] Texture atlas '%s': %u textures in %u pages of %ux%u, %u skipped, %.1f%% of the pages used\n",
+			atlasName.c_str(), stats.packedTextures, stats.pages, TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE,
+			stats.skippedTextures, stats.efficiency * 100.0f);
+}
+
+atlasStats_t
+TextureAtlas::GetStats() const
+{
+	atlasStats_t stats
+	{
+		.pages           = m_pageCount,
+		.packedTextures  = static_cast<uint32_t>(m_entries.size()),
+		.skippedTextures = m_skipped,
+		.pageBytes       = static_cast<VkDeviceSize>(m_pageCount) * TEXTURE_ATLAS_PAGE_SIZE * TEXTURE_ATLAS_PAGE_SIZE * 4
+	};
+
+	for (const auto &entry : m_entries) stats.textureBytes += static_cast<VkDeviceSize>(entry.width) * entry.height * 4;
+
+	if (stats.pageBytes > 0) stats.efficiency = static_cast<float>(stats.textureBytes) / static_cast<float>(stats.pageBytes);
+
+	return stats;
+}
+
+void
+TextureAtlas::Pack()
+{
+	// Padded sizes rounded up to the padding, so every position the packer picks is a multiple of it
+	auto paddedSize = [](uint32_t size) -> int
+	{
+		const uint32_t padded = size + 2 * TEXTURE_ATLAS_PADDING;
+		return static_cast<int>(( padded + TEXTURE_ATLAS_PADDING - 1 ) / TEXTURE_ATLAS_PADDING * TEXTURE_ATLAS_PADDING);
+	};
+
+	std::vector<stbrp_rect> pending(m_entries.size());
+	for (size_t i = 0; i < m_entries.size(); ++i)
+	{
+		pending[i] = { .id = static_cast<int>(i), .w = paddedSize(m_entries[i].width), .h = paddedSize(m_entries[i].height) };
+	}
+
+	// One packer run per page, with what did not fit the previous ones
+	std::vector<stbrp_node> nodes(TEXTURE_ATLAS_PAGE_SIZE);
+	while (!pending.empty())
+	{
+		stbrp_context context;
+		stbrp_init_target(&context, TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE, nodes.data(), static_cast<int>(nodes.size()));
+		stbrp_pack_rects(&context, pending.data(), static_cast<int>(pending.size()));
+
+		std::vector<stbrp_rect> left;
+		for (const auto &rect : pending)
+		{
+			if (!rect.was_packed)
+			{
+				left.push_back(rect);
+				continue;
+			}
+
+			entry_t &entry = m_entries[rect.id];
+			entry.page = m_pageCount;
+			entry.x    = static_cast<uint32_t>(rect.x) + TEXTURE_ATLAS_PADDING;
+			entry.y    = static_cast<uint32_t>(rect.y) + TEXTURE_ATLAS_PADDING;
+		}
+
+		++m_pageCount;
+		pending.swap(left);
+	}
+}
+
+void
+TextureAtlas::FillPages()
+{
+	m_pages.assign(m_pageCount, std::vector<uint8_t>(static_cast<size_t>(TEXTURE_ATLAS_PAGE_SIZE) * TEXTURE_ATLAS_PAGE_SIZE * 4, 0));
+
+	const int padding = static_cast<int>(TEXTURE_ATLAS_PADDING);
+	for (auto &entry : m_entries)
+	{
+		uint8_t *page = m_pages[entry.page].data();
+
+		const int width  = static_cast<int>(entry.width);
+		const int height = static_cast<int>(entry.height);
+
+		// The padding takes the closest edge pixel, as clamp to edge would
+		for (int y = -padding; y < height + padding; ++y)
+		{
+			const int srcY = std::clamp(y, 0, height - 1);
+			uint8_t  *dst  = page + ( ( entry.y + y ) * TEXTURE_ATLAS_PAGE_SIZE + entry.x - padding ) * 4;
+
+			for (int x = -padding; x < width + padding; ++x, dst += 4)
+			{
+				const int srcX = std::clamp(x, 0, width - 1);
+				memcpy(dst, entry.pixels.data() + ( static_cast<size_t>(srcY) * width + srcX ) * 4, 4);
+			}
+		}
+
+		entry.pixels = {};
+	}
+}
+
+bool
+TextureAtlas::Write(const std::string &atlasName) const
+{
+	// Pages first, the manifest marks the atlas as complete
+	for (uint32_t page = 0; page < m_pageCount; ++page)
+	{
+		// Cut where the padding runs out, the image and its views then never reach a level that blends neighbours
+		textureMipChain_t mipChain;
+		BuildMipChain(m_pages[page].data(), TEXTURE_ATLAS_PAGE_SIZE, TEXTURE_ATLAS_PAGE_SIZE, VK_FORMAT_R8G8B8A8_SRGB, &mipChain,
+		              ATLAS_MIP_LEVELS);
+
+		if (!WriteMipFile(GetCookedTexturePath(GetPageName(atlasName, page)), mipChain)) return false;
+	}
+
+	const std::string manifestPath = GetManifestPath(atlasName);
+	const std::string tempPath     = manifestPath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		file << "atlas " << ATLAS_MANIFEST_VERSION << ' ' << TEXTURE_ATLAS_PAGE_SIZE << ' ' << TEXTURE_ATLAS_PADDING << ' '
+		     << m_pageCount << ' ' << m_entries.size() << ' ' << m_skipped << ' ' << m_listHash << '\n';
+
+		// page x y width height name
+		for (const auto &entry : m_entries)
+		{
+			file << entry.page << ' ' << entry.x << ' ' << entry.y << ' ' << entry.width << ' ' << entry.height << ' '
+			     << entry.fileName << '\n';
+		}
+
+		if (!file) return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, manifestPath, error);
+	return !error;
+}
+
+bool
+TextureAtlas::ReadManifest(const std::string &atlasName, const std::vector<std::string> &fileNames)
+{
+	m_listHash = HashFileList(fileNames);
+
+	const std::string manifestPath = GetManifestPath(atlasName);
+
+	std::error_code error;
+	const auto manifestTime = std::filesystem::last_write_time(manifestPath, error);
+	if (error) return false;
+
+	// Stale once a texture changed. Textures shipped without their source are fine
+	for (const auto &fileName : fileNames)
+	{
+		const auto sourceTime = std::filesystem::last_write_time(TEXTURE_DIRECTORY + fileName, error);
+		if (!error && sourceTime > manifestTime) return false;
+	}
+
+	std::ifstream file(manifestPath);
+	if (!file.is_open()) return false;
+
+	std::string tag;
+	uint32_t    version, pageSize, padding, pageCount, skipped;
+	size_t      entryCount;
+	uint64_t    listHash;
+	file >> tag >> version >> pageSize >> padding >> pageCount >> entryCount >> skipped >> listHash;
+
+	if (!file || tag != "atlas" || version != ATLAS_MANIFEST_VERSION) return false;
+	if (pageSize != TEXTURE_ATLAS_PAGE_SIZE || padding != TEXTURE_ATLAS_PADDING || listHash != m_listHash) return false;
+
+	for (uint32_t page = 0; page < pageCount; ++page)
+	{
+		if (!std::filesystem::exists(GetCookedTexturePath(GetPageName(atlasName, page)), error)) return false;
+	}
+
+	for (size_t i = 0; i < entryCount; ++i)
+	{
+		entry_t entry;
+		file >> entry.page >> entry.x >> entry.y >> entry.width >> entry.height >> std::ws;
+		std::getline(file, entry.fileName);
+
+		if (!file || entry.page >= pageCount)
+		{
+			m_entries.clear();
+			m_lookup.clear();
+			return false;
+		}
+
+		m_lookup.emplace(entry.fileName, m_entries.size());
+		m_entries.push_back(std::move(entry));
+	}
+
+	m_pageCount = pageCount;
+	m_skipped   = skipped;
+	return true;
+}
@@ -0,0 +1,136 @@
+#ifndef VULKAN_COURSE_TEXTURE_ATLAS_H
+#define VULKAN_COURSE_TEXTURE_ATLAS_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Texture.h"
+#include "Utilities.h"
+
+/**
+ * @struct atlasRegion_t
+ * @brief Where a texture landed in an atlas
+ * @details uv_in_page = uvOffset + uv * uvScale
+ */
+typedef struct atlasRegion_t
+{
+	uint32_t      page     { 0 };
+	glm::vec2     uvOffset { 0.0f };
+	glm::vec2     uvScale  { 1.0f };
+	TextureHandle texture  { -1 };   // Texture of the page, set by the renderer once the page is requested
+} atlasRegion_t;
+
+/**
+ * @struct atlasStats_t
+ * @brief Pack efficiency of an atlas
+ */
+typedef struct atlasStats_t
+{
+	uint32_t     pages           { 0 };
+	uint32_t     packedTextures  { 0 };
+	uint32_t     skippedTextures { 0 };    // Too big for the atlas, or failed to load
+	VkDeviceSize pageBytes       { 0 };    // Pixels of every page
+	VkDeviceSize textureBytes    { 0 };    // Pixels of the packed textures, padding excluded
+	float        efficiency      { 0.0f }; // textureBytes / pageBytes
+} atlasStats_t;
+
+
+/**
+ * @class TextureAtlas
+ * @brief Packs small textures into shared pages with the stb rect packer
+ * @details Each texture is surrounded by TEXTURE_ATLAS_PADDING pixels of its own edges, and placed on a multiple of it,
+ *          so filtering and the first mip levels never blend neighbours. Pages stop at those levels, 3 for a 4 pixel
+ *          padding. Pages are cooked as mip files named GetPageName(), with a manifest next to them, so they load like
+ *          any cooked texture. Pages are colour, sRGB
+ *
+ * @example
+ * {
+ *   TextureAtlas atlas;
+ *   atlas.Build("props", { "crate.png", "barrel.png" });
+ *   atlasRegion_t region;
+ *   if (atlas.FindRegion("crate.png", &region)) TextureAtlas::RemapTexCoords(&vertices, region);
+ * }
+ */
+class TextureAtlas
+{
+public:
+
+	TextureAtlas() = default;
+	~TextureAtlas() = default;
+
+	/**
+	 * @brief Load the cooked atlas if it is up to date, otherwise load the textures, pack them and cook the pages
+	 *
+	 * @param atlasName The name of the atlas
+	 * @param fileNames The textures to pack, relative to the textures folder. The ones too big are skipped
+	 * @return False if nothing could be packed
+	 */
+	bool Build(const std::string &atlasName, const std::vector<std::string> &fileNames);
+
+	/**
+	 * @brief Find where a texture landed
+	 * @return False if the texture is not in the atlas
+	 */
+	bool FindRegion(const std::string &fileName, atlasRegion_t *outRegion) const;
+
+	/** @brief Get the texture name of a page, as given to CreateTextureAsync */
+	[[nodiscard]] static std::string GetPageName(const std::string &atlasName, uint32_t page);
+
+	/** @brief Move texture coordinates into the region of a texture in its page */
+	static void RemapTexCoords(std::vector<vertex_t> *vertices, const atlasRegion_t &region);
+
+	/** @brief Get the number of pages */
+	[[nodiscard]] uint32_t GetPageCount() const;
+
+	/** @brief Get the pack efficiency */
+	[[nodiscard]] atlasStats_t GetStats() const;
+
+	/** @brief Print the pack efficiency */
+	void PrintStats(const std::string &atlasName) const;
+
+private:
+
+	/**
+	 * @struct entry_t
+	 * @brief A texture to pack, then packed
+	 */
+	typedef struct entry_t
+	{
+		std::string          fileName { };
+		uint32_t             width    { 0 };
+		uint32_t             height   { 0 };
+		std::vector<uint8_t> pixels   { };  // RGBA8, dropped once written to its page
+		uint32_t             page     { 0 };
+		uint32_t             x        { 0 }; // Top left of the texture in its page, padding excluded
+		uint32_t             y        { 0 };
+	} entry_t;
+
+	std::vector<entry_t>                          m_entries   { };
+	std::unordered_map<std::string, size_t>       m_lookup    { }; // Normalised file name to entry
+	std::vector<std::vector<uint8_t>>             m_pages     { }; // RGBA8 pages, empty when read from the manifest
+	uint32_t                                      m_pageCount { 0 };
+	uint32_t                                      m_skipped   { 0 };
+	uint64_t                                      m_listHash  { 0 }; // Hash of the requested texture list
+
+	/** @brief Place every entry, opening pages as needed */
+	void Pack();
+
+	/** @brief Copy the entries into their pages, with their edges extruded into the padding */
+	void FillPages();
+
+	/** @brief Cook the pages and write the manifest */
+	bool Write(const std::string &atlasName) const;
+
+	/** @brief Read the manifest, if it is newer than every texture and lists the same textures */
+	bool ReadManifest(const std::string &atlasName, const std::vector<std::string> &fileNames);
+};
+
+
+FORCE_INLINE uint32_t
+TextureAtlas::GetPageCount() const
+{
+	return m_pageCount;
+}
+
+#endif //VULKAN_COURSE_TEXTURE_ATLAS_H
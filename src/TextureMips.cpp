@@ -0,0 +1,314 @@
+#include "TextureMips.h"
+
+#include <bit>
+#include <filesystem>
+#include <fstream>
+
+#include "ImageKernels.h"
+#include "Utilities.h"
+
+/** @brief "MIPS" */
+constexpr uint32_t MIP_FILE_MAGIC   = 0x5350494D;
+constexpr uint32_t MIP_FILE_VERSION = 3;
+
+/**
+ * @struct mipFileHeader_t
+ * @brief Start of a cooked mip file
+ */
+typedef struct mipFileHeader_t
+{
+	uint32_t magic    { MIP_FILE_MAGIC };
+	uint32_t version  { MIP_FILE_VERSION };
+	uint32_t width    { 0 };
+	uint32_t height   { 0 };
+	uint32_t mipCount { 0 };
+	uint32_t format   { VK_FORMAT_R8G8B8A8_UNORM };
+} mipFileHeader_t;
+
+/**
+ * @struct mipFileLevel_t
+ * @brief Where a level is in the pixel data of a cooked mip file
+ */
+typedef struct mipFileLevel_t
+{
+	uint64_t offset { 0 };
+	uint64_t size   { 0 };
+	uint32_t width  { 0 };
+	uint32_t height { 0 };
+} mipFileLevel_t;
+
+
+/** @brief Lay up to maxLevels levels of a chain out smallest first, each on 4 bytes, and size its pixels */
+static void
+LayoutMipChain(textureMipChain_t *chain, uint32_t maxLevels)
+{
+	const uint32_t channels = GetFormatChannels(chain->format);
+
+	chain->levels.clear();
+	for (uint32_t w = chain->width, h = chain->height;; w = std::max(1u, w / 2), h = std::max(1u, h / 2))
+	{
+		chain->levels.push_back({ .size = static_cast<VkDeviceSize>(w) * h * channels, .width = w, .height = h });
+		if (( w == 1 && h == 1 ) || chain->levels.size() == maxLevels) break;
+	}
+
+	VkDeviceSize offset = 0;
+	for (auto level = chain->levels.rbegin(); level != chain->levels.rend(); ++level)
+	{
+		level->offset = offset;
+		offset = ( offset + level->size + 3 ) & ~VkDeviceSize(3);
+	}
+	chain->pixels.assign(offset, 0);
+}
+
+
+void
+BuildMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, VkFormat format, textureMipChain_t *outChain,
+              uint32_t maxLevels)
+{
+	outChain->width  = width;
+	outChain->height = height;
+	outChain->format = format;
+	LayoutMipChain(outChain, maxLevels);
+
+	memcpy(outChain->pixels.data() + outChain->levels[0].offset, pixels, outChain->levels[0].size);
+
+	const uint32_t channels = GetFormatChannels(format);
+	const bool     bSRGB    = IsSRGBFormat(format);
+
+	for (size_t i = 1; i < outChain->levels.size(); ++i)
+	{
+		const textureMipLevel_t &src = outChain->levels[i - 1];
+		const textureMipLevel_t &dst = outChain->levels[i];
+
+		DownsampleTexels(outChain->pixels.data() + src.offset, src.width, src.height,
+		                 outChain->pixels.data() + dst.offset, dst.width, dst.height, channels, bSRGB);
+	}
+}
+
+void
+BuildTextureMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool bColor,
+                     textureMipChain_t *outChain)
+{
+	const VkFormat format = GetTexelFormat(channels, bColor);
+	const size_t   count  = static_cast<size_t>(width) * height;
+
+	// RGB has no texture format widely supported, and sRGB grey plus alpha keeps its alpha linear in RGBA only
+	std::vector<uint8_t> expanded;
+	if (GetFormatChannels(format) != channels)
+	{
+		expanded.resize(count * 4);
+		if (channels == 3) ExpandRGBToRGBA(pixels, expanded.data(), count);
+
+		for (size_t i = 0; channels == 2 && i < count; ++i)
+		{
+			expanded[i * 4 + 0] = pixels[i * 2];
+			expanded[i * 4 + 1] = pixels[i * 2];
+			expanded[i * 4 + 2] = pixels[i * 2];
+			expanded[i * 4 + 3] = pixels[i * 2 + 1];
+		}
+		pixels = expanded.data();
+	}
+
+	BuildMipChain(pixels, width, height, format, outChain);
+}
+
+void
+ConvertMipChain(textureMipChain_t *chain, VkFormat format)
+{
+	const uint32_t srcChannels = GetFormatChannels(chain->format);
+	const uint32_t dstChannels = GetFormatChannels(format);
+
+	if (srcChannels == dstChannels) chain->format = format;
+	if (srcChannels >= dstChannels) return;
+
+	textureMipChain_t converted { .width = chain->width, .height = chain->height, .format = format };
+	LayoutMipChain(&converted, static_cast<uint32_t>(chain->levels.size()));
+
+	for (size_t i = 0; i < chain->levels.size(); ++i)
+	{
+		const uint8_t *src   = chain->pixels.data() + chain->levels[i].offset;
+		uint8_t       *dst   = converted.pixels.data() + converted.levels[i].offset;
+		const size_t   count = static_cast<size_t>(chain->levels[i].width) * chain->levels[i].height;
+
+		for (size_t t = 0; t < count; ++t, src += srcChannels, dst += dstChannels)
+		{
+			// Same mapping as the swizzle of GetFormatSwizzle: grey, grey, grey, alpha
+			const uint8_t grey  = src[0];
+			const uint8_t alpha = srcChannels == 2 ? src[1] : 255;
+
+			if (dstChannels == 2)
+			{
+				dst[0] = grey;
+				dst[1] = alpha;
+				continue;
+			}
+
+			dst[0] = grey;
+			dst[1] = grey;
+			dst[2] = grey;
+			dst[3] = alpha;
+		}
+	}
+
+	*chain = std::move(converted);
+}
+
+bool
+ReadMipFile(const std::string &filePath, textureMipChain_t *outChain)
+{
+	std::ifstream file(filePath, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	mipFileHeader_t header;
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+
+	if (header.magic != MIP_FILE_MAGIC || header.version != MIP_FILE_VERSION) return false;
+	if (GetFormatChannels(static_cast<VkFormat>(header.format)) == 0 || header.mipCount == 0 || header.mipCount > 32) return false;
+
+	std::vector<mipFileLevel_t> levels(header.mipCount);
+	if (!file.read(reinterpret_cast<char *>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(mipFileLevel_t)))) return false;
+
+	outChain->width  = header.width;
+	outChain->height = header.height;
+	outChain->format = static_cast<VkFormat>(header.format);
+	outChain->levels.clear();
+
+	const uint32_t channels = GetFormatChannels(outChain->format);
+
+	if (header.width == 0 || header.height == 0 || header.mipCount > GetMipLevelCount(header.width, header.height)) return false;
+
+	VkDeviceSize dataSize = 0;
+	for (uint32_t i = 0; i < header.mipCount; ++i)
+	{
+		const mipFileLevel_t &level = levels[i];
+
+		// Each level halves the previous one, from the size of the header
+		if (level.width != std::max(1u, header.width >> i) || level.height != std::max(1u, header.height >> i)) return false;
+		if (level.size != static_cast<uint64_t>(level.width) * level.height * channels || level.offset % 4 != 0) return false;
+
+		outChain->levels.push_back({ .offset = level.offset, .size = level.size, .width = level.width, .height = level.height });
+		dataSize = std::max(dataSize, static_cast<VkDeviceSize>(level.offset + level.size));
+	}
+
+	// Truncated file
+	std::error_code error;
+	const uintmax_t fileSize = std::filesystem::file_size(filePath, error);
+	if (error || sizeof(header) + levels.size() * sizeof(mipFileLevel_t) + dataSize > fileSize) return false;
+
+	outChain->pixels.resize(dataSize);
+	return static_cast<bool>(file.read(reinterpret_cast<char *>(outChain->pixels.data()), static_cast<std::streamsize>(dataSize)));
+}
+
+bool
+WriteMipFile(const std::string &filePath, const textureMipChain_t &chain)
+{
+	std::error_code error;
+	std::filesystem::create_directories(std::filesystem::path(filePath).parent_path(), error);
+
+	const std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		mipFileHeader_t header
+		{
+			.width    = chain.width,
+			.height   = chain.height,
+			.mipCount = static_cast<uint32_t>(chain.levels.size()),
+			.format   = static_cast<uint32_t>(chain.format)
+		};
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+		for (const auto &level : chain.levels)
+		{
+			mipFileLevel_t fileLevel { .offset = level.offset, .size = level.size, .width = level.width, .height = level.height };
+			file.write(reinterpret_cast<const char *>(&fileLevel), sizeof(fileLevel));
+		}
+
+		file.write(reinterpret_cast<const char *>(chain.pixels.data()), static_cast<std::streamsize>(chain.pixels.size()));
+	}
+
+	if (std::filesystem::file_size(tempPath, error) != sizeof(mipFileHeader_t) + chain.levels.size() * sizeof(mipFileLevel_t) + chain.pixels.size())
+	{
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, filePath, error);
+	return !error;
+}
+
+std::string
+GetCookedTexturePath(const std::string &fileName)
+{
+	return TEXTURE_COOKED_DIRECTORY + fileName + ".mips";
+}
+
+VkFormat
+GetTexelFormat(uint32_t channels, bool bSRGB)
+{
+	switch (channels)
+	{
+		case 1:  return bSRGB ? VK_FORMAT_R8_SRGB   : VK_FORMAT_R8_UNORM;
+		case 2:  return bSRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8_UNORM;
+		default: return bSRGB ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	}
+}
+
+uint32_t
+GetFormatChannels(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8_UNORM:
+		case VK_FORMAT_R8_SRGB:       return 1;
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R8G8_SRGB:     return 2;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB: return 4;
+		default:                      return 0;
+	}
+}
+
+bool
+IsSRGBFormat(VkFormat format)
+{
+	switch (format)
+	{
+		case VK_FORMAT_R8_SRGB:
+		case VK_FORMAT_R8G8_SRGB:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_SRGB: return true;
+		default:                      return false;
+	}
+}
+
+VkComponentMapping
+GetFormatSwizzle(VkFormat format)
+{
+	// stb_image decodes 1 channel files as grey, and 2 channel files as grey plus alpha
+	switch (GetFormatChannels(format))
+	{
+		case 1:  return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+		case 2:  return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G };
+		default: return { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+		                  VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	}
+}
+
+uint32_t
+GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	return static_cast<uint32_t>(std::bit_width(std::max(width, height)));
+}
+
+uint32_t
+GetMipTailLevel(const textureMipChain_t &chain)
+{
+	for (uint32_t i = 0; i < chain.levels.size(); ++i)
+	{
+		if (std::max(chain.levels[i].width, chain.levels[i].height) <= TEXTURE_FALLBACK_SIZE) return i;
+	}
+
+	return static_cast<uint32_t>(chain.levels.size()) - 1;
+}
@@ -0,0 +1,82 @@
+#ifndef VULKAN_COURSE_TEXTURE_MIPS_H
+#define VULKAN_COURSE_TEXTURE_MIPS_H
+
+#include <string>
+
+#include "Texture.h"
+
+/*
+ * Cooked mip file layout (native endianness):
+ *
+ *   mipFileHeader_t                       magic, version, size of level 0, level count, format
+ *   mipFileLevel_t  [mipCount]            indexed by mip level, 0 is the full resolution
+ *   pixels                                smallest level first, so the mip tail is at the start of the data.
+ *                                         Levels start on 4 bytes, as buffer to image copies require
+ */
+
+/**
+ * @brief Build the whole mip chain of 8 bit pixels
+ * @details Each level is box filtered from the previous one, down to 1x1. sRGB formats are filtered in linear space
+ *
+ * @param pixels The level 0 pixels, tightly packed
+ * @param format R8, R8G8 or R8G8B8A8, UNORM or SRGB
+ * @param outChain The mip chain, pixels stored smallest level first
+ * @param maxLevels Stop before 1x1 once the chain has this many levels
+ */
+void BuildMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, VkFormat format, textureMipChain_t *outChain,
+                   uint32_t maxLevels = UINT32_MAX);
+
+/**
+ * @brief Build the mip chain of the pixels of a decoded file, in the format GetTexelFormat gives its channels
+ * @details RGB gets an opaque alpha. Grey plus alpha colour is widened to RGBA: R8G8_SRGB would decode the alpha in G
+ *
+ * @param pixels The level 0 pixels, tightly packed, 1 to 4 channels
+ * @param bColor The pixels are colour, cooked as sRGB
+ * @param outChain The mip chain, pixels stored smallest level first
+ */
+void BuildTextureMipChain(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool bColor,
+                          textureMipChain_t *outChain);
+
+/**
+ * @brief Change the format of a mip chain, to one the device supports or to another colour space
+ * @details Channels can only be added: grey levels are repeated to RGB, a second channel becomes alpha.
+ *          The colour space is only relabelled, the bytes are kept
+ */
+void ConvertMipChain(textureMipChain_t *chain, VkFormat format);
+
+/**
+ * @brief Read a cooked mip file
+ * @return False if the file is missing, truncated, not a mip file of this version, or its levels do not halve from level 0
+ */
+bool ReadMipFile(const std::string &filePath, textureMipChain_t *outChain);
+
+/**
+ * @brief Write a cooked mip file
+ * @details Written to a temporary file renamed over the target, readers never see a partial file
+ *
+ * @return False if the file could not be written
+ */
+bool WriteMipFile(const std::string &filePath, const textureMipChain_t &chain);
+
+/** @brief Get the path of the cooked mip file of a texture, given its name relative to the textures folder */
+std::string GetCookedTexturePath(const std::string &fileName);
+
+/** @brief Get the texture format of 8 bit pixels: R8 for 1 channel, R8G8 for 2 (RGBA8 for sRGB), R8G8B8A8 otherwise */
+VkFormat GetTexelFormat(uint32_t channels, bool bSRGB);
+
+/** @brief Get the channels of a texture format, 0 if it is not one */
+uint32_t GetFormatChannels(VkFormat format);
+
+/** @brief Checks if a format stores sRGB encoded colours */
+bool IsSRGBFormat(VkFormat format);
+
+/** @brief Get the swizzle showing R8 as grey and R8G8 as grey plus alpha, identity for every other format */
+VkComponentMapping GetFormatSwizzle(VkFormat format);
+
+/** @brief Get the number of levels of a whole mip chain, down to 1x1 */
+uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+/** @brief Get the first level of the mip tail: the largest level within TEXTURE_FALLBACK_SIZE */
+uint32_t GetMipTailLevel(const textureMipChain_t &chain);
+
+#endif //VULKAN_COURSE_TEXTURE_MIPS_H
@@ -0,0 +1,131 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed size pool of worker threads consuming a FIFO of jobs
+ *
+ * @example
+ * {
+ *   ThreadPool pool(4);
+ *   pool.Enqueue([]() { DecodeSomething(); });
+ *   pool.WaitIdle();
+ * }
+ * // Workers are joined when the pool goes out of scope
+ *
+ */
+class ThreadPool
+{
+
+private:
+    std::vector<std::thread>          workers    {   };
+    std::deque<std::function<void()>> jobs       {   };
+
+    std::mutex                        mutex      {   };
+    std::condition_variable           jobReady   {   };
+    std::condition_variable           jobsDone   {   };
+
+    uint32_t                          activeJobs { 0 };
+    bool                              stopping   { false };
+
+public:
+
+    /**
+     * @brief Construct a new Thread Pool object
+     *
+     * @param threadCount Number of workers to spawn. 0 picks one less than the hardware concurrency (at least 1)
+     */
+    explicit ThreadPool(uint32_t threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            // hardware_concurrency may be 0 when unknown, subtracting first would wrap around
+            const unsigned hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; ++i)
+        {
+            workers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+
+        for (auto &worker : workers) worker.join();
+    }
+
+    // Disallow copying and moving, workers capture `this`
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** @brief Get the number of worker threads */
+    [[nodiscard]] uint32_t GetThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    /** @brief Push a job to the back of the queue */
+    void
+    Enqueue(std::function<void()> &&job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        jobReady.notify_one();
+    }
+
+    /** @brief Block until the queue is empty and no job is running */
+    void
+    WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobsDone.wait(lock, [this]() { return jobs.empty() && activeJobs == 0; });
+    }
+
+private:
+
+    /** @brief Pop and run jobs until the pool is stopped */
+    void
+    WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+                // Drain the remaining jobs before leaving
+                if (jobs.empty()) return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                ++activeJobs;
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --activeJobs;
+                if (jobs.empty() && activeJobs == 0) jobsDone.notify_all();
+            }
+        }
+    }
+};
+
+#endif // THREADPOOL_HPP
@@ -0,0 +1,80 @@
+#ifndef TRIPLEBUFFER_HPP
+#define TRIPLEBUFFER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Lock-free handoff of the latest value from one writer thread to one reader thread
+ * @details Three slots: the writer owns one, the reader owns one, the third is the last published value.
+ *          Publishing and acquiring swap an owned slot with the published one, neither side ever waits.
+ *          The reader only sees the newest value, the ones it was too slow to take are overwritten.
+ *
+ * @example
+ * {
+ *   TripleBuffer<snapshot_t> handoff;
+ *
+ *   // Writer thread
+ *   handoff.GetWriteBuffer() = Simulate();
+ *   handoff.Publish();
+ *
+ *   // Reader thread
+ *   if (handoff.Acquire()) Render(handoff.GetReadBuffer());
+ * }
+ */
+template<typename T>
+class TripleBuffer
+{
+
+private:
+    /** @brief Set on the published slot index while the reader has not taken it */
+    static constexpr uint8_t FRESH_BIT  = 0x4;
+    static constexpr uint8_t INDEX_MASK = 0x3;
+
+    std::array<T, 3>     buffers   {   };
+
+    std::atomic<uint8_t> published { 1 };  // Index of the published slot, and FRESH_BIT
+    uint8_t              writeSlot { 0 };  // Owned by the writer
+    uint8_t              readSlot  { 2 };  // Owned by the reader
+
+public:
+
+    TripleBuffer() = default;
+
+    // Disallow copying and moving, each thread holds on to a slot
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /** @brief Get the slot to write the next value into. Writer thread only */
+    T &GetWriteBuffer() { return buffers[writeSlot]; }
+
+    /** @brief Publish the written slot, the writer gets the previously published one back. Writer thread only */
+    void
+    Publish()
+    {
+        // Release: the reader sees the whole value once it sees the index
+        const uint8_t previous = published.exchange(writeSlot | FRESH_BIT, std::memory_order_acq_rel);
+        writeSlot = previous & INDEX_MASK;
+    }
+
+    /**
+     * @brief Take the newest published value, if there is one since the last call. Reader thread only
+     * @return True if the read slot changed
+     */
+    bool
+    Acquire()
+    {
+        if ((published.load(std::memory_order_relaxed) & FRESH_BIT) == 0) return false;
+
+        // Acquire: pairs with the release of Publish
+        const uint8_t previous = published.exchange(readSlot, std::memory_order_acq_rel);
+        readSlot = previous & INDEX_MASK;
+        return true;
+    }
+
+    /** @brief Get the value last acquired. Reader thread only */
+    [[nodiscard]] const T &GetReadBuffer() const { return buffers[readSlot]; }
+};
+
+#endif // TRIPLEBUFFER_HPP
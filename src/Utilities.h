@@ -2,10 +2,14 @@
 #define UTILITIES_H
 
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <functional>
 #include <fstream>
+#include <mutex>
 #include <ranges>
+#include <utility>
+#include <algorithm>
 #include <array>
 #include <vector>
 
@@ -52,12 +56,138 @@
 // ============================================ Vulkan Constants ========================================================
 // ======================================================================================================================
 
-/** @brief The maximum number of frames that can be in flight */
-constexpr int MAX_FRAME_DRAWS = 2;
+/** @brief The maximum number of frames that can be in flight. Resources the present engine holds are kept this many frames */
+constexpr int MAX_FRAME_DRAWS = 4;
+
+/** @brief Frames in flight until told otherwise, 1 to MAX_FRAME_DRAWS. Fewer is lower latency, more hides CPU spikes */
+constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
 
 /** @brief The maximum number of objects in the scene */
 constexpr int MAX_OBJECTS     = 256;
 
+/** @brief Number of texture decode workers. 0 picks one less than the hardware concurrency */
+constexpr uint32_t TEXTURE_DECODE_THREADS = 0;
+
+/** @brief Size of the staging ring shared by texture uploads */
+constexpr VkDeviceSize TEXTURE_STAGING_RING_SIZE = 64 * 1024 * 1024;
+
+/** @brief Folder texture file names are relative to */
+constexpr const char *TEXTURE_DIRECTORY = "Assets/Textures/";
+
+/** @brief Also deduplicate textures by file content, so identical files under different names share one image. Files are only read to compare when sizes match */
+constexpr bool TEXTURE_CACHE_BY_CONTENT = true;
+
+/** @brief Use one bindless texture array when the device supports descriptor indexing */
+constexpr bool ENABLE_BINDLESS_TEXTURES = true;
+
+/** @brief Upper bound of the bindless texture array, lowered to the device limits */
+constexpr uint32_t BINDLESS_MAX_TEXTURES = 4096;
+
+/** @brief Fragment shader sampling the bindless texture array. Bindless stays off when it is not embedded */
+constexpr const char *BINDLESS_FRAGMENT_SHADER = "frag_bindless.spv";
+
+/** @brief Environment variable naming a folder of .spv files used instead of the embedded shaders, for development */
+constexpr const char *SHADER_OVERRIDE_ENVIRONMENT = "VULKAN_COURSE_SHADER_DIR";
+
+/** @brief Recompile the shader sources when they change and rebuild their pipelines. Linux, with a shader compiler at build time */
+constexpr bool ENABLE_SHADER_HOT_RELOAD = true;
+
+/** @brief Time a source must stay unchanged before it is compiled, editors save in several writes */
+constexpr uint32_t SHADER_RELOAD_DELAY_MS = 100;
+
+/** @brief Device memory textures may use before the least recently used ones fall back to low resolution */
+constexpr VkDeviceSize TEXTURE_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+/** @brief Frames between two queries of the heap budget, every frame once the textures are within 1/8 of the last one */
+constexpr uint64_t TEXTURE_BUDGET_QUERY_FRAMES = 30;
+
+/** @brief Largest side of the mip tail uploaded with the first batch, also kept as the copy drawn while the full image is evicted */
+constexpr uint32_t TEXTURE_FALLBACK_SIZE = 64;
+
+/** @brief Bytes of larger mip levels uploaded per frame. A level bigger than that still goes up alone */
+constexpr VkDeviceSize TEXTURE_MIP_UPLOAD_BUDGET = 8 * 1024 * 1024;
+
+/** @brief Folder of the cooked mip files, mirroring the textures folder */
+constexpr const char *TEXTURE_COOKED_DIRECTORY = "Assets/Textures/Cooked/";
+
+/** @brief Cook textures without an up to date mip file when they are loaded, so the next runs skip the decode */
+constexpr bool TEXTURE_COOK_ON_LOAD = true;
+
+/** @brief Textures up to this size on both sides can be packed into atlas pages */
+constexpr uint32_t TEXTURE_ATLAS_MAX_SIZE = 256;
+
+/** @brief Side of an atlas page */
+constexpr uint32_t TEXTURE_ATLAS_PAGE_SIZE = 2048;
+
+/** @brief Edge pixels repeated around each texture of an atlas. Also its placement grid. Pages keep log2(padding) mips */
+constexpr uint32_t TEXTURE_ATLAS_PADDING = 4;
+
+/** @brief Pipeline cache kept between runs, rejected when written for another device or driver */
+constexpr const char *PIPELINE_CACHE_FILE = "Assets/Cache/pipelines.bin";
+
+/** @brief Number of workers compiling pipeline variants in the background */
+constexpr uint32_t PIPELINE_COMPILE_THREADS = 2;
+
+/** @brief Frames between two saves of the pipeline cache, so a crash keeps what was compiled. Unchanged data is not written */
+constexpr uint64_t PIPELINE_CACHE_SAVE_INTERVAL = 3600;
+
+/** @brief Frame rate the main loop is paced to, 0 runs unpaced */
+constexpr double FRAME_PACER_TARGET_FPS = 60.0;
+
+/** @brief Shortest spin before a frame deadline, the rest of the wait sleeps. Grows with the oversleeps seen */
+constexpr uint32_t FRAME_PACER_MIN_SPIN_US = 200;
+
+/** @brief Track the GPU progress with a timeline semaphore per queue when the device has them, a fence per submit otherwise */
+constexpr bool ENABLE_TIMELINE_SEMAPHORES = true;
+
+/** @brief Pace on the presents reported by VK_KHR_present_wait when the device has it */
+constexpr bool ENABLE_PRESENT_WAIT = true;
+
+/** @brief Present mode the swap chain asks for until told otherwise, FIFO is used when the surface does not support it */
+constexpr VkPresentModeKHR DEFAULT_PRESENT_MODE = VK_PRESENT_MODE_MAILBOX_KHR;
+
+/** @brief Swap chain images asked for until told otherwise, clamped to the surface limits. 0 is one more than the minimum */
+constexpr uint32_t DEFAULT_SWAPCHAIN_IMAGE_COUNT = 0;
+
+/** @brief Measure named GPU scopes with timestamp queries, when the graphics queue supports them */
+constexpr bool ENABLE_GPU_PROFILER = true;
+
+/** @brief Most GPU scopes measured in a frame, the ones past it are dropped */
+constexpr uint32_t GPU_PROFILER_MAX_SCOPES = 64;
+
+/** @brief Frames of GPU timings kept for the stats and the trace */
+constexpr uint32_t GPU_PROFILER_HISTORY_FRAMES = 300;
+
+/** @brief File the GPU timings are written to as a Chrome trace on exit, empty to skip it */
+constexpr const char *GPU_PROFILER_TRACE_FILE = "gpu_trace.json";
+
+/** @brief File the CPU scopes are written to as a Chrome trace, empty to not record them. --cpu-profile overrides it */
+constexpr const char *CPU_PROFILER_TRACE_FILE = "cpu_trace.json";
+
+/** @brief Show the performance overlay from the start, O toggles it */
+constexpr bool OVERLAY_VISIBLE_AT_START = false;
+
+/** @brief Frames in the frame time graphs of the overlay */
+constexpr uint32_t OVERLAY_HISTORY_FRAMES = 240;
+
+/** @brief Offscreen images a headless renderer draws into in turn, in place of the swap chain. At least MAX_FRAME_DRAWS */
+constexpr uint32_t HEADLESS_IMAGE_COUNT = MAX_FRAME_DRAWS;
+
+/** @brief Frames drawn by a headless run when --frames is not given */
+constexpr uint64_t HEADLESS_FRAME_COUNT = 1000;
+
+/** @brief Threads running the independent init steps at once. 0 picks one less than the hardware concurrency, 1 runs them in order */
+constexpr uint32_t INIT_THREADS = 0;
+
+/** @brief Quiet time after the last resize event before the swap chain is rebuilt, a window drag sends a burst of them */
+constexpr uint32_t SWAPCHAIN_RESIZE_DEBOUNCE_MS = 50;
+
+/** @brief Simulation ticks per second, on the main thread. The render thread interpolates between the last two */
+constexpr double SIMULATION_TICK_RATE = 120.0;
+
+/** @brief Ticks run back to back after a stall at most, the simulation falls behind rather than never catching up */
+constexpr uint32_t SIMULATION_MAX_CATCH_UP_TICKS = 8;
+
 /** @brief The device extensions required by this application */
 const std::vector<const char *> deviceExtensions =
 {
@@ -117,10 +247,29 @@ typedef struct swapchainImage_t
 	VkImageView imageView;
 } swapchainImage_t;
 
+/**
+ * @struct presentStats_t
+ * @brief Cadence of the presents and depth of the GPU queue behind them, for one set of present settings
+ */
+typedef struct presentStats_t
+{
+	VkPresentModeKHR presentMode     { VK_PRESENT_MODE_FIFO_KHR };
+	uint32_t         imageCount      { 0 };   // Images in the swap chain
+	uint64_t         presents        { 0 };
+	uint64_t         intervals       { 0 };   // Present to present intervals measured, the first present has none
+	double           totalIntervalMs { 0.0 };
+	double           minIntervalMs   { 0.0 };
+	double           maxIntervalMs   { 0.0 };
+	double           lastIntervalMs  { 0.0 };
+	uint64_t         totalQueueDepth { 0 };   // Frames submitted and not finished by the GPU, summed at each present
+	uint32_t         maxQueueDepth   { 0 };
+} presentStats_t;
+
 
 typedef struct function_queue_t
 {
 	std::deque< std::function<void()> > deque {};
+	std::mutex                          mutex {};   // Init steps run on several threads push at once
 
 	/** @brief Check if the queue is empty */
 	[[nodiscard]]
@@ -140,9 +289,10 @@ typedef struct function_queue_t
 
 	/** @brief Push a function to the queue */
 	void
-	push_function(std::function<void()>&& function)
+	push_function(std::function<void()> function)
 	{
-		deque.push_back(function);
+		std::lock_guard<std::mutex> lock(mutex);
+		deque.push_back(std::move(function));
 	}
 
 	/** @brief Flush the function queue */
@@ -154,6 +304,57 @@ typedef struct function_queue_t
 	}
 } function_queue_t;
 
+/**
+ * @struct deferred_queue_t
+ * @brief Functions to run once the GPU can no longer use what they destroy
+ * @details Each function is tagged with a value of an increasing counter, a timeline value or a frame number,
+ *          and runs once the counter reaches it. Tags must not decrease
+ */
+typedef struct deferred_queue_t
+{
+	std::deque< std::pair<uint64_t, std::function<void()>> > deque {};
+
+	/** @brief Check if the queue is empty */
+	[[nodiscard]]
+	FORCE_INLINE bool
+	empty() const
+	{
+		return deque.empty();
+	}
+
+	/** @brief Push a function to run once the counter reaches a value */
+	void
+	push_function(uint64_t retireValue, std::function<void()>&& function)
+	{
+		deque.emplace_back(retireValue, std::move(function));
+	}
+
+	/** @brief Run the functions whose value the counter reached */
+	void
+	collect(uint64_t reachedValue)
+	{
+		while (!deque.empty() && deque.front().first <= reachedValue)
+		{
+			// Pop first, a function may push new ones
+			auto function = std::move(deque.front().second);
+			deque.pop_front();
+			function();
+		}
+	}
+
+	/** @brief Run every function. The device must be idle */
+	void
+	flush()
+	{
+		while (!deque.empty())
+		{
+			auto function = std::move(deque.front().second);
+			deque.pop_front();
+			function();
+		}
+	}
+} deferred_queue_t;
+
 /**
  * @struct vertex_t
  * @brief Contains the position and color of a vertex
@@ -246,6 +447,76 @@ ReadFile(const std::string &filename)
 }
 
 
+/**
+ * @brief Hash bytes with 64 bit FNV-1a
+ *
+ * @param data The bytes to hash
+ * @param size The number of bytes
+ * @param seed The hash to continue from, to chain several ranges
+ * @return The hash of the bytes
+ */
+[[nodiscard]]
+inline uint64_t
+HashFNV1a(const void *data, size_t size, uint64_t seed = 0xCBF29CE484222325ull)
+{
+	const auto *bytes = static_cast<const uint8_t *>(data);
+
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+
+/**
+ * @brief Check if the instance supports an extension
+ *
+ * @param extensionName The name of the extension
+ * @return True if the extension can be enabled on the instance
+ */
+[[nodiscard]]
+static bool
+IsInstanceExtensionAvailable(const char *extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+	return std::ranges::any_of(extensions, [extensionName](const VkExtensionProperties &extension)
+	{
+		return strcmp(extension.extensionName, extensionName) == 0;
+	});
+}
+
+/**
+ * @brief Check if a physical device supports an extension
+ *
+ * @param physicalDevice The physical device to check
+ * @param extensionName The name of the extension
+ * @return True if the extension can be enabled on the device
+ */
+[[nodiscard]]
+static bool
+IsDeviceExtensionAvailable(VkPhysicalDevice physicalDevice, const char *extensionName)
+{
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+	return std::ranges::any_of(extensions, [extensionName](const VkExtensionProperties &extension)
+	{
+		return strcmp(extension.extensionName, extensionName) == 0;
+	});
+}
+
+
 /**
  * @brief Find the memory type index
  *
@@ -434,21 +705,22 @@ CopyImageBuffer(VkDevice device, VkQueue transferQueue, VkCommandPool transferCo
 }
 
 /**
- * @brief Use memory barrier to transition image layout.
- * @details Transition image layout from one layout to another using memory barrier.
+ * @brief Build the memory barrier of an image layout transition
  *
- * @param device The logical device to use
- * @param queue The queue to use for the transition
- * @param commandPool The command pool to use for the transition
  * @param image The image to transition
  * @param oldLayout The old layout of the image
  * @param newLayout The new layout of the image
+ * @param srcStage The pipeline stage the barrier waits on
+ * @param dstStage The pipeline stage that waits on the barrier
+ * @param baseMipLevel The first mip level to transition
+ * @param levelCount The number of mip levels to transition
+ * @return The image memory barrier
  */
-static void
-TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool,
-                      VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
+static VkImageMemoryBarrier
+GetImageLayoutBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+                      VkPipelineStageFlags *srcStage, VkPipelineStageFlags *dstStage,
+                      uint32_t baseMipLevel = 0, uint32_t levelCount = 1)
 {
-  CommandBuffer commandBuffer(device, commandPool, queue);
   /*
     * Barrier is used to synchronize access to resources, like images
     * It can be used to transfer queue family ownership, change image layout, transfer queue family ownership
@@ -468,24 +740,21 @@ TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool,
       .subresourceRange    =
       {
         .aspectMask        = VK_IMAGE_ASPECT_COLOR_BIT, // Aspect of image being altered 
-        .baseMipLevel      = 0,                         // First mip level to start the alteration
-        .levelCount        = 1,                         // Number of mip levels to alter starting from base mip level
+        .baseMipLevel      = baseMipLevel,              // First mip level to start the alteration
+        .levelCount        = levelCount,                // Number of mip levels to alter starting from base mip level
         .baseArrayLayer    = 0,                         // First layer to start alterations on
         .layerCount        = 1,                         // Number of layers to alter starting from baseArrayLayer
       },
   };
 
-  VkPipelineStageFlags srcStage;
-  VkPipelineStageFlags dstStage;
-
   // Transition the image layout
   if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
   {
     imageMemoryBarrier.srcAccessMask = 0;                            // Memory access stage transition must happen after this stage. 0 means "at start"
     imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; // Memory access stage transition must happen before this stage
 
-    srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;                    // Top of pipeline is special stage where commands are initially processed
-    dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;                       // Transfer stage is where transfer commands are processed
+    *srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;                   // Top of pipeline is special stage where commands are initially processed
+    *dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;                      // Transfer stage is where transfer commands are processed
   }
   // Transfer from transfer destination to shader read
   else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
@@ -493,14 +762,38 @@ TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool,
     imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; // Memory access stage transition must happen after this stage
     imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;    // Memory access stage transition must happen before this stage
 
-    srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;                       // Transfer stage is where transfer commands are processed
-    dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;                // Fragment stage is where fragment shaders are processed
+    *srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;                      // Transfer stage is where transfer commands are processed
+    *dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;               // Fragment stage is where fragment shaders are processed
   }
   else
   {
     throw std::invalid_argument("Unsupported layout transition!");
   }
 
+  return imageMemoryBarrier;
+}
+
+/**
+ * @brief Use memory barrier to transition image layout.
+ * @details Transition image layout from one layout to another using memory barrier.
+ *
+ * @param device The logical device to use
+ * @param queue The queue to use for the transition
+ * @param commandPool The command pool to use for the transition
+ * @param image The image to transition
+ * @param oldLayout The old layout of the image
+ * @param newLayout The new layout of the image
+ */
+static void
+TransitionImageLayout(VkDevice device, VkQueue queue, VkCommandPool commandPool,
+                      VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout)
+{
+  CommandBuffer commandBuffer(device, commandPool, queue);
+
+  VkPipelineStageFlags srcStage;
+  VkPipelineStageFlags dstStage;
+  VkImageMemoryBarrier imageMemoryBarrier = GetImageLayoutBarrier(image, oldLayout, newLayout, &srcStage, &dstStage);
+
   vkCmdPipelineBarrier(commandBuffer,
                         srcStage, dstStage,          // Pipeline stages (match to src and dst access masks)
                         0,                           // Dependency flags
@@ -4,8 +4,14 @@
 #include <cstdint>
 #include <cstring>
 #include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <vulkan/vulkan_core.h>
 
+#include "CpuProfiler.h"
+#include "Shaders.h"
+#include "TaskGraph.hpp"
 #include "VulkanValidation.h"
 
 VulkanRenderer::~VulkanRenderer()
@@ -20,118 +26,199 @@ VulkanRenderer::Init(GLFWwindow *newWindow)
 {
 	m_window = newWindow;
 
-	try
-	{
-		// Instance Creation
-		CreateInstance();
-		CreateDebugMessenger();
-		CreateSurface();
-
-		// Device Setup
-		GetPhysicalDevice();
-		CreateLogicalDevice();
-
-		// Swap Chain Creation
-		CreateSwapChain();
-		CreateDepthBufferImage();
-		CreateRenderPass();
-		CreateDescriptorSetLayout();
-		CreatePushConstantRange();
-		CreateGraphicsPipeline();
-		CreateFramebuffers();
-
-		// Command Pool and Buffer Setup
-		CreateCommandPool();
-		CreateCommandBuffers();
-
-    // Descriptors
-    CreateTextureSampler();
-		//AllocateDynamicBufferTransferSpace(); // Create transfer space for dynamic uniform data. Unneeded for Push Constants
-		CreateUniformBuffers();
-		CreateDescriptorPool();
-		CreateDescriptorSets();
-
-		// Semaphores and Fences
-		CreateSemaphores();
-
-		// Set up the UBOs
-		CreateViewProjUBO();
-
-    {
-      // Mesh Model Loading
-			std::vector<vertex_t> meshVertices =
-			{
-        //   X  ,  Y  , Z   |    R   , G    , B     |    U   , V
-				{ { -0.4,  0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 1.0f, 1.0f } },
-        { { -0.4, -0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 1.0f, 0.0f } },
-        { {  0.4, -0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 0.0f, 0.0f } },
-        { {  0.4,  0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 0.0f, 1.0f } },
-			};
+	// Later sizes come from the resize callback, GLFW cannot be asked from the render thread
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_window, &width, &height);
+	m_framebufferSize.store(static_cast<uint64_t>(width) << 32 | static_cast<uint32_t>(height), std::memory_order_relaxed);
 
-			std::vector<vertex_t> meshVertices2 =
-			{
-				{ { -0.60,  0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 1.0f, 1.0f } },
-        { { -0.60, -0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 1.0f, 0.0f } },
-        { {  0.60, -0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 0.0f, 0.0f } },
-        { {  0.60,  0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 0.0f, 1.0f } },
+	return InitRenderer();
+}
 
-			};
+int
+VulkanRenderer::InitHeadless(uint32_t width, uint32_t height, uint32_t imageCount)
+{
+	m_bHeadless          = true;
+	m_headlessImageCount = std::max<uint32_t>(imageCount, MAX_FRAME_DRAWS);
 
-			// Index Data
-			std::vector<uint32_t> meshIndices =
-			{
-				0, 1, 2,
-				2, 3, 0
-			};
+	// Never resized, there is no window to send the events
+	m_framebufferSize.store(static_cast<uint64_t>(width) << 32 | height, std::memory_order_relaxed);
 
-      const int texID = CreateTexture("zschzen.jpg");
-			Mesh firstMesh = Mesh(m_mainDevice, m_graphicsQueue, m_graphicsCommandPool, &meshVertices, &meshIndices, texID);
-			Mesh secondMesh = Mesh(m_mainDevice, m_graphicsQueue, m_graphicsCommandPool, &meshVertices2, &meshIndices, texID);
+	return InitRenderer();
+}
 
-			// Add to a mesh list
-			m_meshList.push_back(firstMesh);
-			m_meshList.push_back(secondMesh);
+int
+VulkanRenderer::InitRenderer()
+{
+	m_initStart = std::chrono::steady_clock::now();
+
+	// Frames in flight asked for before the renderer existed
+	m_framesInFlight = std::clamp<uint32_t>(m_requestedFramesInFlight.load(std::memory_order_relaxed), 1, MAX_FRAME_DRAWS);
+	m_bFramesInFlightChanged.store(false, std::memory_order_relaxed);
+
+	// Each step runs once the ones it reads from are done, the independent ones at the same time.
+	// A step pushes its destruction after the ones it depends on, the deletion queue still destroys dependents first
+	TaskGraph graph;
+
+	// Instance Creation
+	const auto instance  = graph.Add("Instance", [this]() { CreateInstance(); });
+	const auto debug     = graph.Add("Debug messenger", [this]() { CreateDebugMessenger(); }, { instance });
+	const auto surface   = graph.Add("Surface", [this]() { if (!m_bHeadless) CreateSurface(); }, { instance });
+
+	// Device Setup
+	const auto physical  = graph.Add("Physical device", [this]() { GetPhysicalDevice(); }, { debug, surface });
+	const auto device    = graph.Add("Logical device", [this]() { CreateLogicalDevice(); }, { physical });
+
+	// Swap Chain Creation, or the images standing in for it
+	const auto swapChain = graph.Add("Swap chain", [this]() { if (m_bHeadless) CreateOffscreenImages(); else CreateSwapChain(); },
+	                                 { device });
+	const auto depth     = graph.Add("Depth buffer", [this]() { CreateDepthBufferImage(); }, { swapChain });
+	const auto pass      = graph.Add("Render pass", [this]() { CreateRenderPass(); }, { swapChain, depth });
+	graph.Add("Framebuffers", [this]() { CreateFramebuffers(); }, { pass });
+	graph.Add("View projection", [this]() { CreateViewProjUBO(); }, { swapChain });
+
+	// Pipelines: the shader modules and the default pipeline are the longest step on a cold cache
+	const auto layouts   = graph.Add("Descriptor set layouts", [this]() { CreateDescriptorSetLayout(); }, { device });
+	const auto constants = graph.Add("Push constant range", [this]() { CreatePushConstantRange(); }, { device });
+	const auto cache     = graph.Add("Pipeline cache", [this]() { CreatePipelineCache(); }, { device });
+	graph.Add("Graphics pipeline", [this]() { CreateGraphicsPipeline(); }, { pass, layouts, constants, cache });
+	graph.Add("Shader watcher", [this]() { CreateShaderWatcher(); }, { device });
+
+	// The only step submitting to the queue, for the font upload
+	graph.Add("Overlay", [this]() { CreateOverlay(); }, { pass, cache });
+
+	// Command Pool and Buffer Setup
+	const auto pool      = graph.Add("Command pool", [this]() { CreateCommandPool(); }, { device });
+	graph.Add("Command buffers", [this]() { CreateCommandBuffers(); }, { pool });
+	graph.Add("Texture loader", [this]() { CreateTextureLoader(); }, { swapChain, pool });
+
+	// Descriptors
+	graph.Add("Texture sampler", [this]() { CreateTextureSampler(); }, { device });
+	//AllocateDynamicBufferTransferSpace(); // Create transfer space for dynamic uniform data. Unneeded for Push Constants
+	const auto uniforms  = graph.Add("Uniform buffers", [this]() { CreateUniformBuffers(); }, { device });
+	const auto pools     = graph.Add("Descriptor pools", [this]() { CreateDescriptorPool(); }, { layouts });
+	graph.Add("Descriptor sets", [this]() { CreateDescriptorSets(); }, { pools, uniforms });
+
+	// Semaphores and Fences
+	graph.Add("Semaphores", [this]() { CreateSemaphores(); }, { device });
 
-			// Add meshes to the deletion queue
-			m_mainDeletionQueue.push_function([&]() -> void
+	try
+	{
+		{
+			PROFILE_SCOPE("Init graph");
+			if (INIT_THREADS == 1) graph.Run(nullptr);
+			else
 			{
-				for (auto &m : m_meshList) m.DestroyVertexBuffer();
-				m_meshList.clear();
-			});
+				ThreadPool initWorkers(INIT_THREADS);
+				graph.Run(&initWorkers);
+			}
 		}
+
+		// Meshes are added by the application once initialised, all of them are destroyed here
+		m_mainDeletionQueue.push_function([&]() -> void
+		{
+			for (auto &m : m_meshList) m.DestroyVertexBuffer();
+			m_meshList.clear();
+		});
 	}
 	catch (const std::runtime_error &e)
 	{
+		graph.PrintStats("Init");
 		fprintf(stderr, "[ERROR] %s\n", e.what());
 		return EXIT_FAILURE;
 	}
 
+	graph.PrintStats("Init");
+	m_initMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_initStart).count();
+
 	return EXIT_SUCCESS;
 }
 
+void
+VulkanRenderer::PrintTimeToFirstFrame(double finishedMs)
+{
+	m_bFirstFrameReported = true;
+
+	// The scene is what the application did between Init and its first Draw
+	fprintf(stdout, "[INFO] Time to first frame: init %.2f ms, submitted at %.2f ms", m_initMs, m_firstSubmitMs);
+	if (finishedMs >= 0.0) fprintf(stdout, ", done on the GPU by %.2f ms\n", finishedMs);
+	else fprintf(stdout, "\n");
+}
+
 void
 VulkanRenderer::Draw()
 {
+	PROFILE_SCOPE("Draw");
+	const auto frameStart = std::chrono::steady_clock::now();
+
+	// Nothing to draw into while minimised, the textures still upload
+	int width = 0, height = 0;
+	GetFramebufferSize(&width, &height);
+	if (width == 0 || height == 0)
+	{
+		ProcessTextureUploads();
+		return;
+	}
+
+	// Safe point: nothing of this frame is recorded yet
+	if (m_bFramesInFlightChanged.load(std::memory_order_acquire)) ApplyFramesInFlight();
+
+	// Wait for the last draw of this frame in flight to finish before recording it again
+	{
+		PROFILE_SCOPE("Wait for frame");
+		m_graphicsTimeline.Wait(m_frameTimelineValues[m_currentFrame]);
+	}
+
+	// Its timestamps are written too, read them back and start measuring this frame
+	m_gpuProfiler.BeginFrame(m_currentFrame, m_frameNumber);
+
+	/* ----------------------------------------- TEXTURE UPLOADS ----------------------------------------- */
+
+	// Submit the textures decoded since the last frame and flag the finished ones as ready
+	ProcessTextureUploads();
+
 	/* ----------------------------------------- GET NEXT IMAGE ----------------------------------------- */
 
-	// Wait for given fence to signal (open) from the last draw before continuing
-	VK_CHECK(vkWaitForFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currentFrame], VK_TRUE, UINT64_MAX),
-			 "Failed to wait for a fence to signal that it is available for re-use");
-	// Manually reset (close) fences
-	VK_CHECK(vkResetFences(m_mainDevice.logicalDevice, 1, &m_drawFences[m_currentFrame]),
-			 "Failed to reset fences!");
+	// Destroy what the finished work was the last to use, without blocking on the rest
+	m_frameDeletionQueue.collect(m_graphicsTimeline.GetCompletedValue());
+
+	// Seen done at the latest one frame after it was, the reads never wait
+	if (m_frameNumber > 0 && !m_bFirstFrameReported && m_graphicsTimeline.IsComplete(m_firstFrameTimelineValue))
+	{
+		PrintTimeToFirstFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_initStart).count());
+	}
+	m_presentDeletionQueue.collect(m_frameNumber);
+
+	// Bring back the textures drawn at low resolution last frame, evict the unused ones over budget
+	UpdateTextureResidency();
+
+	// Swap in the pipelines rebuilt from edited shaders, before this frame records
+	ReloadShaders();
+
 
+	/* ----------------------------------------- ACQUIRE IMAGE ----------------------------------------- */
 
-	/* ----------------------------------------- FRAME BUFFER CREATION ----------------------------------------- */
-	uint32_t imageIndex;
-	// Get index of next image to be drawn to
-	vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, UINT64_MAX,
-						  m_imageAvailableSemaphore[m_currentFrame], VK_NULL_HANDLE, &imageIndex);
+	uint32_t imageIndex = 0;
+	if (m_bHeadless)
+	{
+		// Nothing hands the images back, take them in turn. The frame that last drew into this one has finished
+		imageIndex = static_cast<uint32_t>(m_frameNumber % m_swapChainImages.size());
+	}
+	else if (!AcquireNextImage(&imageIndex))
+	{
+		return;
+	}
 
 	/* ----------------------------------------- UPDATE UNIFORM BUFFER ----------------------------------------- */
 
-	RecordCommands(m_commandBuffers[imageIndex], imageIndex);
-	UpdateUniformBuffers(imageIndex);
+	// Laid out before the recording, drawn last in the render pass. Hidden it costs this check
+	if (m_overlay.IsVisible())
+	{
+		PROFILE_SCOPE("Build overlay");
+		m_overlay.Build(GetFrameStats(), m_swapChainExtent);
+	}
+
+	RecordCommands(m_commandBuffers[m_currentFrame], imageIndex);
+	UpdateUniformBuffers(m_currentFrame);
 
 	/* ----------------------------------------- SUBMIT COMMAND BUFFER TO RENDER -------------------------------- */
 
@@ -142,47 +229,140 @@ VulkanRenderer::Draw()
 	{
 		.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
 
-		.waitSemaphoreCount   = 1,                                          // Number of semaphores to wait on
+		.waitSemaphoreCount   = m_bHeadless ? 0u : 1u,                      // Number of semaphores to wait on, no acquire headless
 		.pWaitSemaphores      = &m_imageAvailableSemaphore[m_currentFrame], // Semaphores to wait on
 		.pWaitDstStageMask    = waitStages,                                 // Semaphores to wait on
 
 		.commandBufferCount   = 1,
-		.pCommandBuffers      = &m_commandBuffers[imageIndex],              // Command buffer to submit
+		.pCommandBuffers      = &m_commandBuffers[m_currentFrame],          // Command buffer to submit
 
-		.signalSemaphoreCount = 1,                                          // Number of semaphores to signal
+		.signalSemaphoreCount = m_bHeadless ? 0u : 1u,                      // Number of semaphores to signal, no present headless
 		.pSignalSemaphores    = &m_renderFinishedSemaphore[m_currentFrame]  // Semaphores to signal
 	};
 
-	// Submit command buffer to queue
-	VK_CHECK(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_drawFences[m_currentFrame]),
-			 "Failed to submit command buffer to queue");
+	// Submit command buffer to queue, the frame is done once the timeline reaches the returned value
+	m_frameTimelineValues[m_currentFrame] = m_graphicsTimeline.Submit(m_graphicsQueue, submitInfo);
+	m_gpuProfiler.EndFrame();
+
+	if (m_frameNumber == 0)
+	{
+		m_firstSubmitMs           = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_initStart).count();
+		m_firstFrameTimelineValue = m_frameTimelineValues[m_currentFrame];
+	}
 
 	/* ----------------------------------------- PRESENT RENDERED IMAGE TO SCREEN -------------------------------- */
 
-	// Present info
-	VkPresentInfoKHR presentInfo =
+	// Headless, the image stays in the transfer source layout for SaveFrame
+	if (!m_bHeadless) PresentImage(imageIndex);
+
+	// GPU time of the last frame read back, a few frames old
+	const std::deque<gpuFrameTiming_t> &gpuHistory = m_gpuProfiler.GetHistory();
+	m_overlay.AddFrameTimes(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count(),
+	                        gpuHistory.empty() ? 0.0f : static_cast<float>(gpuHistory.back().gpuMs),
+	                        static_cast<float>(m_presentStats.lastIntervalMs));
+
+	// Increment current frame (limited by the frames in flight)
+	m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+	++m_frameNumber;
+
+	// Keep what was compiled so far if the application does not exit cleanly, off the render thread
+	if (m_frameNumber % PIPELINE_CACHE_SAVE_INTERVAL == 0) m_pipelineCache.SaveAsync();
+}
+
+bool
+VulkanRenderer::SaveFrame(const std::string &fileName)
+{
+	if (!m_bHeadless || m_frameNumber == 0) return false;
+
+	const swapchainImage_t &image  = m_swapChainImages[(m_frameNumber - 1) % m_swapChainImages.size()];
+	const uint32_t          width  = m_swapChainExtent.width;
+	const uint32_t          height = m_swapChainExtent.height;
+
+	VkBuffer       readbackBuffer;
+	VkDeviceMemory readbackMemory;
+	CreateBuffer(m_mainDevice, static_cast<VkDeviceSize>(width) * height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &readbackBuffer, &readbackMemory);
+
 	{
-		.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		// Submitted after the frame on the same queue, waited on when it goes out of scope
+		CommandBuffer commandBuffer(m_mainDevice.logicalDevice, m_graphicsCommandPool, m_graphicsQueue);
 
-		.waitSemaphoreCount = 1,                                          // Number of semaphores to wait on
-		.pWaitSemaphores    = &m_renderFinishedSemaphore[m_currentFrame], // Semaphores to wait on
+		// The render pass left the image in the transfer source layout, only its writes must be made visible
+		VkImageMemoryBarrier imageBarrier =
+		{
+			.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.srcAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+			.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image               = image.image,
+			.subresourceRange    = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .baseMipLevel = 0, .levelCount = 1, .baseArrayLayer = 0, .layerCount = 1 }
+		};
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							 0, nullptr, 0, nullptr, 1, &imageBarrier);
 
-		.swapchainCount     = 1,                                          // Number of swapchains to present to
-		.pSwapchains        = &m_swapchain,                               // Swapchains to present images to
+		VkBufferImageCopy region =
+		{
+			.imageSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = 0, .baseArrayLayer = 0, .layerCount = 1 },
+			.imageExtent      = { width, height, 1 }
+		};
+		vkCmdCopyImageToBuffer(commandBuffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
 
-		.pImageIndices      = &imageIndex                                 // Index of images in swapchains to present
-	};
+		// Read by the host once the queue is idle
+		VkMemoryBarrier hostBarrier =
+		{
+			.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+			.dstAccessMask = VK_ACCESS_HOST_READ_BIT
+		};
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+							 1, &hostBarrier, 0, nullptr, 0, nullptr);
+	}
 
-	// Present image
-	VkResult presentResult = vkQueuePresentKHR(m_presentationQueue, &presentInfo);
-	if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR || m_framebufferResized)
+	void *data;
+	VK_CHECK(vkMapMemory(m_mainDevice.logicalDevice, readbackMemory, 0, VK_WHOLE_SIZE, 0, &data), "Failed to map the readback buffer!");
+
+	// PPM is RGB, drop the alpha and put BGRA images back in order
+	const bool bBGRA = m_swapChainImageFormat == VK_FORMAT_B8G8R8A8_SRGB || m_swapChainImageFormat == VK_FORMAT_B8G8R8A8_UNORM;
+	bool bWritten = false;
 	{
-		m_framebufferResized = false;
-		RecreateSwapChain();
+		std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+		if (file.is_open())
+		{
+			file << "P6\n" << width << ' ' << height << "\n255\n";
+
+			const auto *pixels = static_cast<const uint8_t *>(data);
+			std::vector<char> row(static_cast<size_t>(width) * 3);
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					const uint8_t *pixel = pixels + (static_cast<size_t>(y) * width + x) * 4;
+					row[x * 3 + 0] = static_cast<char>(pixel[bBGRA ? 2 : 0]);
+					row[x * 3 + 1] = static_cast<char>(pixel[1]);
+					row[x * 3 + 2] = static_cast<char>(pixel[bBGRA ? 0 : 2]);
+				}
+				file.write(row.data(), static_cast<std::streamsize>(row.size()));
+			}
+			bWritten = file.good();
+		}
+	}
+
+	vkUnmapMemory(m_mainDevice.logicalDevice, readbackMemory);
+	vkDestroyBuffer(m_mainDevice.logicalDevice, readbackBuffer, nullptr);
+	vkFreeMemory(m_mainDevice.logicalDevice, readbackMemory, nullptr);
+
+	if (!bWritten)
+	{
+		fprintf(stderr, "[ERROR] Failed to write frame %llu to %s\n", static_cast<unsigned long long>(m_frameNumber - 1), fileName.c_str());
+		return false;
 	}
 
-	// Increment current frame (limited by MAX_FRAME_DRAWS)
-	m_currentFrame = (m_currentFrame + 1) % MAX_FRAME_DRAWS;
+	fprintf(stdout, "[INFO] Frame %llu written to %s, %ux%u\n", static_cast<unsigned long long>(m_frameNumber - 1), fileName.c_str(),
+			width, height);
+	return true;
 }
 
 // TODO: Get rid off deletion queues and use arrays of vulkan handles
@@ -191,9 +371,56 @@ VulkanRenderer::Cleanup()
 {
 	if (m_mainDeletionQueue.empty()) return;
 
+	// Let the workers and the upload batches in flight finish
+	WaitForTextures();
+
 	// Wait for a logical device to finish before cleanup
 	vkDeviceWaitIdle(m_mainDevice.logicalDevice);
 
+	// Nothing is in flight anymore, run the pending destructions
+	m_frameDeletionQueue.flush();
+	m_presentDeletionQueue.flush();
+
+	// Batches left only hold mip levels streamed in after the textures were ready
+	for (const auto &batch : m_textureUploadBatches)
+	{
+		for (const auto &texture : batch.textures)
+		{
+			if (texture.dedicatedMemory == VK_NULL_HANDLE) continue;
+
+			vkDestroyBuffer(m_mainDevice.logicalDevice, texture.staging.buffer, nullptr);
+			vkFreeMemory(m_mainDevice.logicalDevice, texture.dedicatedMemory, nullptr);
+		}
+
+		vkFreeCommandBuffers(m_mainDevice.logicalDevice, m_graphicsCommandPool, 1, &batch.commandBuffer);
+	}
+	m_textureUploadBatches.clear();
+
+	if (!m_bHeadless) PrintPresentStats();
+
+	// Stopped before the first frame was seen done
+	if (m_frameNumber > 0 && !m_bFirstFrameReported) PrintTimeToFirstFrame(-1.0);
+
+	m_gpuProfiler.PrintStats();
+	if (*GPU_PROFILER_TRACE_FILE != '\0') m_gpuProfiler.ExportChromeTrace(GPU_PROFILER_TRACE_FILE);
+
+	const textureCacheStats_t cacheStats = GetTextureCacheStats();
+	fprintf(stdout, "[INFO] Texture cache: %u hits (%u by content), %u misses, %.2f MiB and %.1f ms saved\n",
+			cacheStats.hits, cacheStats.contentHits, cacheStats.misses,
+			static_cast<double>(cacheStats.bytesSaved) / ( 1024.0 * 1024.0 ), cacheStats.msSaved);
+
+	const textureFormatStats_t formatStats = GetTextureFormatStats();
+	fprintf(stdout, "[INFO] Texture formats: %u R8, %u R8G8, %u RGBA8 (%u sRGB), %.2f MiB instead of %.2f MiB as RGBA8\n",
+			formatStats.r8Textures, formatStats.r8g8Textures, formatStats.rgba8Textures, formatStats.srgbTextures,
+			static_cast<double>(formatStats.bytes) / ( 1024.0 * 1024.0 ),
+			static_cast<double>(formatStats.rgba8Bytes) / ( 1024.0 * 1024.0 ));
+
+	const textureResidencyStats_t residencyStats = GetTextureResidencyStats();
+	fprintf(stdout, "[INFO] Texture residency: %.2f / %.2f MiB, %u evictions, %u stream-ins (avg %.1f ms, max %.1f ms)\n",
+			static_cast<double>(residencyStats.residentBytes) / ( 1024.0 * 1024.0 ),
+			static_cast<double>(residencyStats.budgetBytes) / ( 1024.0 * 1024.0 ),
+			residencyStats.evictions, residencyStats.streamIns, residencyStats.averageStreamInMs, residencyStats.maxStreamInMs);
+
   // Destroy Textures
   for (size_t i = 0; i < m_textureImages.size(); ++i)
   {
@@ -204,10 +431,15 @@ VulkanRenderer::Cleanup()
     vkDestroyImageView(m_mainDevice.logicalDevice, imageView, nullptr);
     vkDestroyImage(m_mainDevice.logicalDevice, image, nullptr);
     vkFreeMemory(m_mainDevice.logicalDevice, memory, nullptr);
+
+    const textureResidency_t &residency = m_textureResidency[i];
+    vkDestroyImageView(m_mainDevice.logicalDevice, residency.fallbackView, nullptr);
+    vkDestroyImage(m_mainDevice.logicalDevice, residency.fallbackImage, nullptr);
+    vkFreeMemory(m_mainDevice.logicalDevice, residency.fallbackMemory, nullptr);
   }
 
   // Clear buffers
-	CleanupFramebuffers();
+	CleanupFrameResources();
 	CleanupDepthBuffer();
 
 	// Clean up swap chain
@@ -230,6 +462,13 @@ VulkanRenderer::CreateInstance()
 		}
 	}
 
+	// Ask for 1.2 when the loader has it, timeline semaphores are core there. A 1.0 loader has no vkEnumerateInstanceVersion
+	auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+	if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&loaderVersion) != VK_SUCCESS) loaderVersion = VK_API_VERSION_1_0;
+
+	m_apiVersion = loaderVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+
 	// Information about the application.
 	// Debugging purposes. Used for developer convenience.
 	VkApplicationInfo appInfo =
@@ -240,7 +479,7 @@ VulkanRenderer::CreateInstance()
 		.applicationVersion = VK_MAKE_API_VERSION(1, 0, 0, 0),
 		.pEngineName        = "No Engine",
 		.engineVersion      = VK_MAKE_API_VERSION(1, 0, 0, 0),
-		.apiVersion         = VK_API_VERSION_1_0
+		.apiVersion         = m_apiVersion
 	};
 
 	// Instance extensions
@@ -319,13 +558,96 @@ VulkanRenderer::CreateLogicalDevice()
 		.samplerAnisotropy = VK_TRUE
 	};
 
+	// The required extensions are the swap chain ones, headless needs none
+	std::vector<const char *> enabledExtensions = m_bHeadless ? std::vector<const char *> { } : deviceExtensions;
+
+	// Bindless textures: a partially bound, update after bind array of textures
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures =
+	{
+		.sType                                        = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,  // Write slots while the array is bound
+		.descriptorBindingPartiallyBound              = VK_TRUE,  // Leave the slots of unloaded textures empty
+		.runtimeDescriptorArray                       = VK_TRUE   // Unsized array in the shader
+	};
+
+	m_bBindlessTextures = ENABLE_BINDLESS_TEXTURES && CheckBindlessSupport(m_mainDevice.physicalDevice, &m_bindlessCapacity);
+	if (m_bBindlessTextures)
+	{
+		enabledExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);        // Required by descriptor indexing
+		enabledExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE; // Index the array with a push constant
+
+		fprintf(stdout, "[INFO] Bindless textures enabled, %u slots\n", m_bindlessCapacity);
+	}
+
+	// Optional, lets the texture budget follow what the driver says is available
+	m_bMemoryBudget = m_bPhysicalDeviceProperties2 &&
+	                  IsDeviceExtensionAvailable(m_mainDevice.physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	if (m_bMemoryBudget)
+	{
+		m_vkGetPhysicalDeviceMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+				vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+		m_bMemoryBudget = m_vkGetPhysicalDeviceMemoryProperties2 != nullptr;
+	}
+	if (m_bMemoryBudget) enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	// Optional, lets the frame pacer wait for the presents to reach the display
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures =
+	{
+		.sType     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+		.presentId = VK_TRUE
+	};
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures =
+	{
+		.sType       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.pNext       = &presentIdFeatures,
+		.presentWait = VK_TRUE
+	};
+
+	m_bPresentWait = !m_bHeadless && ENABLE_PRESENT_WAIT && CheckPresentWaitSupport(m_mainDevice.physicalDevice);
+	if (m_bPresentWait)
+	{
+		enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	}
+
+	// Optional, one counter per queue instead of a fence per frame and per upload
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures =
+	{
+		.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR,
+		.timelineSemaphore = VK_TRUE
+	};
+
+	bool bTimelineExtension = false;
+	m_bTimelineSemaphores = ENABLE_TIMELINE_SEMAPHORES && CheckTimelineSemaphoreSupport(m_mainDevice.physicalDevice, &bTimelineExtension);
+	if (m_bTimelineSemaphores && bTimelineExtension) enabledExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+	// Chain the feature structures of the optional extensions
+	void *featureChain = nullptr;
+	if (m_bBindlessTextures)
+	{
+		indexingFeatures.pNext = featureChain;
+		featureChain           = &indexingFeatures;
+	}
+	if (m_bPresentWait)
+	{
+		presentIdFeatures.pNext = featureChain;
+		featureChain            = &presentWaitFeatures;
+	}
+	if (m_bTimelineSemaphores)
+	{
+		timelineFeatures.pNext = featureChain;
+		featureChain           = &timelineFeatures;
+	}
+
 	VkDeviceCreateInfo deviceCreateInfo =
 	{
 		.sType                    = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext                    = featureChain,
 		.queueCreateInfoCount     = static_cast<uint32_t>(queueCreateInfos.size()),
 		.pQueueCreateInfos        = queueCreateInfos.data(),
-		.enabledExtensionCount    = static_cast<uint32_t>(deviceExtensions.size()),
-		.ppEnabledExtensionNames  = deviceExtensions.data(),
+		.enabledExtensionCount    = static_cast<uint32_t>(enabledExtensions.size()),
+		.ppEnabledExtensionNames  = enabledExtensions.data(),
 		.pEnabledFeatures         = &physicalDeviceFeatures
 	};
 
@@ -336,9 +658,27 @@ VulkanRenderer::CreateLogicalDevice()
 	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.graphicsFamily, 0, &m_graphicsQueue);
 	vkGetDeviceQueue(m_mainDevice.logicalDevice, indices.presentationFamily, 0, &m_presentationQueue);
 
+	if (m_bPresentWait)
+	{
+		m_vkWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(m_mainDevice.logicalDevice, "vkWaitForPresentKHR"));
+		m_bPresentWait     = m_vkWaitForPresent != nullptr;
+	}
+	fprintf(stdout, "[INFO] Present wait %s\n", m_bPresentWait ? "enabled" : "not available, frames are paced on the clock only");
+
+	// Frames and texture uploads signal one counter on the graphics queue
+	m_graphicsTimeline.Create(m_mainDevice.logicalDevice, m_bTimelineSemaphores);
+	m_bTimelineSemaphores = m_graphicsTimeline.IsTimelineSemaphore();
+	fprintf(stdout, "[INFO] Vulkan %u.%u instance, GPU progress tracked with %s\n", VK_API_VERSION_MAJOR(m_apiVersion),
+			VK_API_VERSION_MINOR(m_apiVersion), m_bTimelineSemaphores ? "a timeline semaphore" : "a fence per submit");
+
+	// Timestamps are written by the frames and the texture uploads, both on the graphics queue
+	m_gpuProfiler.Create(m_mainDevice, static_cast<uint32_t>(indices.graphicsFamily));
+
 	// Add logical device to deletion queue
 	m_mainDeletionQueue.push_function([&]() -> void
 	{
+		m_gpuProfiler.Destroy();
+		m_graphicsTimeline.Destroy();
 		vkDestroyDevice(m_mainDevice.logicalDevice, nullptr);
 		m_mainDevice.logicalDevice = VK_NULL_HANDLE;
 	});
@@ -380,8 +720,11 @@ VulkanRenderer::CreateSurface()
 }
 
 void
-VulkanRenderer::CreateSwapChain()
+VulkanRenderer::CreateSwapChain(VkSwapchainKHR oldSwapchain)
 {
+	// Requests made from now on go to the next swap chain
+	m_bSwapchainSettingsChanged.store(false, std::memory_order_relaxed);
+
 	// Best swap chain settings
 	swapChainDetails_t swapChainDetails = GetSwapChainDetails(m_mainDevice.physicalDevice);
 
@@ -390,8 +733,10 @@ VulkanRenderer::CreateSwapChain()
 	VkPresentModeKHR presentationMode   = ChooseBestPresentationMode(swapChainDetails.presentationModes);
 	VkExtent2D extent                   = ChooseSwapExtent(swapChainDetails.surfaceCapabilities);
 
-	// Swap chain image count (+1 to have a triple buffered system)
-	uint32_t imageCount = swapChainDetails.surfaceCapabilities.minImageCount + 1;
+	// Swap chain image count, by default +1 to have a triple buffered system
+	const uint32_t requestedImageCount = m_requestedImageCount.load(std::memory_order_relaxed);
+	uint32_t imageCount = requestedImageCount == 0 ? swapChainDetails.surfaceCapabilities.minImageCount + 1
+	                    : std::max(requestedImageCount, swapChainDetails.surfaceCapabilities.minImageCount);
 
 	// If imageCount higher than the max, then clamp it
 	// If 0, then limitless
@@ -416,7 +761,7 @@ VulkanRenderer::CreateSwapChain()
 		.compositeAlpha   = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,                      // How to handle blending images with external graphics
 		.presentMode      = presentationMode,                                       // How images should be presented to the screen
 		.clipped          = VK_TRUE,                                                // Whether to clip parts of images not in view (e.g. behind another window, off screen, etc)
-		.oldSwapchain     = VK_NULL_HANDLE                                          // Swapchain to replace, used for resizing the window
+		.oldSwapchain     = oldSwapchain                                            // Swapchain to replace, used for resizing the window
 	};
 
 	// Get the queue family indices
@@ -449,6 +794,7 @@ VulkanRenderer::CreateSwapChain()
 	// Store for later reference
 	m_swapChainImageFormat = surfaceFormat.format;
 	m_swapChainExtent = extent;
+	++m_swapchainCount;
 
 	// Get swap chain images count
 	uint32_t swapChainImageCount;
@@ -458,6 +804,19 @@ VulkanRenderer::CreateSwapChain()
 	std::vector<VkImage> images(swapChainImageCount);
 	vkGetSwapchainImagesKHR(m_mainDevice.logicalDevice, m_swapchain, &swapChainImageCount, images.data());
 
+	// The statistics are per present settings, close the previous ones
+	if (presentationMode != m_presentStats.presentMode || swapChainImageCount != m_presentStats.imageCount)
+	{
+		if (m_swapchainCount > 1) PrintPresentStats();
+
+		m_presentStats    = { .presentMode = presentationMode, .imageCount = swapChainImageCount };
+		m_lastPresentTime = { };
+
+		fprintf(stdout, "[INFO] Presenting with %s, %u swap chain images, %u frames in flight\n",
+				GetPresentModeName(presentationMode), swapChainImageCount, m_framesInFlight.load(std::memory_order_relaxed));
+	}
+	m_presentMode.store(presentationMode, std::memory_order_relaxed);
+
 	for (const auto &image : images)
 	{
 		// Store image handle
@@ -472,6 +831,32 @@ VulkanRenderer::CreateSwapChain()
 	}
 }
 
+void
+VulkanRenderer::CreateOffscreenImages()
+{
+	int width = 0, height = 0;
+	GetFramebufferSize(&width, &height);
+
+	// sRGB first like the surface formats, a headless frame matches a windowed one
+	m_swapChainImageFormat = ChooseSupportedFormat({ VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM },
+	                                               VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT);
+	m_swapChainExtent      = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+	m_offscreenImageMemory.resize(m_headlessImageCount);
+	for (uint32_t i = 0; i < m_headlessImageCount; ++i)
+	{
+		// Drawn into by the render pass, copied out by SaveFrame
+		VkImage image = CreateImage(m_swapChainExtent.width, m_swapChainExtent.height, m_swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+		                            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &m_offscreenImageMemory[i]);
+
+		m_swapChainImages.push_back({ .image = image, .imageView = CreateImageView(image, m_swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT) });
+	}
+
+	fprintf(stdout, "[INFO] Headless: %u offscreen images of %ux%u\n", m_headlessImageCount,
+			m_swapChainExtent.width, m_swapChainExtent.height);
+}
+
 void
 VulkanRenderer::CreateViewProjUBO()
 {
@@ -485,29 +870,158 @@ VulkanRenderer::CreateViewProjUBO()
 void
 VulkanRenderer::RecreateSwapChain()
 {
-	// Get the size of the window
+	// Minimised: keep the old swap chain, the next frame with a size recreates it
 	int width = 0, height = 0;
-	glfwGetFramebufferSize(m_window, &width, &height);
-	while (width == 0 || height == 0)
+	GetFramebufferSize(&width, &height);
+	if (width == 0 || height == 0)
 	{
-		glfwGetFramebufferSize(m_window, &width, &height);
-		glfwWaitEvents();
+		m_bFramebufferResized = true;
+		return;
 	}
 
-	// Wait for logical device to finish before continuing
-	vkDeviceWaitIdle(m_mainDevice.logicalDevice);
+	const auto recreateStart = std::chrono::steady_clock::now();
 
-	// Clear
-	CleanupSwapChain();
-	CleanupFramebuffers();
-	CleanupDepthBuffer();
+	// Frames in flight still draw into these, they are destroyed once those are done: no wait on the device
+	VkSwapchainKHR                oldSwapchain    = m_swapchain;
+	std::vector<swapchainImage_t> oldImages       = std::move(m_swapChainImages);
+	std::vector<VkFramebuffer>    oldFramebuffers = std::move(m_swapChainFramebuffers);
+	VkImage                       oldDepthImage   = m_depthBufferImage;
+	VkDeviceMemory                oldDepthMemory  = m_depthBufferImageMemory;
+	VkImageView                   oldDepthView    = m_depthBufferImageView;
+	const VkExtent2D              oldExtent       = m_swapChainExtent;
+
+	m_swapChainImages.clear();
+	m_swapChainFramebuffers.clear();
+
+	// The old swap chain is retired by this call, images already acquired from it can still be presented
+	CreateSwapChain(oldSwapchain);
 
-	// Recreate the swap chain
-	CreateSwapChain();
-	CreateDepthBufferImage();
+	// Only a new size needs a new depth buffer, a present mode or image count change keeps it
+	const bool bNewDepthBuffer = m_swapChainExtent.width != oldExtent.width || m_swapChainExtent.height != oldExtent.height;
+	if (bNewDepthBuffer) CreateDepthBufferImage();
 	CreateFramebuffers();
 
 	CreateViewProjUBO();
+
+	// A present may still hold the old images, the timeline cannot tell when it lets go
+	m_presentDeletionQueue.push_function(m_frameNumber + MAX_FRAME_DRAWS, [=, this]() -> void
+	{
+		for (const auto &framebuffer : oldFramebuffers) vkDestroyFramebuffer(m_mainDevice.logicalDevice, framebuffer, nullptr);
+		for (const auto &image : oldImages) vkDestroyImageView(m_mainDevice.logicalDevice, image.imageView, nullptr);
+
+		if (bNewDepthBuffer)
+		{
+			vkDestroyImageView(m_mainDevice.logicalDevice, oldDepthView, nullptr);
+			vkDestroyImage(m_mainDevice.logicalDevice, oldDepthImage, nullptr);
+			vkFreeMemory(m_mainDevice.logicalDevice, oldDepthMemory, nullptr);
+		}
+
+		vkDestroySwapchainKHR(m_mainDevice.logicalDevice, oldSwapchain, nullptr);
+	});
+
+	const float recreateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - recreateStart).count();
+	fprintf(stdout, "[INFO] Swap chain %u: %ux%u, %zu images, recreated in %.2f ms\n", m_swapchainCount,
+			m_swapChainExtent.width, m_swapChainExtent.height, m_swapChainImages.size(), recreateMs);
+
+	// Present IDs belong to a swap chain, start over with the next present
+	m_firstPresentId = 0;
+}
+
+bool
+VulkanRenderer::AcquireNextImage(uint32_t *outImageIndex)
+{
+	// Rebuild once a burst of resize events is over, the old swap chain stays usable meanwhile
+	const int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	if (m_bFramebufferResized && nowNs - m_lastResizeNs.load(std::memory_order_relaxed) >= SWAPCHAIN_RESIZE_DEBOUNCE_MS * 1000000ll)
+	{
+		m_bFramebufferResized = false;
+		RecreateSwapChain();
+	}
+	else if (m_bSwapchainSettingsChanged.load(std::memory_order_acquire))
+	{
+		// New present mode or image count, the size did not change: the depth buffer is kept
+		RecreateSwapChain();
+	}
+
+	VkResult acquireResult;
+	{
+		// Get index of next image to be drawn to, blocks when the presentation engine holds them all
+		PROFILE_SCOPE("Acquire image");
+		acquireResult = vkAcquireNextImageKHR(m_mainDevice.logicalDevice, m_swapchain, UINT64_MAX,
+											  m_imageAvailableSemaphore[m_currentFrame], VK_NULL_HANDLE, outImageIndex);
+	}
+
+	// Cannot present to it anymore, skip the frame. Nothing was submitted, the next frame does not wait on it
+	if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		RecreateSwapChain();
+		return false;
+	}
+	if (acquireResult != VK_SUBOPTIMAL_KHR) VK_CHECK(acquireResult, "Failed to acquire a swap chain image!");
+
+	return true;
+}
+
+void
+VulkanRenderer::PresentImage(uint32_t imageIndex)
+{
+	RecordPresent();
+
+	// Tag the present so the frame pacer can wait for it to reach the display. IDs must increase, 0 is no ID
+	const uint64_t presentId     = m_frameNumber + 1;
+	VkPresentIdKHR presentIdInfo =
+	{
+		.sType          = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+		.swapchainCount = 1,
+		.pPresentIds    = &presentId
+	};
+
+	// Present info
+	VkPresentInfoKHR presentInfo =
+	{
+		.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.pNext              = m_bPresentWait ? &presentIdInfo : nullptr,
+
+		.waitSemaphoreCount = 1,                                          // Number of semaphores to wait on
+		.pWaitSemaphores    = &m_renderFinishedSemaphore[m_currentFrame], // Semaphores to wait on
+
+		.swapchainCount     = 1,                                          // Number of swapchains to present to
+		.pSwapchains        = &m_swapchain,                               // Swapchains to present images to
+
+		.pImageIndices      = &imageIndex                                 // Index of images in swapchains to present
+	};
+
+	// Present image, blocks in FIFO when the queue of presents is full
+	VkResult presentResult;
+	{
+		PROFILE_SCOPE("Present");
+		presentResult = vkQueuePresentKHR(m_presentationQueue, &presentInfo);
+	}
+
+	if (m_firstPresentId == 0) m_firstPresentId = presentId;
+	m_lastPresentId = presentId;
+	if (presentResult == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		RecreateSwapChain();
+	}
+	else if (presentResult == VK_SUBOPTIMAL_KHR)
+	{
+		// Still presentable, let it go through the debounce like a resize
+		m_bFramebufferResized = true;
+	}
+}
+
+bool
+VulkanRenderer::WaitForPresent(uint64_t timeoutNs)
+{
+	// Leave one frame queued for the display, waiting on the last one would starve it
+	if (!m_bPresentWait || m_lastPresentId < 2) return false;
+
+	const uint64_t waitId = m_lastPresentId - 1;
+	if (m_firstPresentId == 0 || waitId < m_firstPresentId) return false;
+
+	// Out of date is reported by the next present too, the swap chain is recreated there
+	return m_vkWaitForPresent(m_mainDevice.logicalDevice, m_swapchain, waitId, timeoutNs) == VK_SUCCESS;
 }
 
 void
@@ -515,6 +1029,9 @@ VulkanRenderer::CreateRenderPass()
 {
 	/* ------------------------------------------- ATTACHMENTS ------------------------------------------- */
 
+	// Presented, or copied out by SaveFrame when headless
+	const VkImageLayout colorFinalLayout = m_bHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
 	/// Colour attachment of render pass (e.g. layout(location = 0) in shader)
 	VkAttachmentDescription colorAttachment =
 	{
@@ -525,7 +1042,7 @@ VulkanRenderer::CreateRenderPass()
 		.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,  // Describes what to do with the stencil before rendering
 		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE, // Describes what to do with the stencil after rendering
 		.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,        // Image data layout before render pass
-		.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR   // Image data layout after render pass
+		.finalLayout    = colorFinalLayout                  // Image data layout after render pass
 	};
 
 	// Depth attachment of render pass
@@ -732,6 +1249,25 @@ VulkanRenderer::CreateDescriptorSetLayout()
     .pBindings    = &samplerLayoutBinding
   };
 
+  // Bindless: a single binding holding every texture
+  //  - PARTIALLY_BOUND   : Slots of textures not loaded yet can stay empty
+  //  - UPDATE_AFTER_BIND : New textures are written while command buffers using the set are pending
+  VkDescriptorBindingFlagsEXT bindlessBindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+                                                   | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT;
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindlessFlagsCreateInfo =
+  {
+    .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT,
+    .bindingCount  = 1,
+    .pBindingFlags = &bindlessBindingFlags
+  };
+
+  if (m_bBindlessTextures)
+  {
+    samplerLayoutBinding.descriptorCount = m_bindlessCapacity;
+    textureLayoutCreateInfo.pNext        = &bindlessFlagsCreateInfo;
+    textureLayoutCreateInfo.flags        = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+  }
+
   VK_CHECK(vkCreateDescriptorSetLayout(m_mainDevice.logicalDevice, &textureLayoutCreateInfo, nullptr, &m_samplerSetLayout),
            "Failed to create a Texture Descriptor Set Layout!");
 
@@ -746,301 +1282,205 @@ void
 VulkanRenderer::CreatePushConstantRange()
 {
 	// Define push constant values (no 'create' needed)
-	m_pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // Shader stage push constant will go to
-	m_pushConstantRange.offset     = 0;                          // Offset into given data to pass to push constant
-	m_pushConstantRange.size       = sizeof(model_t);            // Size of data being passed
+	m_pushConstantRanges.push_back(
+	{
+		.stageFlags = VK_SHADER_STAGE_VERTEX_BIT, // Shader stage push constant will go to
+		.offset     = 0,                          // Offset into given data to pass to push constant
+		.size       = sizeof(model_t)             // Size of data being passed
+	});
+
+	// Bindless: the texture slot follows the model matrix
+	if (m_bBindlessTextures)
+	{
+		m_pushConstantRanges.push_back(
+		{
+			.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+			.offset     = sizeof(model_t),
+			.size       = sizeof(uint32_t)
+		});
+	}
 }
 
 void
-VulkanRenderer::CreateGraphicsPipeline()
+VulkanRenderer::CreatePipelineCache()
 {
-	// Read in SPIR-V bytecode
-	auto vertShaderCode = ReadFile("Assets/Shader/vert.spv");
-	auto fragShaderCode = ReadFile("Assets/Shader/frag.spv");
-
-	// Shader Module is a wrapper object for the shader bytecode
-	VkShaderModule vertexShaderModule = CreateShaderModule(vertShaderCode);
-	VkShaderModule fragShaderModule   = CreateShaderModule(fragShaderCode);
+	m_pipelineCache.Create(m_mainDevice, PIPELINE_CACHE_FILE);
 
-
-	/* ----------------------------------------- Shader Stage Creation Information ----------------------------------------- */
-
-	std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages =
+	// Saved on the way out, after the pipelines built from it are gone
+	m_mainDeletionQueue.push_function([&]() -> void
 	{
-		{
-			// Vertex stage creation information
-			{
-				.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-				.stage               = VK_SHADER_STAGE_VERTEX_BIT,  // Shader stage name
-				.module              = vertexShaderModule,          // Shader module to be used by stage
-				.pName               = "main"                       // Entry point in the shader
-			},
-			// Fragment stage creation information
-			{
-				.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-				.stage               = VK_SHADER_STAGE_FRAGMENT_BIT,
-				.module              = fragShaderModule,
-				.pName               = "main"
-			}
-		}
-	};
-
+		m_pipelineCache.Destroy();
+	});
+}
 
-	/* ----------------------------------------- Vertex Input ----------------------------------------- */
+void
+VulkanRenderer::CreateGraphicsPipeline()
+{
+	/* ----------------------------------------- Pipeline Layout ----------------------------------------- */
 
-	VkVertexInputBindingDescription bindingDescription    = vertex_t::GetBindingDescription();
-	vertex_t::attributeDescriptions attributeDescriptions = vertex_t::GetAttributeDescriptions();
+  std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = { m_descriptorSetLayout, m_samplerSetLayout };
 
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo =
+	/// A pipeline layout object describes the complete set of resources that can be accessed by a pipeline.
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
 	{
-		.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-		.vertexBindingDescriptionCount   = 1,                                                   // Number of vertex binding descriptions
-		.pVertexBindingDescriptions      = &bindingDescription,                                 // List of vertex binding descriptions (data spacing/stride information)
-		.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size()), // Number of vertex attribute descriptions
-		.pVertexAttributeDescriptions    = attributeDescriptions.data()                         // List of vertex attribute descriptions (data format and where to bind to from)
-	};
-
+		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
 
-	/* ----------------------------------------- Input Assembly ----------------------------------------- */
+		.setLayoutCount         = static_cast<uint32_t>(descriptorSetLayouts.size()),   // Number of descriptor set layouts included
+		.pSetLayouts            = descriptorSetLayouts.data(),                          // Array of descriptor set layouts to bind to the pipeline
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo =
-	{
-		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-		.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, // Primitive type to assemble vertices as
-		.primitiveRestartEnable = VK_FALSE                             // Allow overriding of "strip" topology to start new primitives
+		.pushConstantRangeCount = static_cast<uint32_t>(m_pushConstantRanges.size()),   // Number of push constant ranges
+		.pPushConstantRanges    = m_pushConstantRanges.data()                           // Pointer to array of push constant ranges
 	};
 
-	/*
-	 * VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST treats each set of three vertices as an independent triangle.
-	 * For example, if we have six vertices (v0, v1, v2, v3, v4, v5), it will form two triangles: (v0, v1, v2) and (v3, v4, v5).
-	 *
-	 * v0     v3
-	 *  *-----*
-	 *  |   / |
-	 *  |  /  |
-	 *  | /   |
-	 *  |/    |
-	 *  *-----*
-	 * v2     v5
-	 */
-
-
-	/* ----------------------------------------- Viewport & Scissor ----------------------------------------- */
-
-	// Viewport is the area that the output will be rendered to
-	VkViewport viewport =
-	{
-		.x        = 0.0F,                             // x start coordinate
-		.y        = 0.0F,                             // y start coordinate
-
-		.width    = (float)m_swapChainExtent.width,   // width of the framebuffer
-		.height   = (float)m_swapChainExtent.height,  // height of the framebuffer
+	VK_CHECK(vkCreatePipelineLayout(m_mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout),
+			 "Failed to create pipeline layout");
 
-		.minDepth = 0.0F,                             // Min depth of the framebuffer
-		.maxDepth = 1.0F                              // Max depth of the framebuffer
-	};
 
-	// Crop the framebuffer
-	VkRect2D scissor =
-	{
-		.offset = { 0, 0 },          // Offset to use region from
-		.extent = m_swapChainExtent  // Extent to describe region to use, starting at offset
-	};
+	/* ----------------------------------------- Create Pipeline ----------------------------------------- */
 
-	// Combine viewport and scissor into a viewport state
-	VkPipelineViewportStateCreateInfo viewportStateCreateInfo =
-	{
-		.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-		.viewportCount = 1,          // Number of viewports to use
-		.pViewports    = &viewport,  // List of viewports to use
-		.scissorCount  = 1,          // Number of scissor rectangles to use
-		.pScissors     = &scissor    // List of scissor rectangles to use
-	};
+	m_pipelines.Create(m_mainDevice, &m_pipelineCache);
 
+	// The default variant is every mesh's fallback, it is the only one compiled on this thread
+	const auto creationStart = std::chrono::steady_clock::now();
+	m_meshPipeline = m_pipelines.CompileNow(GetDefaultPipelineDesc());
 
-	/* ----------------------------------------- Dynamic States ----------------------------------------- */
+	const float creationMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - creationStart).count();
+	fprintf(stdout, "[INFO] Graphics pipeline created in %.2f ms (pipeline cache %s)\n", creationMs,
+			m_pipelineCache.GetStats().bLoaded ? "hit" : "miss");
 
-	// Dynamic states to enable
-	// !WARNING! If you are resizing the window, you need to recreate the swap chain,
-	// 			 swap chain images, and any image views associated with output attachments to the swap chain
-	std::vector<VkDynamicState> dynamicStates =
+	// Shaders compiled before the constants existed would still sample the texture, leave untextured meshes out
+	const pipelineDesc_t untexturedDesc = GetDefaultPipelineDesc(false);
+	if (HasShaderConstant(untexturedDesc.fragmentShader, SHADER_CONSTANT_TEXTURED))
 	{
-		VK_DYNAMIC_STATE_VIEWPORT,  // Dynamic Viewport : Can resize in command buffer with vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		VK_DYNAMIC_STATE_SCISSOR,   // Dynamic Scissor  : Can resize in command buffer with vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-		VK_DYNAMIC_STATE_LINE_WIDTH   // Dynamic Line Width : Can resize in command buffer with vkCmdSetLineWidth(commandBuffer, 1.0F);
-	};
-
-	// Dynamic state creation information
-	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo =
+		m_untexturedPipeline = m_pipelines.Request(untexturedDesc);
+	}
+	else
 	{
-		.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-		.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()), // Number of dynamic states to enable
-		.pDynamicStates    = dynamicStates.data()                         // List of dynamic states to enable
-	};
-
-
-	/* ----------------------------------------- Depth Stencil ----------------------------------------- */
+		fprintf(stdout, "[INFO] '%s' has no specialization constants, meshes without a texture are not drawn\n",
+				untexturedDesc.fragmentShader.c_str());
+	}
 
-	// Depth and stencil testing
-	VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo =
+	// Add pipelines to deletion queue
+	m_mainDeletionQueue.push_function([&]() -> void
 	{
-		.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-		.depthTestEnable       = VK_TRUE,                  // Enable checking depth to determine fragment write
-		.depthWriteEnable      = VK_TRUE,                  // Enable writing to the depth buffer (to replace old values)
-		.depthCompareOp        = VK_COMPARE_OP_LESS,       // Comparison operation that allows an overwriting (is in front)
-		.depthBoundsTestEnable = VK_FALSE,                 // Depth bounds test: Does the depth value exist between two bounds
-		.stencilTestEnable     = VK_FALSE,                 // Enable checking stencil value
-		.front                 = {},                       // Stencil operations for front-facing triangles
-		.back                  = {},                       // Stencil operations for back-facing triangles
-		.minDepthBounds        = 0.0F,                     // Min depth bounds
-		.maxDepthBounds        = 1.0F,                     // Max depth bounds
-	};
-
-	/**
-	 * Depth Testing (depthCompareOp):
-	 *
-	 * - VK_COMPARE_OP_NEVER            : Always pass the depth test
-	 * - VK_COMPARE_OP_LESS             : Pass if the new depth is less than the old depth
-	 * - VK_COMPARE_OP_EQUAL            : Pass if the new depth is equal to the old depth
-	 * - VK_COMPARE_OP_LESS_OR_EQUAL    : Pass if the new depth is less than or equal to the old depth
-	 * - VK_COMPARE_OP_GREATER          : Pass if the new depth is greater than the old depth
-	 * - VK_COMPARE_OP_NOT_EQUAL        : Pass if the new depth is not equal to the old depth
-	 * - VK_COMPARE_OP_GREATER_OR_EQUAL : Pass if the new depth is greater than or equal to the old depth
-	 * - VK_COMPARE_OP_ALWAYS           : Always pass the depth test
-	 */
-
+		m_pipelines.Destroy();
+		vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_pipelineLayout, nullptr);
+		m_meshPipeline       = -1;
+		m_untexturedPipeline = -1;
+		m_pipelineLayout     = VK_NULL_HANDLE;
+	});
+}
 
-	/* ----------------------------------------- Rasterizer ----------------------------------------- */
+void
+VulkanRenderer::CreateShaderWatcher()
+{
+	m_shaderWatcher.Create();
 
-	// How to draw the polygons
-	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo =
+	m_mainDeletionQueue.push_function([&]() -> void
 	{
-		.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-		.depthClampEnable        = VK_FALSE,                         // Change if fragments beyond near/far planes are clamped (default) or discarded
-		.rasterizerDiscardEnable = VK_FALSE,                         // Whether to discard data and skip rasterizer. Never creates fragments, only suitable for pipeline without framebuffer output
-		.polygonMode             = VK_POLYGON_MODE_FILL,             // How to handle filling points between vertices
-		.cullMode                = VK_CULL_MODE_BACK_BIT,            // Which face of a triangle to cull
-		.frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE,  // Winding to determine which side is front
-		.depthBiasEnable         = VK_FALSE,                         // Whether to add depth bias to fragments (good for stopping "shadow acne" in shadow mapping)
-		.lineWidth               = 1.0F,                             // How thick lines should be when drawn
-	};
-
-
+		m_shaderWatcher.Destroy();
+	});
+}
 
-	/* ----------------------------------------- Multisampling ----------------------------------------- */
+void
+VulkanRenderer::CreateOverlay()
+{
+	queueFamilyIndices_t indices = GetQueueFamilies(m_mainDevice.physicalDevice);
+	m_overlay.Create(m_instance, m_mainDevice, static_cast<uint32_t>(indices.graphicsFamily), m_graphicsQueue, m_renderPass,
+	                 m_pipelineCache.Get(), IsSRGBFormat(m_swapChainImageFormat));
 
-	// How to handle multisampling
-	VkPipelineMultisampleStateCreateInfo multisamplingCreateInfo =
+	m_mainDeletionQueue.push_function([&]() -> void
 	{
-		.sType                 = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-		.rasterizationSamples  = VK_SAMPLE_COUNT_1_BIT,  // Number of samples to use per fragment
-		.sampleShadingEnable   = VK_FALSE,               // Enable multisample shading or not
-	};
+		m_overlay.Destroy();
+	});
+}
 
+void
+VulkanRenderer::ReloadShaders()
+{
+	std::vector<std::string> reloaded;
+	m_shaderWatcher.Poll(&reloaded);
+	for (const auto &name : reloaded) m_pipelines.Reload(name);
 
-	/* ----------------------------------------- Colour Blending ----------------------------------------- */
+	std::vector<VkPipeline> retired;
+	m_pipelines.SwapReloaded(&retired);
 
-	// How to handle the colours
-	VkPipelineColorBlendAttachmentState colorBlendAttachment =
+	// Frames in flight were recorded with the old pipelines, no wait on the device
+	for (VkPipeline pipeline : retired)
 	{
-		.blendEnable         = VK_TRUE,                                             // Enable blending
-		.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,                           // How to handle blending of new colour
-		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,                 // How to handle blending of old colour
-		.colorBlendOp        = VK_BLEND_OP_ADD,                                     // Type of blend operation to use
-		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,                                 // How to handle blending of new alpha
-		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,                                // How to handle blending of old alpha
-		.alphaBlendOp        = VK_BLEND_OP_ADD,                                     // Type of blend operation to use for alpha
-		.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT  // Which colours to apply the blend to
-		                     | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
-	};
+		m_frameDeletionQueue.push_function(m_graphicsTimeline.GetNextValue(), [this, pipeline]() -> void
+		{
+			vkDestroyPipeline(m_mainDevice.logicalDevice, pipeline, nullptr);
+		});
+	}
+}
 
-	/*
-	 * Blend Equation:
-	 *
-	 * newColor.rgb = (srcColourBlendFactor * newColor)    colourBlendOp    (dstColourBlendFactor * oldColor)
-	 * newColor.a   = (srcAlphaBlendFactor * newAlpha)     alphaBlendOp     (dstAlphaBlendFactor * oldAlpha)
-	 *
-	 * Summarised:
-	 *
-	 * (VK_BLEND_FACTOR_SRC_ALPHA * newColor) + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * oldColor)
-	 * ( newAlpha + newColor ) + ( ( 1 - newAlpha ) * oldColor )
-	 */
+pipelineDesc_t
+VulkanRenderer::GetDefaultPipelineDesc(bool bTextured, bool bVertexColour) const
+{
+	const vertex_t::attributeDescriptions attributeDescriptions = vertex_t::GetAttributeDescriptions();
 
-	// How to handle all the colours and alpha
-	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo =
+	return
 	{
-		.sType             = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-		.logicOpEnable     = VK_FALSE,                   // Alternative to calculations is to use logical operations
-		.logicOp           = VK_LOGIC_OP_COPY,           // What logical operation to use
-		.attachmentCount   = 1,                          // Number of colour blend attachments
-		.pAttachments      = &colorBlendAttachment,      // Information about how to handle blending
-		.blendConstants    = { 0.0F, 0.0F, 0.0F, 0.0F }  // (Optional) Constants to use for blending [VK_BLEND_FACTOR_CONSTANT_COLOR]
-	};
-
+		.vertexShader     = "vert.spv",
+		.fragmentShader   = m_bBindlessTextures ? BINDLESS_FRAGMENT_SHADER : "frag.spv",
 
-	/* ----------------------------------------- Pipeline Layout ----------------------------------------- */
-
-  std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = { m_descriptorSetLayout, m_samplerSetLayout };
-
-	/// A pipeline layout object describes the complete set of resources that can be accessed by a pipeline.
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
-	{
-		.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.constants        =
+		{
+			{ .id = SHADER_CONSTANT_TEXTURED,      .value = bTextured ? VK_TRUE : VK_FALSE },
+			{ .id = SHADER_CONSTANT_VERTEX_COLOUR, .value = bVertexColour ? VK_TRUE : VK_FALSE }
+		},
 
-		.setLayoutCount         = static_cast<uint32_t>(descriptorSetLayouts.size()),   // Number of descriptor set layouts included
-		.pSetLayouts            = descriptorSetLayouts.data(),                          // Array of descriptor set layouts to bind to the pipeline
+		.vertexBinding    = vertex_t::GetBindingDescription(),
+		.vertexAttributes = { attributeDescriptions.begin(), attributeDescriptions.end() },
 
-		.pushConstantRangeCount = 1,                                                    // Number of push constant ranges
-		.pPushConstantRanges    = &m_pushConstantRange                                  // Pointer to array of push constant ranges
+		.layout           = m_pipelineLayout,
+		.renderPass       = m_renderPass,
+		.subpass          = 0
 	};
+}
 
-	VK_CHECK(vkCreatePipelineLayout(m_mainDevice.logicalDevice, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout),
-			 "Failed to create pipeline layout");
+PipelineHandle
+VulkanRenderer::RequestPipeline(pipelineDesc_t desc)
+{
+	if (desc.layout == VK_NULL_HANDLE)     desc.layout     = m_pipelineLayout;
+	if (desc.renderPass == VK_NULL_HANDLE) desc.renderPass = m_renderPass;
 
+	// Fall back to the default of the same kind, a textured pipeline would sample no texture
+	const bool bUntextured = std::ranges::any_of(desc.constants, [](const shaderConstant_t &constant) -> bool
+	{
+		return constant.id == SHADER_CONSTANT_TEXTURED && constant.value == VK_FALSE;
+	});
 
-	/* ----------------------------------------- Create Pipeline ----------------------------------------- */
+	return m_pipelines.Request(desc, bUntextured ? m_untexturedPipeline : m_meshPipeline);
+}
 
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo =
-	{
-		.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-		.stageCount          = static_cast<uint32_t>(shaderStages.size()),
-		.pStages             = shaderStages.data(),
-
-		// Actual states creations
-		.pVertexInputState   = &vertexInputCreateInfo,
-		.pInputAssemblyState = &inputAssemblyCreateInfo,
-		.pViewportState      = &viewportStateCreateInfo,
-		.pRasterizationState = &rasterizerCreateInfo,
-		.pMultisampleState   = &multisamplingCreateInfo,
-		.pDepthStencilState  = &depthStencilStateCreateInfo,
-		.pColorBlendState    = &colorBlendCreateInfo,
-		.pDynamicState       = &dynamicStateCreateInfo,
-
-		.layout              = m_pipelineLayout,                                  // Pipeline layout to use with render pass
-		.renderPass          = m_renderPass,                                      // Render pass description the pipeline is compatible with
-		.subpass             = 0,                                                 // Index of the subpass to use with this pipeline
-
-		// Pipeline derivatives : Can create multiple pipelines that derive from one another for optimisation
-		.basePipelineHandle  = VK_NULL_HANDLE,                                    // Pipeline to derive from
-		.basePipelineIndex   = -1                                                 // Index of the base pipeline to derive from
-	};
+uint32_t
+VulkanRenderer::AddMesh(std::vector<vertex_t> vertices, std::vector<uint32_t> indices, TextureHandle texture)
+{
+	m_meshList.emplace_back(m_mainDevice, m_graphicsQueue, m_graphicsCommandPool, &vertices, &indices, texture);
+	return static_cast<uint32_t>(m_meshList.size() - 1);
+}
 
-	VK_CHECK(vkCreateGraphicsPipelines(m_mainDevice.logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
-									   &m_graphicsPipeline),
-			 "Failed to create Graphics Pipeline");
+uint32_t
+VulkanRenderer::AddMeshInstance(uint32_t meshIndex, TextureHandle texture)
+{
+	m_meshList.push_back(m_meshList[meshIndex].CreateInstance(texture));
+	return static_cast<uint32_t>(m_meshList.size() - 1);
+}
 
-	// Destroy shader modules
-	vkDestroyShaderModule(m_mainDevice.logicalDevice, fragShaderModule, nullptr);
-	vkDestroyShaderModule(m_mainDevice.logicalDevice, vertexShaderModule, nullptr);
+std::string
+VulkanRenderer::GetDeviceName() const
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_mainDevice.physicalDevice, &deviceProperties);
+	return deviceProperties.deviceName;
+}
 
-	// Add pipeline to deletion queue
-	m_mainDeletionQueue.push_function([&]() -> void
-	{
-		vkDestroyPipeline(m_mainDevice.logicalDevice, m_graphicsPipeline, nullptr);
-		vkDestroyPipelineLayout(m_mainDevice.logicalDevice, m_pipelineLayout, nullptr);
-		m_graphicsPipeline = VK_NULL_HANDLE;
-		m_pipelineLayout   = VK_NULL_HANDLE;
-	});
+void
+VulkanRenderer::SetMeshPipeline(size_t meshIndex, PipelineHandle pipeline)
+{
+	m_meshList[meshIndex].SetPipeline(pipeline);
 }
 
 void
@@ -1136,8 +1576,8 @@ VulkanRenderer::CreateCommandPool()
 void
 VulkanRenderer::CreateCommandBuffers()
 {
-	// Resize command buffer count to have one for each framebuffer
-	m_commandBuffers.resize(m_swapChainFramebuffers.size());
+	// One command buffer for each frame in flight, re-recorded once its fence is signalled
+	m_commandBuffers.resize(m_framesInFlight);
 
 	VkCommandBufferAllocateInfo commandBufferAllocInfo =
 	{
@@ -1147,62 +1587,69 @@ VulkanRenderer::CreateCommandBuffers()
 		.commandBufferCount = static_cast<uint32_t>(m_commandBuffers.size())
 	};
 
-	// Allocate command buffers and place handles in array of buffers
+	// Allocate command buffers and place handles in array of buffers. Freed by CleanupFrameResources
 	VK_CHECK(vkAllocateCommandBuffers(m_mainDevice.logicalDevice, &commandBufferAllocInfo, m_commandBuffers.data()),
 			 "Failed to allocate Command Buffers!");
-
-	// Add command buffers to deletion queue
-	m_mainDeletionQueue.push_function([&]() -> void
-	{
-		vkFreeCommandBuffers(m_mainDevice.logicalDevice, m_graphicsCommandPool,
-							 static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
-	});
 }
 
 void
 VulkanRenderer::CreateSemaphores()
 {
-	// Resize the semaphores to fit all the swap chain images
-	m_imageAvailableSemaphore.resize(MAX_FRAME_DRAWS);
-	m_renderFinishedSemaphore.resize(MAX_FRAME_DRAWS);
-	m_drawFences.resize(MAX_FRAME_DRAWS);
+	// One of each for every frame in flight. Nothing signalled yet, the first frames do not wait
+	m_imageAvailableSemaphore.resize(m_framesInFlight);
+	m_renderFinishedSemaphore.resize(m_framesInFlight);
+	m_frameTimelineValues.assign(m_framesInFlight, 0);
 
 	/// Semaphore creation information
 	VkSemaphoreCreateInfo semaphoreCreateInfo = { .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 
-	/// Fence creation information
-	VkFenceCreateInfo fenceCreateInfo =
-	{
-		.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-		.flags = VK_FENCE_CREATE_SIGNALED_BIT         // Fence starts "signaled" (green flag) so we don't have to wait on the first frame
-	};
-
-	for (size_t i = 0; i < MAX_FRAME_DRAWS; ++i)
+	for (size_t i = 0; i < m_frameTimelineValues.size(); ++i)
 	{
 		// Create Semaphores
 		VK_CHECK(vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo,
 								   nullptr, &m_imageAvailableSemaphore[i]), "Failed to create a Semaphore!");
 		VK_CHECK(vkCreateSemaphore(m_mainDevice.logicalDevice, &semaphoreCreateInfo,
 								   nullptr, &m_renderFinishedSemaphore[i]), "Failed to create a Semaphore!");
-
-		// Create Fences
-		VK_CHECK(vkCreateFence(m_mainDevice.logicalDevice, &fenceCreateInfo,
-							   nullptr, &m_drawFences[i]), "Failed to create a Fence!");
 	}
+}
 
-	// Add semaphores to deletion queue
-	m_mainDeletionQueue.push_function([&]() -> void
+void
+VulkanRenderer::ApplyFramesInFlight()
+{
+	m_bFramesInFlightChanged.store(false, std::memory_order_relaxed);
+
+	const uint32_t framesInFlight = std::clamp<uint32_t>(m_requestedFramesInFlight.load(std::memory_order_relaxed), 1, MAX_FRAME_DRAWS);
+	if (framesInFlight == m_framesInFlight) return;
+
+	// Only the frames in flight are waited on, the last one submitted finishes after the others
+	m_graphicsTimeline.Wait(*std::ranges::max_element(m_frameTimelineValues));
+
+	// A present can still wait on the render finished semaphores, the timeline cannot tell when it is done with them
+	m_presentDeletionQueue.push_function(m_frameNumber + MAX_FRAME_DRAWS, [this, imageAvailable = std::move(m_imageAvailableSemaphore),
+	                                                   renderFinished = std::move(m_renderFinishedSemaphore)]() -> void
 	{
-		for (size_t i = 0; i < MAX_FRAME_DRAWS; ++i)
-		{
-			vkDestroySemaphore(m_mainDevice.logicalDevice, m_imageAvailableSemaphore[i], nullptr);
-			vkDestroySemaphore(m_mainDevice.logicalDevice, m_renderFinishedSemaphore[i], nullptr);
-			vkDestroyFence(m_mainDevice.logicalDevice, m_drawFences[i], nullptr);
-		}
-		m_imageAvailableSemaphore.clear();
-		m_renderFinishedSemaphore.clear();
-		m_drawFences.clear();
+		for (const auto &semaphore : imageAvailable) vkDestroySemaphore(m_mainDevice.logicalDevice, semaphore, nullptr);
+		for (const auto &semaphore : renderFinished) vkDestroySemaphore(m_mainDevice.logicalDevice, semaphore, nullptr);
 	});
+	m_imageAvailableSemaphore.clear();
+	m_renderFinishedSemaphore.clear();
+
+	CleanupFrameResources();
+
+	fprintf(stdout, "[INFO] Frames in flight: %u -> %u\n", m_framesInFlight.load(std::memory_order_relaxed), framesInFlight);
+
+	m_framesInFlight = framesInFlight;
+	m_currentFrame   = 0;
+
+	CreateCommandBuffers();
+	CreateUniformBuffers();
+	CreateDescriptorSets();
+	CreateSemaphores();
+
+	// The present statistics are per setting
+	PrintPresentStats();
+	m_presentStats    = { .presentMode = m_presentStats.presentMode, .imageCount = m_presentStats.imageCount };
+	m_lastPresentTime = { };
 }
 
 void
@@ -1222,7 +1669,7 @@ VulkanRenderer::CreateTextureSampler()
     .anisotropyEnable        = VK_TRUE,                          // Enable anisotropic filtering
     .maxAnisotropy           = 16,                               // Anisotropic filter amount
     .minLod                  = 0.0F,                             // Minimum level of detail to pick mip level
-    .maxLod                  = 0.0F,                             // Maximum level of detail to pick mip level
+    .maxLod                  = VK_LOD_CLAMP_NONE,                // Maximum level of detail to pick mip level. Views limit it to the levels uploaded
     .borderColor             = VK_BORDER_COLOR_INT_OPAQUE_BLACK, // Border beyond texture (only works for border clamp)
     .unnormalizedCoordinates = VK_FALSE,                         // Whether coords should be normalized (between 0 and 1)
   };
@@ -1238,6 +1685,34 @@ VulkanRenderer::CreateTextureSampler()
   });
 }
 
+void
+VulkanRenderer::CreateTextureLoader()
+{
+	m_textureWorkers = std::make_unique<ThreadPool>(TEXTURE_DECODE_THREADS);
+	m_textureStagingRing.Create(m_mainDevice, TEXTURE_STAGING_RING_SIZE);
+
+	// Colour textures are only sRGB when the swap chain encodes back, otherwise they would draw darker
+	m_bSRGBTextures = IsSRGBFormat(m_swapChainImageFormat);
+
+	// Formats the device can sample and filter, falling back to RGBA8 which every device supports
+	for (uint32_t channels = 1; channels <= 4; ++channels)
+	{
+		for (bool bSRGB : { false, true })
+		{
+			m_textureFormats[bSRGB][channels - 1] = ChooseSupportedFormat(
+				{ GetTexelFormat(channels, bSRGB), GetTexelFormat(4, bSRGB) }, VK_IMAGE_TILING_OPTIMAL,
+				VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+		}
+	}
+
+	// Add to deletion queue
+	m_mainDeletionQueue.push_function([&]() -> void
+	{
+		m_textureWorkers.reset(); // Joins the workers. Already idle, WaitForTextures runs first on cleanup
+		m_textureStagingRing.Destroy();
+	});
+}
+
 
 void
 VulkanRenderer::CreateUniformBuffers()
@@ -1248,15 +1723,15 @@ VulkanRenderer::CreateUniformBuffers()
 	// Model buffer size
 	//VkDeviceSize modelBufferSize = m_modelUniformAlignment * MAX_OBJECTS;
 
-	// One uniform buffer for each image
-	m_vpUniformBuffers      .resize(m_swapChainImages.size());
-	m_vpUniformBuffersMemory.resize(m_swapChainImages.size());
+	// One uniform buffer for each frame in flight, the swap chain can change its image count
+	m_vpUniformBuffers      .resize(m_framesInFlight);
+	m_vpUniformBuffersMemory.resize(m_framesInFlight);
 
 	//m_modelDUniformBuffers      .resize(m_swapChainImages.size());
 	//m_modelDUniformBuffersMemory.resize(m_swapChainImages.size());
 
 	// Create Uniform buffers
-	for (size_t i = 0; i < m_swapChainImages.size(); ++i)
+	for (size_t i = 0; i < m_vpUniformBuffers.size(); ++i)
 	{
 		CreateBuffer(m_mainDevice, vpBufferSize,
 					 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
@@ -1283,7 +1758,7 @@ VulkanRenderer::CreateDescriptorPool()
 		// View Projection
 		{
 			.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,                    // Type of descriptor
-			.descriptorCount = static_cast<uint32_t>(m_vpUniformBuffers.size())      // Number of descriptors (as an individual piece of data) of that type to store
+			.descriptorCount = MAX_FRAME_DRAWS                                       // Number of descriptors (as an individual piece of data) of that type to store
 		},
 		/*
 		 * LEGACY CODE: We are using now Push Constants, instead of Dynamic Uniform Buffers
@@ -1300,7 +1775,7 @@ VulkanRenderer::CreateDescriptorPool()
 	VkDescriptorPoolCreateInfo poolCreateInfo =
 	{
 		.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-		.maxSets       = static_cast<uint32_t>(m_swapChainImages.size()),  // Maximum number of descriptor sets that can be created from the pool
+		.maxSets       = MAX_FRAME_DRAWS,                                  // Maximum number of descriptor sets that can be created from the pool. Reset when the frames in flight change
 		.poolSizeCount = static_cast<uint32_t>(poolSizes.size()),          // Number of descriptor sets can be created from this pool
 		.pPoolSizes    = poolSizes.data()                                  // Pool sizes to create the pool with
 	};
@@ -1320,16 +1795,19 @@ VulkanRenderer::CreateDescriptorPool()
 
   // TODO: Consider using Texture Array or Texture Atlas for multiple textures
 
+  // Bindless: one set holding the whole texture array, instead of one set per texture
+  // Otherwise three sets per texture: the full image, its next view while mips stream in, and the low resolution copy
   VkDescriptorPoolSize samplerPoolSize =
   {
     .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-    .descriptorCount = MAX_OBJECTS
+    .descriptorCount = m_bBindlessTextures ? m_bindlessCapacity : MAX_OBJECTS * 3
   };
 
   VkDescriptorPoolCreateInfo samplerPoolCreateInfo =
   {
     .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-    .maxSets       = MAX_OBJECTS,
+    .flags         = m_bBindlessTextures ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0u,
+    .maxSets       = m_bBindlessTextures ? 1u : MAX_OBJECTS * 3,
     .poolSizeCount = 1,
     .pPoolSizes    = &samplerPoolSize
   };
@@ -1337,6 +1815,21 @@ VulkanRenderer::CreateDescriptorPool()
   VK_CHECK(vkCreateDescriptorPool(m_mainDevice.logicalDevice, &samplerPoolCreateInfo, nullptr, &m_samplerDescriptorPool),
            "Failed to create a Sampler Descriptor Pool!");
 
+  if (m_bBindlessTextures)
+  {
+    VkDescriptorSetAllocateInfo setAllocInfo =
+    {
+      .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool     = m_samplerDescriptorPool,
+      .descriptorSetCount = 1,
+      .pSetLayouts        = &m_samplerSetLayout
+    };
+
+    // Freed with the pool
+    VK_CHECK(vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &setAllocInfo, &m_bindlessDescriptorSet),
+             "Failed to allocate the Bindless Texture Descriptor Set!");
+  }
+
   m_mainDeletionQueue.push_function([&]() -> void
   {
     vkDestroyDescriptorPool(m_mainDevice.logicalDevice, m_samplerDescriptorPool, nullptr);
@@ -1348,16 +1841,16 @@ void
 VulkanRenderer::CreateDescriptorSets()
 {
 	// Resize the descriptor set list so there is one for each buffer
-	m_descriptorSets.resize(m_swapChainImages.size());
+	m_descriptorSets.resize(m_vpUniformBuffers.size());
 
-	std::vector<VkDescriptorSetLayout> setLayouts(m_swapChainImages.size(), m_descriptorSetLayout);
+	std::vector<VkDescriptorSetLayout> setLayouts(m_vpUniformBuffers.size(), m_descriptorSetLayout);
 
 	// Descriptor Set Allocation Info
 	VkDescriptorSetAllocateInfo setAllocInfo =
 	{
 		.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.descriptorPool     = m_descriptorPool,                                // Pool to allocate a descriptor set from
-		.descriptorSetCount = static_cast<uint32_t>(m_swapChainImages.size()), // Number of sets to allocate
+		.descriptorSetCount = static_cast<uint32_t>(m_vpUniformBuffers.size()), // Number of sets to allocate
 		.pSetLayouts        = setLayouts.data()                                // Layouts to use to allocate sets (1:1 relationship)
 	};
 
@@ -1366,7 +1859,7 @@ VulkanRenderer::CreateDescriptorSets()
 			 "Failed to allocate Descriptor Sets!");
 
 	// Update all the descriptor set buffer bindings
-	for (size_t i = 0; i < m_swapChainImages.size(); ++i)
+	for (size_t i = 0; i < m_vpUniformBuffers.size(); ++i)
 	{
 		/* ----------------------- View Projection Descriptor Set ----------------------- */
 
@@ -1427,13 +1920,15 @@ VulkanRenderer::CreateDescriptorSets()
 }
 
 void
-VulkanRenderer::UpdateUniformBuffers(uint32_t imageIndex)
+VulkanRenderer::UpdateUniformBuffers(uint32_t frame)
 {
+	PROFILE_SCOPE("UpdateUniformBuffers");
+
 	// Copy VP data
 	void *data;
-	vkMapMemory(m_mainDevice.logicalDevice, m_vpUniformBuffersMemory[imageIndex], 0, sizeof(ubo_view_proj_t), 0, &data);
+	vkMapMemory(m_mainDevice.logicalDevice, m_vpUniformBuffersMemory[frame], 0, sizeof(ubo_view_proj_t), 0, &data);
 	memcpy(data, &m_ubo_vp, sizeof(ubo_view_proj_t));
-	vkUnmapMemory(m_mainDevice.logicalDevice, m_vpUniformBuffersMemory[imageIndex]);
+	vkUnmapMemory(m_mainDevice.logicalDevice, m_vpUniformBuffersMemory[frame]);
 
 	/*
 	 * LEGACY CODE: We are using now Push Constants, instead of Dynamic Uniform Buffers
@@ -1463,6 +1958,9 @@ VulkanRenderer::UpdateUniformBuffers(uint32_t imageIndex)
 void
 VulkanRenderer::RecordCommands(VkCommandBuffer commandBuffer, uint32_t currImage)
 {
+	PROFILE_SCOPE("RecordCommands");
+	m_drawStats = { };
+
 	// Command buffer details
 	VkCommandBufferBeginInfo bufferBeginInfo =
 	{
@@ -1507,6 +2005,9 @@ VulkanRenderer::RecordCommands(VkCommandBuffer commandBuffer, uint32_t currImage
 	// Start recording commands to the command buffer
 	VK_CHECK(vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo), "Failed to start recording a command buffer");
 
+	// Timestamp scopes, opened outside the render pass: the first one may reset the query pool
+	const int32_t frameScope      = m_gpuProfiler.BeginScope(commandBuffer, "Frame");
+	const int32_t renderPassScope = m_gpuProfiler.BeginScope(commandBuffer, "Render pass");
 
 		/* ------------------------------------- Begin the render pass -------------------------------------- */
 		// Begin the render pass
@@ -1534,18 +2035,52 @@ VulkanRenderer::RecordCommands(VkCommandBuffer commandBuffer, uint32_t currImage
 			};
 			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-			// ------- Bind Pipeline -------
-			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+			// ------- Bind Bindless Textures -------
+			// Bound once for every draw, each draw pushes the slot of its texture
+			if (m_bBindlessTextures)
+			{
+				std::array<VkDescriptorSet, 2> descriptorSets = { m_descriptorSets[m_currentFrame], m_bindlessDescriptorSet };
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+										0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr);
+			}
 
 			// ------- Draw -------
+			int        boundDescriptor = -1;                  // Meshes sharing an atlas page keep the binding of the previous draw
+			bool       bViewBound      = m_bBindlessTextures; // The view projection set is bound, with a texture or alone
+			VkPipeline boundPipeline   = VK_NULL_HANDLE;      // Meshes sharing a variant keep the pipeline of the previous draw
+			VkBuffer   boundBuffer     = VK_NULL_HANDLE;      // Instances of a mesh keep its vertex and index buffers
 			for (size_t j = 0; j < m_meshList.size(); ++j)
 			{
-				VkBuffer vertexBuffers[] = { m_meshList[j].GetVertexBuffer() };                  // Buffers to bind
-				VkDeviceSize offsets[] = { 0 };                                                  // Offsets into buffers being bound
-				vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);       // Command to bind vertex buffer before drawing with them
+				const TextureHandle textureID = m_meshList[j].GetTextureID();
+				const bool          bTextured = textureID >= 0;
+
+				// Texture still loading, skip the mesh for now
+				if (bTextured && !IsTextureReady(textureID)) continue;
+
+				// ------- Bind Pipeline -------
+				// A variant still compiling draws with the default one. The layout is shared, the descriptor sets stay bound
+				const PipelineHandle defaultPipeline = bTextured ? m_meshPipeline : m_untexturedPipeline;
+				const PipelineHandle meshPipeline    = m_meshList[j].GetPipeline();
+				VkPipeline           pipeline        = m_pipelines.Resolve(meshPipeline < 0 ? defaultPipeline : meshPipeline);
+				if (pipeline == VK_NULL_HANDLE) continue;
+
+				if (pipeline != boundPipeline)
+				{
+					boundPipeline = pipeline;
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+				}
+
+				if (m_meshList[j].GetVertexBuffer() != boundBuffer)
+				{
+					boundBuffer = m_meshList[j].GetVertexBuffer();
+
+					VkBuffer vertexBuffers[] = { m_meshList[j].GetVertexBuffer() };                  // Buffers to bind
+					VkDeviceSize offsets[] = { 0 };                                                  // Offsets into buffers being bound
+					vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);       // Command to bind vertex buffer before drawing with them
 
-				// Bind the mesh index buffer with 0 offset and using the mesh's index count
-				vkCmdBindIndexBuffer(commandBuffer, m_meshList[j].GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+					// Bind the mesh index buffer with 0 offset and using the mesh's index count
+					vkCmdBindIndexBuffer(commandBuffer, m_meshList[j].GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+				}
 
 				// Dynamic Offset Amount
 				//const uint32_t dynamicOffset = static_cast<uint32_t>(m_modelUniformAlignment) * j;
@@ -1561,24 +2096,72 @@ VulkanRenderer::RecordCommands(VkCommandBuffer commandBuffer, uint32_t currImage
 						&model                        // Actual data being pushed (can be a struct)
 				);
 
-        std::array<VkDescriptorSet, 2> descriptorSets =
-        {
-          m_descriptorSets[currImage],
-          m_samplerDescriptorSets[m_meshList[j].GetTextureID()]
-        };
-
-				// Bind the descriptor sets
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
-										0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr); //, 1, &dynamicOffset);
+				// Untextured variants only read the view projection set
+				if (!bTextured)
+				{
+					if (!bViewBound)
+					{
+						vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+												0, 1, &m_descriptorSets[m_currentFrame], 0, nullptr);
+						bViewBound = true;
+					}
+
+					vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_meshList[j].GetIndexCount()), 1, 0, 0, 0);
+					m_drawStats.Add(static_cast<uint32_t>(m_meshList[j].GetIndexCount()), 1);
+					continue;
+				}
+
+				// Evicted textures are drawn with their low resolution copy
+				textureResidency_t &residency = m_textureResidency[textureID];
+				residency.lastUsedFrame = m_frameNumber;
+				residency.lastUsedValue = m_graphicsTimeline.GetNextValue(); // The value this frame signals, submitted next
+
+				const int textureDescriptor = residency.bResident ? residency.fullDescriptor : residency.fallbackDescriptor;
+
+				if (m_bBindlessTextures)
+				{
+					// Slot of the texture in the bindless array
+					const uint32_t textureIndex = static_cast<uint32_t>(textureDescriptor);
+					vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+									   sizeof(model_t), sizeof(uint32_t), &textureIndex);
+				}
+				else if (textureDescriptor != boundDescriptor)
+				{
+          boundDescriptor = textureDescriptor;
+          bViewBound      = true;
+
+          std::array<VkDescriptorSet, 2> descriptorSets =
+          {
+            m_descriptorSets[m_currentFrame],
+            m_samplerDescriptorSets[textureDescriptor]
+          };
+
+					// Bind the descriptor sets
+					vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout,
+											0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, nullptr); //, 1, &dynamicOffset);
+				}
 
 				// Execute the pipeline
 				vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_meshList[j].GetIndexCount()), 1, 0, 0, 0);
+				m_drawStats.Add(static_cast<uint32_t>(m_meshList[j].GetIndexCount()), 1);
+			}
+
+			// ------- Overlay -------
+			// Last, over the scene. Nothing is recorded when it was not built for this frame
+			if (m_overlay.IsVisible())
+			{
+				PROFILE_SCOPE("Record overlay");
+				const int32_t overlayScope = m_gpuProfiler.BeginScope(commandBuffer, "Overlay");
+				m_overlay.Record(commandBuffer);
+				m_gpuProfiler.EndScope(commandBuffer, overlayScope);
 			}
 
 
 		/* ------------------------------------- End the render pass -------------------------------------- */
 		vkCmdEndRenderPass(commandBuffer);
 
+	m_gpuProfiler.EndScope(commandBuffer, renderPassScope);
+	m_gpuProfiler.EndScope(commandBuffer, frameScope);
 
 	// Stop recording commands to the command buffer
 	VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to stop recording a command buffer");
@@ -1588,10 +2171,10 @@ VulkanRenderer::RecordCommands(VkCommandBuffer commandBuffer, uint32_t currImage
 std::vector<const char*>
 VulkanRenderer::GetRequiredExtensions()
 {
-	// GLFW Extensions
+	// GLFW Extensions, the surface ones. None headless, GLFW is not even initialised
 	uint32_t glfwExtensionCount = 0;
-	const char **glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	const char **glfwExtensions = nullptr;
+	if (!m_bHeadless) glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
 	// Create a vector to hold the extensions
 	std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
@@ -1612,6 +2195,13 @@ VulkanRenderer::GetRequiredExtensions()
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 
+	// Optional, needed to query the descriptor indexing features on a 1.0 instance
+	m_bPhysicalDeviceProperties2 = IsInstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if (m_bPhysicalDeviceProperties2)
+	{
+		extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
 #ifndef NDEBUG
 	// Print the extensions
 	fprintf(stdout, "[INFO] Required Extensions:\n");
@@ -1714,16 +2304,24 @@ VulkanRenderer::CleanupSwapChain()
 	{
 		vkDestroyImageView(m_mainDevice.logicalDevice, image.imageView, nullptr);
 	}
+
+	// Headless, the images are the renderer's own
+	for (size_t i = 0; i < m_offscreenImageMemory.size(); ++i)
+	{
+		vkDestroyImage(m_mainDevice.logicalDevice, m_swapChainImages[i].image, nullptr);
+		vkFreeMemory(m_mainDevice.logicalDevice, m_offscreenImageMemory[i], nullptr);
+	}
+	m_offscreenImageMemory.clear();
 	m_swapChainImages.clear();
 
 	vkDestroySwapchainKHR(m_mainDevice.logicalDevice, m_swapchain, nullptr);
 }
 
 void
-VulkanRenderer::CleanupFramebuffers()
+VulkanRenderer::CleanupFrameResources()
 {
 	// Clean up uniform buffers
-	for (size_t i = 0; i < m_swapChainImages.size(); ++i)
+	for (size_t i = 0; i < m_vpUniformBuffers.size(); ++i)
 	{
 		vkDestroyBuffer(m_mainDevice.logicalDevice, m_vpUniformBuffers[i], nullptr);
 		vkFreeMemory(m_mainDevice.logicalDevice, m_vpUniformBuffersMemory[i], nullptr);
@@ -1735,6 +2333,23 @@ VulkanRenderer::CleanupFramebuffers()
 	m_vpUniformBuffers.clear();
 	m_vpUniformBuffersMemory.clear();
 
+	// Descriptor sets go back to the pool, the pool only holds these
+	if (m_descriptorPool != VK_NULL_HANDLE) vkResetDescriptorPool(m_mainDevice.logicalDevice, m_descriptorPool, 0);
+	m_descriptorSets.clear();
+
+	if (!m_commandBuffers.empty())
+	{
+		vkFreeCommandBuffers(m_mainDevice.logicalDevice, m_graphicsCommandPool,
+							 static_cast<uint32_t>(m_commandBuffers.size()), m_commandBuffers.data());
+	}
+	m_commandBuffers.clear();
+
+	for (const auto &semaphore : m_imageAvailableSemaphore) vkDestroySemaphore(m_mainDevice.logicalDevice, semaphore, nullptr);
+	for (const auto &semaphore : m_renderFinishedSemaphore) vkDestroySemaphore(m_mainDevice.logicalDevice, semaphore, nullptr);
+	m_imageAvailableSemaphore.clear();
+	m_renderFinishedSemaphore.clear();
+	m_frameTimelineValues.clear();
+
 	//m_modelDUniformBuffers.clear();
 	//m_modelDUniformBuffersMemory.clear();
 }
@@ -1874,7 +2489,8 @@ VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device)
 	VkPhysicalDeviceFeatures deviceFeatures;
 	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
-	// Check if the device supports the required extensions
+	// Check if the device supports the required extensions, only the swap chain needs them
+	if (!m_bHeadless)
 	{
 		std::string unSupDevExt{};
 		if (!TryCheckDeviceExtensionSupport(device, unSupDevExt))
@@ -1891,9 +2507,9 @@ VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device)
 		return false;
 	}
 
-	// Check if the device supports the swap chain extension
-	bool bSwapChainValid = false;
-	if (indices.IsValid())
+	// Check if the device supports the swap chain extension. Headless draws into its own images
+	bool bSwapChainValid = m_bHeadless;
+	if (!m_bHeadless && indices.IsValid())
 	{
 		swapChainDetails_t swapChainDetails = GetSwapChainDetails(device);
 		bSwapChainValid = !swapChainDetails.formats.empty() && !swapChainDetails.presentationModes.empty();
@@ -1907,6 +2523,132 @@ VulkanRenderer::CheckDeviceSuitable(VkPhysicalDevice device)
 		  //deviceFeatures.geometryShader
 }
 
+bool
+VulkanRenderer::CheckPresentWaitSupport(VkPhysicalDevice device)
+{
+	// The present features can only be queried through the properties2 functions
+	if (!m_bPhysicalDeviceProperties2) return false;
+
+	if (!IsDeviceExtensionAvailable(device, VK_KHR_PRESENT_ID_EXTENSION_NAME) ||
+	    !IsDeviceExtensionAvailable(device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) return false;
+
+	auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+			vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if (getFeatures2 == nullptr) return false;
+
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR
+	};
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+		.pNext = &presentIdFeatures
+	};
+	VkPhysicalDeviceFeatures2KHR features =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+		.pNext = &presentWaitFeatures
+	};
+	getFeatures2(device, &features);
+
+	return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+}
+
+bool
+VulkanRenderer::CheckTimelineSemaphoreSupport(VkPhysicalDevice device, bool *outExtension)
+{
+	// The timeline features can only be queried through the properties2 functions
+	if (!m_bPhysicalDeviceProperties2) return false;
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+	// Core when both the instance and the device are 1.2, the extension otherwise
+	*outExtension = m_apiVersion < VK_API_VERSION_1_2 || deviceProperties.apiVersion < VK_API_VERSION_1_2;
+	if (*outExtension && !IsDeviceExtensionAvailable(device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) return false;
+
+	auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+			vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	if (getFeatures2 == nullptr) return false;
+
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR
+	};
+	VkPhysicalDeviceFeatures2KHR features =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+		.pNext = &timelineFeatures
+	};
+	getFeatures2(device, &features);
+
+	return timelineFeatures.timelineSemaphore;
+}
+
+bool
+VulkanRenderer::CheckBindlessSupport(VkPhysicalDevice device, uint32_t *outCapacity)
+{
+	// The descriptor indexing features can only be queried through the properties2 functions
+	if (!m_bPhysicalDeviceProperties2) return false;
+
+	if (!IsDeviceExtensionAvailable(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) ||
+	    !IsDeviceExtensionAvailable(device, VK_KHR_MAINTENANCE3_EXTENSION_NAME)) return false;
+
+	// The bindless shader is only embedded when the build found a shader compiler, see src/CMakeLists.txt
+	if (!HasShader(BINDLESS_FRAGMENT_SHADER))
+	{
+		fprintf(stdout, "[INFO] '%s' not embedded, bindless textures disabled\n", BINDLESS_FRAGMENT_SHADER);
+		return false;
+	}
+
+	auto getFeatures2   = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+			vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2KHR"));
+	auto getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(
+			vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2KHR"));
+	if (getFeatures2 == nullptr || getProperties2 == nullptr) return false;
+
+	/* ----------------------------------------- FEATURES ----------------------------------------- */
+
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT
+	};
+	VkPhysicalDeviceFeatures2KHR features =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR,
+		.pNext = &indexingFeatures
+	};
+	getFeatures2(device, &features);
+
+	if (!features.features.shaderSampledImageArrayDynamicIndexing ||
+	    !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind ||
+	    !indexingFeatures.descriptorBindingPartiallyBound ||
+	    !indexingFeatures.runtimeDescriptorArray) return false;
+
+	/* ----------------------------------------- LIMITS ----------------------------------------- */
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT
+	};
+	VkPhysicalDeviceProperties2KHR properties =
+	{
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR,
+		.pNext = &indexingProperties
+	};
+	getProperties2(device, &properties);
+
+	// Combined image samplers count against both the sampler and the sampled image limits
+	*outCapacity = std::min({ BINDLESS_MAX_TEXTURES,
+	                          indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+	                          indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+	                          indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+	                          indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+	return *outCapacity > 0;
+}
+
 // TODO: Cache the queue families
 queueFamilyIndices_t
 VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device)
@@ -1934,8 +2676,10 @@ VulkanRenderer::GetQueueFamilies(VkPhysicalDevice device)
 
 		// Check queueFamily presentation
 		// Is the surface presentation supported on this device for this queue family?
+		// Headless nothing is presented, the graphics family stands in for it
 		VkBool32 vbPresentationSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &vbPresentationSupport);
+		if (m_bHeadless) vbPresentationSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		else vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &vbPresentationSupport);
 		if (queueFamily.queueCount > 0 && vbPresentationSupport)
 		{
 			indices.presentationFamily = i;
@@ -1994,39 +2738,153 @@ VulkanRenderer::ChooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &I
 		return { VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
 	}
 
-	// If the surface has a preferred format, then return it
+	// Prefer an sRGB format, so sRGB textures are encoded back on write
 	for (const auto &format : InFormats)
 	{
-		if ( ( format.format == VK_FORMAT_R8G8B8A8_UNORM || format.format == VK_FORMAT_B8G8R8A8_UNORM ) &&
+		if ( ( format.format == VK_FORMAT_R8G8B8A8_SRGB || format.format == VK_FORMAT_B8G8R8A8_SRGB ) &&
 			format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR )
 		{
 			return format;
 		}
 	}
 
-	// First available
-	return InFormats[0];
-}
-
-VkPresentModeKHR
+	// If the surface has a preferred format, then return it
+	for (const auto &format : InFormats)
+	{
+		if ( ( format.format == VK_FORMAT_R8G8B8A8_UNORM || format.format == VK_FORMAT_B8G8R8A8_UNORM ) &&
+			format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR )
+		{
+			return format;
+		}
+	}
+
+	// First available
+	return InFormats[0];
+}
+
+VkPresentModeKHR
 VulkanRenderer::ChooseBestPresentationMode(const std::vector<VkPresentModeKHR> &InPresentationModes)
 {
-	// Look for mailbox presentation mode
-	// Mailbox is the lowest latency V-Sync enabled mode (something like triple buffering)
+	// Look for the requested presentation mode
+	// Mailbox is the lowest latency V-Sync enabled mode (something like triple buffering), the default
+	const VkPresentModeKHR requestedMode = m_requestedPresentMode.load(std::memory_order_relaxed);
 	for (const auto &presentationMode : InPresentationModes)
 	{
-		if (presentationMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (presentationMode == requestedMode)
 		{
 			return presentationMode;
 		}
 	}
 
+	fprintf(stdout, "[INFO] Present mode %s is not supported by the surface, using fifo\n", GetPresentModeName(requestedMode));
+
 	// If not found, use FIFO as it is always available
 	// FIFO is the only mode that is guaranteed to be available
 	// 		is the equivalent of V-Sync (something like double buffering)
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+void
+VulkanRenderer::RecordPresent()
+{
+	const auto now = std::chrono::steady_clock::now();
+	if (m_lastPresentTime != std::chrono::steady_clock::time_point { })
+	{
+		const double intervalMs = std::chrono::duration<double, std::milli>(now - m_lastPresentTime).count();
+
+		m_presentStats.minIntervalMs    = m_presentStats.intervals == 0 ? intervalMs : std::min(m_presentStats.minIntervalMs, intervalMs);
+		m_presentStats.maxIntervalMs    = std::max(m_presentStats.maxIntervalMs, intervalMs);
+		m_presentStats.totalIntervalMs += intervalMs;
+		m_presentStats.lastIntervalMs   = intervalMs;
+		++m_presentStats.intervals;
+	}
+	m_lastPresentTime = now;
+
+	// Frames the GPU has not finished yet, the one just submitted included. A poll, nothing waits
+	const uint64_t completed  = m_graphicsTimeline.GetCompletedValue();
+	uint32_t       queueDepth = 0;
+	for (const auto &value : m_frameTimelineValues)
+	{
+		if (value > completed) ++queueDepth;
+	}
+
+	m_presentStats.totalQueueDepth += queueDepth;
+	m_presentStats.maxQueueDepth    = std::max(m_presentStats.maxQueueDepth, queueDepth);
+	++m_presentStats.presents;
+}
+
+overlayStats_t
+VulkanRenderer::GetFrameStats()
+{
+	overlayStats_t stats =
+	{
+		.draws         = m_drawStats,
+		.uniformBytes  = static_cast<VkDeviceSize>(m_framesInFlight) * sizeof(ubo_view_proj_t),
+		.stagingBytes  = m_textureStagingRing.GetCapacity(),
+		.stagingUsed   = m_textureStagingRing.GetUsedBytes(),
+		.pipelineCache = m_pipelineCache.GetStats(),
+		.pipelines     = m_pipelines.GetStats(),
+		.residency     = GetTextureResidencyStats()
+	};
+	stats.textureBytes = stats.residency.residentBytes;
+
+	// Instances share the buffers of their mesh
+	for (const Mesh &mesh : m_meshList)
+	{
+		if (!mesh.OwnsBuffers()) continue;
+		stats.meshBytes += static_cast<VkDeviceSize>(mesh.GetVertexCount()) * sizeof(vertex_t) +
+		                   static_cast<VkDeviceSize>(mesh.GetIndexCount()) * sizeof(uint32_t);
+	}
+
+	VkMemoryRequirements depthRequirements;
+	vkGetImageMemoryRequirements(m_mainDevice.logicalDevice, m_depthBufferImage, &depthRequirements);
+	stats.depthBytes = depthRequirements.size;
+
+	return stats;
+}
+
+void
+VulkanRenderer::PrintPresentStats() const
+{
+	const presentStats_t &stats = m_presentStats;
+	if (stats.presents == 0) return;
+
+	const double averageMs = stats.intervals ? stats.totalIntervalMs / static_cast<double>(stats.intervals) : 0.0;
+	fprintf(stdout, "[INFO] Presents with %s, %u images: %llu presents, interval avg %.3f ms (min %.3f, max %.3f), "
+	                "GPU queue depth avg %.2f (max %u)\n",
+			GetPresentModeName(stats.presentMode), stats.imageCount, static_cast<unsigned long long>(stats.presents),
+			averageMs, stats.minIntervalMs, stats.maxIntervalMs,
+			static_cast<double>(stats.totalQueueDepth) / static_cast<double>(stats.presents), stats.maxQueueDepth);
+}
+
+const char *
+VulkanRenderer::GetPresentModeName(VkPresentModeKHR presentMode)
+{
+	switch (presentMode)
+	{
+		case VK_PRESENT_MODE_IMMEDIATE_KHR:    return "immediate";
+		case VK_PRESENT_MODE_MAILBOX_KHR:      return "mailbox";
+		case VK_PRESENT_MODE_FIFO_KHR:         return "fifo";
+		case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+		default:                               return "unknown";
+	}
+}
+
+bool
+VulkanRenderer::ParsePresentMode(const std::string &name, VkPresentModeKHR *outPresentMode)
+{
+	for (const VkPresentModeKHR presentMode : { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+	                                            VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR })
+	{
+		if (name != GetPresentModeName(presentMode)) continue;
+
+		*outPresentMode = presentMode;
+		return true;
+	}
+
+	return false;
+}
+
 VkExtent2D
 VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &InSurfaceCapabilities)
 {
@@ -2039,7 +2897,7 @@ VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &InSurfaceCapabi
 	{
 		// Set the size of the window to the size of the surface
 		int width, height;
-		glfwGetFramebufferSize(m_window, &width, &height);
+		GetFramebufferSize(&width, &height);
 
 		VkExtent2D actualExtent =
 		{
@@ -2082,7 +2940,8 @@ VulkanRenderer::ChooseSupportedFormat(const std::vector<VkFormat> &InFormats,
 
 
 VkImageView
-VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) const
+VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+                                uint32_t baseMipLevel, uint32_t levelCount) const
 {
 	// Create an image view for the image
 	VkImageViewCreateInfo viewInfo =
@@ -2091,19 +2950,12 @@ VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFla
 		.image            = image,                                        // Image to create view for
 		.viewType         = VK_IMAGE_VIEW_TYPE_2D,                        // Type of image (1D, 2D, 3D, Cube, etc)
 		.format           = format,                                       // Format of the image data
-		.components       =                                               // Allows for swizzling of the color channels
-		{
-			// some_image.rgba = some_image.bgra
-			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
-			.a = VK_COMPONENT_SWIZZLE_IDENTITY
-		},
+		.components       = GetFormatSwizzle(format),                     // Allows for swizzling of the color channels, grey textures to RGB
 		.subresourceRange =                                               // What part of the image to view
 		{
 			.aspectMask     = aspectFlags,                            // Which aspect of the image to view (e.g. COLOR_BIT for viewing color)
-			.baseMipLevel   = 0,                                      // Start mipmap level to view from
-			.levelCount     = 1,                                      // Number of mipmap levels to view
+			.baseMipLevel   = baseMipLevel,                           // Start mipmap level to view from
+			.levelCount     = levelCount,                             // Number of mipmap levels to view
 			.baseArrayLayer = 0,                                      // Start array level to view from
 			.layerCount     = 1                                       // Number of array levels to view
 		}
@@ -2117,28 +2969,10 @@ VulkanRenderer::CreateImageView(VkImage image, VkFormat format, VkImageAspectFla
 	return imageView;
 }
 
-VkShaderModule
-VulkanRenderer::CreateShaderModule(const std::vector<char> &code) const
-{
-	// Shader module creation info
-	VkShaderModuleCreateInfo createInfo =
-	{
-		.sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-		.codeSize = code.size(),
-		.pCode    = reinterpret_cast<const uint32_t *> ( code.data() )
-	};
-
-	// Create shader module
-	VkShaderModule shaderModule;
-	VK_CHECK(vkCreateShaderModule(m_mainDevice.logicalDevice, &createInfo, nullptr, &shaderModule),
-			 "Failed to create a shader module!");
-
-	return shaderModule;
-}
-
 VkImage
 VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-							VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory *imageMemory) const
+							VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceMemory *imageMemory,
+							uint32_t mipLevels) const
 {
 	// ------------------------------------------------ Create Image ---------------------------------------------------
 
@@ -2155,7 +2989,7 @@ VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, Vk
 				.height = height,                          // Height of the image extent
 				.depth = 1                                 // 2D image, so depth must be 1 (no 3D aspect)
 			},
-		.mipLevels     = 1,                                // Number of mip levels
+		.mipLevels     = mipLevels,                        // Number of mip levels
 		.arrayLayers   = 1,                                // Number of layers (Used for multi-layer images, like stereoscopic 3D or cube maps)
 		.samples       = VK_SAMPLE_COUNT_1_BIT,            // Number of samples for multi-sampling
 		.tiling        = tiling,                           // How the data should be tiled
@@ -2192,83 +3026,32 @@ VulkanRenderer::CreateImage(uint32_t width, uint32_t height, VkFormat format, Vk
 }
 
 int
-VulkanRenderer::CreateTextureImage(std::string fileName)
+VulkanRenderer::CreateTexture(std::string fileName)
 {
-  int width, height;
-  VkDeviceSize imageSize;
-  
-  stbi_uc *imageData = LoadTextureFile(fileName, &width, &height, &imageSize);
-
-  // Create stagind buffer to hold loaded data to copy to device
-  VkBuffer imageStagingBuffer;
-  VkDeviceMemory imageStagingBufferMemory;
-  CreateBuffer(m_mainDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-               &imageStagingBuffer, &imageStagingBufferMemory);
-
-  // Copy image data to staging buffer
-  void *data;
-  vkMapMemory(m_mainDevice.logicalDevice, imageStagingBufferMemory, 0, imageSize, 0, &data);
-  memcpy(data, imageData, static_cast<size_t>(imageSize));
-  vkUnmapMemory(m_mainDevice.logicalDevice, imageStagingBufferMemory);
-
-  // Free image data
-  stbi_image_free(imageData);
-
-  // Create image
-  VkDeviceMemory texImageMemory;
-  VkImage texImage = CreateImage(width, height, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, 
-                         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory);
-
-  // -- TRANSITION IMAGE LAYOUT --
-  TransitionImageLayout(m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool, texImage,
-                        VK_IMAGE_LAYOUT_UNDEFINED,             // Old layout
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL   // New layout
-  );
-
-
-    // -- COPY IMAGE DATA --
-    CopyImageBuffer(m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool, imageStagingBuffer, texImage, width, height);
-
-
-  // Transition image to shader read layout
-  TransitionImageLayout(m_mainDevice.logicalDevice, m_graphicsQueue, m_graphicsCommandPool, texImage,
-                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,    // Old layout
-                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL // New layout
-  );
+  TextureHandle handle = CreateTextureAsync(fileName);
 
-  // Add texture data to Vector
-  m_textureImages.push_back(texImage);
-  m_textureImageMemory.push_back(texImageMemory);
+  // Run the decode and upload right away
+  WaitForTextures();
 
-  // Destroy staging buffers
-  vkDestroyBuffer(m_mainDevice.logicalDevice, imageStagingBuffer, nullptr);
-  vkFreeMemory(m_mainDevice.logicalDevice, imageStagingBufferMemory, nullptr);
+  if (m_textureStates[handle] == TEXTURE_STATE_FAILED) throw std::runtime_error("Failed to create Texture: '" + fileName + "'");
 
-  return m_textureImages.size() - 1;
+  return handle;
 }
 
 int
-VulkanRenderer::CreateTexture(std::string fileName)
+VulkanRenderer::CreateTextureDescriptor(VkImageView textureImage)
 {
-  // Create a texture image and get the index
-  int texID = CreateTextureImage(fileName);
-
-  // Create image view and add to list
-  VkImageView imageView = CreateImageView(m_textureImages[texID], VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-  m_textureImageViews.push_back(imageView);
+  // Bindless: hand out the next slot of the array
+  if (m_bBindlessTextures)
+  {
+    if (m_bindlessTextureCount >= m_bindlessCapacity) throw std::runtime_error("Out of bindless texture slots!");
 
-  // Create texture descriptor
-  int descriptorIndex = CreateTextureDescriptor(imageView);
+    const uint32_t slot = m_bindlessTextureCount++;
+    if (textureImage != VK_NULL_HANDLE) WriteTextureDescriptor(m_bindlessDescriptorSet, textureImage, slot);
 
-  // Return descriptor index
-  return descriptorIndex;
-}
+    return static_cast<int>(slot);
+  }
 
-int
-VulkanRenderer::CreateTextureDescriptor(VkImageView textureImage)
-{
   VkDescriptorSet descriptorSet;
   VkDescriptorSetAllocateInfo setAllocInfo =
   {
@@ -2281,6 +3064,18 @@ VulkanRenderer::CreateTextureDescriptor(VkImageView textureImage)
   VK_CHECK(vkAllocateDescriptorSets(m_mainDevice.logicalDevice, &setAllocInfo, &descriptorSet),
            "Failed to allocate Texture Descriptor Set!");
 
+  // Textures still loading get their view written once it exists
+  if (textureImage != VK_NULL_HANDLE) WriteTextureDescriptor(descriptorSet, textureImage);
+
+  // Add descriptor set to list
+  m_samplerDescriptorSets.push_back(descriptorSet);
+
+  return m_samplerDescriptorSets.size() - 1;
+}
+
+void
+VulkanRenderer::WriteTextureDescriptor(VkDescriptorSet descriptorSet, VkImageView textureImage, uint32_t arrayElement)
+{
   // Texture Image Info
   VkDescriptorImageInfo imageInfo =
   {
@@ -2294,37 +3089,1063 @@ VulkanRenderer::CreateTextureDescriptor(VkImageView textureImage)
     .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
     .dstSet          = descriptorSet,
     .dstBinding      = 0,                                            // Binding to write to (as mentioned before, for sampler, it is 0, with set 1)
-    .dstArrayElement = 0,
+    .dstArrayElement = arrayElement,                                 // Slot of the bindless array, 0 otherwise
     .descriptorCount = 1,
     .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
     .pImageInfo      = &imageInfo
   };
 
-  // Update new descriptor set
+  // Update descriptor set
   vkUpdateDescriptorSets(m_mainDevice.logicalDevice, 1, &textureWrite, 0, nullptr);
+}
 
-  // Add descriptor set to list
-  m_samplerDescriptorSets.push_back(descriptorSet);
+void
+VulkanRenderer::WriteTextureSlot(int descriptorIndex, VkImageView textureImage)
+{
+  if (m_bBindlessTextures) WriteTextureDescriptor(m_bindlessDescriptorSet, textureImage, static_cast<uint32_t>(descriptorIndex));
+  else                     WriteTextureDescriptor(m_samplerDescriptorSets[descriptorIndex], textureImage);
+}
 
-  return m_samplerDescriptorSets.size() - 1;
+TextureHandle
+VulkanRenderer::CreateTextureAsync(const std::string &fileName, textureUsage_e usage)
+{
+  /* ----------------------------------------- CACHE LOOKUP ----------------------------------------- */
+
+  // "a/../b.png" and "b.png" are the same file
+  const std::string pathKey = std::filesystem::path(fileName).lexically_normal().generic_string();
+
+  if (auto cached = m_texturePathCache.find(pathKey); cached != m_texturePathCache.end())
+  {
+    textureCacheEntry_t &entry = m_textureCacheEntries[cached->second];
+    ++entry.refCount;
+    ++entry.cacheHits;
+    ++m_textureCacheStats.hits;
+
+    return cached->second;
+  }
+
+  // Only a stat on a miss: the file is read here only to compare it with live textures of the same size, the worker
+  // then decodes these bytes instead of reading the file again
+  std::vector<char> fileData;
+  uintmax_t fileSize = 0;
+
+  if constexpr (TEXTURE_CACHE_BY_CONTENT)
+  {
+    // Missing file: the worker reports it and flags the texture as failed
+    std::error_code error;
+    fileSize = std::filesystem::file_size(TEXTURE_DIRECTORY + fileName, error);
+    if (error) fileSize = 0;
+
+    const TextureHandle match = fileSize != 0 ? FindTextureByContent(fileName, fileSize, &fileData) : -1;
+    if (match >= 0)
+    {
+      textureCacheEntry_t &entry = m_textureCacheEntries[match];
+      ++entry.refCount;
+      ++entry.cacheHits;
+      ++m_textureCacheStats.hits;
+      ++m_textureCacheStats.contentHits;
+
+      // Next requests with this path hit the path lookup
+      entry.pathKeys.push_back(pathKey);
+      m_texturePathCache.emplace(pathKey, match);
+
+      return match;
+    }
+  }
+
+  ++m_textureCacheStats.misses;
+
+  /* ----------------------------------------- RESERVE HANDLE ----------------------------------------- */
+
+  TextureHandle handle;
+  if (!m_freeTextureHandles.empty())
+  {
+    // Reuse a destroyed texture slot, its descriptor sets are no longer bound
+    handle = m_freeTextureHandles.back();
+    m_freeTextureHandles.pop_back();
+  }
+  else
+  {
+    handle = static_cast<TextureHandle>(m_textureImages.size());
+
+    // Keep the texture lists indexed by handle
+    m_textureImages.push_back(VK_NULL_HANDLE);
+    m_textureImageMemory.push_back(VK_NULL_HANDLE);
+    m_textureImageViews.push_back(VK_NULL_HANDLE);
+    m_textureStates.push_back(TEXTURE_STATE_PENDING);
+    m_textureCacheEntries.emplace_back();
+
+    // Reserve the descriptor sets now, so the handle can be handed to meshes before the texture exists
+    m_textureResidency.push_back(
+    {
+      .fullDescriptor     = CreateTextureDescriptor(VK_NULL_HANDLE),
+      .fallbackDescriptor = CreateTextureDescriptor(VK_NULL_HANDLE),
+      .spareDescriptor    = CreateTextureDescriptor(VK_NULL_HANDLE)
+    });
+  }
+
+  // Keep the descriptors of a reused handle
+  textureResidency_t &residency = m_textureResidency[handle];
+  residency =
+  {
+    .fullDescriptor     = residency.fullDescriptor,
+    .fallbackDescriptor = residency.fallbackDescriptor,
+    .spareDescriptor    = residency.spareDescriptor,
+    .fileName           = fileName,
+    .usage              = usage
+  };
+
+  m_textureStates[handle]       = TEXTURE_STATE_PENDING;
+  m_textureCacheEntries[handle] =
+  {
+    .pathKeys    = { pathKey },
+    .fileSize    = fileSize,
+    .contentHash = fileData.empty() ? 0 : HashFNV1a(fileData.data(), fileData.size()),
+    .refCount    = 1
+  };
+
+  m_texturePathCache.emplace(pathKey, handle);
+  if (fileSize != 0) m_textureContentCache.emplace(fileSize, handle);
+
+  ++m_pendingTextureCount;
+
+  m_textureWorkers->Enqueue([this, handle, fileName, usage, fileData = std::move(fileData)]() mutable -> void
+  {
+    DecodeTexture(handle, fileName, usage, std::move(fileData));
+  });
+
+  return handle;
+}
+
+void
+VulkanRenderer::ReleaseTexture(TextureHandle handle)
+{
+  if (handle < 0 || handle >= static_cast<TextureHandle>(m_textureCacheEntries.size())) return;
+
+  textureCacheEntry_t &entry = m_textureCacheEntries[handle];
+  if (entry.refCount == 0 || --entry.refCount > 0) return;
+
+  ForgetCachedTexture(handle);
+
+  // Still loading, destroyed once its upload batch is done
+  if (m_textureStates[handle] == TEXTURE_STATE_PENDING || m_textureResidency[handle].bUploading) return;
+
+  DestroyTexture(handle);
+}
+
+textureCacheStats_t
+VulkanRenderer::GetTextureCacheStats() const
+{
+  textureCacheStats_t stats = m_textureCacheStats;
+
+  // Add the savings of the live textures to the ones of the destroyed textures
+  for (const auto &entry : m_textureCacheEntries)
+  {
+    if (entry.refCount == 0) continue;
+
+    ++stats.liveTextures;
+    stats.bytesSaved += entry.cacheHits * entry.byteSize;
+    stats.msSaved    += static_cast<float>(entry.cacheHits) * entry.decodeMs;
+  }
+
+  return stats;
+}
+
+void
+VulkanRenderer::CountTextureFormat(const textureMipChain_t &chain)
+{
+  switch (GetFormatChannels(chain.format))
+  {
+    case 1:  ++m_textureFormatStats.r8Textures;    break;
+    case 2:  ++m_textureFormatStats.r8g8Textures;  break;
+    default: ++m_textureFormatStats.rgba8Textures; break;
+  }
+
+  if (IsSRGBFormat(chain.format)) ++m_textureFormatStats.srgbTextures;
+
+  for (const auto &level : chain.levels)
+  {
+    m_textureFormatStats.bytes      += level.size;
+    m_textureFormatStats.rgba8Bytes += static_cast<VkDeviceSize>(level.width) * level.height * 4;
+  }
+}
+
+bool
+VulkanRenderer::CreateTextureAtlas(const std::string &atlasName, const std::vector<std::string> &fileNames)
+{
+  TextureAtlas atlas;
+  if (!atlas.Build(atlasName, fileNames)) return false;
+
+  // Pages load as cooked textures, their source never exists
+  std::vector<TextureHandle> pages(atlas.GetPageCount());
+  for (uint32_t page = 0; page < atlas.GetPageCount(); ++page)
+  {
+    pages[page] = CreateTextureAsync(TextureAtlas::GetPageName(atlasName, page));
+  }
+
+  for (const auto &fileName : fileNames)
+  {
+    atlasRegion_t region;
+    if (!atlas.FindRegion(fileName, &region)) continue;
+
+    region.texture = pages[region.page];
+    m_atlasRegions[std::filesystem::path(fileName).lexically_normal().generic_string()] = region;
+  }
+
+  atlas.PrintStats(atlasName);
+  return true;
+}
+
+bool
+VulkanRenderer::GetAtlasRegion(const std::string &fileName, atlasRegion_t *outRegion) const
+{
+  auto found = m_atlasRegions.find(std::filesystem::path(fileName).lexically_normal().generic_string());
+  if (found == m_atlasRegions.end()) return false;
+
+  *outRegion = found->second;
+  return true;
+}
+
+TextureHandle
+VulkanRenderer::FindTextureByContent(const std::string &fileName, uintmax_t fileSize, std::vector<char> *outFileData)
+{
+  const auto [first, last] = m_textureContentCache.equal_range(fileSize);
+  if (first == last) return -1;
+
+  try
+  {
+    *outFileData = ReadFile(TEXTURE_DIRECTORY + fileName);
+  }
+  catch (const std::runtime_error &)
+  {
+    return -1;
+  }
+  const uint64_t hash = HashFNV1a(outFileData->data(), outFileData->size());
+
+  for (auto cached = first; cached != last; ++cached)
+  {
+    textureCacheEntry_t &entry = m_textureCacheEntries[cached->second];
+    const std::string   &path  = TEXTURE_DIRECTORY + m_textureResidency[cached->second].fileName;
+
+    // The texture was never compared yet, hash its file once
+    std::vector<char> cachedData;
+    try
+    {
+      if (entry.contentHash == 0)
+      {
+        cachedData        = ReadFile(path);
+        entry.contentHash = HashFNV1a(cachedData.data(), cachedData.size());
+      }
+      if (entry.contentHash != hash) continue;
+
+      // Same hash: compare the bytes, a collision must not make two textures one
+      if (cachedData.empty()) cachedData = ReadFile(path);
+    }
+    catch (const std::runtime_error &)
+    {
+      continue;
+    }
+
+    if (cachedData == *outFileData) return cached->second;
+  }
+
+  return -1;
+}
+
+void
+VulkanRenderer::ForgetCachedTexture(TextureHandle handle)
+{
+  textureCacheEntry_t &entry = m_textureCacheEntries[handle];
+
+  // Only erase the keys still pointing to this texture, a failed path may have been requested again since
+  for (const auto &pathKey : entry.pathKeys)
+  {
+    auto cached = m_texturePathCache.find(pathKey);
+    if (cached != m_texturePathCache.end() && cached->second == handle) m_texturePathCache.erase(cached);
+  }
+
+  const auto [first, last] = m_textureContentCache.equal_range(entry.fileSize);
+  for (auto cached = first; cached != last; ++cached)
+  {
+    if (cached->second != handle) continue;
+
+    m_textureContentCache.erase(cached);
+    break;
+  }
+
+  entry.pathKeys.clear();
+  entry.fileSize    = 0;
+  entry.contentHash = 0;
+}
+
+void
+VulkanRenderer::DestroyTexture(TextureHandle handle)
+{
+  textureCacheEntry_t &entry = m_textureCacheEntries[handle];
+
+  // Keep the savings of the texture in the totals
+  m_textureCacheStats.bytesSaved += entry.cacheHits * entry.byteSize;
+  m_textureCacheStats.msSaved    += static_cast<float>(entry.cacheHits) * entry.decodeMs;
+  entry = {};
+
+  VkImageView    imageView = m_textureImageViews[handle];
+  VkImage        image     = m_textureImages[handle];
+  VkDeviceMemory memory    = m_textureImageMemory[handle];
+
+  m_textureImageViews[handle]  = VK_NULL_HANDLE;
+  m_textureImages[handle]      = VK_NULL_HANDLE;
+  m_textureImageMemory[handle] = VK_NULL_HANDLE;
+  m_textureStates[handle]      = TEXTURE_STATE_RELEASED;
+
+  textureResidency_t &residency = m_textureResidency[handle];
+  if (residency.bResident) m_residentTextureBytes -= residency.fullBytes;
+  m_residentTextureBytes -= residency.fallbackBytes;
+
+  VkImageView    fallbackView   = residency.fallbackView;
+  VkImage        fallbackImage  = residency.fallbackImage;
+  VkDeviceMemory fallbackMemory = residency.fallbackMemory;
+
+  // Keep the descriptors for the next texture using the handle
+  residency =
+  {
+    .fullDescriptor     = residency.fullDescriptor,
+    .fallbackDescriptor = residency.fallbackDescriptor,
+    .spareDescriptor    = residency.spareDescriptor
+  };
+
+  // Command buffers of the frames in flight may still sample it
+  m_frameDeletionQueue.push_function(m_graphicsTimeline.GetNextValue(), [=, this]() -> void
+  {
+    vkDestroyImageView(m_mainDevice.logicalDevice, imageView, nullptr);
+    vkDestroyImage(m_mainDevice.logicalDevice, image, nullptr);
+    vkFreeMemory(m_mainDevice.logicalDevice, memory, nullptr);
+
+    vkDestroyImageView(m_mainDevice.logicalDevice, fallbackView, nullptr);
+    vkDestroyImage(m_mainDevice.logicalDevice, fallbackImage, nullptr);
+    vkFreeMemory(m_mainDevice.logicalDevice, fallbackMemory, nullptr);
+
+    m_freeTextureHandles.push_back(handle);
+  });
+}
+
+textureResidencyStats_t
+VulkanRenderer::GetTextureResidencyStats() const
+{
+  textureResidencyStats_t stats = m_textureResidencyStats;
+  stats.residentBytes = m_residentTextureBytes;
+
+  for (size_t i = 0; i < m_textureResidency.size(); ++i)
+  {
+    if (m_textureStates[i] != TEXTURE_STATE_READY) continue;
+
+    const textureResidency_t &residency = m_textureResidency[i];
+    stats.fallbackBytes += residency.fallbackBytes;
+
+    if (residency.bResident) ++stats.residentTextures;
+    else                     ++stats.evictedTextures;
+  }
+
+  if (stats.streamIns > 0) stats.averageStreamInMs = m_streamInTotalMs / static_cast<float>(stats.streamIns);
+
+  return stats;
+}
+
+void
+VulkanRenderer::UpdateTextureResidency()
+{
+  /* ----------------------------------------- STREAM IN ----------------------------------------- */
+
+  // Evicted textures drawn last frame come back at full resolution
+  for (size_t i = 0; i < m_textureResidency.size(); ++i)
+  {
+    const textureResidency_t &residency = m_textureResidency[i];
+    if (m_textureStates[i] != TEXTURE_STATE_READY) continue;
+    if (residency.bResident || residency.bStreaming || residency.bStreamFailed) continue;
+    if (residency.lastUsedFrame + 1 < m_frameNumber) continue;
+
+    StreamInTexture(static_cast<TextureHandle>(i));
+  }
+
+  /* ----------------------------------------- EVICT ----------------------------------------- */
+
+  // The heap budget query goes to the driver, only ask again when the textures could reach it
+  const bool bNearBudget = m_residentTextureBytes > m_textureBudget - m_textureBudget / 8;
+  if (bNearBudget || m_frameNumber >= m_textureBudgetFrame)
+  {
+    m_textureBudget      = GetEffectiveTextureBudget();
+    m_textureBudgetFrame = m_frameNumber + TEXTURE_BUDGET_QUERY_FRAMES;
+  }
+  m_textureResidencyStats.budgetBytes = m_textureBudget;
+
+  if (m_residentTextureBytes <= m_textureBudget) return;
+
+  // Textures no frame in flight samples, least recently drawn first
+  std::vector<TextureHandle> candidates;
+  for (size_t i = 0; i < m_textureResidency.size(); ++i)
+  {
+    const textureResidency_t &residency = m_textureResidency[i];
+    if (m_textureStates[i] != TEXTURE_STATE_READY || !residency.bResident || residency.bStreaming || residency.bUploading) continue;
+    if (!m_graphicsTimeline.IsComplete(residency.lastUsedValue)) continue;
+
+    // Small textures are their own fallback, nothing to save
+    if (residency.tailMip == 0) continue;
+
+    candidates.push_back(static_cast<TextureHandle>(i));
+  }
+
+  std::ranges::sort(candidates, { }, [this](TextureHandle handle) -> uint64_t { return m_textureResidency[handle].lastUsedFrame; });
+
+  // Once they are all gone the rest is in use, stay over budget for now
+  for (TextureHandle victim : candidates)
+  {
+    if (m_residentTextureBytes <= m_textureBudget) break;
+    EvictTexture(victim);
+  }
+}
+
+void
+VulkanRenderer::StreamInTexture(TextureHandle handle)
+{
+  textureResidency_t &residency = m_textureResidency[handle];
+  residency.bStreaming        = true;
+  residency.bUploading        = true;
+  residency.streamRequestTime = std::chrono::steady_clock::now();
+
+  ++m_pendingTextureCount;
+
+  m_textureWorkers->Enqueue([this, handle, fileName = residency.fileName, usage = residency.usage]() -> void
+  {
+    DecodeTexture(handle, fileName, usage, {}, true);
+  });
+}
+
+void
+VulkanRenderer::EvictTexture(TextureHandle handle)
+{
+  textureResidency_t &residency = m_textureResidency[handle];
+  residency.bResident = false;
+  residency.mipChain.reset();
+
+  m_residentTextureBytes -= residency.fullBytes;
+  ++m_textureResidencyStats.evictions;
+
+  VkImageView    imageView = m_textureImageViews[handle];
+  VkImage        image     = m_textureImages[handle];
+  VkDeviceMemory memory    = m_textureImageMemory[handle];
+
+  m_textureImageViews[handle]  = VK_NULL_HANDLE;
+  m_textureImages[handle]      = VK_NULL_HANDLE;
+  m_textureImageMemory[handle] = VK_NULL_HANDLE;
+
+  // Draws switch to the low resolution copy from now on, older frames may still sample the full image
+  m_frameDeletionQueue.push_function(m_graphicsTimeline.GetNextValue(), [this, imageView, image, memory]() -> void
+  {
+    vkDestroyImageView(m_mainDevice.logicalDevice, imageView, nullptr);
+    vkDestroyImage(m_mainDevice.logicalDevice, image, nullptr);
+    vkFreeMemory(m_mainDevice.logicalDevice, memory, nullptr);
+  });
+}
+
+VkDeviceSize
+VulkanRenderer::GetEffectiveTextureBudget() const
+{
+  if (!m_bMemoryBudget) return m_textureMemoryBudget;
+
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties =
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT
+  };
+  VkPhysicalDeviceMemoryProperties2KHR memoryProperties =
+  {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR,
+    .pNext = &budgetProperties
+  };
+  m_vkGetPhysicalDeviceMemoryProperties2(m_mainDevice.physicalDevice, &memoryProperties);
+
+  // Textures live in the largest device local heap
+  uint32_t heapIndex = 0;
+  for (uint32_t i = 0; i < memoryProperties.memoryProperties.memoryHeapCount; ++i)
+  {
+    const VkMemoryHeap &heap = memoryProperties.memoryProperties.memoryHeaps[i];
+    if (( heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ) == 0) continue;
+
+    if (heap.size > memoryProperties.memoryProperties.memoryHeaps[heapIndex].size ||
+        ( memoryProperties.memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT ) == 0)
+    {
+      heapIndex = i;
+    }
+  }
+
+  // What the heap can hold, minus what is used by anything but the textures
+  const VkDeviceSize heapBudget = budgetProperties.heapBudget[heapIndex];
+  const VkDeviceSize heapUsage  = budgetProperties.heapUsage[heapIndex];
+  const VkDeviceSize otherUsage = heapUsage > m_residentTextureBytes ? heapUsage - m_residentTextureBytes : 0;
+  const VkDeviceSize available  = heapBudget > otherUsage ? heapBudget - otherUsage : 0;
+
+  return std::min(m_textureMemoryBudget, available);
+}
+
+void
+VulkanRenderer::WaitForTextures()
+{
+  while (m_pendingTextureCount > 0)
+  {
+    ProcessTextureUploads();
+    if (m_pendingTextureCount == 0) break;
+
+    // Wait on the oldest batch first, finishing it gives staging space back to the workers
+    if (!m_textureUploadBatches.empty())
+    {
+      m_graphicsTimeline.Wait(m_textureUploadBatches.front().timelineValue);
+      continue;
+    }
+
+    // Nothing in flight, everything left is on the workers
+    std::unique_lock<std::mutex> lock(m_decodedTexturesMutex);
+    m_decodedTexturesReady.wait(lock, [this]() -> bool { return !m_decodedTextures.empty(); });
+  }
+}
+
+void
+VulkanRenderer::DecodeTexture(TextureHandle handle, std::string fileName, textureUsage_e usage, std::vector<char> fileData,
+                              bool bStreamIn)
+{
+  textureDecode_t decoded { .handle = handle, .bStreamIn = bStreamIn };
+
+  try
+  {
+    PROFILE_SCOPE("DecodeTexture");
+    const auto decodeStart = std::chrono::steady_clock::now();
+
+    auto mipChain = std::make_shared<textureMipChain_t>();
+    LoadTextureMips(fileName, usage, fileData, mipChain.get());
+
+    decoded.decodeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+
+    decoded.width  = mipChain->width;
+    decoded.height = mipChain->height;
+
+    // Only the mip tail goes up with the first batch, the larger levels are streamed over the next frames
+    decoded.firstMip = GetMipTailLevel(*mipChain);
+    decoded.mipCount = static_cast<uint32_t>(mipChain->levels.size()) - decoded.firstMip;
+
+    // Smallest level first, so the tail is one range at the start of the pixels
+    const textureMipLevel_t &tailTop  = mipChain->levels[decoded.firstMip];
+    const VkDeviceSize       tailSize = tailTop.offset + tailTop.size;
+
+    // Offsets aligned to 16 satisfy the buffer to image copy rules (multiple of 4 and of the texel size)
+    if (!m_textureStagingRing.Allocate(tailSize, 16, &decoded.staging))
+    {
+      // Bigger than the whole ring, use a staging buffer of its own
+      CreateDedicatedStaging(tailSize, &decoded);
+    }
+
+    // Copy image data to staging memory
+    memcpy(decoded.staging.mapped, mipChain->pixels.data(), static_cast<size_t>(tailSize));
+
+    if (decoded.dedicatedMemory != VK_NULL_HANDLE) vkUnmapMemory(m_mainDevice.logicalDevice, decoded.dedicatedMemory);
+
+    decoded.mipChain = std::move(mipChain);
+  }
+  catch (const std::runtime_error &e)
+  {
+    fprintf(stderr, "[ERROR] %s\n", e.what());
+    decoded.bFailed = true;
+  }
+
+  // Hand over to the upload batcher
+  {
+    std::lock_guard<std::mutex> lock(m_decodedTexturesMutex);
+    m_decodedTextures.push_back(std::move(decoded));
+  }
+  m_decodedTexturesReady.notify_one();
+}
+
+void
+VulkanRenderer::CreateDedicatedStaging(VkDeviceSize size, textureDecode_t *outTexture)
+{
+  CreateBuffer(m_mainDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+               &outTexture->staging.buffer, &outTexture->dedicatedMemory);
+  outTexture->staging.size = size;
+
+  VK_CHECK(vkMapMemory(m_mainDevice.logicalDevice, outTexture->dedicatedMemory, 0, size, 0, &outTexture->staging.mapped),
+           "Failed to map Texture Staging Memory!");
+}
+
+void
+VulkanRenderer::ProcessTextureUploads()
+{
+  PROFILE_SCOPE("ProcessTextureUploads");
+
+  /* ----------------------------------------- RETIRE FINISHED BATCHES ----------------------------------------- */
+
+  // Batches run on one queue, so they finish in submission order
+  while (!m_textureUploadBatches.empty())
+  {
+    textureUploadBatch_t &batch = m_textureUploadBatches.front();
+    if (!m_graphicsTimeline.IsComplete(batch.timelineValue)) break;
+
+    for (const auto &texture : batch.textures)
+    {
+      // Give the staging memory back
+      if (texture.dedicatedMemory != VK_NULL_HANDLE)
+      {
+        vkDestroyBuffer(m_mainDevice.logicalDevice, texture.staging.buffer, nullptr);
+        vkFreeMemory(m_mainDevice.logicalDevice, texture.dedicatedMemory, nullptr);
+      }
+      else
+      {
+        m_textureStagingRing.Release(texture.staging);
+      }
+
+      textureResidency_t  &residency = m_textureResidency[texture.handle];
+      textureCacheEntry_t &entry     = m_textureCacheEntries[texture.handle];
+
+      residency.bUploading  = false;
+      residency.uploadedMip = texture.firstMip;
+
+      if (!texture.bMipUpload)
+      {
+        --m_pendingTextureCount;
+
+        // Drawable from now on, with the mip tail
+        residency.bResident = true;
+
+        if (!texture.bStreamIn)
+        {
+          m_textureStates[texture.handle] = TEXTURE_STATE_READY;
+
+          entry.byteSize = residency.fullBytes;
+          entry.decodeMs = texture.decodeMs;
+        }
+      }
+
+      // Full resolution is on the device
+      if (texture.firstMip == 0)
+      {
+        residency.mipChain.reset();
+
+        if (residency.bStreaming)
+        {
+          const float streamInMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - residency.streamRequestTime).count();
+
+          ++m_textureResidencyStats.streamIns;
+          m_textureResidencyStats.lastStreamInMs = streamInMs;
+          m_textureResidencyStats.maxStreamInMs  = std::max(m_textureResidencyStats.maxStreamInMs, streamInMs);
+          m_streamInTotalMs += streamInMs;
+
+          residency.bStreaming = false;
+        }
+      }
+
+      // Every reference was released while it was loading
+      if (entry.refCount == 0) DestroyTexture(texture.handle);
+    }
+
+    vkFreeCommandBuffers(m_mainDevice.logicalDevice, m_graphicsCommandPool, 1, &batch.commandBuffer);
+    m_textureUploadBatches.pop_front();
+  }
+
+  /* ----------------------------------------- SWAP VIEWS ----------------------------------------- */
+
+  // Show the levels that arrived. The new view goes to the spare descriptor, once no frame in flight uses it
+  for (size_t i = 0; i < m_textureResidency.size(); ++i)
+  {
+    textureResidency_t &residency = m_textureResidency[i];
+    if (!residency.bResident || residency.viewMip <= residency.uploadedMip || !m_graphicsTimeline.IsComplete(residency.spareFreeValue)) continue;
+
+    VkImageView imageView = CreateImageView(m_textureImages[i], residency.format, VK_IMAGE_ASPECT_COLOR_BIT,
+                                            residency.uploadedMip, residency.mipLevels - residency.uploadedMip);
+    WriteTextureSlot(residency.spareDescriptor, imageView);
+
+    // Draws recorded from now on use the new view
+    std::swap(residency.fullDescriptor, residency.spareDescriptor);
+    residency.viewMip        = residency.uploadedMip;
+    residency.spareFreeValue = m_graphicsTimeline.GetNextValue();
+
+    VkImageView oldView = m_textureImageViews[i];
+    m_textureImageViews[i] = imageView;
+
+    m_frameDeletionQueue.push_function(m_graphicsTimeline.GetNextValue(), [this, oldView]() -> void
+    {
+      vkDestroyImageView(m_mainDevice.logicalDevice, oldView, nullptr);
+    });
+  }
+
+  /* ----------------------------------------- COLLECT DECODED TEXTURES ----------------------------------------- */
+
+  std::vector<textureDecode_t> decoded;
+  {
+    std::lock_guard<std::mutex> lock(m_decodedTexturesMutex);
+    decoded.swap(m_decodedTextures);
+  }
+
+  textureUploadBatch_t batch {};
+  for (auto &texture : decoded)
+  {
+    if (texture.bFailed && texture.bStreamIn)
+    {
+      --m_pendingTextureCount;
+
+      // The file is gone, keep drawing the low resolution copy
+      textureResidency_t &residency = m_textureResidency[texture.handle];
+      residency.bStreaming    = false;
+      residency.bUploading    = false;
+      residency.bStreamFailed = true;
+
+      if (m_textureCacheEntries[texture.handle].refCount == 0) DestroyTexture(texture.handle);
+      continue;
+    }
+
+    if (texture.bFailed)
+    {
+      m_textureStates[texture.handle] = TEXTURE_STATE_FAILED;
+      --m_pendingTextureCount;
+
+      // Let a later request try again, the handle stays failed until released
+      ForgetCachedTexture(texture.handle);
+      if (m_textureCacheEntries[texture.handle].refCount == 0) DestroyTexture(texture.handle);
+      continue;
+    }
+
+    batch.textures.push_back(std::move(texture));
+  }
+
+  QueueTextureMipUploads(&batch);
+
+  if (batch.textures.empty()) return;
+
+  /* ----------------------------------------- CREATE IMAGES ----------------------------------------- */
+
+  std::vector<VkImageMemoryBarrier> toTransferBarriers;
+  std::vector<VkImageMemoryBarrier> toShaderBarriers;
+  std::vector<VkBufferImageCopy>    copyRegions;
+  std::vector<VkBuffer>             copySources;
+  VkPipelineStageFlags toTransferSrcStage, toTransferDstStage;
+  VkPipelineStageFlags toShaderSrcStage,   toShaderDstStage;
+
+  // One copy per level, from the staged range of a texture to a level of an image
+  auto addCopy = [&](const textureDecode_t &texture, VkImage image, uint32_t srcMip, uint32_t dstMip) -> void
+  {
+    const textureMipLevel_t &level      = texture.mipChain->levels[srcMip];
+    const VkDeviceSize       rangeStart = texture.mipChain->levels[texture.firstMip + texture.mipCount - 1].offset;
+
+    copySources.push_back(texture.staging.buffer);
+    copyRegions.push_back(
+    {
+      .bufferOffset      = texture.staging.offset + ( level.offset - rangeStart ), // Where the level starts in the staging buffer
+      .bufferRowLength   = 0,                                                      // Tightly packed
+      .bufferImageHeight = 0,
+      .imageSubresource  =
+      {
+        .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .mipLevel       = dstMip,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+      },
+      .imageOffset      = { 0, 0, 0 },
+      .imageExtent      = { level.width, level.height, 1 },
+    });
+
+    toTransferBarriers.push_back(GetImageLayoutBarrier(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                                       &toTransferSrcStage, &toTransferDstStage, dstMip));
+    toShaderBarriers.push_back(GetImageLayoutBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                     &toShaderSrcStage, &toShaderDstStage, dstMip));
+  };
+
+  for (const auto &texture : batch.textures)
+  {
+    textureResidency_t &residency = m_textureResidency[texture.handle];
+
+    // Next level of an image already there. Once the last one is staged, streaming needs no CPU levels
+    if (texture.bMipUpload)
+    {
+      addCopy(texture, m_textureImages[texture.handle], texture.firstMip, texture.firstMip);
+      if (texture.firstMip == 0) residency.mipChain.reset();
+      continue;
+    }
+
+    // Kept for streaming only while levels are left to upload
+    const textureMipChain_t &mipChain = *texture.mipChain;
+    residency.mipChain  = texture.firstMip > 0 ? texture.mipChain : nullptr;
+    residency.mipLevels = static_cast<uint32_t>(mipChain.levels.size());
+    residency.format    = mipChain.format;
+
+    // Every level is allocated now, only the tail has pixels yet
+    VkDeviceMemory texImageMemory;
+    VkImage texImage = CreateImage(texture.width, texture.height, residency.format, VK_IMAGE_TILING_OPTIMAL,
+                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texImageMemory, residency.mipLevels);
+    VkImageView imageView = CreateImageView(texImage, residency.format, VK_IMAGE_ASPECT_COLOR_BIT,
+                                            texture.firstMip, texture.mipCount);
+
+    m_textureImages[texture.handle]      = texImage;
+    m_textureImageMemory[texture.handle] = texImageMemory;
+    m_textureImageViews[texture.handle]  = imageView;
+
+    residency.tailMip       = texture.firstMip;
+    residency.viewMip       = texture.firstMip;
+    residency.uploadedMip   = residency.mipLevels;
+    residency.fullBytes     = mipChain.pixels.size();
+    m_residentTextureBytes += residency.fullBytes;
+
+    // Safe to write now, the descriptor is not used by any command buffer until the texture is resident
+    WriteTextureSlot(residency.fullDescriptor, imageView);
+    for (uint32_t mip = texture.firstMip; mip < texture.firstMip + texture.mipCount; ++mip) addCopy(texture, texImage, mip, mip);
+
+    // A stream-in only brings the full image back
+    if (texture.bStreamIn) continue;
+
+    CountTextureFormat(mipChain);
+
+    // The top of the tail doubles as the copy drawn while the full image is evicted
+    const textureMipLevel_t &tailTop = mipChain.levels[texture.firstMip];
+
+    residency.fallbackImage = CreateImage(tailTop.width, tailTop.height, residency.format, VK_IMAGE_TILING_OPTIMAL,
+                                          VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &residency.fallbackMemory);
+    residency.fallbackView  = CreateImageView(residency.fallbackImage, residency.format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    residency.fallbackBytes = tailTop.size;
+    m_residentTextureBytes += residency.fallbackBytes;
+
+    WriteTextureSlot(residency.fallbackDescriptor, residency.fallbackView);
+    addCopy(texture, residency.fallbackImage, texture.firstMip, 0);
+  }
+
+  /* ----------------------------------------- RECORD COPIES ----------------------------------------- */
+
+  AllocateCommandBuffer(m_mainDevice.logicalDevice, m_graphicsCommandPool, batch.commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo =
+  {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT  // Only using the command buffer once
+  };
+  VK_CHECK(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo), "Failed to begin texture upload command buffer!");
+
+    // Submitted before the frame, so it counts towards the frame being recorded
+    const int32_t uploadScope = m_gpuProfiler.BeginScope(batch.commandBuffer, "Texture uploads");
+
+    // Every level of the batch goes to transfer layout with a single barrier
+    vkCmdPipelineBarrier(batch.commandBuffer, toTransferSrcStage, toTransferDstStage, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(toTransferBarriers.size()), toTransferBarriers.data());
+
+    for (size_t i = 0; i < copyRegions.size(); ++i)
+    {
+      vkCmdCopyBufferToImage(batch.commandBuffer, copySources[i], toTransferBarriers[i].image,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegions[i]);
+    }
+
+    // And back to shader read with a single barrier
+    vkCmdPipelineBarrier(batch.commandBuffer, toShaderSrcStage, toShaderDstStage, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(toShaderBarriers.size()), toShaderBarriers.data());
+
+    m_gpuProfiler.EndScope(batch.commandBuffer, uploadScope);
+
+  VK_CHECK(vkEndCommandBuffer(batch.commandBuffer), "Failed to end texture upload command buffer!");
+
+  /* ----------------------------------------- SUBMIT ----------------------------------------- */
+
+  VkSubmitInfo submitInfo =
+  {
+    .sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    .commandBufferCount = 1,
+    .pCommandBuffers    = &batch.commandBuffer
+  };
+
+  // No wait here, the timeline is polled by the next calls
+  batch.timelineValue = m_graphicsTimeline.Submit(m_graphicsQueue, submitInfo);
+
+  // The levels are in staging memory now, the batch needs no CPU copy of them
+  for (auto &texture : batch.textures)
+  {
+    m_textureResidency[texture.handle].bUploading = true;
+    texture.mipChain.reset();
+  }
+
+  m_textureUploadBatches.push_back(std::move(batch));
+}
+
+void
+VulkanRenderer::QueueTextureMipUploads(textureUploadBatch_t *batch)
+{
+  // Textures drawn lately, the ones not drawn keep their current levels until they are
+  std::vector<TextureHandle> candidates;
+  for (size_t i = 0; i < m_textureResidency.size(); ++i)
+  {
+    const textureResidency_t &residency = m_textureResidency[i];
+    if (!residency.mipChain || !residency.bResident || residency.bUploading || residency.uploadedMip == 0) continue;
+    if (residency.lastUsedFrame + MAX_FRAME_DRAWS < m_frameNumber) continue;
+
+    candidates.push_back(static_cast<TextureHandle>(i));
+  }
+
+  // Most recently drawn first
+  std::sort(candidates.begin(), candidates.end(), [this](TextureHandle a, TextureHandle b) -> bool
+  {
+    return m_textureResidency[a].lastUsedFrame > m_textureResidency[b].lastUsedFrame;
+  });
+
+  VkDeviceSize budgetLeft = TEXTURE_MIP_UPLOAD_BUDGET;
+  for (TextureHandle handle : candidates)
+  {
+    textureResidency_t &residency = m_textureResidency[handle];
+
+    const uint32_t           mip   = residency.uploadedMip - 1;
+    const textureMipLevel_t &level = residency.mipChain->levels[mip];
+
+    // A level bigger than the whole budget only goes up alone
+    if (level.size > budgetLeft && budgetLeft < TEXTURE_MIP_UPLOAD_BUDGET) break;
+
+    textureDecode_t upload
+    {
+      .handle     = handle,
+      .width      = level.width,
+      .height     = level.height,
+      .bMipUpload = true,
+      .firstMip   = mip,
+      .mipCount   = 1,
+      .mipChain   = residency.mipChain
+    };
+
+    // Never wait on the ring here, it is only given back by this thread
+    if (!m_textureStagingRing.TryAllocate(level.size, 16, &upload.staging))
+    {
+      // Ring full for now, try again next frame
+      if (level.size <= m_textureStagingRing.GetCapacity()) break;
+
+      CreateDedicatedStaging(level.size, &upload);
+    }
+
+    memcpy(upload.staging.mapped, residency.mipChain->pixels.data() + level.offset, static_cast<size_t>(level.size));
+
+    if (upload.dedicatedMemory != VK_NULL_HANDLE) vkUnmapMemory(m_mainDevice.logicalDevice, upload.dedicatedMemory);
+
+    budgetLeft -= std::min(budgetLeft, level.size);
+    batch->textures.push_back(std::move(upload));
+
+    if (budgetLeft == 0) break;
+  }
+}
+
+void
+VulkanRenderer::LoadTextureMips(const std::string &fileName, textureUsage_e usage, const std::vector<char> &fileData,
+                                textureMipChain_t *outChain)
+{
+  const std::string sourcePath = TEXTURE_DIRECTORY + fileName;
+  const std::string cookedPath = GetCookedTexturePath(fileName);
+
+  // Cooked in the colour space of the texture, whatever the swap chain: sRGB colour mips are filtered in linear space
+  const bool bColor = IsColorTexture(fileName, usage);
+
+  // Use the cooked file if it is newer than its source, or shipped without it
+  bool bCooked = false;
+
+  std::error_code error;
+  const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+  if (!error)
+  {
+    const auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+    const bool bSource    = !error;
+    bCooked = ( !bSource || sourceTime <= cookedTime ) && ReadMipFile(cookedPath, outChain);
+
+    // A newer file does not prove it was cooked from this source: its size and levels must match the image header
+    int width, height, channels;
+    const bool bSourceInfo = bCooked && bSource &&
+                             ( fileData.empty() ? stbi_info(sourcePath.c_str(), &width, &height, &channels)
+                                                : stbi_info_from_memory(reinterpret_cast<const stbi_uc *>(fileData.data()),
+                                                                        static_cast<int>(fileData.size()), &width, &height, &channels) );
+    if (bSourceInfo && ( outChain->width != static_cast<uint32_t>(width) || outChain->height != static_cast<uint32_t>(height) ||
+                         outChain->levels.size() != GetMipLevelCount(outChain->width, outChain->height) ))
+    {
+      fprintf(stdout, "[INFO] Cooked texture does not match its source, cooking it again: '%s'\n", cookedPath.c_str());
+      bCooked = false;
+    }
+
+    // Cooked by an older build with the colour space of its swap chain, or before the usage of the texture changed
+    if (bCooked && bSource && IsSRGBFormat(outChain->format) != bColor)
+    {
+      fprintf(stdout, "[INFO] Cooked texture is in another colour space, cooking it again: '%s'\n", cookedPath.c_str());
+      bCooked = false;
+    }
+  }
+
+  if (!bCooked)
+  {
+    int width, height, channels;
+    VkDeviceSize imageSize;
+    stbi_uc *imageData = fileData.empty() ? LoadTextureFile(fileName, &width, &height, &channels, &imageSize)
+                                          : LoadTextureMemory(fileName, fileData, &width, &height, &channels, &imageSize);
+
+    // Cooked with as few channels as the file has, whatever the device supports
+    BuildTextureMipChain(imageData, static_cast<uint32_t>(width), static_cast<uint32_t>(height), static_cast<uint32_t>(channels),
+                         bColor, outChain);
+
+    // Free image data
+    stbi_image_free(imageData);
+
+    if constexpr (TEXTURE_COOK_ON_LOAD)
+    {
+      if (!WriteMipFile(cookedPath, *outChain)) fprintf(stderr, "[ERROR] Failed to write cooked texture: '%s'\n", cookedPath.c_str());
+    }
+  }
+
+  // Expand to a format the device can sample. Colour is only sampled as sRGB when the swap chain encodes back,
+  // otherwise it would draw darker: the bytes are relabelled, never converted
+  const bool bSRGB = m_bSRGBTextures && IsSRGBFormat(outChain->format);
+  ConvertMipChain(outChain, m_textureFormats[bSRGB][GetFormatChannels(outChain->format) - 1]);
+}
+
+bool
+VulkanRenderer::IsColorTexture(const std::string &fileName, textureUsage_e usage)
+{
+  if (usage != TEXTURE_USAGE_AUTO) return usage == TEXTURE_USAGE_COLOR;
+
+  std::string stem = std::filesystem::path(fileName).stem().string();
+  std::transform(stem.begin(), stem.end(), stem.begin(), [](unsigned char c) -> char { return static_cast<char>(std::tolower(c)); });
+
+  // Common suffixes of non colour maps
+  for (const char *suffix : { "_n", "_nrm", "_normal", "_mask", "_rough", "_roughness", "_metal", "_metallic",
+                              "_ao", "_orm", "_height", "_disp" })
+  {
+    if (stem.ends_with(suffix)) return false;
+  }
+
+  return true;
 }
 
 
 stbi_uc *
 VulkanRenderer::LoadTextureFile(std::string fileName,
-                                int *width, int *height,
+                                int *width, int *height, int *channels,
                                 VkDeviceSize *imageSize)
 {
-  int channels;
-
-  // Load image pixel data
-  std::string filePath = "Assets/Textures/" + fileName;
-  stbi_uc *image = stbi_load(filePath.c_str(), width, height, &channels, STBI_rgb_alpha);
+  // Load image pixel data, with the channels of the file
+  std::string filePath = TEXTURE_DIRECTORY + fileName;
+  stbi_uc *image = stbi_load(filePath.c_str(), width, height, channels, 0);
 
   if (!image) throw std::runtime_error("Failed to load Image: '" + filePath + "'");
 
-  // Calculate image size by 4 channels (RGBA)
-  *imageSize = (*width * *height) * 4;
+  // Calculate image size by the channels of the file
+  *imageSize = static_cast<VkDeviceSize>(*width) * *height * *channels;
+
+  return image;
+}
+
+stbi_uc *
+VulkanRenderer::LoadTextureMemory(const std::string &fileName, const std::vector<char> &fileData,
+                                  int *width, int *height, int *channels, VkDeviceSize *imageSize)
+{
+  // Decode image pixel data, with the channels of the file
+  stbi_uc *image = stbi_load_from_memory(reinterpret_cast<const stbi_uc *>(fileData.data()), static_cast<int>(fileData.size()),
+                                         width, height, channels, 0);
+
+  if (!image) throw std::runtime_error("Failed to load Image: '" + std::string(TEXTURE_DIRECTORY) + fileName + "'");
+
+  // Calculate image size by the channels of the file
+  *imageSize = static_cast<VkDeviceSize>(*width) * *height * *channels;
 
   return image;
 }
@@ -10,14 +10,31 @@
 
 // TODO: Organize includes
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <stdexcept>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <vector>
 #include <set>
+#include <unordered_map>
 
 #include "stb_image.h"
+#include "GpuProfiler.h"
+#include "GpuTimeline.h"
 #include "Mesh.h"
+#include "Overlay.h"
+#include "PipelineCache.h"
+#include "PipelineManager.h"
+#include "ShaderWatcher.h"
+#include "StagingRing.h"
+#include "Texture.h"
+#include "TextureAtlas.h"
+#include "TextureMips.h"
+#include "ThreadPool.hpp"
 #include "Utilities.h"
 
 
@@ -45,18 +62,203 @@ public:
 	 */
 	int Init(GLFWwindow *newWindow);
 
+	/**
+	 * @brief Initializes the Vulkan Renderer without a window: no GLFW, no surface and no present
+	 * @details Frames are drawn in turn into offscreen images with the same render pass, pipelines and recording.
+	 *          Runs on devices without a display, such as lavapipe or SwiftShader
+	 *
+	 * @param width Width of the offscreen images
+	 * @param height Height of the offscreen images
+	 * @param imageCount Number of offscreen images, raised to MAX_FRAME_DRAWS so no frame draws into an image still in flight
+	 * @return 0 if the renderer was initialized successfully, 1 if it failed
+	 */
+	int InitHeadless(uint32_t width, uint32_t height, uint32_t imageCount = HEADLESS_IMAGE_COUNT);
+
+	/**
+	 * @brief Write the image of the last frame drawn to a binary PPM file. Headless only, waits for the graphics queue
+	 * @return False if not headless, nothing was drawn yet or the file cannot be written
+	 */
+	bool SaveFrame(const std::string &fileName);
+
 	/** @brief Draws the frame */
 	void Draw();
 
 	/** @brief Cleans up the Vulkan Renderer */
 	void Cleanup();
 
-	/** @briefs Checks if the framebuffer was resized */
+	/** @brief Records the new framebuffer size, the swap chain is recreated by the next frame. Main thread */
 	static void FramebufferResizeCallback(GLFWwindow* window, int width, int height);
 
 	/** @brief Updates the model */
 	void UpdateModel(uint32_t modelID, glm::mat4 newModel);
 
+	/**
+	 * @brief Upload a mesh and add it to the scene, drawn from the next frame. Render thread, or before it starts
+	 * @details Waits for the graphics queue, once for each buffer
+	 *
+	 * @param texture Handle from CreateTextureAsync, -1 for an untextured mesh
+	 * @return The index of the mesh, for UpdateModel and SetMeshPipeline
+	 */
+	uint32_t AddMesh(std::vector<vertex_t> vertices, std::vector<uint32_t> indices, TextureHandle texture = -1);
+
+	/**
+	 * @brief Add a mesh drawing the vertex and index buffers of another one, with its own model and texture. Nothing is uploaded
+	 * @details Consecutive meshes with the same buffers keep them bound, the renderer has no instanced draw
+	 *
+	 * @return The index of the new mesh
+	 */
+	uint32_t AddMeshInstance(uint32_t meshIndex, TextureHandle texture);
+
+	/** @brief Get the number of meshes in the scene, instances included */
+	[[nodiscard]] uint32_t GetMeshCount() const;
+
+	/** @brief Get what the last recorded frame drew and the device memory in use. Render thread, or once it stopped */
+	[[nodiscard]] overlayStats_t GetFrameStats();
+
+	/** @brief Get the GPU timings of the last frames read back, oldest first. Render thread, or once it stopped */
+	[[nodiscard]] const std::deque<gpuFrameTiming_t> &GetGpuFrameTimings() const;
+
+	/** @brief Get the name of the physical device drawn with */
+	[[nodiscard]] std::string GetDeviceName() const;
+
+	/** @brief Checks if presents can be waited on, VK_KHR_present_id and VK_KHR_present_wait are enabled */
+	[[nodiscard]] bool SupportsPresentWait() const;
+
+	/**
+	 * @brief Block until at most one presented frame is still waiting for the display
+	 *
+	 * @param timeoutNs Longest wait in nanoseconds
+	 * @return False if there was nothing to wait on, the wait timed out or presents cannot be waited on
+	 */
+	bool WaitForPresent(uint64_t timeoutNs);
+
+	/**
+	 * @brief Request a present mode. Only the swap chain is rebuilt, by the next frame. Any thread
+	 * @details IMMEDIATE and MAILBOX give the lowest latency, FIFO and FIFO_RELAXED the lowest power.
+	 *          FIFO is used if the surface does not support the mode
+	 */
+	void SetPresentMode(VkPresentModeKHR presentMode);
+
+	/**
+	 * @brief Request a swap chain image count. Only the swap chain is rebuilt, by the next frame. Any thread
+	 *
+	 * @param imageCount Clamped to the surface limits, 0 is one more than the minimum
+	 */
+	void SetSwapchainImageCount(uint32_t imageCount);
+
+	/**
+	 * @brief Request a number of frames in flight. Applied at the start of the next frame, once the frames in flight finished.
+	 *        Any thread
+	 *
+	 * @param framesInFlight Clamped to 1 to MAX_FRAME_DRAWS
+	 */
+	void SetFramesInFlight(uint32_t framesInFlight);
+
+	/** @brief Get the number of frames in flight. Any thread */
+	[[nodiscard]] uint32_t GetFramesInFlight() const;
+
+	/** @brief Show or hide the performance overlay. Any thread */
+	void SetOverlayVisible(bool bVisible);
+
+	/** @brief Checks if the performance overlay is shown. Any thread */
+	[[nodiscard]] bool IsOverlayVisible() const;
+
+	/** @brief Get the present mode the swap chain was created with. Any thread */
+	[[nodiscard]] VkPresentModeKHR GetPresentMode() const;
+
+	/** @brief Get the present statistics since the present settings last changed. Render thread, or once it stopped */
+	[[nodiscard]] const presentStats_t &GetPresentStats() const;
+
+	/** @brief Print the present statistics since the present settings last changed */
+	void PrintPresentStats() const;
+
+	/** @brief Get the short name of a present mode, as taken by ParsePresentMode */
+	static const char *GetPresentModeName(VkPresentModeKHR presentMode);
+
+	/**
+	 * @brief Get a present mode from its short name: immediate, mailbox, fifo or fifo_relaxed
+	 * @return False if the name is unknown
+	 */
+	static bool ParsePresentMode(const std::string &name, VkPresentModeKHR *outPresentMode);
+
+	/**
+	 * @brief Request a texture to be decoded on a worker thread and uploaded with the next batch
+	 * @details Textures are cached by normalised path, and by file content if TEXTURE_CACHE_BY_CONTENT is set. A miss
+	 *          only costs a stat of the file: it is read on this thread only when a live texture has the same size.
+	 *          A cached texture is returned as is, with one more reference. Balance each call with ReleaseTexture
+	 *
+	 * @param fileName The name of the file, relative to the textures folder
+	 * @param usage What the texture holds, picks sRGB or linear storage. The first request of a cached texture decides
+	 * @return The texture handle. Can be given to a mesh right away, the mesh is drawn once the texture is ready
+	 */
+	TextureHandle CreateTextureAsync(const std::string &fileName, textureUsage_e usage = TEXTURE_USAGE_AUTO);
+
+	/**
+	 * @brief Drop a reference to a texture
+	 * @details The last reference destroys the texture once no frame in flight uses it, and the handle gets reused.
+	 *          Meshes must not keep a released handle
+	 */
+	void ReleaseTexture(TextureHandle handle);
+
+	/** @brief Get the texture cache counters */
+	[[nodiscard]] textureCacheStats_t GetTextureCacheStats() const;
+
+	/**
+	 * @brief Set how much device memory the textures may use
+	 * @details Over budget, the least recently drawn textures drop to their low resolution copy until drawn again.
+	 *          With VK_EXT_memory_budget, the budget is also capped to what the driver reports as available
+	 */
+	void SetTextureMemoryBudget(VkDeviceSize budget);
+
+	/** @brief Get the formats picked for the textures loaded so far, and the memory saved against RGBA8 */
+	[[nodiscard]] textureFormatStats_t GetTextureFormatStats() const;
+
+	/** @brief Get the texture memory counters */
+	[[nodiscard]] textureResidencyStats_t GetTextureResidencyStats() const;
+
+	/**
+	 * @brief Pack small textures into atlas pages, cooked once and loaded like any texture
+	 * @details Packed textures are drawn from their page: give the mesh the region texture, with its coordinates
+	 *          moved by TextureAtlas::RemapTexCoords. Textures too big for the atlas are left out, load them on their own
+	 *
+	 * @param atlasName The name of the atlas
+	 * @param fileNames The textures to pack, relative to the textures folder
+	 * @return False if nothing could be packed
+	 */
+	bool CreateTextureAtlas(const std::string &atlasName, const std::vector<std::string> &fileNames);
+
+	/**
+	 * @brief Find where a texture landed in the atlases created so far
+	 * @return False if the texture is in no atlas
+	 */
+	bool GetAtlasRegion(const std::string &fileName, atlasRegion_t *outRegion) const;
+
+	/**
+	 * @brief Get the description of a mesh pipeline, to derive variants from
+	 *
+	 * @param bTextured Sample the mesh texture. Untextured variants draw meshes created without a texture (-1)
+	 * @param bVertexColour Multiply by the vertex colour
+	 */
+	[[nodiscard]] pipelineDesc_t GetDefaultPipelineDesc(bool bTextured = true, bool bVertexColour = false) const;
+
+	/**
+	 * @brief Request a pipeline variant, compiled on a worker if it was never requested before
+	 * @details Meshes using the variant draw with the default pipeline until it is ready, nothing compiles on the render thread.
+	 *          A null layout or render pass is filled with the renderer ones
+	 *
+	 * @return The handle of the variant, the same for the same description
+	 */
+	PipelineHandle RequestPipeline(pipelineDesc_t desc);
+
+	/** @brief Set the pipeline variant a mesh draws with, -1 for the default one */
+	void SetMeshPipeline(size_t meshIndex, PipelineHandle pipeline);
+
+	/** @brief Checks if a texture finished uploading and can be sampled */
+	[[nodiscard]] bool IsTextureReady(TextureHandle handle) const;
+
+	/** @brief Blocks until every requested texture is uploaded or failed to load */
+	void WaitForTextures();
+
 private:
 
 	// ======================================================================================================================
@@ -66,11 +268,38 @@ private:
 	/** @brief The window to render to */
 	GLFWwindow *m_window  {nullptr};
 
-	/** @brief The current frame */
+	/** @brief No window: frames are drawn into offscreen images and never presented */
+	bool     m_bHeadless          { false };
+	uint32_t m_headlessImageCount { HEADLESS_IMAGE_COUNT };
+
+	/** @brief The current frame in flight, below m_framesInFlight */
 	uint32_t m_currentFrame {0};
 
-	/** @brief Is frame buffer resized */
-	uint8_t m_framebufferResized : 1 {0};
+	/** @brief Frames recorded ahead of the GPU, each has its own command buffer, uniform buffer, descriptor set and sync objects */
+	std::atomic<uint32_t> m_framesInFlight          { DEFAULT_FRAMES_IN_FLIGHT };
+
+	/** @brief Frames in flight asked for. Set from any thread, applied by the render thread */
+	std::atomic<uint32_t> m_requestedFramesInFlight { DEFAULT_FRAMES_IN_FLIGHT };
+	std::atomic<bool>     m_bFramesInFlightChanged  { false };
+
+	/** @brief Number of frames drawn so far */
+	uint64_t m_frameNumber  {0};
+
+	/** @brief Start of Init, the time to first frame is measured from it */
+	std::chrono::steady_clock::time_point m_initStart                { };
+	double                                m_initMs                   { 0.0 };
+	double                                m_firstSubmitMs            { 0.0 };    // From the start of Init
+	uint64_t                              m_firstFrameTimelineValue  { 0 };      // The first frame is done once the timeline reaches it
+	bool                                  m_bFirstFrameReported      { false };
+
+	/** @brief Is frame buffer resized. Set by the window callback on the main thread, read by the render thread */
+	std::atomic<bool>     m_bFramebufferResized { false };
+
+	/** @brief Framebuffer width in the high half and height in the low half, GLFW can only be asked on the main thread */
+	std::atomic<uint64_t> m_framebufferSize     { 0 };
+
+	/** @brief Steady clock time of the last resize event in nanoseconds, the swap chain waits for the burst to end */
+	std::atomic<int64_t>  m_lastResizeNs        { 0 };
 
 	// ======================================================================================================================
 	// ============================================ Scene Components ========================================================
@@ -105,7 +334,13 @@ private:
 
 	std::vector<swapchainImage_t> m_swapChainImages       { };
 	std::vector<VkFramebuffer>    m_swapChainFramebuffers { };
-	std::vector<VkCommandBuffer>  m_commandBuffers        { };
+	std::vector<VkCommandBuffer>  m_commandBuffers        { }; // One per frame in flight, not per image: they outlive swap chains
+
+	/** @brief Memory of the images when headless, the renderer owns them. Empty with a swap chain */
+	std::vector<VkDeviceMemory>   m_offscreenImageMemory  { };
+
+	/** @brief Swap chains created so far, the first included */
+	uint32_t                      m_swapchainCount        { 0 };
 
 	// Depth buffer
 	VkImage        m_depthBufferImage       { VK_NULL_HANDLE };
@@ -120,13 +355,28 @@ private:
 	 */
 	VkDescriptorSetLayout m_descriptorSetLayout { VK_NULL_HANDLE };
   VkDescriptorSetLayout m_samplerSetLayout    { VK_NULL_HANDLE };
-	VkPushConstantRange   m_pushConstantRange   {  };
+	std::vector<VkPushConstantRange> m_pushConstantRanges {  };
 
 	/** @brief Descriptor pool is used to allocate descriptor sets to write descriptors into. */
 	VkDescriptorPool             m_descriptorPool         { VK_NULL_HANDLE };
   VkDescriptorPool             m_samplerDescriptorPool  { VK_NULL_HANDLE };
 	std::vector<VkDescriptorSet> m_descriptorSets         {  };               // < For VP UBO
   std::vector<VkDescriptorSet> m_samplerDescriptorSets  {  };               // < For Textures
+	VkDescriptorSet              m_bindlessDescriptorSet  { VK_NULL_HANDLE }; // < For Textures, in bindless mode
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Bindless Textures +++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Textures are slots of one array bound once per frame, the slot index is pushed per draw */
+	bool     m_bBindlessTextures         { false };
+
+	/** @brief Size of the bindless texture array */
+	uint32_t m_bindlessCapacity          { 0 };
+
+	/** @brief Bindless slots handed out so far */
+	uint32_t m_bindlessTextureCount      { 0 };
+
+	/** @brief VK_KHR_get_physical_device_properties2 is enabled on the instance */
+	bool     m_bPhysicalDeviceProperties2 { false };
 
 	std::vector<VkBuffer>       m_vpUniformBuffers       {  };
 	std::vector<VkDeviceMemory> m_vpUniformBuffersMemory {  };
@@ -136,6 +386,103 @@ private:
   std::vector<VkImage>        m_textureImages      { };
   std::vector<VkDeviceMemory> m_textureImageMemory { };
   std::vector<VkImageView>    m_textureImageViews  { };
+  std::vector<textureState_e> m_textureStates      { };
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Texture Cache +++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Cache bookkeeping, indexed by texture handle */
+	std::vector<textureCacheEntry_t>               m_textureCacheEntries { };
+
+	/** @brief Live textures by normalised path, and by file size for the content matches */
+	std::unordered_map<std::string, TextureHandle>    m_texturePathCache    { };
+	std::unordered_multimap<uintmax_t, TextureHandle> m_textureContentCache { };
+
+	/** @brief Handles of destroyed textures, with their descriptor set ready to be rewritten */
+	std::vector<TextureHandle>                     m_freeTextureHandles  { };
+
+	/** @brief Hit and miss counters, plus the savings of the textures already destroyed */
+	textureCacheStats_t                            m_textureCacheStats   { };
+
+	/** @brief Regions of the atlas textures by normalised path, with the texture of their page */
+	std::unordered_map<std::string, atlasRegion_t> m_atlasRegions        { };
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Texture Loading +++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Workers decoding texture files into staging memory */
+	std::unique_ptr<ThreadPool>      m_textureWorkers       { };
+
+	/** @brief Staging memory shared by every texture upload */
+	StagingRing                      m_textureStagingRing   { };
+
+	/** @brief Textures decoded by the workers, waiting for the next upload batch */
+	std::vector<textureDecode_t>     m_decodedTextures      { };
+	std::mutex                       m_decodedTexturesMutex { };
+	std::condition_variable          m_decodedTexturesReady { };
+
+	/** @brief Submitted upload batches, oldest first */
+	std::deque<textureUploadBatch_t> m_textureUploadBatches { };
+
+	/** @brief Number of textures requested but not yet ready or failed, plus the stream-ins in flight */
+	uint32_t                         m_pendingTextureCount  { 0 };
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Texture Residency +++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Residency of the textures, indexed by texture handle */
+	std::vector<textureResidency_t> m_textureResidency      { };
+
+	/** @brief Configured texture memory budget */
+	VkDeviceSize                    m_textureMemoryBudget   { TEXTURE_MEMORY_BUDGET };
+
+	/** @brief Device memory held by the full images and the low resolution copies */
+	VkDeviceSize                    m_residentTextureBytes  { 0 };
+
+	/** @brief Budget evicted down to, queried again at m_textureBudgetFrame or once the textures come close to it */
+	VkDeviceSize                    m_textureBudget         { TEXTURE_MEMORY_BUDGET };
+	uint64_t                        m_textureBudgetFrame    { 0 };
+
+	/** @brief Eviction and stream-in counters */
+	textureResidencyStats_t         m_textureResidencyStats { };
+	float                           m_streamInTotalMs       { 0.0f };
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Texture Formats +++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Colour textures are sampled as sRGB, the swap chain format is sRGB too. They are cooked as sRGB either way */
+	bool                                      m_bSRGBTextures      { false };
+
+	/** @brief Format sampled for 1 to 4 channel pixels, indexed [bSRGB][channels - 1]. R8 and R8G8 fall back to RGBA8 */
+	std::array<std::array<VkFormat, 4>, 2>    m_textureFormats     { };
+
+	/** @brief Formats of the textures loaded so far */
+	textureFormatStats_t                      m_textureFormatStats { };
+
+	/** @brief VK_EXT_memory_budget is enabled, the heap budget is queried by the residency update */
+	bool                                        m_bMemoryBudget                   { false };
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_vkGetPhysicalDeviceMemoryProperties2 { nullptr };
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Present Wait ++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Presents are tagged with an ID, the frame pacer waits for them to reach the display */
+	bool                    m_bPresentWait     { false };
+	PFN_vkWaitForPresentKHR m_vkWaitForPresent { nullptr };
+
+	/** @brief ID of the last present, the frame number plus one */
+	uint64_t                m_lastPresentId    { 0 };
+
+	/** @brief ID of the first present to the current swap chain, older IDs cannot be waited on */
+	uint64_t                m_firstPresentId   { 0 };
+
+	// ++++++++++++++++++++++++++++++++++++++++++++++ Present Settings ++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+	/** @brief Settings the next swap chain is created with. Set from any thread, read by the render thread */
+	std::atomic<VkPresentModeKHR> m_requestedPresentMode      { DEFAULT_PRESENT_MODE };
+	std::atomic<uint32_t>         m_requestedImageCount       { DEFAULT_SWAPCHAIN_IMAGE_COUNT };
+	std::atomic<bool>             m_bSwapchainSettingsChanged { false };
+
+	/** @brief Present mode of the current swap chain */
+	std::atomic<VkPresentModeKHR> m_presentMode               { VK_PRESENT_MODE_FIFO_KHR };
+
+	presentStats_t                        m_presentStats    { };
+	std::chrono::steady_clock::time_point m_lastPresentTime { };
 
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Dynamic Uniform Buffers +++++++++++++++++++++++++++++++++++++++++++++
 
@@ -163,8 +510,14 @@ private:
 
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Graphics Pipeline +++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-	/** @brief The graphics pipeline */
-	VkPipeline      m_graphicsPipeline    { VK_NULL_HANDLE };
+	/** @brief Pipeline variants, deduplicated by description and compiled in the background */
+	PipelineManager  m_pipelines          { };
+
+	/** @brief Variant of the meshes that set none, also the fallback of the others */
+	PipelineHandle   m_meshPipeline       { -1 };
+
+	/** @brief Same for meshes without a texture. -1 when the shaders were built without specialization constants */
+	PipelineHandle   m_untexturedPipeline { -1 };
 
 	/** @brief The pipeline layout */
 	VkPipelineLayout m_pipelineLayout     { VK_NULL_HANDLE };
@@ -172,6 +525,12 @@ private:
 	/** @brief The render pass */
 	VkRenderPass     m_renderPass         { VK_NULL_HANDLE };
 
+	/** @brief Shared by every pipeline, loaded from and saved to PIPELINE_CACHE_FILE */
+	PipelineCache    m_pipelineCache      { };
+
+	/** @brief Recompiles edited shader sources, their pipelines are rebuilt and swapped between frames */
+	ShaderWatcher    m_shaderWatcher      { };
+
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Utility Components +++++++++++++++++++++++++++++++++++++++++++++++++++
 
 	VkFormat         m_swapChainImageFormat   {   };
@@ -185,6 +544,12 @@ private:
 
 	function_queue_t m_mainDeletionQueue      {   };
 
+	/** @brief Resources released while submitted work may still use them, tagged with a value of the graphics timeline */
+	deferred_queue_t m_frameDeletionQueue     {   };
+
+	/** @brief Resources a present may still use, tagged with a frame number. The timeline does not track the present engine */
+	deferred_queue_t m_presentDeletionQueue   {   };
+
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Sync Components +++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 	/** @brief The images available */
@@ -193,8 +558,26 @@ private:
 	/** @brief The max number of frames that can be processed simultaneously */
 	std::vector<VkSemaphore> m_renderFinishedSemaphore { };
 
-	/** @brief The fences */
-	std::vector<VkFence> m_drawFences                  { };
+	/** @brief Completion of the work submitted to the graphics queue: frames and texture uploads */
+	GpuTimeline m_graphicsTimeline                     { };
+
+	/** @brief Named GPU scopes of the frames, measured with timestamps written on the graphics queue */
+	GpuProfiler m_gpuProfiler                          { };
+
+	/** @brief Frame times and counters over the scene, toggled at runtime */
+	Overlay m_overlay                                  { };
+
+	/** @brief What the last recorded frame drew */
+	drawStats_t m_drawStats                            { };
+
+	/** @brief Timeline value each frame in flight signals, the frame can be recorded again once it is reached */
+	std::vector<uint64_t> m_frameTimelineValues        { };
+
+	/** @brief API version the instance was created with, 1.2 when the loader has it */
+	uint32_t m_apiVersion                              { VK_API_VERSION_1_0 };
+
+	/** @brief The graphics timeline is a timeline semaphore, from Vulkan 1.2 or VK_KHR_timeline_semaphore */
+	bool     m_bTimelineSemaphores                     { false };
 
 
 	// ======================================================================================================================
@@ -203,6 +586,18 @@ private:
 
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Create Functions +++++++++++++++++++++++++++++++++++++++++++++++++++++
 
+	/**
+	 * @brief Create everything once the framebuffer size is known, shared by Init and InitHeadless
+	 * @return 0 if the renderer was initialized successfully, 1 if it failed
+	 */
+	int InitRenderer();
+
+	/**
+	 * @brief Print the time from the start of Init to the first frame
+	 * @param finishedMs When the GPU was seen done with the first frame, negative if it was not
+	 */
+	void PrintTimeToFirstFrame(double finishedMs);
+
 	/** @brief Create the Vulkan instance */
 	void CreateInstance();
 
@@ -215,15 +610,34 @@ private:
 	/** @brief Create the surface to render to */
 	void CreateSurface();
 
-	/** @brief Create the swap chain */
-	void CreateSwapChain();
+	/**
+	 * @brief Create the swap chain
+	 * @param oldSwapchain The swap chain it replaces, its resources are handed over. VK_NULL_HANDLE at startup
+	 */
+	void CreateSwapChain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+
+	/** @brief Create the offscreen images a headless renderer draws into, in place of the swap chain images */
+	void CreateOffscreenImages();
 
 	/** @brief Update the View and Projection UBOs */
 	void CreateViewProjUBO();
 
-	/** @brief Recreate the swap chain */
+	/**
+	 * @brief Recreate the swap chain and what depends on its size, without waiting for the device
+	 * @details The old swap chain is handed to the new one, then retired with its framebuffers, views and depth buffer
+	 *          once the frames in flight are done with them
+	 */
 	void RecreateSwapChain();
 
+	/**
+	 * @brief Rebuild the swap chain if it is due, then acquire its next image
+	 * @return False if the frame must be skipped, the swap chain was out of date
+	 */
+	bool AcquireNextImage(uint32_t *outImageIndex);
+
+	/** @brief Present a drawn image once the frame finished rendering, and recreate the swap chain if it went out of date */
+	void PresentImage(uint32_t imageIndex);
+
 	/** @brief Create the depth buffer image */
 	void CreateDepthBufferImage();
 
@@ -236,9 +650,27 @@ private:
 	/** @brief Create the push constant range */
 	void CreatePushConstantRange();
 
+	/** @brief Create the pipeline cache, seeded from the previous runs */
+	void CreatePipelineCache();
+
 	/** @brief Create the Graphics Pipeline */
 	void CreateGraphicsPipeline();
 
+	/** @brief Get the framebuffer size last reported by the window, 0 x 0 while minimised */
+	void GetFramebufferSize(int *outWidth, int *outHeight) const;
+
+	/** @brief Start watching the shader sources for the hot reload */
+	void CreateShaderWatcher();
+
+	/** @brief Create the performance overlay, drawn at the end of the render pass */
+	void CreateOverlay();
+
+	/**
+	 * @brief Rebuild the pipelines of the recompiled shaders and swap in the ones rebuilt since the last frame
+	 * @details Called once per frame, after the wait on the frame fence. Replaced pipelines are destroyed once no frame in flight uses them
+	 */
+	void ReloadShaders();
+
 	/** @brief Create the frame buffers */
 	void CreateFramebuffers();
 
@@ -251,9 +683,19 @@ private:
 	/** @brief Create the semaphores */
 	void CreateSemaphores();
 
+	/**
+	 * @brief Resize the per frame resources to the requested frames in flight
+	 * @details Waits for the frames in flight only, the device keeps working. The semaphores may still be waited on by a present,
+	 *          they are destroyed MAX_FRAME_DRAWS frames later
+	 */
+	void ApplyFramesInFlight();
+
   /** @brief Create the texture sampler */
   void CreateTextureSampler();
 
+	/** @brief Create the texture decode workers and the staging ring */
+	void CreateTextureLoader();
+
 	/* --------------- Descriptor Functions --------------- */
 
 	/** @brief Create the Uniform Buffers */
@@ -267,12 +709,12 @@ private:
 
 	/* --------------- Uniform Buffer Functions --------------- */
 
-	/** @brief Update the Uniform Buffers */
-	void UpdateUniformBuffers(uint32_t imageIndex);
+	/** @brief Update the Uniform Buffers of a frame in flight */
+	void UpdateUniformBuffers(uint32_t frame);
 
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Record Functions +++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-	/** @brief Record the command buffers */
+	/** @brief Record the command buffer of the current frame in flight, drawing into a swap chain image */
 	void RecordCommands(VkCommandBuffer commandBuffer, uint32_t currImage);
 
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Get Functions ++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -293,11 +735,11 @@ private:
 
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Cleanup Functions +++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-	/** @brief Cleanup the swap chain */
+	/** @brief Cleanup the swap chain, or the offscreen images when headless */
 	void CleanupSwapChain();
 
-	/** @brief Cleanup the Framebuffers */
-	void CleanupFramebuffers();
+	/** @brief Cleanup the per frame resources: command buffers, sync objects, View Projection uniform buffers and descriptor sets */
+	void CleanupFrameResources();
 
 	/** @brief Cleanup the Depth Buffer */
 	void CleanupDepthBuffer();
@@ -338,6 +780,26 @@ private:
 	 */
 	bool CheckDeviceSuitable(VkPhysicalDevice device);
 
+	/**
+	 * @brief Checks if the device can run the bindless texture array
+	 *
+	 * @param device The Vulkan physical device to check
+	 * @param outCapacity The size the bindless array can have on this device
+	 * @return True if the descriptor indexing features and the bindless shader are available
+	 */
+	bool CheckBindlessSupport(VkPhysicalDevice device, uint32_t *outCapacity);
+
+	/** @brief Checks if the device can tag presents with an ID and wait for them, VK_KHR_present_id and VK_KHR_present_wait */
+	bool CheckPresentWaitSupport(VkPhysicalDevice device);
+
+	/**
+	 * @brief Checks if the device has timeline semaphores, core in Vulkan 1.2 or from VK_KHR_timeline_semaphore
+	 *
+	 * @param device The Vulkan physical device to check
+	 * @param outExtension True if the extension must be enabled, the instance or the device is older than 1.2
+	 */
+	bool CheckTimelineSemaphoreSupport(VkPhysicalDevice device, bool *outExtension);
+
 	// ++++++++++++++++++++++++++++++++++++++++++++++ Get Functions +++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 	/**
@@ -367,13 +829,16 @@ private:
 	VkSurfaceFormatKHR ChooseBestSurfaceFormat(const std::vector<VkSurfaceFormatKHR> &InFormats);
 
 	/**
-	 * @brief Choose the best presentation mode. Subject to change
+	 * @brief Choose the requested presentation mode, or FIFO if the surface does not support it
 	 *
 	 * @param InPresentationModes The available presentation modes
-	 * @return The best presentation mode
+	 * @return The presentation mode to use
 	 */
 	VkPresentModeKHR ChooseBestPresentationMode(const std::vector<VkPresentModeKHR> &InPresentationModes);
 
+	/** @brief Add a present to the statistics: interval since the previous one and frames still queued on the GPU */
+	void RecordPresent();
+
 	/**
 	 * @brief Choose the swap extent
 	 *
@@ -400,17 +865,12 @@ private:
 	 * @param image The image to create the view for
 	 * @param format The format of the image
 	 * @param aspectFlags The aspect flags of the image
+	 * @param baseMipLevel The first mip level the view shows
+	 * @param levelCount The number of mip levels the view shows
 	 * @return The image view
 	 */
-	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) const;
-
-	/**
-	 * @brief Create a shader module
-	 *
-	 * @param code The code of the shader
-	 * @return The shader module
-	 */
-	[[nodiscard]] VkShaderModule CreateShaderModule(const std::vector<char> &code) const;
+	VkImageView CreateImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags,
+	                            uint32_t baseMipLevel = 0, uint32_t levelCount = 1) const;
 
 	/**
 	 * @brief Create an image
@@ -422,46 +882,151 @@ private:
 	 * @param usage The usage of the image, what the image is to be used for
 	 * @param properties The properties of the image, the memory properties of the image
 	 * @param imageMemory The image memory, the handle to the image memory
+	 * @param mipLevels The number of mip levels of the image
 	 * @return The image created
 	 */
 	VkImage CreateImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage,
-	                    VkMemoryPropertyFlags properties, VkDeviceMemory *imageMemory) const;
+	                    VkMemoryPropertyFlags properties, VkDeviceMemory *imageMemory, uint32_t mipLevels = 1) const;
 
   /**
-   * @brief Create a texture image
+   * @brief Create a texture and wait for it to be uploaded
    *
    * @param fileName The name of the file
-   * @return The texture image index
-   */
-  int CreateTextureImage(std::string fileName);
-
-  /**
-   * @brief Create a texture image view
-   *
-   * @param image The image
-   * @return The texture image view
+   * @return The texture handle
    */
   int CreateTexture(std::string fileName);
 
   /**
    * @brief Create a texture sampler
    *
+   * @param textureImage The image view to write, or VK_NULL_HANDLE to only reserve the set
    * @return Descriptor set index
    */
   int CreateTextureDescriptor(VkImageView textureImage);
 
+  /**
+   * @brief Point a texture descriptor to an image view
+   *
+   * @param descriptorSet The descriptor set to update. Must not be in use by the GPU, unless it is update after bind
+   * @param textureImage The image view to bind
+   * @param arrayElement The slot to write, for the bindless array
+   */
+  void WriteTextureDescriptor(VkDescriptorSet descriptorSet, VkImageView textureImage, uint32_t arrayElement = 0);
+
+  /**
+   * @brief Point the descriptor of a texture handle to an image view, in its own set or in its bindless slot
+   *
+   * @param descriptorIndex The descriptor set index, or the bindless slot
+   * @param textureImage The image view to bind
+   */
+  void WriteTextureSlot(int descriptorIndex, VkImageView textureImage);
+
+  /**
+   * @brief Decode a texture file into staging memory and hand it to the upload batcher
+   * @details Runs on a texture worker thread
+   *
+   * @param handle The texture handle reserved by CreateTextureAsync
+   * @param fileName The name of the file
+   * @param usage What the texture holds
+   * @param fileData The file already read for hashing, or empty to read it here
+   * @param bStreamIn Reload of an evicted texture: only the full image, the low resolution copy is still there
+   */
+  void DecodeTexture(TextureHandle handle, std::string fileName, textureUsage_e usage, std::vector<char> fileData,
+                     bool bStreamIn = false);
+
+  /**
+   * @brief Find a live texture whose file holds the same bytes, compared in full after a hash match
+   *
+   * @param fileName The requested file, relative to the textures folder
+   * @param fileSize Its size, only textures of this size are compared
+   * @param outFileData The bytes of the requested file when it had to be read, for the worker to decode
+   * @return The texture, -1 if none matches
+   */
+  TextureHandle FindTextureByContent(const std::string &fileName, uintmax_t fileSize, std::vector<char> *outFileData);
+
+  /** @brief Remove the cache keys pointing to a texture, so the next request loads the file again */
+  void ForgetCachedTexture(TextureHandle handle);
+
+  /** @brief Destroy a texture once the frames in flight are done with it, and recycle its handle */
+  void DestroyTexture(TextureHandle handle);
+
+  /** @brief Add a texture uploaded for the first time to the format counters */
+  void CountTextureFormat(const textureMipChain_t &chain);
+
+  /** @brief Create a staging buffer of its own for an upload too big for the staging ring, and map it */
+  void CreateDedicatedStaging(VkDeviceSize size, textureDecode_t *outTexture);
+
+  /**
+   * @brief Retire finished upload batches and submit in one batch the textures decoded since the last call,
+   *        plus the next mip levels of the textures being streamed in
+   */
+  void ProcessTextureUploads();
+
+  /**
+   * @brief Stage the next mip level of the textures drawn lately, up to TEXTURE_MIP_UPLOAD_BUDGET bytes
+   * @param batch The batch to add the levels to
+   */
+  void QueueTextureMipUploads(textureUploadBatch_t *batch);
+
+  /**
+   * @brief Stream back the evicted textures drawn last frame, then evict the least recently drawn ones down to the budget
+   * @details Called once per frame, after the wait on the frame fence. The budget is queried every
+   *          TEXTURE_BUDGET_QUERY_FRAMES frames, or every frame once the textures come close to it
+   */
+  void UpdateTextureResidency();
+
+  /** @brief Load the full image of an evicted texture again, on a worker */
+  void StreamInTexture(TextureHandle handle);
+
+  /** @brief Drop the full image of a texture, draws use the low resolution copy until it is streamed back in */
+  void EvictTexture(TextureHandle handle);
+
+  /** @brief Get the budget to evict down to: the configured one, capped by the heap budget of VK_EXT_memory_budget */
+  [[nodiscard]] VkDeviceSize GetEffectiveTextureBudget() const;
+
 	// ++++++++++++++++++++++++++++++++++++++++++++++++ Load Functions ++++++++++++++++++++++++++++++++++++++++++++++++++
 
+  /**
+   * @brief Load the mip chain of a texture, from its cooked mip file when it is up to date
+   * @details Otherwise decodes the file, builds the mips and cooks them if TEXTURE_COOK_ON_LOAD is set.
+   *          Cooked with the channels of the file, then expanded to a format the device supports
+   *
+   * @param fileName The name of the file, relative to the textures folder
+   * @param usage What the texture holds, colour is stored as sRGB when the swap chain is
+   * @param fileData The file already read for hashing, or empty to read it if needed
+   * @param outChain The mip chain
+   */
+  void LoadTextureMips(const std::string &fileName, textureUsage_e usage, const std::vector<char> &fileData,
+                       textureMipChain_t *outChain);
+
+  /** @brief Checks if a texture holds colours, from its usage or else from the suffix of its file name */
+  [[nodiscard]] static bool IsColorTexture(const std::string &fileName, textureUsage_e usage);
+
   /**
    * @brief Load a texture file
    *
    * @param fileName The name of the file
    * @param width The width of the image
    * @param height The height of the image
+   * @param channels The channels of the file: 1 for grey, 2 for grey plus alpha, 3 for RGB, 4 for RGBA
    * @param imageSize The size of the image
    * @return The image data
    */
-  stbi_uc* LoadTextureFile(std::string fileName, int *width, int *height, VkDeviceSize *imageSize);
+  stbi_uc* LoadTextureFile(std::string fileName, int *width, int *height, int *channels, VkDeviceSize *imageSize);
+
+  /**
+   * @brief Decode a texture file already in memory
+   *
+   * @param fileName The name of the file, for error messages
+   * @param fileData The bytes of the file
+   * @param width The width of the image
+   * @param height The height of the image
+   * @param channels The channels of the file: 1 for grey, 2 for grey plus alpha, 3 for RGB, 4 for RGBA
+   * @param imageSize The size of the image
+   * @return The image data
+   */
+  stbi_uc* LoadTextureMemory(const std::string &fileName, const std::vector<char> &fileData,
+                             int *width, int *height, int *channels, VkDeviceSize *imageSize);
 };
 
 
@@ -474,7 +1039,18 @@ FORCE_INLINE void
 VulkanRenderer::FramebufferResizeCallback(GLFWwindow* window, int width, int height)
 {
 	auto app = reinterpret_cast<VulkanRenderer*>(glfwGetWindowUserPointer(window));
-	app->m_framebufferResized = true;
+	app->m_framebufferSize.store(static_cast<uint64_t>(width) << 32 | static_cast<uint32_t>(height), std::memory_order_relaxed);
+	app->m_lastResizeNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+	app->m_bFramebufferResized.store(true, std::memory_order_release);
+}
+
+FORCE_INLINE void
+VulkanRenderer::GetFramebufferSize(int *outWidth, int *outHeight) const
+{
+	const uint64_t size = m_framebufferSize.load(std::memory_order_relaxed);
+	*outWidth  = static_cast<int>(size >> 32);
+	*outHeight = static_cast<int>(size & 0xFFFFFFFF);
 }
 
 FORCE_INLINE void
@@ -485,4 +1061,95 @@ VulkanRenderer::UpdateModel(uint32_t modelID, glm::mat4 newModel)
 	m_meshList[modelID].SetModel(newModel);
 }
 
+FORCE_INLINE uint32_t
+VulkanRenderer::GetMeshCount() const
+{
+	return static_cast<uint32_t>(m_meshList.size());
+}
+
+FORCE_INLINE const std::deque<gpuFrameTiming_t> &
+VulkanRenderer::GetGpuFrameTimings() const
+{
+	return m_gpuProfiler.GetHistory();
+}
+
+FORCE_INLINE bool
+VulkanRenderer::IsTextureReady(TextureHandle handle) const
+{
+	if (handle < 0 || handle >= static_cast<TextureHandle>(m_textureStates.size())) return false;
+
+	return m_textureStates[handle] == TEXTURE_STATE_READY;
+}
+
+FORCE_INLINE void
+VulkanRenderer::SetTextureMemoryBudget(VkDeviceSize budget)
+{
+	// Applied by the next residency update
+	m_textureMemoryBudget = budget;
+	m_textureBudgetFrame  = 0;
+}
+
+FORCE_INLINE textureFormatStats_t
+VulkanRenderer::GetTextureFormatStats() const
+{
+	return m_textureFormatStats;
+}
+
+FORCE_INLINE bool
+VulkanRenderer::SupportsPresentWait() const
+{
+	return m_bPresentWait;
+}
+
+FORCE_INLINE void
+VulkanRenderer::SetPresentMode(VkPresentModeKHR presentMode)
+{
+	m_requestedPresentMode.store(presentMode, std::memory_order_relaxed);
+	m_bSwapchainSettingsChanged.store(true, std::memory_order_release);
+}
+
+FORCE_INLINE void
+VulkanRenderer::SetSwapchainImageCount(uint32_t imageCount)
+{
+	m_requestedImageCount.store(imageCount, std::memory_order_relaxed);
+	m_bSwapchainSettingsChanged.store(true, std::memory_order_release);
+}
+
+FORCE_INLINE void
+VulkanRenderer::SetFramesInFlight(uint32_t framesInFlight)
+{
+	m_requestedFramesInFlight.store(framesInFlight, std::memory_order_relaxed);
+	m_bFramesInFlightChanged.store(true, std::memory_order_release);
+}
+
+FORCE_INLINE uint32_t
+VulkanRenderer::GetFramesInFlight() const
+{
+	return m_framesInFlight.load(std::memory_order_relaxed);
+}
+
+FORCE_INLINE void
+VulkanRenderer::SetOverlayVisible(bool bVisible)
+{
+	m_overlay.SetVisible(bVisible);
+}
+
+FORCE_INLINE bool
+VulkanRenderer::IsOverlayVisible() const
+{
+	return m_overlay.IsVisible();
+}
+
+FORCE_INLINE VkPresentModeKHR
+VulkanRenderer::GetPresentMode() const
+{
+	return m_presentMode.load(std::memory_order_relaxed);
+}
+
+FORCE_INLINE const presentStats_t &
+VulkanRenderer::GetPresentStats() const
+{
+	return m_presentStats;
+}
+
 #endif //VULKANRENDERER_H
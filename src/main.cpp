@@ -1,12 +1,18 @@
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <thread>
 
-#define STB_IMAGE_IMPLEMENTATION
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "CpuProfiler.h"
+#include "FramePacer.h"
+#include "FrameSnapshot.h"
+#include "TripleBuffer.hpp"
 #include "VulkanRenderer.h"
 
 
@@ -14,6 +20,15 @@
 GLFWwindow *window;
 VulkanRenderer vulkanRenderer;
 
+/** @brief Latest simulation state, from the main thread to the render thread */
+TripleBuffer<frameSnapshot_t> snapshots;
+
+/** @brief Cleared by the main thread to stop the render thread, or by the render thread when a frame fails */
+std::atomic<bool> bRunning { true };
+
+/** @brief Frames per second of the render thread, shown in the title by the main thread */
+std::atomic<double> renderFps { 0.0 };
+
 // Prev position
 int prevX = 0; int prevY = 0;
 
@@ -34,59 +49,388 @@ InitWindow(const std::string &wName = "Vulkan Window", const int width = 800, co
 	glfwSetFramebufferSizeCallback(window, VulkanRenderer::FramebufferResizeCallback);
 }
 
+/** @brief Pack and cook an atlas without opening a window: --cook-atlas <name> <textures...> */
+int
+CookAtlas(int argc, char *argv[])
+{
+	if (argc < 4)
+	{
+		fprintf(stderr, "[ERROR] Usage: %s --cook-atlas <name> <textures...>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const std::vector<std::string> fileNames(argv + 3, argv + argc);
+
+	TextureAtlas atlas;
+	if (!atlas.Build(argv[2], fileNames)) return EXIT_FAILURE;
+
+	atlas.PrintStats(argv[2]);
+	return EXIT_SUCCESS;
+}
+
+/** @brief Read a size written as <width>x<height>, both above 0 */
+bool
+ParseSize(const char *value, uint32_t *outWidth, uint32_t *outHeight)
+{
+	return std::sscanf(value, "%ux%u", outWidth, outHeight) == 2 && *outWidth > 0 && *outHeight > 0;
+}
+
+/** @brief Seconds since a time point, on the clock shared by both threads */
+double
+SecondsSince(std::chrono::steady_clock::time_point epoch)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+/** @brief Add the two textured quads WriteSnapshot moves to the renderer. False if an upload failed */
+bool
+CreateScene()
+{
+	std::vector<vertex_t> meshVertices =
+	{
+		//   X  ,  Y  , Z   |    R   , G    , B     |    U   , V
+		{ { -0.4,  0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 1.0f, 1.0f } },
+		{ { -0.4, -0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 1.0f, 0.0f } },
+		{ {  0.4, -0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 0.0f, 0.0f } },
+		{ {  0.4,  0.4, 0.0 }, { 1.0f, 0.33f, 0.33f }, { 0.0f, 1.0f } },
+	};
+
+	std::vector<vertex_t> meshVertices2 =
+	{
+		{ { -0.60,  0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 1.0f, 1.0f } },
+		{ { -0.60, -0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 1.0f, 0.0f } },
+		{ {  0.60, -0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 0.0f, 0.0f } },
+		{ {  0.60,  0.6, 0.0 }, { 0.55f, 0.91f, 0.99f }, { 0.0f, 1.0f } },
+	};
+
+	// Index Data
+	std::vector<uint32_t> meshIndices =
+	{
+		0, 1, 2,
+		2, 3, 0
+	};
+
+	try
+	{
+		const TextureHandle texID = vulkanRenderer.CreateTextureAsync("zschzen.jpg");
+		vulkanRenderer.AddMesh(std::move(meshVertices), meshIndices, texID);
+		vulkanRenderer.AddMesh(std::move(meshVertices2), std::move(meshIndices), texID);
+	}
+	catch (const std::runtime_error &e)
+	{
+		fprintf(stderr, "[ERROR] %s\n", e.what());
+		return false;
+	}
+	return true;
+}
+
+/** @brief Write the transforms of the scene at a rotation angle into a snapshot */
+void
+WriteSnapshot(float angle, frameSnapshot_t *outSnapshot)
+{
+	outSnapshot->models.resize(2);
+
+	outSnapshot->models[0] =
+	{
+		.position = glm::vec3(0.0f, 0.0f, -2.5f),
+		.rotation = glm::angleAxis(glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f)),
+		.scale    = glm::vec3(1.0f)
+	};
+
+	outSnapshot->models[1] =
+	{
+		.position = glm::vec3(0.0f, 0.0f, -3.0f),
+		.rotation = glm::angleAxis(glm::radians(-angle * 5), glm::vec3(0.0f, 0.0f, 1.0f)),
+		.scale    = glm::vec3(1.25f)
+	};
+}
+
+/**
+ * @brief Draw the latest snapshots until stopped. Owns VulkanRenderer::Draw
+ * @details Draws one tick in the past, between the last two snapshots, so the motion stays smooth whatever the
+ *          tick and frame rates are
+ *
+ * @param epoch Start of the simulated time
+ * @param outDrawMs Total time spent drawing
+ * @param outMaxDrawMs Longest frame spent drawing
+ * @param outFrames Number of frames drawn
+ */
+void
+RenderLoop(std::chrono::steady_clock::time_point epoch, double *outDrawMs, double *outMaxDrawMs, uint64_t *outFrames)
+{
+	PROFILE_THREAD("Render");
+
+	// Frames start on absolute deadlines, and wait for the display when the driver can tell
+	FramePacer framePacer;
+	framePacer.SetTargetFrameRate(FRAME_PACER_TARGET_FPS);
+	if (vulkanRenderer.SupportsPresentWait())
+	{
+		framePacer.SetPresentWait([](uint64_t timeoutNs) -> bool
+		{
+			return vulkanRenderer.WaitForPresent(timeoutNs);
+		});
+	}
+
+	frameSnapshot_t previous, current;
+	while (bRunning.load(std::memory_order_acquire))
+	{
+		PROFILE_SCOPE("Frame");
+
+		double deltaTime;
+		{
+			PROFILE_SCOPE("Pace frame");
+			deltaTime = framePacer.WaitForNextFrame();
+		}
+		if (deltaTime > 0.0) renderFps.store(1.0 / deltaTime, std::memory_order_relaxed);
+
+		// Swapping keeps the capacity of both, copying the new one then allocates nothing
+		if (snapshots.Acquire())
+		{
+			std::swap(previous, current);
+			current = snapshots.GetReadBuffer();
+		}
+
+		// ------------------------------------------- Interpolate -------------------------------------------
+		const double renderTime = SecondsSince(epoch) - 1.0 / SIMULATION_TICK_RATE;
+		const double span       = current.time - previous.time;
+		const float  alpha      = span > 0.0 ? glm::clamp(static_cast<float>((renderTime - previous.time) / span), 0.0f, 1.0f) : 1.0f;
+
+		for (size_t i = 0; i < current.models.size(); ++i)
+		{
+			const transform_t transform = i < previous.models.size()
+			                            ? InterpolateTransform(previous.models[i], current.models[i], alpha) : current.models[i];
+			vulkanRenderer.UpdateModel(static_cast<uint32_t>(i), GetTransformMatrix(transform));
+		}
+
+		// ------------------------------------------- Render -------------------------------------------
+		const auto drawStart = std::chrono::steady_clock::now();
+		try
+		{
+			vulkanRenderer.Draw();
+		}
+		catch (const std::runtime_error &e)
+		{
+			fprintf(stderr, "[ERROR] %s\n", e.what());
+			bRunning.store(false, std::memory_order_release);
+		}
+
+		const double drawMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - drawStart).count();
+		*outDrawMs   += drawMs;
+		*outMaxDrawMs = std::max(*outMaxDrawMs, drawMs);
+		++*outFrames;
+	}
+
+	framePacer.PrintStats();
+}
+
+/**
+ * @brief Draw a number of frames as fast as the device goes, without a window, and print the throughput
+ * @details The scene turns by a fixed step per frame, the same frame number always gives the same image
+ *
+ * @param width Width of the offscreen images
+ * @param height Height of the offscreen images
+ * @param frameCount Number of frames to draw
+ * @param capturePath PPM file the last frame is written to, empty for none
+ */
+int
+RunHeadless(uint32_t width, uint32_t height, uint64_t frameCount, const std::string &capturePath)
+{
+	int initResult;
+	{
+		PROFILE_SCOPE("Init");
+		initResult = vulkanRenderer.InitHeadless(width, height);
+	}
+	if (initResult != EXIT_SUCCESS) return EXIT_FAILURE;
+
+	if (!CreateScene())
+	{
+		vulkanRenderer.Cleanup();
+		return EXIT_FAILURE;
+	}
+
+	// Every frame draws the textures at full resolution, none is still loading
+	vulkanRenderer.WaitForTextures();
+
+	frameSnapshot_t snapshot;
+	double   maxDrawMs = 0.0;
+	uint64_t frames    = 0;
+	const auto start = std::chrono::steady_clock::now();
+	for (; frames < frameCount; ++frames)
+	{
+		PROFILE_SCOPE("Frame");
+
+		// One simulation tick per frame
+		WriteSnapshot(static_cast<float>(std::fmod(45.0 * static_cast<double>(frames) / SIMULATION_TICK_RATE, 360.0)), &snapshot);
+		for (size_t i = 0; i < snapshot.models.size(); ++i)
+		{
+			vulkanRenderer.UpdateModel(static_cast<uint32_t>(i), GetTransformMatrix(snapshot.models[i]));
+		}
+
+		const auto drawStart = std::chrono::steady_clock::now();
+		try
+		{
+			vulkanRenderer.Draw();
+		}
+		catch (const std::runtime_error &e)
+		{
+			fprintf(stderr, "[ERROR] %s\n", e.what());
+			break;
+		}
+		maxDrawMs = std::max(maxDrawMs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - drawStart).count());
+	}
+
+	const bool   bCaptured = capturePath.empty() || vulkanRenderer.SaveFrame(capturePath);
+	const double totalMs   = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	fprintf(stdout, "[INFO] Headless: %llu frames of %ux%u in %.1f ms, %.3f ms per frame, %.3f ms max, %.1f frames per second\n",
+			static_cast<unsigned long long>(frames), width, height, totalMs, frames ? totalMs / static_cast<double>(frames) : 0.0,
+			maxDrawMs, totalMs > 0.0 ? static_cast<double>(frames) * 1000.0 / totalMs : 0.0);
+
+	vulkanRenderer.Cleanup();
+	return frames == frameCount && bCaptured ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int
-main()
+main(int argc, char *argv[])
 {
+	if (argc > 1 && std::string(argv[1]) == "--cook-atlas") return CookAtlas(argc, argv);
+
+	// Options, each followed by its value
+	//   --resize-stress <seconds>      Resize the window in bursts for a number of seconds, then quit
+	//   --present-mode <mode>          immediate, mailbox, fifo or fifo_relaxed
+	//   --swapchain-images <count>     0 is one more than the surface minimum
+	//   --frames-in-flight <count>     1 to MAX_FRAME_DRAWS
+	//   --cpu-profile <file>           Chrome trace of the CPU scopes, "none" to not record them
+	//   --headless <width>x<height>    Draw offscreen without a window, then quit
+	//   --frames <count>               Frames drawn headless
+	//   --capture <file.ppm>           Write the last frame drawn headless
+	double      resizeStress   = 0.0;
+	std::string cpuProfilePath = CPU_PROFILER_TRACE_FILE;
+	bool        bHeadless      = false;
+	uint32_t    headlessWidth  = 0;
+	uint32_t    headlessHeight = 0;
+	uint64_t    headlessFrames = HEADLESS_FRAME_COUNT;
+	std::string capturePath    = "";
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string option = argv[i];
+		const char       *value  = argv[i + 1];
+
+		VkPresentModeKHR presentMode;
+		if (option == "--resize-stress") resizeStress = std::atof(value);
+		else if (option == "--cpu-profile") cpuProfilePath = value;
+		else if (option == "--headless" && ParseSize(value, &headlessWidth, &headlessHeight)) bHeadless = true;
+		else if (option == "--frames") headlessFrames = std::strtoull(value, nullptr, 10);
+		else if (option == "--capture") capturePath = value;
+		else if (option == "--swapchain-images") vulkanRenderer.SetSwapchainImageCount(static_cast<uint32_t>(std::atoi(value)));
+		else if (option == "--frames-in-flight") vulkanRenderer.SetFramesInFlight(static_cast<uint32_t>(std::atoi(value)));
+		else if (option == "--present-mode" && VulkanRenderer::ParsePresentMode(value, &presentMode)) vulkanRenderer.SetPresentMode(presentMode);
+		else
+		{
+			fprintf(stderr, "[ERROR] Unknown option '%s %s'\n", option.c_str(), value);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Scopes are recorded from the start, init included
+	PROFILE_THREAD("Main");
+	if (!cpuProfilePath.empty() && cpuProfilePath != "none") CpuProfiler::Start(cpuProfilePath);
+
+	// No GLFW at all, runs where there is no display
+	if (bHeadless)
+	{
+		const int result = RunHeadless(headlessWidth, headlessHeight, headlessFrames, capturePath);
+		CpuProfiler::Stop();
+		return result;
+	}
+
 	// Window setup
 	InitWindow("Vulkan Window", 800, 600);
 
 	// Try to create Vulkan Instance
-	if (vulkanRenderer.Init(window) != EXIT_SUCCESS) return EXIT_FAILURE;
+	int initResult;
+	{
+		PROFILE_SCOPE("Init");
+		initResult = vulkanRenderer.Init(window);
+	}
+	if (initResult != EXIT_SUCCESS)
+	{
+		CpuProfiler::Stop();
+		return EXIT_FAILURE;
+	}
 
-	// Main loop
+	// Before the render thread starts, it owns the scene from then on
+	if (!CreateScene())
 	{
+		vulkanRenderer.Cleanup();
+		glfwDestroyWindow(window);
+		glfwTerminate();
+		CpuProfiler::Stop();
+		return EXIT_FAILURE;
+	}
+
+	// Main loop: events and simulation here, drawing on the render thread
+	{
+		const auto epoch = std::chrono::steady_clock::now();
+
+		// The render thread starts with the scene at rest
+		WriteSnapshot(0.0f, &snapshots.GetWriteBuffer());
+		snapshots.Publish();
+
+		double   drawMs    = 0.0;
+		double   maxDrawMs = 0.0;
+		uint64_t frames    = 0;
+		std::thread renderThread(RenderLoop, epoch, &drawMs, &maxDrawMs, &frames);
+
 		// model
 		float angle = 0.0f;
 
-		// Time
-		int maxFPS = 60;
-		double deltaTime = 0.0f;
-		double lastTime = 0.0f;
-		double currentTime = 0.0f;
-		double desiredFrameTime = 1.0f / maxFPS;
+		// Time, in fixed ticks
+		const double tickTime      = 1.0 / SIMULATION_TICK_RATE;
+		double       simulatedTime = 0.0;
+		uint64_t     tick          = 0;
+		double       simulateMs    = 0.0;
+		double       titleTime     = 0.0;
+
+		// Wake up once per tick, events are polled as often
+		FramePacer tickPacer;
+		tickPacer.SetTargetFrameRate(SIMULATION_TICK_RATE);
 
-		bool isRunning = true;
-		while (isRunning && !glfwWindowShouldClose(window))
+		// P cycles the present modes, F the frames in flight and O shows the overlay, on the press only
+		bool bPresentModeKeyDown    = false;
+		bool bFramesInFlightKeyDown = false;
+		bool bOverlayKeyDown        = false;
+
+		while (bRunning.load(std::memory_order_acquire) && !glfwWindowShouldClose(window))
 		{
-			// ------------------------------------------- Time -------------------------------------------
-			currentTime = glfwGetTime();
-			deltaTime = currentTime - lastTime;
+			PROFILE_SCOPE("Main loop");
 
-			// Limit FPS
-			if (deltaTime < desiredFrameTime)
+			// ------------------------------------------- Time -------------------------------------------
 			{
-				int sleepTime = static_cast<int>((desiredFrameTime - deltaTime) * 1000);
-				if (sleepTime > 0)
-				{
-					std::this_thread::sleep_for(std::chrono::milliseconds(sleepTime));
-				}
+				PROFILE_SCOPE("Pace tick");
+				tickPacer.WaitForNextFrame();
 			}
 
-			// Update the previous frame time
-			lastTime = currentTime;
-
-			// update glfw title
+			// update glfw title, GLFW windows can only be changed from the main thread
+			const double now = SecondsSince(epoch);
+			if (now - titleTime >= 0.5)
 			{
-				std::string fps = std::format("{:.2f}", 1.0 / deltaTime);
-				glfwSetWindowTitle(window, ("Vulkan Window - FPS: " + fps).c_str());
+				titleTime = now;
+
+				std::string fps = std::format("{:.2f}", renderFps.load(std::memory_order_relaxed));
+				glfwSetWindowTitle(window, ("Vulkan Window - FPS: " + fps + " - " +
+				                            VulkanRenderer::GetPresentModeName(vulkanRenderer.GetPresentMode()) + ", " +
+				                            std::to_string(vulkanRenderer.GetFramesInFlight()) + " frames in flight").c_str());
 			}
 
 			// ------------------------------------------- Input -------------------------------------------
-			glfwPollEvents();
+			{
+				PROFILE_SCOPE("Poll events");
+				glfwPollEvents();
+			}
 
 			if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 			{
-				isRunning = false;
 				glfwSetWindowShouldClose(window, GLFW_TRUE);
 			}
 
@@ -114,33 +458,82 @@ main()
 				}
 			}
 
+			const bool bPresentModeKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+			if (bPresentModeKey && !bPresentModeKeyDown)
+			{
+				constexpr VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+				                                              VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR };
 
-			// ------------------------------------------- Update -------------------------------------------
+				const auto current = std::ranges::find(presentModes, vulkanRenderer.GetPresentMode());
+				const auto next    = current == std::end(presentModes) || current + 1 == std::end(presentModes) ? presentModes : current + 1;
+				vulkanRenderer.SetPresentMode(*next);
+			}
+			bPresentModeKeyDown = bPresentModeKey;
 
-			// Rotate model based on deltaTime
-			angle += std::fmod(45.0f * static_cast<float>(deltaTime), 360.0F);
+			const bool bFramesInFlightKey = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+			if (bFramesInFlightKey && !bFramesInFlightKeyDown)
+			{
+				vulkanRenderer.SetFramesInFlight(vulkanRenderer.GetFramesInFlight() % MAX_FRAME_DRAWS + 1);
+			}
+			bFramesInFlightKeyDown = bFramesInFlightKey;
 
-			glm::mat4 firstModel(1.0f);
-			glm::mat4 secondModel(1.0f);
+			const bool bOverlayKey = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+			if (bOverlayKey && !bOverlayKeyDown) vulkanRenderer.SetOverlayVisible(!vulkanRenderer.IsOverlayVisible());
+			bOverlayKeyDown = bOverlayKey;
 
-			firstModel = glm::translate(firstModel, glm::vec3(0.0f, 0.0f, -2.5f));
-			firstModel = glm::rotate(firstModel, glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+			// A new size every tick for a quarter of a second, then a pause: both the bursts and the settling are timed
+			if (resizeStress > 0.0)
+			{
+				if (now >= resizeStress) glfwSetWindowShouldClose(window, GLFW_TRUE);
+				else if (std::fmod(now, 0.5) < 0.25)
+				{
+					const double wave = std::sin(now * 20.0);
+					glfwSetWindowSize(window, 800 + static_cast<int>(200.0 * wave), 600 + static_cast<int>(150.0 * wave));
+				}
+			}
 
-			secondModel = glm::translate(secondModel, glm::vec3(0.0f, 0.0f, -3.0f));
-			secondModel = glm::rotate(secondModel, glm::radians(-angle * 5), glm::vec3(0.0f, 0.0f, 1.0f));
-      secondModel = glm::scale(secondModel, glm::vec3(1.25f));
 
-			vulkanRenderer.UpdateModel(0, firstModel);
-			vulkanRenderer.UpdateModel(1, secondModel);
+			// ------------------------------------------- Update -------------------------------------------
 
-			// ------------------------------------------- Render -------------------------------------------
-			vulkanRenderer.Draw();
+			// Catch up with the clock in fixed steps, give up on the time lost in a long stall
+			PROFILE_SCOPE("Simulate");
+			const auto simulateStart = std::chrono::steady_clock::now();
+			uint32_t   ticks         = 0;
+			while (simulatedTime + tickTime <= now && ticks < SIMULATION_MAX_CATCH_UP_TICKS)
+			{
+				// Rotate model by a fixed step
+				angle = std::fmod(angle + 45.0f * static_cast<float>(tickTime), 360.0F);
+
+				simulatedTime += tickTime;
+				++tick;
+				++ticks;
+			}
+			if (ticks == SIMULATION_MAX_CATCH_UP_TICKS) simulatedTime = std::max(simulatedTime, now - tickTime);
+			if (ticks == 0) continue;
+
+			// ------------------------------------------- Publish -------------------------------------------
+			frameSnapshot_t &snapshot = snapshots.GetWriteBuffer();
+			snapshot.tick = tick;
+			snapshot.time = simulatedTime;
+			WriteSnapshot(angle, &snapshot);
+			snapshots.Publish();
+
+			simulateMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - simulateStart).count();
 		}
+
+		bRunning.store(false, std::memory_order_release);
+		renderThread.join();
+
+		fprintf(stdout, "[INFO] Simulation: %llu ticks, %.3f ms per tick. Render: %llu frames, %.3f ms per frame, %.3f ms max\n",
+				static_cast<unsigned long long>(tick), tick ? simulateMs / static_cast<double>(tick) : 0.0,
+				static_cast<unsigned long long>(frames), frames ? drawMs / static_cast<double>(frames) : 0.0, maxDrawMs);
 	}
 
 	// Clean up
 	vulkanRenderer.Cleanup();
 	glfwDestroyWindow(window);
 	glfwTerminate();
+
+	CpuProfiler::Stop();
 	return 0;
 }